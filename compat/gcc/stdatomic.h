@@ -11,6 +11,8 @@
 #define GCCVER_STDATOMIC_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #if !defined(__cplusplus)
 
@@ -18,10 +20,15 @@ typedef int atomic_int;
 typedef unsigned int atomic_uint;
 typedef unsigned long atomic_ulong;
 typedef bool atomic_bool;
+typedef size_t atomic_size_t;
+typedef uintptr_t atomic_uintptr_t;
+typedef uint_fast64_t atomic_uint_fast64_t;
 
 #define memory_order_relaxed __ATOMIC_RELAXED
 #define memory_order_acquire __ATOMIC_ACQUIRE
 #define memory_order_release __ATOMIC_RELEASE
+#define memory_order_acq_rel __ATOMIC_ACQ_REL
+#define memory_order_seq_cst __ATOMIC_SEQ_CST
 
 #define atomic_init(p_a, v)           __atomic_store_n(p_a, v, memory_order_relaxed)
 #define atomic_store(p_a, v)          __atomic_store_n(p_a, v, __ATOMIC_SEQ_CST)
@@ -33,6 +40,12 @@ typedef bool atomic_bool;
 #define atomic_fetch_sub(p_a, dec)    __atomic_fetch_sub(p_a, dec, __ATOMIC_SEQ_CST)
 #define atomic_fetch_sub_explicit(p_a, dec, mo) __atomic_fetch_sub(p_a, dec, mo)
 #define atomic_compare_exchange_weak(object, expected, desired) __atomic_compare_exchange_n(object, expected, desired, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define atomic_compare_exchange_strong(object, expected, desired) __atomic_compare_exchange_n(object, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define atomic_compare_exchange_weak_explicit(object, expected, desired, succ, fail) __atomic_compare_exchange_n(object, expected, desired, true, succ, fail)
+#define atomic_compare_exchange_strong_explicit(object, expected, desired, succ, fail) __atomic_compare_exchange_n(object, expected, desired, false, succ, fail)
+#define atomic_exchange(p_a, v)       __atomic_exchange_n(p_a, v, __ATOMIC_SEQ_CST)
+#define atomic_exchange_explicit(p_a, v, mo) __atomic_exchange_n(p_a, v, mo)
+#define atomic_thread_fence(mo)       __atomic_thread_fence(mo)
 
 #endif /* !defined(__cplusplus) */
 
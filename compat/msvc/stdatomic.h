@@ -30,16 +30,27 @@ typedef volatile ULONG  __declspec(align(32)) atomic_int;
 typedef volatile ULONG __declspec(align(32)) atomic_uint;
 typedef volatile ULONG __declspec(align(32)) atomic_ulong;
 typedef volatile USHORT _declspec(align(16)) atomic_uint_fast16_t;
+typedef volatile SIZE_T __declspec(align(32)) atomic_size_t;
+typedef volatile ULONG_PTR __declspec(align(32)) atomic_uintptr_t;
+typedef volatile ULONG64 __declspec(align(32)) atomic_uint_fast64_t;
 
 typedef enum {
     memory_order_relaxed,
     memory_order_acquire,
-    memory_order_release
+    memory_order_release,
+    memory_order_acq_rel,
+    memory_order_seq_cst
 } msvc_atomic_memory_order;
 
+/* 64 bit types (atomic_size_t on win64) need the 64 bit calls, the value is
+ * widened to LONG64 either way so 32 bit types convert back unchanged */
 #define atomic_init(p_a, v)           atomic_store(p_a, v)
-#define atomic_store(p_a, v)          InterlockedExchange((LONG*)p_a, v)
-#define atomic_load(p_a)              InterlockedCompareExchange((LONG*)p_a, 0, 0)
+#define atomic_store(p_a, v)          (sizeof(*(p_a)) == 8 ? \
+    InterlockedExchange64((LONG64*)(p_a), (LONG64)(v)) : \
+    (LONG64)InterlockedExchange((LONG*)(p_a), (LONG)(v)))
+#define atomic_load(p_a)              (sizeof(*(p_a)) == 8 ? \
+    InterlockedCompareExchange64((LONG64*)(p_a), 0, 0) : \
+    (LONG64)InterlockedCompareExchange((LONG*)(p_a), 0, 0))
 #define atomic_load_explicit(p_a, mo) atomic_load(p_a)
 #define atomic_store_explicit(p_a, v, mo) atomic_store(p_a, v)
 
@@ -47,10 +58,42 @@ typedef enum {
  * TODO use a special call to increment/decrement
  * using InterlockedIncrement/InterlockedDecrement
  */
-#define atomic_fetch_add(p_a, inc)    InterlockedExchangeAdd((LPLONG)p_a, inc)
-#define atomic_fetch_sub(p_a, dec)    InterlockedExchangeAdd((LPLONG)p_a, -(int)(dec))
+#define atomic_fetch_add(p_a, inc)    (sizeof(*(p_a)) == 8 ? \
+    InterlockedExchangeAdd64((LONG64*)(p_a), (LONG64)(inc)) : \
+    (LONG64)InterlockedExchangeAdd((LPLONG)(p_a), (LONG)(inc)))
+#define atomic_fetch_sub(p_a, dec)    (sizeof(*(p_a)) == 8 ? \
+    InterlockedExchangeAdd64((LONG64*)(p_a), -(LONG64)(dec)) : \
+    (LONG64)InterlockedExchangeAdd((LPLONG)(p_a), -(LONG)(dec)))
 #define atomic_fetch_add_explicit(p_a, inc, mo)   atomic_fetch_add(p_a, inc)
 #define atomic_fetch_sub_explicit(p_a, inc, mo)   atomic_fetch_sub(p_a, inc)
+#define atomic_exchange(p_a, v)                   atomic_store(p_a, v)
+#define atomic_exchange_explicit(p_a, v, mo)      atomic_store(p_a, v)
+#define atomic_thread_fence(mo)                   MemoryBarrier()
+#define atomic_compare_exchange_strong_explicit(p_a, expected, desired, succ, fail) \
+    (sizeof(*(p_a)) == 8 ? \
+    msvc_atomic_compare_exchange64((LONG64*)(p_a), (LONG64*)(expected), (LONG64)(desired)) : \
+    msvc_atomic_compare_exchange32((LONG*)(p_a), (LONG*)(expected), (LONG)(desired)))
+#define atomic_compare_exchange_strong(p_a, expected, desired) \
+    atomic_compare_exchange_strong_explicit(p_a, expected, desired, memory_order_seq_cst, memory_order_seq_cst)
+/* InterlockedCompareExchange never fails spuriously */
+#define atomic_compare_exchange_weak_explicit(p_a, expected, desired, succ, fail) \
+    atomic_compare_exchange_strong_explicit(p_a, expected, desired, succ, fail)
+static inline int msvc_atomic_compare_exchange32(volatile LONG *obj, LONG *expected, LONG desired)
+{
+    LONG old = InterlockedCompareExchange(obj, desired, *expected);
+    if (old == *expected)
+        return 1;
+    *expected = old;
+    return 0;
+}
+static inline int msvc_atomic_compare_exchange64(volatile LONG64 *obj, LONG64 *expected, LONG64 desired)
+{
+    LONG64 old = InterlockedCompareExchange64(obj, desired, *expected);
+    if (old == *expected)
+        return 1;
+    *expected = old;
+    return 0;
+}
 static inline int atomic_compare_exchange_weak(intptr_t *obj, intptr_t *expected, intptr_t desired)
 {
     intptr_t old = *expected;
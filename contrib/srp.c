@@ -61,16 +61,26 @@
 
 
 #include "srp.h"
+#include "pthread-shim.h"
 
+/* Sessions may be worked on from several threads at once (one session per
+ * thread), the shared random generator is serialized by srp_random_lock and
+ * the Montgomery constant is cached per N instead of globally. */
 static int g_initialized = 0;
 static mbedtls_entropy_context entropy_ctx;
 static mbedtls_ctr_drbg_context ctr_drbg_ctx;
-static mbedtls_mpi * RR;
+#if !defined(_WIN32) || HAVE_PTHREADS
+static pthread_mutex_t srp_random_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static pthread_mutex_t srp_random_lock;
+static INIT_ONCE srp_random_once;
+#endif
 
 typedef struct
 {
     BIGNUM     *N;
     BIGNUM     *g;
+    mbedtls_mpi RR;
 } NGConstant;
 
 struct NGHex
@@ -182,6 +192,7 @@ static NGConstant * new_ng( SRP_NGType ng_type, const char * n_hex, const char *
     ng->g = (mbedtls_mpi *) malloc(sizeof(mbedtls_mpi));
     mbedtls_mpi_init(ng->N);
     mbedtls_mpi_init(ng->g);
+    mbedtls_mpi_init(&ng->RR);
 
     if( !ng || !ng->N || !ng->g )
     {
@@ -211,6 +222,7 @@ static void delete_ng( NGConstant * ng )
    {
       mbedtls_mpi_free( ng->N );
       mbedtls_mpi_free( ng->g );
+      mbedtls_mpi_free( &ng->RR );
       free(ng->N);
       free(ng->g);
       free(ng);
@@ -572,12 +584,26 @@ static void init_random()
         128
     );
 
-    RR = (mbedtls_mpi *) malloc(sizeof(mbedtls_mpi));
-    mbedtls_mpi_init(RR);
     g_initialized = 1;
 
 }
 
+static void srp_random_lock_init(void)
+{
+#if defined(_WIN32) && !HAVE_PTHREADS
+    init_mutex_once(&srp_random_lock, &srp_random_once);
+#endif
+}
+
+static void fill_random( BIGNUM * X, size_t size )
+{
+    srp_random_lock_init();
+    pthread_mutex_lock(&srp_random_lock);
+    init_random(); /* Only happens once */
+    mbedtls_mpi_fill_random( X, size, &mbedtls_ctr_drbg_random, &ctr_drbg_ctx );
+    pthread_mutex_unlock(&srp_random_lock);
+}
+
 
 /***********************************************************************************************************
  *
@@ -609,6 +635,8 @@ void srp_session_delete(struct SRPSession *session)
 
 void srp_random_seed( const unsigned char * random_data, size_t data_length )
 {
+    srp_random_lock_init();
+    pthread_mutex_lock(&srp_random_lock);
     g_initialized = 1;
 
 
@@ -616,12 +644,24 @@ void srp_random_seed( const unsigned char * random_data, size_t data_length )
                            (const unsigned char *) random_data,
                            data_length )  != 0 )
     {
+        pthread_mutex_unlock(&srp_random_lock);
         return;
     }
+    pthread_mutex_unlock(&srp_random_lock);
 
 }
 
 
+void srp_random_bytes( unsigned char * buf, size_t len )
+{
+    srp_random_lock_init();
+    pthread_mutex_lock(&srp_random_lock);
+    init_random(); /* Only happens once */
+    mbedtls_ctr_drbg_random( &ctr_drbg_ctx, buf, len );
+    pthread_mutex_unlock(&srp_random_lock);
+}
+
+
 void srp_create_salted_verification_key( struct SRPSession *session,
                                          const char * username,
                                          const unsigned char * password, size_t len_password,
@@ -642,18 +682,14 @@ void srp_create_salted_verification_key( struct SRPSession *session,
     if( !session || !s || !v )
        goto cleanup_and_exit;
 
-    init_random(); /* Only happens once */
-
-    mbedtls_mpi_fill_random( s, 32,
-                     &mbedtls_ctr_drbg_random,
-                     &ctr_drbg_ctx );
+    fill_random( s, 32 );
 
     x = calculate_x( session->hash_alg, s, username, password, len_password );
 
     if( !x )
        goto cleanup_and_exit;
 
-    mbedtls_mpi_exp_mod(v, session->ng->g, x, session->ng->N, RR);
+    mbedtls_mpi_exp_mod(v, session->ng->g, x, session->ng->N, &session->ng->RR);
 
     *len_s   = mbedtls_mpi_size(s);
     *len_v   = mbedtls_mpi_size(v);
@@ -742,8 +778,6 @@ struct SRPVerifier *  srp_verifier_new( struct SRPSession *session,
        goto cleanup_and_exit;
     }
 
-    init_random(); /* Only happens once */
-
     ver->hash_alg = session->hash_alg;
     ver->ng       = session->ng;
 
@@ -762,24 +796,22 @@ struct SRPVerifier *  srp_verifier_new( struct SRPSession *session,
     mbedtls_mpi_mod_mpi( tmp1, A, session->ng->N );
     if ( mbedtls_mpi_cmp_int( tmp1, 0 )  != 0)
     {
-        mbedtls_mpi_fill_random( b, 32,
-                     &mbedtls_ctr_drbg_random,
-                     &ctr_drbg_ctx );
+        fill_random( b, 32 );
 
        k = H_nn(session->hash_alg, session->ng->N, session->ng->g);
 
        /* B = kv + g^b */
        mbedtls_mpi_mul_mpi( tmp1, k, v);
-       mbedtls_mpi_exp_mod( tmp2, session->ng->g, b, session->ng->N, RR );
+       mbedtls_mpi_exp_mod( tmp2, session->ng->g, b, session->ng->N, &session->ng->RR );
        mbedtls_mpi_add_mpi( tmp1, tmp1, tmp2 );
        mbedtls_mpi_mod_mpi( B, tmp1, session->ng->N );
 
        u = H_nn(session->hash_alg, A, B);
 
        /* S = (A *(v^u)) ^ b */
-       mbedtls_mpi_exp_mod(tmp1, v, u, session->ng->N, RR);
+       mbedtls_mpi_exp_mod(tmp1, v, u, session->ng->N, &session->ng->RR);
        mbedtls_mpi_mul_mpi(tmp2, A, tmp1);
-       mbedtls_mpi_exp_mod(S, tmp2, b, session->ng->N, RR);
+       mbedtls_mpi_exp_mod(S, tmp2, b, session->ng->N, &session->ng->RR);
 
        hash_num(session->hash_alg, S, ver->session_key);
 
@@ -893,8 +925,6 @@ struct SRPUser * srp_user_new( struct SRPSession *session, const char * username
     if (!usr)
        goto err_exit;
 
-    init_random(); /* Only happens once */
-
     usr->hash_alg = session->hash_alg;
     usr->ng       = session->ng;
 
@@ -1007,8 +1037,8 @@ void  srp_user_start_authentication( struct SRPUser * usr, const char ** usernam
                                      const unsigned char ** bytes_A, size_t * len_A )
 {
 
-    mbedtls_mpi_fill_random( usr->a, 32, &mbedtls_ctr_drbg_random, &ctr_drbg_ctx);
-    mbedtls_mpi_exp_mod(usr->A, usr->ng->g, usr->a, usr->ng->N, RR);
+    fill_random( usr->a, 32 );
+    mbedtls_mpi_exp_mod(usr->A, usr->ng->g, usr->a, usr->ng->N, &usr->ng->RR);
 
     *len_A   = mbedtls_mpi_size(usr->A);
     *bytes_A = malloc( *len_A );
@@ -1088,20 +1118,20 @@ void  srp_user_process_challenge( struct SRPUser * usr,
     /* SRP-6a safety check */
     if( mbedtls_mpi_cmp_int( B, 0 ) != 0 && mbedtls_mpi_cmp_int( u, 0 ) !=0 )
     {
-        mbedtls_mpi_exp_mod(v, usr->ng->g, x, usr->ng->N, RR);
+        mbedtls_mpi_exp_mod(v, usr->ng->g, x, usr->ng->N, &usr->ng->RR);
         /* S = (B - k*(g^x)) ^ (a + ux) */
         mbedtls_mpi_mul_mpi( tmp1, u, x );
         mbedtls_mpi_mod_mpi( tmp1, tmp1, usr->ng->N);
         mbedtls_mpi_add_mpi( tmp2, usr->a, tmp1);
         mbedtls_mpi_mod_mpi( tmp2, tmp2, usr->ng->N);
         /* tmp2 = (a + ux)      */
-        mbedtls_mpi_exp_mod( tmp1, usr->ng->g, x, usr->ng->N, RR);
+        mbedtls_mpi_exp_mod( tmp1, usr->ng->g, x, usr->ng->N, &usr->ng->RR);
         mbedtls_mpi_mul_mpi( tmp3, k, tmp1 );
         mbedtls_mpi_mod_mpi( tmp3, tmp3, usr->ng->N);
         /* tmp3 = k*(g^x)       */
         mbedtls_mpi_sub_mpi(tmp1, B, tmp3);
         /* tmp1 = (B - K*(g^x)) */
-        mbedtls_mpi_exp_mod( usr->S, tmp1, tmp2, usr->ng->N, RR);
+        mbedtls_mpi_exp_mod( usr->S, tmp1, tmp2, usr->ng->N, &usr->ng->RR);
 
         hash_num(usr->hash_alg, usr->S, usr->session_key);
 
@@ -117,6 +117,9 @@ typedef enum
  */
 void srp_random_seed( const unsigned char * random_data, size_t data_length );
 
+/* Fills buf with len bytes from the same generator used for the SRP secrets */
+void srp_random_bytes( unsigned char * buf, size_t len );
+
 
 /*
  * The n_hex and g_hex parameters should be 0 unless SRP_NG_CUSTOM is used for ng_type.
@@ -45,7 +45,11 @@ enum rist_profile
 enum rist_data_block_sender_flags
 {
 	RIST_DATA_FLAGS_USE_SEQ = 1,
-	RIST_DATA_FLAGS_NEED_FREE = 2
+	/* Ignored by the sender, it shares its bit with RIST_DATA_FLAGS_FLOW_BUFFER_START */
+	RIST_DATA_FLAGS_NEED_FREE = 2,
+	/* The payload from rist_sender_payload_alloc() is handed over. Kept clear of
+	 * the receiver flags so a received block can be written as is */
+	RIST_DATA_FLAGS_HAND_OVER = 1 << 8
 };
 
 enum rist_data_block_receiver_flags
@@ -27,6 +27,8 @@ extern "C" {
  *  Userlookup is assumed to have been successful if both verifier params and both
  *  salt params are set by the lookup function.
  *  libRIST will take ownership of all heap allocated data.
+ *  The function is called from libRIST's authentication worker threads, one
+ *  call at a time across all contexts, so it does not need to be thread safe.
  *
  *  @param username IN the username attempting authentication
  *  @param verifier_len OUT len in bytes of the verifier.
@@ -63,6 +65,45 @@ typedef void (*user_verifier_lookup_t)(char * username,
  **/
 RIST_API int rist_enable_eap_srp(struct rist_peer *peer, const char *username, const char *password, user_verifier_lookup_t lookup_func, void *userdata);
 
+struct rist_srp_verifier_store;
+
+/**
+ * @brief Load an SRP password file into memory
+ *
+ * Reads a file with one username:verifier:salt:3 line per user, as written by
+ * the ristsrppasswd tool, into a hash table. A thread of the store checks the
+ * file contents for changes about once a second and swaps the new table in,
+ * lookups never wait on the file.
+ *
+ * @param store OUT the verifier store.
+ * @param path IN path of the password file.
+ * @return 0 on success, -1 when the file can't be read or on any other error
+ **/
+RIST_API int rist_srp_verifier_store_create(struct rist_srp_verifier_store **store, const char *path);
+
+/**
+ * @brief Free a verifier store
+ *
+ * Only call this once every peer using the store as lookup userdata is gone.
+ *
+ * @param store IN the verifier store.
+ **/
+RIST_API void rist_srp_verifier_store_destroy(struct rist_srp_verifier_store *store);
+
+/**
+ * @brief Ready made lookup function backed by a verifier store
+ *
+ * Pass this as lookup_func with the store as userdata to rist_enable_eap_srp().
+ * @see *user_verifier_lookup_t
+ **/
+RIST_API void rist_srp_verifier_store_lookup(char *username,
+											 size_t *verifier_len, char **verifier,
+											 size_t *salt_len, char **salt,
+											 bool *use_default_2048_bit_n_modulus,
+											 char **n_modulus_ascii,
+											 char **generator_ascii,
+											 void *user_data);
+
 #ifdef __cplusplus
 }
 #endif
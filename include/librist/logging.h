@@ -102,6 +102,33 @@ RIST_API int rist_logging_set_global(struct rist_logging_settings *logging_setti
  **/
 RIST_API void rist_logging_unset_global(void);
 
+/**
+ * @brief Move log delivery off the logging threads
+ *
+ * Process wide. When queue_size is non zero messages are formatted into a
+ * bounded queue of fixed size records (longer messages are truncated) and
+ * written out by a background thread, log callbacks are then called from that
+ * thread. A full queue drops the message rather than blocking the caller.
+ * Queued messages are flushed by rist_destroy, rist_logging_set,
+ * rist_logging_unset_global and rist_logging_settings_free2.
+ *
+ * rate_limit caps the messages per second of every log call site (format
+ * string), the excess is dropped and summarized once the next second starts.
+ *
+ * @param queue_size number of queued messages (rounded up to a power of 2),
+ *        0 to go back to logging from the calling thread after a flush
+ * @param rate_limit messages per second per call site, 0 for no limit
+ * @return 0 on success, -1 on error
+ **/
+RIST_API int rist_logging_set_async(size_t queue_size, unsigned rate_limit);
+
+/**
+ * @brief Messages dropped by the asynchronous queue or the rate limit
+ *
+ * @return count since the process started
+ **/
+RIST_API uint64_t rist_logging_get_dropped(void);
+
 /**
  * @brief Free the rist_logging_settings structure memory allocation
  *
@@ -43,7 +43,12 @@ enum rist_opt
 {
 	//Set callback called when a thread is created or destroyed. This can only be set before rist_start is called.
 	//optval1 must point to a rist_thread_callback_t struct, optval2 may contain a pointer to user data, optval3 must be NULL.
-	RIST_OPT_THREAD_CALLBACK
+	RIST_OPT_THREAD_CALLBACK,
+	//Take packet arrival times from kernel receive timestamps instead of reading the clock once the protocol thread
+	//gets to the packet. This can only be set before peers are created. optval1 must point to an int holding an
+	//enum udpsocket_timestamp_mode (see udpsocket.h), optval2 and optval3 must be NULL. Sockets the kernel cannot
+	//timestamp fall back to reading the clock.
+	RIST_OPT_RECEIVE_TIMESTAMPS
 };
 
 /**
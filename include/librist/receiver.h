@@ -60,6 +60,78 @@ RIST_API int rist_receiver_nack_type_set(struct rist_ctx *ctx, enum rist_nack_ty
  */
 RIST_API int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t desired_size);
 
+enum rist_output_pacing
+{
+	/* packets are released once they spent the recovery buffer in the queue (default) */
+	RIST_OUTPUT_PACING_NONE = 0,
+	/* MPEG-TS datagrams are released following the PCR timeline of the stream */
+	RIST_OUTPUT_PACING_MPEGTS_PCR = 1,
+};
+
+/**
+ * @brief Pace the output on the PCR of the stream
+ *
+ * Releases the datagrams of an MPEG-TS flow at the rate the PCRs they carry
+ * dictate instead of the rate the sender timestamped them at, for constant
+ * bitrate output into re-multiplexers. The PCR clock is followed against ours,
+ * drift included, and the release lags the PCR timeline by jitter_ms so sender
+ * timestamp jitter up to that much does not eat into the recovery buffer. The
+ * data output thread wakes at least every jitter_ms. PCR jitter of the output
+ * is reported as the pcr_jitter percentiles of the flow stats.
+ * Can only be set before starting.
+ *
+ * @param ctx RIST receiver context
+ * @param pacing output pacing mode
+ * @param jitter_ms output jitter bound in ms, 0 for the default of 2 ms
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_receiver_output_pacing_set(struct rist_ctx *ctx, enum rist_output_pacing pacing, uint32_t jitter_ms);
+
+enum rist_latency_mode
+{
+	/* the buffer stays halfway between recovery_length_min and recovery_length_max (default) */
+	RIST_LATENCY_FIXED = 0,
+	/* the buffer follows the observed recovery times and RTT within those bounds */
+	RIST_LATENCY_ADAPTIVE = 1,
+};
+
+/**
+ * @brief Adapt the receiver buffer to the network
+ *
+ * Starts each flow halfway between the recovery_length_min and
+ * recovery_length_max of its peers like the fixed mode, then grows the buffer
+ * a quarter at a time whenever packets miss their output deadline and shrinks
+ * it by a tenth after 10 s without misses, never below 1.5 times the slowest
+ * recent recovery plus two RTTs. Changes are applied gradually, the output runs
+ * at most 2% faster or slower while the buffer moves, so no data is dropped or
+ * repeated for it. The applied and target buffer are reported as the latency
+ * and latency_target of the flow stats.
+ * Can only be set before starting.
+ *
+ * @param ctx RIST receiver context
+ * @param mode latency mode
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_receiver_latency_mode_set(struct rist_ctx *ctx, enum rist_latency_mode mode);
+
+/**
+ * @brief Start output early when joining a running stream
+ *
+ * Without it, a flow outputs its first packet once it spent the full buffer
+ * in the queue. With it, output starts start_ms after the first packet and the
+ * buffer then converges to its target, the output running at most 2% slower
+ * or faster meanwhile. Senders with rist_sender_fast_start_set() burst their
+ * recent history to a receiver joining, that history arrives ahead of time and
+ * is added to the buffer right away, so the flow starts close to its target.
+ * Retransmissions starting a flow are taken as that burst.
+ * Can only be set before starting.
+ *
+ * @param ctx RIST receiver context
+ * @param start_ms buffer of the first packets in ms, 0 to disable (default)
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_receiver_fast_start_set(struct rist_ctx *ctx, uint32_t start_ms);
+
 /**
  * @brief Reads rist data
  *
@@ -73,6 +145,23 @@ RIST_API int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t d
 RIST_DEPRECATED RIST_API int rist_receiver_data_read(struct rist_ctx *ctx, const struct rist_data_block **data_block, int timeout);
 RIST_API int rist_receiver_data_read2(struct rist_ctx *ctx, struct rist_data_block **data_block, int timeout);
 
+/**
+ * @brief Reads up to count rist data blocks
+ *
+ * Batch version of rist_receiver_data_read2, the flow with the most queued
+ * blocks is drained first, then the others. Blocks of one flow keep their
+ * order, several threads may read concurrently and each gets a distinct run
+ * of blocks. The first block read after the fifo dropped data carries
+ * RIST_DATA_FLAGS_OVERFLOW.
+ *
+ * @param ctx RIST receiver context
+ * @param[out] data_blocks array of count entries, each returned block MUST be freed via rist_receiver_data_block_free2
+ * @param count maximum number of blocks to return
+ * @param timeout How long to wait for queue data (ms) when none is queued, 0 for no wait
+ * @return number of blocks returned, -1 or -2 on error
+ */
+RIST_API int rist_receiver_data_readv(struct rist_ctx *ctx, struct rist_data_block **data_blocks, size_t count, int timeout);
+
 /**
  * @brief Data callback function
  *
@@ -118,9 +207,12 @@ RIST_API void rist_receiver_data_block_free2(struct rist_data_block **block);
  * Calling applications can provide an fd that will be written to whenever a packet
  * is ready for reading via FIFO read function (rist_receiver_data_read).
  * This allows calling applications to poll an fd (i.e.: in event loops).
- * Whenever a packet is ready for reading, a byte (with undefined value) will
+ * When packets become ready for reading, a byte (with undefined value) will
  * be written to the FD. Calling application should make no assumptions
- * whatsoever based on the number of bytes available for reading.
+ * whatsoever based on the number of bytes available for reading: writes are
+ * coalesced, after a byte was written the next one only follows once
+ * rist_receiver_data_read has drained the queue (returned 1 or 0), so
+ * applications must keep reading until then on every wake up.
  * It is highly recommended that the fd is setup to operate in non blocking mode.
  * A call with a 0 value fd disables the notify fd functionality. And must be
  * made before a calling application closes the fd.
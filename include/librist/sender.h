@@ -79,11 +79,74 @@ RIST_API int rist_sender_flow_id_get(struct rist_ctx *ctx, uint32_t *flow_id);
  */
 RIST_API int rist_sender_flow_id_set(struct rist_ctx *ctx, uint32_t flow_id);
 
+enum rist_source_clock
+{
+	/* packets written with ts_ntp 0 are timestamped when written (default) */
+	RIST_SOURCE_CLOCK_NONE = 0,
+	/* packets written with ts_ntp 0 are timestamped from the PCR of their
+	 * MPEG-TS payload, interpolated between PCRs */
+	RIST_SOURCE_CLOCK_MPEGTS_PCR = 1,
+	/* the application turns the RTP timestamps of its input into ts_ntp
+	 * values with rist_sender_source_clock_ts() */
+	RIST_SOURCE_CLOCK_RTP = 2,
+};
+
+/**
+ * @brief Recover the source clock for ts_ntp
+ *
+ * Timestamps packets with the time the source emitted them instead of the
+ * time they were written, so buffering in the producer does not show up as
+ * jitter at the receiver. The source clock is unwrapped and followed against
+ * the local clock, drift between the two included. Source clock jumps
+ * (discontinuities) restart the recovery.
+ *
+ * @param ctx RIST sender context
+ * @param source_clock which clock to recover
+ * @param clock_rate RTP clock rate in Hz for RIST_SOURCE_CLOCK_RTP, 0 for 90 kHz
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_source_clock_set(struct rist_ctx *ctx, enum rist_source_clock source_clock, uint32_t clock_rate);
+
+/**
+ * @brief ts_ntp for an RTP timestamp
+ *
+ * With RIST_SOURCE_CLOCK_RTP, call this for each packet right before writing
+ * it, from the thread writing the data, and pass the result as ts_ntp.
+ *
+ * @param ctx RIST sender context
+ * @param rtp_timestamp timestamp from the RTP header of the input packet
+ * @return ts_ntp value, 0 on error (the library then timestamps the packet)
+ */
+RIST_API uint64_t rist_sender_source_clock_ts(struct rist_ctx *ctx, uint32_t rtp_timestamp);
+
+/**
+ * @brief Burst recent history to receivers joining
+ *
+ * When a receiver connects to a listening peer (main and advanced profiles),
+ * the packets of the last burst_ms still in the retransmission buffer are sent
+ * to it as retransmissions at twice real time, its live data being held until
+ * the burst caught up. A receiver with rist_receiver_fast_start_set() starts
+ * its output from that history instead of waiting for its buffer to fill,
+ * other receivers ignore the burst.
+ * Can only be set before starting.
+ *
+ * @param ctx RIST sender context
+ * @param burst_ms history to burst in ms, 0 to disable (default)
+ * @return 0 on success, -1 on error
+ */
+RIST_API int rist_sender_fast_start_set(struct rist_ctx *ctx, uint32_t burst_ms);
+
 /**
  * @brief Write data into a librist packet.
  *
  * One sender can send write data into a librist packet.
  *
+ * With RIST_DATA_FLAGS_HAND_OVER set in flags the payload must come from
+ * rist_sender_payload_alloc(). The library then keeps that buffer as is
+ * instead of copying it and releases it once it leaves the retransmission
+ * buffer, or right away on error. A payload that did not come from this
+ * sender is copied and stays with the caller.
+ *
  * @param ctx RIST sender context
  * @param data_block pointer to the rist_data_block structure
  * the ts_ntp will be populated by the lib if a value of 0 is passed
@@ -91,6 +154,49 @@ RIST_API int rist_sender_flow_id_set(struct rist_ctx *ctx, uint32_t flow_id);
  */
 RIST_API int rist_sender_data_write(struct rist_ctx *ctx, const struct rist_data_block *data_block);
 
+/**
+ * @brief Write several data blocks into librist packets.
+ *
+ * Same as calling rist_sender_data_write() for each block, but the packets
+ * are queued under one lock acquisition per chunk and the sender thread is
+ * woken up once for the whole batch. Invalid blocks are dropped and the
+ * rest of the batch is still queued. The block that would take the written
+ * bytes past INT_MAX and the ones after it are not written and stay with
+ * the caller.
+ *
+ * @param ctx RIST sender context
+ * @param data_blocks array of count rist_data_block structures
+ * @param count number of blocks in the array
+ * @return number of written bytes on success, -1 in case of error.
+ */
+RIST_API int rist_sender_data_writev(struct rist_ctx *ctx, const struct rist_data_block *data_blocks, size_t count);
+
+/**
+ * @brief Allocate a payload buffer to hand over to the sender.
+ *
+ * The buffer comes from a pool of the sender context and has room for the
+ * protocol headers in front of it. Fill in up to size bytes and pass it to
+ * rist_sender_data_write() or rist_sender_data_writev() with
+ * RIST_DATA_FLAGS_HAND_OVER to send it without a copy.
+ *
+ * @param ctx RIST sender context
+ * @param size payload size in bytes
+ * @return the payload buffer, NULL in case of error.
+ */
+RIST_API void *rist_sender_payload_alloc(struct rist_ctx *ctx, size_t size);
+
+/**
+ * @brief Release a payload buffer that was not handed over.
+ *
+ * Buffers passed with RIST_DATA_FLAGS_HAND_OVER are released by the library,
+ * only use this for the ones that were never written. All of them must be
+ * released before the context is destroyed.
+ *
+ * @param ctx RIST sender context
+ * @param payload buffer returned by rist_sender_payload_alloc()
+ */
+RIST_API void rist_sender_payload_free(struct rist_ctx *ctx, void *payload);
+
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,22 @@ struct rist_stats_sender_peer
 	double quality;
 	/* current RTT */
 	uint32_t rtt;
+	/* data writes that had to wake the sender thread */
+	uint32_t wakeups;
+	/* data writes picked up by the running sender thread without a wake up */
+	uint32_t wakeups_coalesced;
+};
+
+/* Distribution of a latency metric over one stats interval (microseconds) */
+struct rist_stats_percentiles
+{
+	/* number of samples */
+	uint64_t count;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
 };
 
 struct rist_stats_receiver_flow
@@ -70,6 +86,31 @@ struct rist_stats_receiver_flow
 	uint64_t max_inter_packet_spacing;
 	/* avg rtt all non dead peers */
 	uint32_t rtt;
+	/* missing packets that arrived through another (duplicate) path before being nacked */
+	uint32_t recovered_redundancy;
+	/* packet arrival to output */
+	struct rist_stats_percentiles buffer_delay;
+	/* packet inter-arrival time */
+	struct rist_stats_percentiles inter_packet_spacing;
+	/* missing packet detection to arrival of the retransmission */
+	struct rist_stats_percentiles recovery_time;
+	/* rtt of all peers */
+	struct rist_stats_percentiles rtt_percentiles;
+	/* reader wake ups and notify fd writes made for delivered packets */
+	uint32_t wakeups;
+	/* delivered packets a reader picked up without a wake up */
+	uint32_t wakeups_coalesced;
+	/* packets dropped because the output fifo was full */
+	uint32_t fifo_overflow;
+	/* drift of the sender clock against ours (ppm) */
+	double clock_drift;
+	/* corrections made to the sender clock offset (microseconds) */
+	double clock_offset_adjust;
+	/* output deviation from the PCR timeline, PCR to PCR, with PCR output pacing */
+	struct rist_stats_percentiles pcr_jitter;
+	/* receiver buffer applied to new packets and the one it moves toward (ms) */
+	uint32_t latency;
+	uint32_t latency_target;
 };
 
 enum rist_stats_type
@@ -80,6 +121,17 @@ enum rist_stats_type
 
 #define RIST_STATS_VERSION (0)
 
+enum rist_stats_format
+{
+	/* JSON and struct, every report is allocated and must be released with rist_stats_free() */
+	RIST_STATS_FORMAT_JSON = 0,
+	/* JSON and struct written into buffers reused for every report of the same peer/flow,
+	 * only valid for the duration of the callback, rist_stats_free() does nothing */
+	RIST_STATS_FORMAT_JSON_REUSED,
+	/* Struct only, stats_json is NULL, reused like RIST_STATS_FORMAT_JSON_REUSED */
+	RIST_STATS_FORMAT_BINARY
+};
+
 struct rist_stats
 {
 	uint32_t json_size;
@@ -103,6 +155,41 @@ struct rist_stats
  */
 RIST_API int rist_stats_callback_set(struct rist_ctx *ctx, int statsinterval, int (*stats_cb)(void *arg, const struct rist_stats *stats_container), void *arg);
 
+/**
+ * @brief Set callback for receiving stats structs in the given format
+ *
+ * Same as rist_stats_callback_set() (which uses RIST_STATS_FORMAT_JSON) but
+ * lets the application skip the per report allocations, see enum rist_stats_format.
+ *
+ * @param ctx RIST context
+ * @param statsinterval interval between stats reporting
+ * @param format report format
+ * @param stats_cb Callback function that will be called
+ * @param arg extra arguments for callback function
+ */
+RIST_API int rist_stats_callback_set2(struct rist_ctx *ctx, int statsinterval, enum rist_stats_format format, int (*stats_cb)(void *arg, const struct rist_stats *stats_container), void *arg);
+
+/**
+ * @brief Render the statistics of one or more contexts as OpenMetrics text
+ *
+ * Every peer (sender) or flow (receiver) report is folded into a registry kept
+ * by the context: packet counts accumulate into counters, the other values and
+ * the latency quantiles show the latest report, so the text refreshes at the
+ * stats interval. Safe to call from any thread, it never blocks the data path.
+ * Stats reporting must be enabled with rist_stats_callback_set(2).
+ *
+ * With more than one context the series carry a context="<index>" label, peer
+ * and flow ids are only unique within a context.
+ *
+ * @param ctxs array of RIST contexts
+ * @param count number of contexts in ctxs
+ * @param buf output buffer, may be NULL when size is 0
+ * @param size size of buf
+ * @return length of the complete text excluding the terminator, like snprintf,
+ *         call again with a bigger buffer when it is >= size. -1 on error
+ */
+RIST_API int rist_metrics_render(struct rist_ctx **ctxs, size_t count, char *buf, size_t size);
+
 /**
  * @brief Free the rist_stats structure memory allocations
  *
@@ -110,6 +110,24 @@ RIST_API uint32_t udpsocket_get_buffer_size(int sd);
  */
 RIST_API uint32_t udpsocket_get_buffer_send_size(int sd);
 
+/* Kernel receive timestamps, see udpsocket_recvfrom_ts() */
+enum udpsocket_timestamp_mode {
+	UDPSOCKET_TIMESTAMP_NONE = 0,
+	/* taken by the kernel when the packet came in (SO_TIMESTAMPNS) */
+	UDPSOCKET_TIMESTAMP_SOFTWARE,
+	/* taken by the NIC where the driver supports it and receive timestamping
+	 * is enabled on the interface (hwstamp_ctl), with its clock synchronized to
+	 * the system clock (phc2sys); software timestamps otherwise */
+	UDPSOCKET_TIMESTAMP_HARDWARE
+};
+
+/*
+ * Ask the kernel to timestamp packets received on [sd].
+ * Returns the mode enabled, -1 if the platform or socket does not support it
+ * (errno is set accordingly).
+ */
+RIST_API int udpsocket_set_timestamping(int sd, enum udpsocket_timestamp_mode mode);
+
 /*
  * Explicitly set the mcast interface for the socket [sd] to [mciface] for address
  * family [family].
@@ -135,6 +153,14 @@ RIST_API int udpsocket_send_nonblocking(int sd, const void *buf, size_t size);
 RIST_API int udpsocket_sendto(int sd, const void *buf, size_t size, const char *host, uint16_t port);
 RIST_API int udpsocket_recv(int sd, void *buf, size_t size);
 RIST_API int udpsocket_recvfrom(int sd, void *buf, size_t size, int flags, struct sockaddr *addr, socklen_t *addr_len);
+/*
+ * udpsocket_recvfrom() that also returns when the packet arrived, taken from the
+ * kernel timestamp on sockets set up with udpsocket_set_timestamping(). The time
+ * is in the clock domain librist uses for rist_data_block ts_ntp. [ts_ntp] is
+ * set to 0 when no usable timestamp came with the packet.
+ */
+RIST_API int udpsocket_recvfrom_ts(int sd, void *buf, size_t size, int flags, struct sockaddr *addr, socklen_t *addr_len,
+								   uint64_t *ts_ntp);
 RIST_API int udpsocket_close(int sd);
 RIST_API int udpsocket_parse_url(char *url, char *address, int address_maxlen, uint16_t *port, int *local);
 RIST_API int udpsocket_parse_url_parameters(const char *url, udpsocket_url_param_t *params,
@@ -0,0 +1,179 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "clock-drift.h"
+
+void rist_clock_drift_init(struct rist_clock_drift *d, uint64_t bucket_length)
+{
+	d->bucket_length = bucket_length;
+	rist_clock_drift_reset(d);
+}
+
+void rist_clock_drift_reset(struct rist_clock_drift *d)
+{
+	d->has_base = false;
+	d->bucket_samples = 0;
+	d->count = 0;
+	d->next = 0;
+	d->valid = false;
+	d->intercept = 0.0;
+	d->slope = 0.0;
+}
+
+/* Lower convex hull of the buckets sorted by time, as indices into x/y */
+static size_t clock_drift_lower_hull(const double *x, const double *y, size_t n, size_t *hull)
+{
+	size_t h = 0;
+	for (size_t i = 0; i < n; i++) {
+		while (h >= 2 && (x[hull[h - 1]] - x[hull[h - 2]]) * (y[i] - y[hull[h - 2]]) -
+								 (y[hull[h - 1]] - y[hull[h - 2]]) * (x[i] - x[hull[h - 2]]) <=
+							 0.0)
+			h--;
+		hull[h++] = i;
+	}
+	return h;
+}
+
+static void clock_drift_fit(struct rist_clock_drift *d)
+{
+	double x[RIST_CLOCK_DRIFT_BUCKETS];
+	double y[RIST_CLOCK_DRIFT_BUCKETS];
+	size_t n = d->count;
+	// oldest bucket first, kept in time order for the hull
+	size_t first = n < RIST_CLOCK_DRIFT_BUCKETS ? 0 : d->next;
+	for (size_t i = 0; i < n; i++) {
+		const struct rist_clock_drift_bucket *b = &d->buckets[(first + i) % RIST_CLOCK_DRIFT_BUCKETS];
+		double bx = (double)(int64_t)(b->time - d->base_time);
+		double by = (double)b->offset;
+		size_t j = i;
+		for (; j > 0 && x[j - 1] > bx; j--) {
+			x[j] = x[j - 1];
+			y[j] = y[j - 1];
+		}
+		x[j] = bx;
+		y[j] = by;
+	}
+
+	// buckets that never saw the queue drain sit above the lower hull, each of
+	// its edges is a line below all buckets. The edge the nearest quarter of the
+	// buckets hugs best is the least delayed path, the line is refit through
+	// that quarter as the edge alone follows the noise of two buckets.
+	size_t hull[RIST_CLOCK_DRIFT_BUCKETS];
+	size_t h = clock_drift_lower_hull(x, y, n, hull);
+	size_t keep = n / 4 > 2 ? n / 4 : 2;
+	if (keep > n)
+		keep = n;
+	double slope = 0.0;
+	double intercept = y[hull[0]];
+	double best_score = 0.0;
+	for (size_t e = 0; e + 1 < h; e++) {
+		size_t a = hull[e];
+		size_t b = hull[e + 1];
+		double edge_slope = x[b] > x[a] ? (y[b] - y[a]) / (x[b] - x[a]) : 0.0;
+		double edge_intercept = y[a] - edge_slope * x[a];
+		double nearest[RIST_CLOCK_DRIFT_BUCKETS];
+		size_t count = 0;
+		for (size_t i = 0; i < n; i++) {
+			double r = y[i] - (edge_intercept + edge_slope * x[i]);
+			if (count == keep && r >= nearest[keep - 1])
+				continue;
+			size_t j = count < keep ? count++ : keep - 1;
+			for (; j > 0 && nearest[j - 1] > r; j--)
+				nearest[j] = nearest[j - 1];
+			nearest[j] = r;
+		}
+		double score = 0.0;
+		for (size_t i = 0; i < keep; i++)
+			score += nearest[i];
+		if (e == 0 || score < best_score) {
+			best_score = score;
+			slope = edge_slope;
+			intercept = edge_intercept;
+		}
+	}
+
+	double residual[RIST_CLOCK_DRIFT_BUCKETS];
+	double sorted[RIST_CLOCK_DRIFT_BUCKETS];
+	for (size_t i = 0; i < n; i++) {
+		residual[i] = y[i] - (intercept + slope * x[i]);
+		size_t j = i;
+		for (; j > 0 && sorted[j - 1] > residual[i]; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = residual[i];
+	}
+	double threshold = sorted[keep - 1];
+	double fit_x = 0.0;
+	double fit_y = 0.0;
+	size_t fit_n = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (residual[i] > threshold)
+			continue;
+		fit_x += x[i];
+		fit_y += y[i];
+		fit_n++;
+	}
+	fit_x /= (double)fit_n;
+	fit_y /= (double)fit_n;
+	double sxx = 0.0;
+	double sxy = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		if (residual[i] > threshold)
+			continue;
+		sxx += (x[i] - fit_x) * (x[i] - fit_x);
+		sxy += (x[i] - fit_x) * (y[i] - fit_y);
+	}
+	// a single bucket only gives the level
+	if (sxx > 0.0)
+		slope = sxy / sxx;
+	d->slope = slope;
+	d->intercept = fit_y - slope * fit_x;
+	d->valid = true;
+}
+
+bool rist_clock_drift_add(struct rist_clock_drift *d, uint64_t now, int64_t offset)
+{
+	if (!d->has_base) {
+		d->has_base = true;
+		d->base_time = now;
+		d->base_offset = offset;
+	}
+	if (now < d->base_time)
+		return false;
+	int64_t relative = offset - d->base_offset;
+	if (!d->bucket_samples) {
+		d->bucket_start = now;
+		d->bucket_min.time = now;
+		d->bucket_min.offset = relative;
+	} else if (relative < d->bucket_min.offset) {
+		d->bucket_min.time = now;
+		d->bucket_min.offset = relative;
+	}
+	d->bucket_samples++;
+	// a sample stamped before the bucket started does not close it
+	if ((int64_t)(now - d->bucket_start) < (int64_t)d->bucket_length)
+		return false;
+
+	d->buckets[d->next] = d->bucket_min;
+	d->next = (d->next + 1) % RIST_CLOCK_DRIFT_BUCKETS;
+	if (d->count < RIST_CLOCK_DRIFT_BUCKETS)
+		d->count++;
+	d->bucket_samples = 0;
+	clock_drift_fit(d);
+	return true;
+}
+
+int64_t rist_clock_drift_offset(const struct rist_clock_drift *d, uint64_t now)
+{
+	double x = (double)(int64_t)(now - d->base_time);
+	double y = d->intercept + d->slope * x;
+	return d->base_offset + (int64_t)(y < 0.0 ? y - 0.5 : y + 0.5);
+}
+
+double rist_clock_drift_ppm(const struct rist_clock_drift *d)
+{
+	return d->valid ? d->slope * 1e6 : 0.0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_CLOCK_DRIFT_H
+#define RIST_CLOCK_DRIFT_H
+
+#include "common/attributes.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RIST_CLOCK_DRIFT_BUCKETS 32
+
+/*
+ * Streaming estimate of the offset between the receiver clock and a sender's
+ * source clock. Every in-order packet gives a sample (arrival - source time)
+ * made of the clock offset plus its network delay. The smallest sample of each
+ * bucket of time is the one that saw the least queueing, a line fitted along
+ * the lower edge of the minima of the last RIST_CLOCK_DRIFT_BUCKETS buckets
+ * gives the offset at any time and, as its slope, how fast the two clocks
+ * drift apart.
+ * Adding a sample is O(1), the fit is redone when a bucket closes.
+ */
+struct rist_clock_drift_bucket {
+	uint64_t time;
+	int64_t offset;
+};
+
+struct rist_clock_drift {
+	uint64_t bucket_length;
+	/* samples are kept relative to the first one after a reset */
+	bool has_base;
+	uint64_t base_time;
+	int64_t base_offset;
+	/* bucket being filled */
+	uint32_t bucket_samples;
+	uint64_t bucket_start;
+	struct rist_clock_drift_bucket bucket_min;
+	/* closed buckets, the oldest is overwritten */
+	struct rist_clock_drift_bucket buckets[RIST_CLOCK_DRIFT_BUCKETS];
+	size_t count;
+	size_t next;
+	/* offset(t) = base_offset + intercept + slope * (t - base_time) */
+	bool valid;
+	double intercept;
+	double slope;
+};
+
+/* bucket_length in clock ticks */
+RIST_PRIV void rist_clock_drift_init(struct rist_clock_drift *d, uint64_t bucket_length);
+/* Forgets all samples, for discontinuities of either clock */
+RIST_PRIV void rist_clock_drift_reset(struct rist_clock_drift *d);
+/* Returns true when a bucket closed and the estimate moved */
+RIST_PRIV bool rist_clock_drift_add(struct rist_clock_drift *d, uint64_t now, int64_t offset);
+/* Estimated offset at now, only meaningful once an estimate is valid */
+RIST_PRIV int64_t rist_clock_drift_offset(const struct rist_clock_drift *d, uint64_t now);
+/* Drift of the source clock against ours in parts per million, positive when
+ * the offset grows (the source clock runs slow) */
+RIST_PRIV double rist_clock_drift_ppm(const struct rist_clock_drift *d);
+
+#endif
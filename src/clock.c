@@ -0,0 +1,156 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "clock.h"
+#include "time-shim.h"
+#include <stdatomic.h>
+
+#if defined(USE_TSC_CLOCK) && (defined(__x86_64__) || defined(_M_X64))
+#define RIST_CLOCK_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#else
+#define RIST_CLOCK_TSC 0
+#endif
+
+// There is 70 years (incl. 17 leap ones) offset to the Unix Epoch.
+// No leap seconds during that period since they were not invented yet.
+#define NTP_UNIX_EPOCH_OFFSET ((70LL * 365 + 17) * 24 * 60 * 60)
+
+static inline uint64_t timespec_to_ntp(const timespec_t *ts)
+{
+	// Convert nanoseconds to 32-bits fraction (232 picosecond units)
+	// ceil(2^64 / 10^9) turns the division into a multiply and shift, the
+	// product stays below 2^64 for any tv_nsec < 10^9
+	uint64_t t = ((uint64_t)ts->tv_nsec * 18446744074ULL) >> 32;
+	t |= (uint64_t)(NTP_UNIX_EPOCH_OFFSET + ts->tv_sec) << 32;
+	return t;
+}
+
+static uint64_t timestampNTP_monotonic(void)
+{
+	// We use clock_gettime instead of gettimeofday even though we only need microseconds
+	// because gettimeofday implementation under linux is dependent on the kernel clock
+	// and can produce duplicate times (too close to kernel timer)
+
+	// We use the NTP time standard: rfc5905 (https://tools.ietf.org/html/rfc5905#section-6)
+	// The 64-bit timestamps used by NTP consist of a 32-bit part for seconds
+	// and a 32-bit part for fractional second, giving a time scale that rolls
+	// over every 232 seconds (136 years) and a theoretical resolution of
+	// 2−32 seconds (233 picoseconds). NTP uses an epoch of January 1, 1900.
+	// Therefore, the first rollover occurs on February 7, 2036.
+	timespec_t ts;
+#if defined (__APPLE__)
+	clock_gettime_osx(CLOCK_MONOTONIC_OSX, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return timespec_to_ntp(&ts); // nanoseconds (technically, 232.831 picosecond units)
+}
+
+#if RIST_CLOCK_TSC
+#define TSC_UNCALIBRATED 0
+#define TSC_CALIBRATING 1
+#define TSC_READY 2
+#define TSC_UNAVAILABLE 3
+// Calibration window against CLOCK_MONOTONIC (10 ms)
+#define TSC_CALIBRATION_TICKS ((10ULL << 32) / 1000)
+#define TSC_MULT_SHIFT 24
+
+static struct {
+	atomic_int state;
+	uint64_t tsc_base;
+	uint64_t ntp_base;
+	// NTP ticks per TSC tick, 8.24 fixed point
+	uint64_t mult;
+} tsc_clock;
+
+static bool tsc_invariant(void)
+{
+	unsigned int regs[4] = { 0 };
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0x80000000);
+	if ((unsigned int)info[0] < 0x80000007)
+		return false;
+	__cpuid(info, 0x80000007);
+	regs[3] = (unsigned int)info[3];
+#else
+	if (__get_cpuid_max(0x80000000, NULL) < 0x80000007)
+		return false;
+	__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+	// EDX bit 8: invariant TSC (constant rate, keeps ticking in deep C-states)
+	return (regs[3] & (1U << 8)) != 0;
+}
+
+static inline uint64_t tsc_to_ntp(uint64_t tsc)
+{
+	// Split the multiply so it cannot overflow regardless of uptime
+	uint64_t delta = tsc - tsc_clock.tsc_base;
+	return tsc_clock.ntp_base + (((delta >> 32) * tsc_clock.mult) << (32 - TSC_MULT_SHIFT)) +
+		(((delta & 0xFFFFFFFF) * tsc_clock.mult) >> TSC_MULT_SHIFT);
+}
+#endif
+
+bool rist_clock_init(void)
+{
+#if RIST_CLOCK_TSC
+	int expected = TSC_UNCALIBRATED;
+	if (!atomic_compare_exchange_strong_explicit(&tsc_clock.state, &expected, TSC_CALIBRATING,
+				memory_order_acq_rel, memory_order_acquire))
+		return expected == TSC_READY;
+	if (!tsc_invariant()) {
+		atomic_store_explicit(&tsc_clock.state, TSC_UNAVAILABLE, memory_order_release);
+		return false;
+	}
+	uint64_t ntp_start = timestampNTP_monotonic();
+	uint64_t tsc_start = __rdtsc();
+	uint64_t ntp_end;
+	do {
+		ntp_end = timestampNTP_monotonic();
+	} while (ntp_end - ntp_start < TSC_CALIBRATION_TICKS);
+	uint64_t tsc_end = __rdtsc();
+	uint64_t tsc_delta = tsc_end - tsc_start;
+	uint64_t mult = tsc_delta ? ((ntp_end - ntp_start) << TSC_MULT_SHIFT) / tsc_delta : 0;
+	// Below ~17 MHz the multiplier no longer fits, such a TSC is useless anyway
+	if (mult == 0 || mult > UINT32_MAX) {
+		atomic_store_explicit(&tsc_clock.state, TSC_UNAVAILABLE, memory_order_release);
+		return false;
+	}
+	tsc_clock.mult = mult;
+	tsc_clock.tsc_base = tsc_end;
+	tsc_clock.ntp_base = ntp_end;
+	atomic_store_explicit(&tsc_clock.state, TSC_READY, memory_order_release);
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t timestampNTP_u64(void)
+{
+#if RIST_CLOCK_TSC
+	if (RIST_LIKELY(atomic_load_explicit(&tsc_clock.state, memory_order_acquire) == TSC_READY))
+		return tsc_to_ntp(__rdtsc());
+#endif
+	return timestampNTP_monotonic();
+}
+
+uint64_t timestampNTP_RTC_u64(void) {
+	timespec_t ts;
+#if defined (__APPLE__)
+	clock_gettime_osx(CLOCK_REALTIME_OSX, &ts);
+#else
+	clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+	return timespec_to_ntp(&ts);
+}
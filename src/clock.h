@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_CLOCK_H
+#define RIST_CLOCK_H
+
+#include "common/attributes.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Time source for the protocol threads, all values are 64-bit NTP timestamps
+ * (32.32 fixed point seconds).
+ *
+ * The hot paths (sender/receiver protocol loops, data output, enqueue) sample
+ * timestampNTP_u64() once per loop iteration or batch and pass that "now" down
+ * instead of reading the clock for every packet.
+ *
+ * When built with use_tsc_clock on x86_64 and the cpu reports an invariant TSC,
+ * the monotonic clock is derived from the TSC after a one-off calibration
+ * against CLOCK_MONOTONIC done by rist_clock_init().
+ */
+
+/* Calibrates the optional TSC fast path, safe to call from any thread and more
+ * than once. Returns true when timestampNTP_u64() is served by the TSC. */
+RIST_PRIV bool rist_clock_init(void);
+RIST_PRIV uint64_t timestampNTP_u64(void);
+RIST_PRIV uint64_t timestampNTP_RTC_u64(void);
+
+/* NTP timestamp to microseconds */
+static inline uint64_t rist_clock_ntp_to_us(uint64_t ntp)
+{
+	return (ntp >> 32) * 1000000 + (((ntp & 0xFFFFFFFF) * 1000000) >> 32);
+}
+
+/* Nanoseconds to NTP timestamp */
+static inline uint64_t rist_clock_ns_to_ntp(uint64_t ns)
+{
+	return ((ns / 1000000000) << 32) + (((ns % 1000000000) << 32) / 1000000000);
+}
+
+#endif
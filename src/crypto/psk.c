@@ -20,56 +20,61 @@
 #include "fastpbkdf2.h"
 #endif
 
+#include "pthread-shim.h"
 #include <stdint.h>
 
-//TODO: handle failures?
-int _librist_crypto_psk_rist_key_init(struct rist_key *key, uint32_t key_size, uint32_t rotation, const char *password)
-{
-	strcpy(key->password, password);
-	key->key_size = key_size;
-	key->key_rotation = rotation;
-#if HAVE_MBEDTLS
-	mbedtls_aes_init(&key->mbedtls_aes_ctx);
-#elif defined(LINUX_CRYPTO)
-	linux_crypto_init(&key->linux_crypto_ctx);
-#endif
-	return 0;
-}
+/*
+ * PBKDF2 (RIST_PBKDF2_HMAC_SHA256_ITERATIONS rounds) is far too slow for the
+ * packet path, so derivations run on a shared worker thread and land in a small
+ * cache keyed by (password, nonce, key size):
+ * - the sender picks its next nonce half way to the rotation point and has the
+ *   key derived before it is needed
+ * - the receiver keeps decrypting with the current key while the key for a new
+ *   nonce derives, and keeps the previous key around for stragglers
+ * The worker lives as long as at least one key with a password exists.
+ */
+#define PSK_CACHE_SIZE 16
 
-int _librist_crypto_psk_rist_key_destroy(struct rist_key *key)
-{
-    if (key->key_size) {
-#if HAVE_MBEDTLS
-	    mbedtls_aes_free(&key->mbedtls_aes_ctx);
-#elif defined(LINUX_CRYPTO)
-	    linux_crypto_free(&key->linux_crypto_ctx);
-#endif
-    }
-	return 0;
-}
+enum psk_cache_state {
+	PSK_CACHE_EMPTY = 0,
+	PSK_CACHE_PENDING,
+	PSK_CACHE_READY,
+};
 
-int _librist_crypto_psk_rist_key_clone(struct rist_key *key_in, struct rist_key *key_out)
-{
-    strcpy(key_out->password, key_in->password);
-    key_out->key_size = key_in->key_size;
-    key_out->key_rotation = key_in->key_rotation;
-#if HAVE_MBEDTLS
-	mbedtls_aes_init(&key_out->mbedtls_aes_ctx);
-#elif defined(LINUX_CRYPTO)
-	linux_crypto_init(&key_out->linux_crypto_ctx);
+struct psk_cache_entry {
+	enum psk_cache_state state;
+	char password[128];
+	uint32_t nonce;
+	uint32_t key_size;
+	uint64_t last_used;
+	uint8_t aes_key[256 / 8];
+};
+
+static struct {
+	pthread_cond_t cond;
+	bool cond_initialized;
+	pthread_t thread;
+	uintptr_t generation;
+	int refcount;
+	uint64_t use_counter;
+	struct psk_cache_entry cache[PSK_CACHE_SIZE];
+} psk_worker;
+
+#if !defined(_WIN32) || HAVE_PTHREADS
+static pthread_mutex_t psk_worker_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static pthread_mutex_t psk_worker_lock;
+static INIT_ONCE once_var;
 #endif
-	return 0;
-}
 
-static void _librist_crypto_aes_key(struct rist_key *key)
+static void psk_pbkdf2(const char *password, uint32_t nonce, uint32_t key_size, uint8_t aes_key[])
 {
-    uint8_t aes_key[256 / 8];
 #if !HAVE_MBEDTLS
     fastpbkdf2_hmac_sha256(
-            (const void *) key->password, strlen(key->password),
-            (const void *) &key->gre_nonce, sizeof(key->gre_nonce),
+            (const void *) password, strlen(password),
+            (const void *) &nonce, sizeof(nonce),
             RIST_PBKDF2_HMAC_SHA256_ITERATIONS,
-            aes_key, key->key_size / 8);
+            aes_key, key_size / 8);
 #else
     mbedtls_md_context_t sha_ctx;
     const mbedtls_md_info_t *info_sha;
@@ -89,15 +94,167 @@ static void _librist_crypto_aes_key(struct rist_key *key)
     }
 
     ret = mbedtls_pkcs5_pbkdf2_hmac(&sha_ctx,
-                                    (const unsigned char *)key->password, strlen(key->password),
-                                    (const uint8_t *)&key->gre_nonce, sizeof(key->gre_nonce),
-                                    RIST_PBKDF2_HMAC_SHA256_ITERATIONS, key->key_size /8, aes_key);
+                                    (const unsigned char *)password, strlen(password),
+                                    (const uint8_t *)&nonce, sizeof(nonce),
+                                    RIST_PBKDF2_HMAC_SHA256_ITERATIONS, key_size /8, aes_key);
     if (ret != 0)
     {
         //rist_log_priv(cctx, RIST_LOG_ERROR, "Mbed TLS pbkdf2 function failed\n");
     }
     mbedtls_md_free(&sha_ctx);
 #endif
+}
+
+static struct psk_cache_entry *psk_cache_find(const char *password, uint32_t nonce, uint32_t key_size)
+{
+	for (size_t i = 0; i < PSK_CACHE_SIZE; i++) {
+		struct psk_cache_entry *e = &psk_worker.cache[i];
+		if (e->state != PSK_CACHE_EMPTY && e->nonce == nonce && e->key_size == key_size &&
+			strcmp(e->password, password) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+static PTHREAD_START_FUNC(psk_worker_thread, arg)
+{
+	uintptr_t generation = (uintptr_t)arg;
+	char password[128];
+	uint8_t aes_key[256 / 8];
+
+	pthread_mutex_lock(&psk_worker_lock);
+	while (psk_worker.generation == generation) {
+		struct psk_cache_entry *job = NULL;
+		for (size_t i = 0; i < PSK_CACHE_SIZE; i++) {
+			if (psk_worker.cache[i].state == PSK_CACHE_PENDING) {
+				job = &psk_worker.cache[i];
+				break;
+			}
+		}
+		if (!job) {
+			pthread_cond_wait(&psk_worker.cond, &psk_worker_lock);
+			continue;
+		}
+		uint32_t nonce = job->nonce;
+		uint32_t key_size = job->key_size;
+		strcpy(password, job->password);
+		pthread_mutex_unlock(&psk_worker_lock);
+
+		psk_pbkdf2(password, nonce, key_size, aes_key);
+
+		pthread_mutex_lock(&psk_worker_lock);
+		// The slot may have been recycled while we were busy
+		if (job->state == PSK_CACHE_PENDING && job->nonce == nonce && job->key_size == key_size &&
+			strcmp(job->password, password) == 0) {
+			memcpy(job->aes_key, aes_key, sizeof(aes_key));
+			job->state = PSK_CACHE_READY;
+		}
+	}
+	pthread_mutex_unlock(&psk_worker_lock);
+	memset(password, 0, sizeof(password));
+	memset(aes_key, 0, sizeof(aes_key));
+	return 0;
+}
+
+static void psk_worker_ref(struct rist_key *key)
+{
+	if (key->worker_ref || !key->password[0])
+		return;
+#if defined(_WIN32) && !HAVE_PTHREADS
+	init_mutex_once(&psk_worker_lock, &once_var);
+#endif
+	pthread_mutex_lock(&psk_worker_lock);
+	if (!psk_worker.cond_initialized) {
+		pthread_cond_init(&psk_worker.cond, NULL);
+		psk_worker.cond_initialized = true;
+	}
+	if (psk_worker.refcount++ == 0) {
+		psk_worker.generation++;
+		if (pthread_create(&psk_worker.thread, NULL, psk_worker_thread, (void *)psk_worker.generation) != 0) {
+			// Without a worker every derivation simply happens inline
+			psk_worker.refcount--;
+			pthread_mutex_unlock(&psk_worker_lock);
+			return;
+		}
+	}
+	key->worker_ref = true;
+	pthread_mutex_unlock(&psk_worker_lock);
+}
+
+static void psk_worker_unref(struct rist_key *key)
+{
+	if (!key->worker_ref)
+		return;
+	key->worker_ref = false;
+	pthread_mutex_lock(&psk_worker_lock);
+	if (--psk_worker.refcount > 0) {
+		pthread_mutex_unlock(&psk_worker_lock);
+		return;
+	}
+	pthread_t thread = psk_worker.thread;
+	psk_worker.generation++;
+	memset(psk_worker.cache, 0, sizeof(psk_worker.cache));
+	pthread_cond_broadcast(&psk_worker.cond);
+	pthread_mutex_unlock(&psk_worker_lock);
+	pthread_join(thread, NULL);
+}
+
+/* Copies the derived key out of the cache, false when it is not ready (yet) */
+static bool psk_cache_get(struct rist_key *key, uint32_t nonce, uint8_t aes_key[])
+{
+	if (!key->worker_ref)
+		return false;
+	bool ready = false;
+	pthread_mutex_lock(&psk_worker_lock);
+	struct psk_cache_entry *e = psk_cache_find(key->password, nonce, key->key_size);
+	if (e && e->state == PSK_CACHE_READY) {
+		memcpy(aes_key, e->aes_key, key->key_size / 8);
+		e->last_used = ++psk_worker.use_counter;
+		ready = true;
+	}
+	pthread_mutex_unlock(&psk_worker_lock);
+	return ready;
+}
+
+/* Queues a derivation, false when there is no worker to run it */
+static bool psk_cache_request(struct rist_key *key, uint32_t nonce)
+{
+	if (!key->worker_ref)
+		return false;
+	pthread_mutex_lock(&psk_worker_lock);
+	struct psk_cache_entry *e = psk_cache_find(key->password, nonce, key->key_size);
+	if (!e) {
+		// Recycle the least recently used slot that is not being worked on
+		for (size_t i = 0; i < PSK_CACHE_SIZE; i++) {
+			struct psk_cache_entry *c = &psk_worker.cache[i];
+			if (c->state == PSK_CACHE_PENDING)
+				continue;
+			if (!e || c->state == PSK_CACHE_EMPTY || c->last_used < e->last_used) {
+				e = c;
+				if (c->state == PSK_CACHE_EMPTY)
+					break;
+			}
+		}
+		if (!e) {
+			pthread_mutex_unlock(&psk_worker_lock);
+			return false;
+		}
+		memset(e, 0, sizeof(*e));
+		strcpy(e->password, key->password);
+		e->nonce = nonce;
+		e->key_size = key->key_size;
+		e->last_used = ++psk_worker.use_counter;
+		e->state = PSK_CACHE_PENDING;
+		pthread_cond_signal(&psk_worker.cond);
+	}
+	pthread_mutex_unlock(&psk_worker_lock);
+	return true;
+}
+
+static void _librist_crypto_aes_setkey(struct rist_key *key, const uint8_t aes_key[])
+{
+    if (aes_key != key->aes_key)
+        memcpy(key->aes_key, aes_key, key->key_size / 8);
 #if HAVE_MBEDTLS
     mbedtls_aes_setkey_enc(&key->mbedtls_aes_ctx, aes_key, key->key_size);
 #elif defined(LINUX_CRYPTO)
@@ -111,6 +268,60 @@ static void _librist_crypto_aes_key(struct rist_key *key)
     key->used_times = 0;
 }
 
+/* Installs the key for key->gre_nonce, from the cache when possible */
+static void _librist_crypto_aes_key(struct rist_key *key)
+{
+    uint8_t aes_key[256 / 8];
+    if (!psk_cache_get(key, key->gre_nonce, aes_key)) {
+        psk_pbkdf2(key->password, key->gre_nonce, key->key_size, aes_key);
+    }
+    _librist_crypto_aes_setkey(key, aes_key);
+    memset(aes_key, 0, sizeof(aes_key));
+}
+
+//TODO: handle failures?
+int _librist_crypto_psk_rist_key_init(struct rist_key *key, uint32_t key_size, uint32_t rotation, const char *password)
+{
+	strcpy(key->password, password);
+	key->key_size = key_size;
+	key->key_rotation = rotation;
+#if HAVE_MBEDTLS
+	mbedtls_aes_init(&key->mbedtls_aes_ctx);
+#elif defined(LINUX_CRYPTO)
+	linux_crypto_init(&key->linux_crypto_ctx);
+#endif
+	psk_worker_ref(key);
+	return 0;
+}
+
+int _librist_crypto_psk_rist_key_destroy(struct rist_key *key)
+{
+    psk_worker_unref(key);
+    if (key->key_size) {
+#if HAVE_MBEDTLS
+	    mbedtls_aes_free(&key->mbedtls_aes_ctx);
+#elif defined(LINUX_CRYPTO)
+	    linux_crypto_free(&key->linux_crypto_ctx);
+#endif
+    }
+	return 0;
+}
+
+int _librist_crypto_psk_rist_key_clone(struct rist_key *key_in, struct rist_key *key_out)
+{
+    strcpy(key_out->password, key_in->password);
+    key_out->key_size = key_in->key_size;
+    key_out->key_rotation = key_in->key_rotation;
+#if HAVE_MBEDTLS
+	mbedtls_aes_init(&key_out->mbedtls_aes_ctx);
+#elif defined(LINUX_CRYPTO)
+	linux_crypto_init(&key_out->linux_crypto_ctx);
+#endif
+    key_out->worker_ref = false;
+    psk_worker_ref(key_out);
+	return 0;
+}
+
 static void _librist_crypto_psk_aes_ctr(struct rist_key *key, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len)
 {
     /* Prepare AES iv */
@@ -136,31 +347,64 @@ static void _librist_crypto_psk_aes_ctr(struct rist_key *key, uint32_t seq_nbe,
     key->used_times++;
 }
 
-void _librist_crypto_psk_decrypt(struct rist_key *key, uint32_t nonce, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len)
+int _librist_crypto_psk_decrypt(struct rist_key *key, uint32_t nonce, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len)
 {
     if (!nonce)
-        return;
+        return 0;
 
     if (nonce != key->gre_nonce) {
+        uint8_t aes_key[256 / 8];
+        if (nonce == key->prev_nonce) {
+            // Straggler from before the last rotation, swap the keys back
+            memcpy(aes_key, key->prev_aes_key, sizeof(aes_key));
+        } else if (!psk_cache_get(key, nonce, aes_key)) {
+            // Keep using the current key until the new one is ready, the first
+            // key (or having no worker) leaves no choice but to derive inline
+            if (key->gre_nonce && psk_cache_request(key, nonce)) {
+                return -1;
+            }
+            psk_pbkdf2(key->password, nonce, key->key_size, aes_key);
+        }
+        if (key->gre_nonce) {
+            key->prev_nonce = key->gre_nonce;
+            memcpy(key->prev_aes_key, key->aes_key, sizeof(key->prev_aes_key));
+        }
         key->gre_nonce = nonce;
-        _librist_crypto_aes_key(key);
+        _librist_crypto_aes_setkey(key, aes_key);
+        memset(aes_key, 0, sizeof(aes_key));
         key->bad_decryption = false;
         key->bad_count = 0;
     }
     if (key->used_times > RIST_AES_KEY_REUSE_TIMES)
-        return;
+        return 0;
 
     _librist_crypto_psk_aes_ctr(key, seq_nbe, gre_version, inbuf, outbuf, payload_len);
-    return;
+    return 0;
 }
 
 void _librist_crypto_psk_encrypt(struct rist_key *key, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len)
 {
-    if (!key->gre_nonce || (key->used_times +1) > RIST_AES_KEY_REUSE_TIMES || (key->key_rotation > 0 && key->used_times >= key->key_rotation)) {
-        do {
-            key->gre_nonce = prand_u32();
-        } while (!key->gre_nonce);
+    uint64_t limit = RIST_AES_KEY_REUSE_TIMES;
+    if (key->key_rotation > 0 && key->key_rotation < limit)
+        limit = key->key_rotation;
+    if (!key->gre_nonce || (key->used_times +1) > limit) {
+        if (key->next_nonce) {
+            key->gre_nonce = key->next_nonce;
+            key->next_nonce = 0;
+        } else {
+            do {
+                key->gre_nonce = prand_u32();
+            } while (!key->gre_nonce);
+        }
         _librist_crypto_aes_key(key);
+    } else if (!key->next_nonce && key->used_times >= limit / 2 && key->worker_ref) {
+        // Half way to the rotation point, have the next key derived in the background
+        uint32_t next;
+        do {
+            next = prand_u32();
+        } while (!next || next == key->gre_nonce);
+        if (psk_cache_request(key, next))
+            key->next_nonce = next;
     }
 
     _librist_crypto_psk_aes_ctr(key, seq_nbe, gre_version, inbuf, outbuf, payload_len);
@@ -33,12 +33,19 @@ struct rist_key {
     char password[128];
     bool bad_decryption;
     int bad_count;
+    /* Background derivation (see psk.c) */
+    bool worker_ref;
+    uint8_t aes_key[256 / 8];
+    uint32_t prev_nonce; // receiver: key kept active while the new one derives
+    uint8_t prev_aes_key[256 / 8];
+    uint32_t next_nonce; // sender: nonce pre-derived ahead of rotation
 };
 
 RIST_PRIV int _librist_crypto_psk_rist_key_init(struct rist_key *key, uint32_t key_size, uint32_t rotation, const char *password);
 RIST_PRIV int _librist_crypto_psk_rist_key_destroy(struct rist_key *key);
 RIST_PRIV int _librist_crypto_psk_rist_key_clone(struct rist_key *key_in, struct rist_key *key_out);
-RIST_PRIV void _librist_crypto_psk_decrypt(struct rist_key *key, uint32_t nonce, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
+/* Returns -1 when the key for nonce is still being derived, the packet must be dropped */
+RIST_PRIV int _librist_crypto_psk_decrypt(struct rist_key *key, uint32_t nonce, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
 RIST_PRIV void _librist_crypto_psk_encrypt(struct rist_key *key, uint32_t seq_nbe, uint8_t gre_version, uint8_t inbuf[], uint8_t outbuf[], size_t payload_len);
 
 
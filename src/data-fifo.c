@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "data-fifo.h"
+#include <stdlib.h>
+
+int rist_data_fifo_init(struct rist_data_fifo *fifo, size_t size)
+{
+	fifo->cells = NULL;
+	fifo->size = size;
+	fifo->mask = size ? size - 1 : 0;
+	atomic_init(&fifo->tail, 0);
+	atomic_init(&fifo->head, 0);
+	atomic_init(&fifo->overflow, 0);
+	if (!size)
+		return 0;
+	fifo->cells = calloc(size, sizeof(*fifo->cells));
+	if (!fifo->cells)
+		return -1;
+	// a cell is free for position p while its seq is p
+	for (size_t i = 0; i < size; i++)
+		atomic_init(&fifo->cells[i].seq, i);
+	return 0;
+}
+
+void rist_data_fifo_free(struct rist_data_fifo *fifo)
+{
+	free(fifo->cells);
+	fifo->cells = NULL;
+	fifo->size = 0;
+}
+
+bool rist_data_fifo_push(struct rist_data_fifo *fifo, struct rist_data_block *block)
+{
+	size_t pos = atomic_load_explicit(&fifo->tail, memory_order_relaxed);
+	if (RIST_UNLIKELY(!fifo->size)) {
+		atomic_fetch_add_explicit(&fifo->overflow, 1, memory_order_relaxed);
+		return false;
+	}
+	struct rist_data_fifo_cell *cell = &fifo->cells[pos & fifo->mask];
+	// still holding the block from one lap ago
+	if (atomic_load_explicit(&cell->seq, memory_order_acquire) != pos) {
+		atomic_fetch_add_explicit(&fifo->overflow, 1, memory_order_relaxed);
+		return false;
+	}
+	cell->block = block;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	atomic_store_explicit(&fifo->tail, pos + 1, memory_order_release);
+	return true;
+}
+
+size_t rist_data_fifo_pop(struct rist_data_fifo *fifo, struct rist_data_block **blocks, size_t max)
+{
+	if (!fifo->size || !max)
+		return 0;
+	if (max > fifo->size)
+		max = fifo->size;
+	size_t pos = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+	size_t n;
+	for (;;) {
+		// count the run of written cells from pos, then claim it in one go
+		for (n = 0; n < max; n++) {
+			size_t seq = atomic_load_explicit(&fifo->cells[(pos + n) & fifo->mask].seq, memory_order_acquire);
+			if (seq != pos + n + 1)
+				break;
+		}
+		if (!n) {
+			// empty, unless another reader moved head since we loaded it
+			size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+			if (head == pos)
+				return 0;
+			pos = head;
+			continue;
+		}
+		if (atomic_compare_exchange_weak_explicit(&fifo->head, &pos, pos + n, memory_order_relaxed, memory_order_relaxed))
+			break;
+	}
+	for (size_t i = 0; i < n; i++) {
+		struct rist_data_fifo_cell *cell = &fifo->cells[(pos + i) & fifo->mask];
+		blocks[i] = cell->block;
+		cell->block = NULL;
+		// free for the writer one lap later
+		atomic_store_explicit(&cell->seq, pos + i + fifo->size, memory_order_release);
+	}
+	return n;
+}
+
+size_t rist_data_fifo_count(struct rist_data_fifo *fifo)
+{
+	size_t head = atomic_load_explicit(&fifo->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&fifo->tail, memory_order_acquire);
+	// readers may have claimed cells the tail we loaded does not cover yet
+	ptrdiff_t count = (ptrdiff_t)(tail - head);
+	return count > 0 ? (size_t)count : 0;
+}
+
+unsigned rist_data_fifo_overflow_take(struct rist_data_fifo *fifo)
+{
+	if (!atomic_load_explicit(&fifo->overflow, memory_order_relaxed))
+		return 0;
+	return atomic_exchange_explicit(&fifo->overflow, 0, memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_DATA_FIFO_H
+#define RIST_DATA_FIFO_H
+
+#include "common/attributes.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct rist_data_block;
+
+/*
+ * Output fifo of a receiver flow: bounded queue of data blocks written by the
+ * flow's data output thread and read by any number of application threads.
+ * Every cell carries a sequence number telling whether it holds the block for
+ * a given position or is free for it, so readers claim a run of ready cells
+ * with a single compare and swap and never touch a cell the writer reuses.
+ * Blocks that do not fit are counted instead of queued.
+ */
+struct rist_data_fifo_cell {
+	atomic_size_t seq;
+	struct rist_data_block *block;
+};
+
+struct rist_data_fifo {
+	struct rist_data_fifo_cell *cells;
+	size_t size;
+	size_t mask;
+	/* next position to write, data output thread only */
+	atomic_size_t tail;
+	/* keeps readers claiming cells off the writer's cache line */
+	char pad[64];
+	/* next position to read */
+	atomic_size_t head;
+	/* blocks dropped since a reader last reported it */
+	atomic_uint overflow;
+};
+
+/* size is a power of two, 0 makes every push fail */
+RIST_PRIV int rist_data_fifo_init(struct rist_data_fifo *fifo, size_t size);
+/* Releases the cells, blocks still queued must be popped first */
+RIST_PRIV void rist_data_fifo_free(struct rist_data_fifo *fifo);
+/* Single writer, false (and the drop counted) when the fifo is full */
+RIST_PRIV bool rist_data_fifo_push(struct rist_data_fifo *fifo, struct rist_data_block *block);
+/* Takes up to max blocks in order, returns how many */
+RIST_PRIV size_t rist_data_fifo_pop(struct rist_data_fifo *fifo, struct rist_data_block **blocks, size_t max);
+/* Blocks queued, exact only while nobody pushes or pops */
+RIST_PRIV size_t rist_data_fifo_count(struct rist_data_fifo *fifo);
+/* Drops since the previous call */
+RIST_PRIV unsigned rist_data_fifo_overflow_take(struct rist_data_fifo *fifo);
+
+#endif
@@ -12,8 +12,11 @@
 #include "rist-private.h"
 #include "udp-private.h"
 #include "log-private.h"
+#include "pthread-shim.h"
 
 #include <mbedtls/bignum.h>
+#include <mbedtls/md.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
@@ -27,17 +30,258 @@
 #define EAP_AUTH_TIMEOUT_RETRY_MAX 5
 #define EAP_AUTH_TIMEOUT 500//ms
 #define EAP_REAUTH_PERIOD 3000 // ms
+/*
+ * Once a full exchange succeeded both sides keep the SRP session key K, the
+ * authenticator reauthenticates by sending a random challenge in an
+ * EAP_SRP_SUBTYPE_LWRECHALLENGE request which the peer answers with
+ * HMAC-SHA256(K, challenge). Every EAP_LW_REAUTH_MAX+1th reauth is still a full
+ * exchange so verifier changes are picked up.
+ */
+#define EAP_LW_REAUTH_MAX 19
 
-void eap_reset_data(struct eapsrp_ctx *ctx)
+/*
+ * The authenticator side of the SRP exchange (verifier lookup and the modular
+ * exponentiations behind the server key) runs on a small shared worker pool so
+ * a burst of reconnecting peers cannot stall the protocol thread. Each ctx has
+ * at most one job in flight, packets for it are dropped until the result is
+ * picked up by eap_periodic(). When EAP_WORKER_MAX_PENDING jobs are queued new
+ * handshakes are deferred, the peer gets the request again on the next retry.
+ *
+ * Application lookup functions were only ever called from one protocol thread
+ * per context, so the workers serialize those calls. The lookups of the
+ * library itself are thread safe and run in parallel.
+ */
+#define EAP_WORKER_THREADS 4
+#define EAP_WORKER_MAX_PENDING 32
+
+enum eap_srp_job_type {
+	EAP_SRP_JOB_IDENTITY,
+	EAP_SRP_JOB_CLIENT_KEY,
+};
+
+enum eap_srp_job_state {
+	EAP_SRP_JOB_QUEUED = 0,
+	EAP_SRP_JOB_RUNNING,
+	EAP_SRP_JOB_DONE,
+};
+
+struct eap_srp_job {
+	struct eap_srp_job *next;
+	enum eap_srp_job_type type;
+	atomic_int state;
+	uint64_t queued_time;
+	uint64_t start_time;
+	int result;
+
+	char username[256];
+	user_verifier_lookup_t lookup_func;
+	void *lookup_func_userdata;
+	// owned by the job while it is in flight, handed back to the ctx when done
+	struct SRPSession *srp_session;
+	struct SRPVerifier *srp_verifier;
+	char *salt;
+	size_t salt_len;
+	char *verifier;
+	size_t verifier_len;
+	uint8_t *bytes_A;
+	size_t len_A;
+	const char *bytes_B;
+	size_t len_B;
+	size_t out_len;
+	uint8_t outpkt[1500];
+};
+
+static struct {
+	pthread_cond_t cond;
+	pthread_cond_t done_cond;
+	bool cond_initialized;
+	pthread_t threads[EAP_WORKER_THREADS];
+	size_t thread_count;
+	uintptr_t generation;
+	int refcount;
+	size_t pending;
+	struct eap_srp_job *head;
+	struct eap_srp_job *tail;
+} eap_worker;
+
+#if !defined(_WIN32) || HAVE_PTHREADS
+static pthread_mutex_t eap_worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t eap_lookup_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static pthread_mutex_t eap_worker_lock;
+static INIT_ONCE once_var;
+static pthread_mutex_t eap_lookup_lock;
+static INIT_ONCE lookup_once_var;
+#endif
+
+static void eap_srp_job_run(struct eap_srp_job *job);
+static void internal_user_verifier_lookup(char * username,
+							size_t *verifier_len, char **verifier,
+							size_t *salt_len, char **salt,
+							bool *use_default_2048_bit_n_modulus,
+							char **n_modulus_ascii,
+							char **generator_ascii,
+							void *user_data);
+
+static PTHREAD_START_FUNC(eap_worker_thread, arg)
 {
-	if (ctx->role == EAP_ROLE_AUTHENTICATOR)
-	{
-		free(ctx->authenticator_bytes_salt);
-		free(ctx->authenticator_bytes_verifier);
+	uintptr_t generation = (uintptr_t)arg;
+
+	pthread_mutex_lock(&eap_worker_lock);
+	while (eap_worker.generation == generation) {
+		struct eap_srp_job *job = eap_worker.head;
+		if (!job) {
+			pthread_cond_wait(&eap_worker.cond, &eap_worker_lock);
+			continue;
+		}
+		eap_worker.head = job->next;
+		if (!eap_worker.head)
+			eap_worker.tail = NULL;
+		job->next = NULL;
+		atomic_store_explicit(&job->state, EAP_SRP_JOB_RUNNING, memory_order_relaxed);
+		pthread_mutex_unlock(&eap_worker_lock);
+
+		job->start_time = timestampNTP_u64();
+		eap_srp_job_run(job);
+
+		pthread_mutex_lock(&eap_worker_lock);
+		eap_worker.pending--;
+		atomic_store_explicit(&job->state, EAP_SRP_JOB_DONE, memory_order_release);
+		pthread_cond_broadcast(&eap_worker.done_cond);
+	}
+	pthread_mutex_unlock(&eap_worker_lock);
+	return 0;
+}
+
+static void eap_worker_ref(struct eapsrp_ctx *ctx)
+{
+	if (ctx->worker_ref)
+		return;
+#if defined(_WIN32) && !HAVE_PTHREADS
+	init_mutex_once(&eap_worker_lock, &once_var);
+#endif
+	pthread_mutex_lock(&eap_worker_lock);
+	if (!eap_worker.cond_initialized) {
+		pthread_cond_init(&eap_worker.cond, NULL);
+		pthread_cond_init(&eap_worker.done_cond, NULL);
+		eap_worker.cond_initialized = true;
+	}
+	if (eap_worker.refcount++ == 0) {
+		eap_worker.generation++;
+		eap_worker.thread_count = 0;
+		for (size_t i = 0; i < EAP_WORKER_THREADS; i++) {
+			if (pthread_create(&eap_worker.threads[i], NULL, eap_worker_thread, (void *)eap_worker.generation) != 0)
+				break;
+			eap_worker.thread_count++;
+		}
+		if (eap_worker.thread_count == 0) {
+			// Without workers every handshake step simply runs inline
+			eap_worker.refcount--;
+			pthread_mutex_unlock(&eap_worker_lock);
+			return;
+		}
+	}
+	ctx->worker_ref = true;
+	pthread_mutex_unlock(&eap_worker_lock);
+}
+
+static void eap_worker_unref(struct eapsrp_ctx *ctx)
+{
+	if (!ctx->worker_ref)
+		return;
+	ctx->worker_ref = false;
+	pthread_mutex_lock(&eap_worker_lock);
+	if (--eap_worker.refcount > 0) {
+		pthread_mutex_unlock(&eap_worker_lock);
+		return;
+	}
+	// Every ctx is gone by now, so are their jobs
+	size_t thread_count = eap_worker.thread_count;
+	pthread_t threads[EAP_WORKER_THREADS];
+	memcpy(threads, eap_worker.threads, sizeof(threads));
+	eap_worker.thread_count = 0;
+	eap_worker.generation++;
+	pthread_cond_broadcast(&eap_worker.cond);
+	pthread_mutex_unlock(&eap_worker_lock);
+	for (size_t i = 0; i < thread_count; i++)
+		pthread_join(threads[i], NULL);
+}
+
+static bool eap_worker_full(struct eapsrp_ctx *ctx)
+{
+	if (!ctx->worker_ref)
+		return false;
+	pthread_mutex_lock(&eap_worker_lock);
+	bool full = eap_worker.pending >= EAP_WORKER_MAX_PENDING;
+	pthread_mutex_unlock(&eap_worker_lock);
+	return full;
+}
+
+/* Queues the job for the worker pool, false when there is no pool to run it */
+static bool eap_worker_submit(struct eapsrp_ctx *ctx, struct eap_srp_job *job)
+{
+	if (!ctx->worker_ref)
+		return false;
+	pthread_mutex_lock(&eap_worker_lock);
+	if (eap_worker.tail)
+		eap_worker.tail->next = job;
+	else
+		eap_worker.head = job;
+	eap_worker.tail = job;
+	eap_worker.pending++;
+	ctx->job = job;
+	pthread_cond_signal(&eap_worker.cond);
+	pthread_mutex_unlock(&eap_worker_lock);
+	return true;
+}
+
+static void eap_srp_job_free(struct eap_srp_job *job)
+{
+	if (job->srp_verifier)
+		srp_verifier_delete(job->srp_verifier);
+	if (job->srp_session)
+		srp_session_delete(job->srp_session);
+	free(job->salt);
+	free(job->verifier);
+	free(job->bytes_A);
+	free(job);
+}
+
+/* Drops the ctx's job, waits for it when a worker is busy with it */
+static void eap_worker_cancel(struct eapsrp_ctx *ctx)
+{
+	struct eap_srp_job *job = ctx->job;
+	if (!job)
+		return;
+	ctx->job = NULL;
+	pthread_mutex_lock(&eap_worker_lock);
+	if (atomic_load_explicit(&job->state, memory_order_relaxed) == EAP_SRP_JOB_QUEUED) {
+		struct eap_srp_job **prev = &eap_worker.head;
+		struct eap_srp_job *last = NULL;
+		while (*prev && *prev != job) {
+			last = *prev;
+			prev = &(*prev)->next;
+		}
+		if (*prev) {
+			*prev = job->next;
+			if (eap_worker.tail == job)
+				eap_worker.tail = last;
+			eap_worker.pending--;
+		}
+	} else {
+		while (atomic_load_explicit(&job->state, memory_order_relaxed) != EAP_SRP_JOB_DONE)
+			pthread_cond_wait(&eap_worker.done_cond, &eap_worker_lock);
 	}
+	pthread_mutex_unlock(&eap_worker_lock);
+	eap_srp_job_free(job);
+}
+
+void eap_reset_data(struct eapsrp_ctx *ctx)
+{
 	free(ctx->ascii_g);
 	free(ctx->ascii_n);
 	free(ctx->last_pkt);
+	free(ctx->last_request);
 	free(ctx->salt);
 	free(ctx->verifier);
 	if (ctx->srp_user)
@@ -49,14 +293,30 @@ void eap_reset_data(struct eapsrp_ctx *ctx)
 	ctx->ascii_g = NULL;
 	ctx->ascii_n = NULL;
 	ctx->last_pkt = NULL;
+	ctx->last_request = NULL;
+	ctx->last_request_size = 0;
 	ctx->salt = NULL;
 	ctx->salt_len = 0;
 	ctx->verifier = NULL;
 	ctx->srp_user = NULL;
 	ctx->srp_session = NULL;
 	ctx->srp_verifier = NULL;
-	ctx->authenticator_bytes_salt = NULL;
-	ctx->authenticator_bytes_verifier = NULL;
+	memset(ctx->session_key, 0, sizeof(ctx->session_key));
+	ctx->has_session_key = false;
+	ctx->lw_pending = false;
+}
+
+static void eap_store_session_key(struct eapsrp_ctx *ctx, const unsigned char *key, size_t key_len)
+{
+	ctx->has_session_key = key && key_len == sizeof(ctx->session_key);
+	if (ctx->has_session_key)
+		memcpy(ctx->session_key, key, key_len);
+}
+
+static int eap_lw_response(struct eapsrp_ctx *ctx, const uint8_t challenge[], uint8_t out[])
+{
+	return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), ctx->session_key, sizeof(ctx->session_key),
+						   challenge, sizeof(ctx->lw_challenge), out);
 }
 
 static int send_eapol_pkt(struct eapsrp_ctx *ctx, uint8_t eapoltype, uint8_t eapcode, uint8_t identifier, size_t payload_len, uint8_t buf[])
@@ -235,6 +495,9 @@ static int process_eap_request_srp_server_validator(struct eapsrp_ctx *ctx, uint
 		ctx->authentication_state = EAP_AUTH_STATE_SUCCESS;
 		ctx->last_auth_timestamp = timestampNTP_u64();
 		ctx->tries = 0;
+		size_t key_len = 0;
+		const unsigned char *key = srp_user_get_session_key(ctx->srp_user, &key_len);
+		eap_store_session_key(ctx, key, key_len);
 		uint8_t outpkt[(EAPOL_EAP_HDRS_OFFSET + sizeof(struct eap_srp_hdr))];
 		struct eap_srp_hdr *hdr = (struct eap_srp_hdr *)&outpkt[EAPOL_EAP_HDRS_OFFSET];
 		hdr->type = EAP_TYPE_SRP_SHA1;
@@ -248,7 +511,25 @@ static int process_eap_request_srp_server_validator(struct eapsrp_ctx *ctx, uint
 	return -1;
 }
 
-static int process_eap_request(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len, uint8_t identifier)
+static int process_eap_request_lw_rechallenge(struct eapsrp_ctx *ctx, uint8_t identifier, size_t len, uint8_t pkt[])
+{
+	uint8_t outpkt[(EAPOL_EAP_HDRS_OFFSET + sizeof(struct eap_srp_hdr) + DIGEST_LENGTH)];
+	struct eap_srp_hdr *hdr = (struct eap_srp_hdr *)&outpkt[EAPOL_EAP_HDRS_OFFSET];
+	hdr->type = EAP_TYPE_SRP_SHA1;
+	hdr->subtype = EAP_SRP_SUBTYPE_LWRECHALLENGE;
+	size_t out_len = sizeof(*hdr);
+	// Without a session key we answer empty, the authenticator falls back to a full exchange
+	ctx->lw_pending = false;
+	if (ctx->has_session_key && len == DIGEST_LENGTH &&
+		eap_lw_response(ctx, pkt, &outpkt[EAPOL_EAP_HDRS_OFFSET + sizeof(*hdr)]) == 0)
+	{
+		out_len += DIGEST_LENGTH;
+		ctx->lw_pending = true;
+	}
+	return send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_RESPONSE, identifier, out_len, outpkt);
+}
+
+static int process_eap_request_type(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len, uint8_t identifier)
 {
 	uint8_t type = pkt[0];
 	if (type == EAP_TYPE_IDENTITY)
@@ -268,7 +549,7 @@ static int process_eap_request(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len
 				return process_eap_request_srp_server_validator(ctx, identifier, (len -2), &pkt[2]);
 				break;
 			case EAP_SRP_SUBTYPE_LWRECHALLENGE:
-				//handle SRP lw rechallenge
+				return process_eap_request_lw_rechallenge(ctx, identifier, (len -2), &pkt[2]);
 				break;
 			default:
 				return EAP_SRP_WRONGSUBTYPE;
@@ -277,14 +558,34 @@ static int process_eap_request(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len
 	return -1;
 }
 
+static int process_eap_request(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len, uint8_t identifier)
+{
+	// A repeated request means our answer was lost or the authenticator is
+	// still busy, answering again from scratch would replace our SRP state
+	// (a fresh A) under the exchange that is already in progress
+	if (ctx->last_pkt && ctx->last_request && ctx->last_identifier == identifier &&
+		ctx->last_request_size == len && memcmp(ctx->last_request, pkt, len) == 0)
+	{
+		sendto(ctx->peer->sd, (const char *)ctx->last_pkt, ctx->last_pkt_size, 0, &ctx->peer->u.address, ctx->peer->address_len);
+		return 0;
+	}
+	ctx->last_identifier = identifier;
+	int ret = process_eap_request_type(ctx, pkt, len, identifier);
+	if (ret == 0 && ctx->last_pkt && ctx->last_identifier == identifier)
+	{
+		free(ctx->last_request);
+		ctx->last_request = malloc(len);
+		ctx->last_request_size = ctx->last_request ? len : 0;
+		if (ctx->last_request)
+			memcpy(ctx->last_request, pkt, len);
+	}
+	return ret;
+}
+
 //EAP RESPONSE HANDLING
 
-static int process_eap_response_identity(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
+static void eap_srp_job_identity(struct eap_srp_job *job)
 {
-	if (len > 255)
-		return -1;
-	memcpy(ctx->username, pkt, len);
-	ctx->username[len] = '\0';
 	char *bytes_v = NULL;
 	size_t len_v = 0;
 	char *bytes_s = NULL;
@@ -292,99 +593,239 @@ static int process_eap_response_identity(struct eapsrp_ctx *ctx, size_t len, uin
 	bool std_2048_ng = false;
 	char *ascii_n = NULL;
 	char *ascii_g = NULL;
-	ctx->lookup_func(ctx->username, &len_v, &bytes_v, &len_s, &bytes_s, &std_2048_ng, &ascii_n, &ascii_g, ctx->lookup_func_userdata);
+	bool serialize = job->lookup_func != internal_user_verifier_lookup &&
+					 job->lookup_func != rist_srp_verifier_store_lookup;
+	if (serialize) {
+#if defined(_WIN32) && !HAVE_PTHREADS
+		init_mutex_once(&eap_lookup_lock, &lookup_once_var);
+#endif
+		pthread_mutex_lock(&eap_lookup_lock);
+	}
+	job->lookup_func(job->username, &len_v, &bytes_v, &len_s, &bytes_s, &std_2048_ng, &ascii_n, &ascii_g, job->lookup_func_userdata);
+	if (serialize)
+		pthread_mutex_unlock(&eap_lookup_lock);
 	bool found = (len_v != 0 && bytes_v && len_s != 0 && bytes_s);
-	uint8_t outpkt[1500] = { 0 };//TUNE THIS
+	if (!found)
+	{
+		free(bytes_v);
+		free(bytes_s);
+		free(ascii_g);
+		free(ascii_n);
+		job->result = -1;
+		return;
+	}
+	uint8_t *outpkt = job->outpkt;
+	size_t outpkt_size = sizeof(job->outpkt);
+	memset(outpkt, 0, outpkt_size);
 	size_t offset = EAPOL_EAP_HDRS_OFFSET;
 	struct eap_srp_hdr *hdr = (struct eap_srp_hdr *)&outpkt[offset];
 	offset += sizeof(*hdr);
 	hdr->type = EAP_TYPE_SRP_SHA1;
 	hdr->subtype = EAP_SRP_SUBTYPE_CHALLENGE;
-	if (found)
+	job->salt = bytes_s;
+	job->salt_len = len_s;
+	job->verifier = bytes_v;
+	job->verifier_len = len_v;
+	offset += 2;//we dont send the server name
+	uint16_t *tmp_swap = (uint16_t *)&outpkt[offset];
+	*tmp_swap = htobe16(len_s);
+	offset += 2;
+	memcpy(&outpkt[offset], bytes_s, len_s);
+	offset += len_s;
+	if (std_2048_ng)
 	{
-		ctx->salt = malloc(len_s);
-		memcpy(ctx->salt, bytes_s, len_s);
-		ctx->verifier = malloc(len_v);
-		memcpy(ctx->verifier, bytes_v, len_v);
-		ctx->salt_len = len_s;
-		ctx->verifier_len = len_v;
-		memset(&pkt[offset], 0, 2);
-		offset += 2;//we dont send the server name
-		uint16_t *tmp_swap = (uint16_t *)&outpkt[offset];
-		*tmp_swap = htobe16(len_s);
+		job->srp_session = srp_session_new(HASH_ALGO, SRP_NG_2048, NULL, NULL);
+		offset += 2;
+	} else {
+		// generator with its length, the modulus takes the remainder of the packet
+		mbedtls_mpi tmp;
+		mbedtls_mpi_init(&tmp);
+		mbedtls_mpi_read_string(&tmp, 16, ascii_g);
+		tmp_swap = (uint16_t *)&outpkt[offset];
+		*tmp_swap = htobe16((uint16_t)mbedtls_mpi_size(&tmp));
 		offset += 2;
-		memcpy(&outpkt[offset], bytes_s, len_s);
-		offset += len_s;
-		if (std_2048_ng)
+		mbedtls_mpi_write_binary(&tmp, &outpkt[offset], mbedtls_mpi_size(&tmp));
+		offset += mbedtls_mpi_size(&tmp);
+		mbedtls_mpi_read_string(&tmp, 16, ascii_n);
+		if (offset + mbedtls_mpi_size(&tmp) <= outpkt_size)
 		{
-			if (ctx->srp_session)
-				srp_session_delete(ctx->srp_session);
-			ctx->srp_session = srp_session_new(HASH_ALGO, SRP_NG_2048, NULL, NULL);
-			memset(&outpkt[offset], 0, 2);
-			offset += 2;
-		} else {
-			mbedtls_mpi tmp;
-			mbedtls_mpi_init(&tmp);
-			mbedtls_mpi_read_string(&tmp, 16, ascii_g);
-			tmp_swap = (uint16_t *)&outpkt[offset];
-			*tmp_swap = htobe16((uint16_t)mbedtls_mpi_size(&tmp));
-			mbedtls_mpi_write_binary(&tmp, &outpkt[offset], (1500 - offset));
+			mbedtls_mpi_write_binary(&tmp, &outpkt[offset], mbedtls_mpi_size(&tmp));
 			offset += mbedtls_mpi_size(&tmp);
-			mbedtls_mpi_read_string(&tmp, 16, ascii_n);
-			tmp_swap = (uint16_t *)&outpkt[offset];
-			*tmp_swap = htobe16((uint16_t)mbedtls_mpi_size(&tmp));
-			mbedtls_mpi_write_binary(&tmp, &outpkt[offset], (1500 - offset));
-			if (ctx->srp_session)
-				srp_session_delete(ctx->srp_session);
-			ctx->srp_session = srp_session_new(HASH_ALGO, SRP_NG_CUSTOM, ascii_n, ascii_g);
 		}
+		mbedtls_mpi_free(&tmp);
+		job->srp_session = srp_session_new(HASH_ALGO, SRP_NG_CUSTOM, ascii_n, ascii_g);
 	}
-	free(bytes_v);
-	free(bytes_s);
 	free(ascii_g);
 	free(ascii_n);
-	if (!found)
-		return -1;
+	job->out_len = offset - EAPOL_EAP_HDRS_OFFSET;
+	job->result = 0;
+}
+
+static int eap_srp_finish_identity(struct eapsrp_ctx *ctx, struct eap_srp_job *job)
+{
+	if (job->result < 0)
+	{
+		rist_log_priv2(ctx->logging_settings, RIST_LOG_WARN, EAP_LOG_PREFIX"Unknown user %s@%s\n", ctx->username, ctx->ip_string);
+		return job->result;
+	}
+	free(ctx->salt);
+	free(ctx->verifier);
+	if (ctx->srp_session)
+		srp_session_delete(ctx->srp_session);
+	ctx->salt = job->salt;
+	ctx->salt_len = job->salt_len;
+	ctx->verifier = job->verifier;
+	ctx->verifier_len = job->verifier_len;
+	ctx->srp_session = job->srp_session;
+	job->salt = NULL;
+	job->verifier = NULL;
+	job->srp_session = NULL;
 	ctx->last_identifier++;
-	size_t out_len = offset;
-	out_len -= EAPOL_EAP_HDRS_OFFSET;
-	return send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_REQUEST, ctx->last_identifier, out_len, outpkt);
+	return send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_REQUEST, ctx->last_identifier, job->out_len, job->outpkt);
 }
 
-static int process_eap_response_client_key(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
+static void eap_srp_job_client_key(struct eap_srp_job *job)
 {
-	char *bytes_B;
-	size_t len_B;
+	job->srp_verifier = srp_verifier_new(job->srp_session, job->username,
+										 (const unsigned char*)job->salt, job->salt_len,
+										 (const unsigned char*)job->verifier, job->verifier_len,
+										 job->bytes_A, job->len_A,
+										 (const unsigned char **)&job->bytes_B, &job->len_B);
+	job->result = job->bytes_B ? 0 : -255;
+}
+
+static int eap_srp_finish_client_key(struct eapsrp_ctx *ctx, struct eap_srp_job *job)
+{
+	// hand the session data back, the verifier references the session's N/g
+	ctx->srp_session = job->srp_session;
+	ctx->salt = job->salt;
+	ctx->verifier = job->verifier;
 	if (ctx->srp_verifier)
 		srp_verifier_delete(ctx->srp_verifier);
-
-	ctx->srp_verifier = srp_verifier_new(ctx->srp_session, ctx->username,
-										 (const unsigned char*)ctx->salt, ctx->salt_len,
-										 (const unsigned char*)ctx->verifier, ctx->verifier_len,
-										 pkt, len,
-										 (const unsigned char **)&bytes_B, &len_B);
-	if (!bytes_B)
+	ctx->srp_verifier = job->srp_verifier;
+	job->srp_session = NULL;
+	job->salt = NULL;
+	job->verifier = NULL;
+	job->srp_verifier = NULL;
+	if (job->result < 0)
 	{
 		//perm failure set tries to max
 		ctx->authentication_state = EAP_AUTH_STATE_FAILED;
 		ctx->tries = 255;
 		return -255;
 	}
-	uint8_t *outpkt = malloc((EAPOL_EAP_HDRS_OFFSET + sizeof(struct eap_srp_hdr) + len_B));
+	uint8_t *outpkt = malloc((EAPOL_EAP_HDRS_OFFSET + sizeof(struct eap_srp_hdr) + job->len_B));
 	struct eap_srp_hdr *hdr = (struct eap_srp_hdr *)&outpkt[EAPOL_EAP_HDRS_OFFSET];
 	hdr->type = EAP_TYPE_SRP_SHA1;
 	hdr->subtype = EAP_SRP_SUBTYPE_SERVER_KEY;
-	memcpy(&outpkt[(EAPOL_EAP_HDRS_OFFSET + sizeof(*hdr))], bytes_B, len_B);
+	memcpy(&outpkt[(EAPOL_EAP_HDRS_OFFSET + sizeof(*hdr))], job->bytes_B, job->len_B);
 	ctx->last_identifier++;
-	int ret = send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_REQUEST, ctx->last_identifier, (sizeof(struct eap_srp_hdr) + len_B), outpkt);
+	int ret = send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_REQUEST, ctx->last_identifier, (sizeof(struct eap_srp_hdr) + job->len_B), outpkt);
 	free(outpkt);
 	return ret;
 }
 
+static void eap_srp_job_run(struct eap_srp_job *job)
+{
+	switch (job->type)
+	{
+		case EAP_SRP_JOB_IDENTITY:
+			eap_srp_job_identity(job);
+			break;
+		case EAP_SRP_JOB_CLIENT_KEY:
+			eap_srp_job_client_key(job);
+			break;
+	}
+}
+
+static int eap_srp_job_finish(struct eapsrp_ctx *ctx, struct eap_srp_job *job)
+{
+	if (ctx->worker_ref)
+	{
+		ctx->stats.jobs++;
+		ctx->stats.queue_time_sum += rist_clock_ntp_to_us(job->start_time - job->queued_time);
+	}
+	int ret = -1;
+	switch (job->type)
+	{
+		case EAP_SRP_JOB_IDENTITY:
+			ret = eap_srp_finish_identity(ctx, job);
+			break;
+		case EAP_SRP_JOB_CLIENT_KEY:
+			ret = eap_srp_finish_client_key(ctx, job);
+			break;
+	}
+	eap_srp_job_free(job);
+	return ret;
+}
+
+/* Runs the job on the worker pool, or inline when there is none */
+static int eap_srp_job_start(struct eapsrp_ctx *ctx, struct eap_srp_job *job)
+{
+	job->queued_time = timestampNTP_u64();
+	if (eap_worker_submit(ctx, job))
+		return 0;
+	job->start_time = job->queued_time;
+	eap_srp_job_run(job);
+	return eap_srp_job_finish(ctx, job);
+}
+
+static int process_eap_response_identity(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
+{
+	if (len > 255)
+		return -1;
+	memcpy(ctx->username, pkt, len);
+	ctx->username[len] = '\0';
+	struct eap_srp_job *job = calloc(1, sizeof(*job));
+	if (!job)
+		return -1;
+	ctx->handshake_start = timestampNTP_u64();
+	job->type = EAP_SRP_JOB_IDENTITY;
+	strcpy(job->username, ctx->username);
+	job->lookup_func = ctx->lookup_func;
+	job->lookup_func_userdata = ctx->lookup_func_userdata;
+	return eap_srp_job_start(ctx, job);
+}
+
+static int process_eap_response_client_key(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
+{
+	if (!ctx->srp_session || !ctx->salt || !ctx->verifier)
+		return EAP_UNEXPECTEDRESPONSE;
+	struct eap_srp_job *job = calloc(1, sizeof(*job));
+	if (!job)
+		return -1;
+	job->bytes_A = malloc(len);
+	if (!job->bytes_A)
+	{
+		free(job);
+		return -1;
+	}
+	memcpy(job->bytes_A, pkt, len);
+	job->len_A = len;
+	job->type = EAP_SRP_JOB_CLIENT_KEY;
+	strcpy(job->username, ctx->username);
+	job->srp_session = ctx->srp_session;
+	job->salt = ctx->salt;
+	job->salt_len = ctx->salt_len;
+	job->verifier = ctx->verifier;
+	job->verifier_len = ctx->verifier_len;
+	ctx->srp_session = NULL;
+	ctx->salt = NULL;
+	ctx->verifier = NULL;
+	if (ctx->srp_verifier)
+	{
+		srp_verifier_delete(ctx->srp_verifier);
+		ctx->srp_verifier = NULL;
+	}
+	return eap_srp_job_start(ctx, job);
+}
+
 static int process_eap_response_client_validator(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
 {
 	if (len < (4 + DIGEST_LENGTH))
 		return EAP_LENERR;
+	if (!ctx->srp_verifier)
+		return EAP_UNEXPECTEDRESPONSE;
 	char *bytes_HAMK;
 	srp_verifier_verify_session(ctx->srp_verifier, &pkt[4], (const unsigned char**)&bytes_HAMK);
 	if (!bytes_HAMK)
@@ -417,8 +858,23 @@ static int process_eap_response_srp_server_validator(struct eapsrp_ctx *ctx)
 	{
 		if (ctx->authentication_state < EAP_AUTH_STATE_SUCCESS)
 			rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, EAP_LOG_PREFIX"Successfully authenticated %s@%s\n", ctx->username, ctx->ip_string);
+		if (ctx->authentication_state == EAP_AUTH_STATE_REAUTH)
+			ctx->stats.full_reauths++;
 		ctx->authentication_state = EAP_AUTH_STATE_SUCCESS;
 		ctx->last_auth_timestamp = timestampNTP_u64();
+		size_t key_len = 0;
+		const unsigned char *key = srp_verifier_get_session_key(ctx->srp_verifier, &key_len);
+		eap_store_session_key(ctx, key, key_len);
+		ctx->lw_reauth_count = 0;
+		if (ctx->handshake_start)
+		{
+			uint64_t latency = rist_clock_ntp_to_us(ctx->last_auth_timestamp - ctx->handshake_start);
+			ctx->stats.handshakes++;
+			ctx->stats.latency_sum += latency;
+			if (latency > ctx->stats.latency_max)
+				ctx->stats.latency_max = latency;
+			ctx->handshake_start = 0;
+		}
 		ctx->tries = 0;
 		ctx->last_identifier++;
 		uint8_t buf[EAPOL_EAP_HDRS_OFFSET];
@@ -428,10 +884,62 @@ static int process_eap_response_srp_server_validator(struct eapsrp_ctx *ctx)
 	return 0;
 }
 
+static int eap_request_lw_rechallenge(struct eapsrp_ctx *ctx)
+{
+	uint8_t outpkt[(EAPOL_EAP_HDRS_OFFSET + sizeof(struct eap_srp_hdr) + DIGEST_LENGTH)];
+	struct eap_srp_hdr *hdr = (struct eap_srp_hdr *)&outpkt[EAPOL_EAP_HDRS_OFFSET];
+	hdr->type = EAP_TYPE_SRP_SHA1;
+	hdr->subtype = EAP_SRP_SUBTYPE_LWRECHALLENGE;
+	srp_random_bytes(ctx->lw_challenge, sizeof(ctx->lw_challenge));
+	memcpy(&outpkt[EAPOL_EAP_HDRS_OFFSET + sizeof(*hdr)], ctx->lw_challenge, DIGEST_LENGTH);
+	ctx->lw_requested = true;
+	ctx->last_identifier++;
+	return send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_REQUEST, ctx->last_identifier, (sizeof(*hdr) + DIGEST_LENGTH), outpkt);
+}
+
+static int process_eap_response_lw_rechallenge(struct eapsrp_ctx *ctx, size_t len, uint8_t pkt[])
+{
+	if (ctx->authentication_state != EAP_AUTH_STATE_REAUTH || !ctx->has_session_key)
+		return EAP_UNEXPECTEDRESPONSE;
+	ctx->lw_requested = false;
+	ctx->lw_answered = true;
+	uint8_t expected[DIGEST_LENGTH];
+	uint8_t diff = 1;
+	if (len == DIGEST_LENGTH && eap_lw_response(ctx, ctx->lw_challenge, expected) == 0)
+	{
+		diff = 0;
+		for (size_t i = 0; i < DIGEST_LENGTH; i++)
+			diff |= expected[i] ^ pkt[i];
+	}
+	if (diff != 0)
+	{
+		rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, EAP_LOG_PREFIX"Session key rechallenge failed for %s@%s, running full reauthentication\n", ctx->username, ctx->ip_string);
+		ctx->stats.lw_failures++;
+		ctx->has_session_key = false;
+		return eap_request_identity(ctx);
+	}
+	ctx->authentication_state = EAP_AUTH_STATE_SUCCESS;
+	ctx->last_auth_timestamp = timestampNTP_u64();
+	ctx->tries = 0;
+	ctx->lw_reauth_count++;
+	ctx->stats.lw_reauths++;
+	ctx->last_identifier++;
+	uint8_t buf[EAPOL_EAP_HDRS_OFFSET];
+	return send_eapol_pkt(ctx, EAPOL_TYPE_EAP, EAP_CODE_SUCCESS, ctx->last_identifier, 0, buf);
+}
+
 static int process_eap_response(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len)
 {
 	uint8_t type = pkt[0];
 	ctx->timeout_retries = 0;
+	// Starting SRP work with the workers saturated only grows the backlog, keep
+	// our request pending instead so it is repeated after EAP_AUTH_TIMEOUT
+	if ((type == EAP_TYPE_IDENTITY || (type == EAP_TYPE_SRP_SHA1 && len > 1 && pkt[1] == EAP_SRP_SUBTYPE_CLIENT_KEY)) &&
+		eap_worker_full(ctx))
+	{
+		ctx->stats.deferred++;
+		return 0;
+	}
 	free(ctx->last_pkt);
 	ctx->last_pkt_size = 0;
 	ctx->last_pkt = NULL;
@@ -452,7 +960,7 @@ static int process_eap_response(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t le
 				return process_eap_response_srp_server_validator(ctx);
 				break;
 			case EAP_SRP_SUBTYPE_LWRECHALLENGE:
-				//handle SRP lw rechallenge
+				return process_eap_response_lw_rechallenge(ctx, (len -2), &pkt[2]);
 				break;
 			default:
 				return EAP_SRP_WRONGSUBTYPE;
@@ -467,6 +975,9 @@ static int process_eap_pkt(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len)
 		return -1;
 	if (ctx->authentication_state == EAP_AUTH_STATE_FAILED && ctx->tries >EAP_AUTH_RETRY_MAX)
 		return -255;
+	// Busy with the previous step on a worker
+	if (ctx->job)
+		return 0;
 	struct eap_hdr *hdr = (struct eap_hdr *)pkt;
 	uint8_t code = hdr->code;
 	uint8_t identifier = hdr->identifier;
@@ -487,7 +998,15 @@ static int process_eap_pkt(struct eapsrp_ctx *ctx, uint8_t pkt[], size_t len)
 			return process_eap_response(ctx, &pkt[sizeof(*hdr)], (len - sizeof(*hdr)));
 			break;
 		case EAP_CODE_SUCCESS:
-			//handle eap success
+			// only the rechallenge response waits for it, the full exchange
+			// already completed on the server validator
+			if (ctx->lw_pending)
+			{
+				ctx->lw_pending = false;
+				ctx->authentication_state = EAP_AUTH_STATE_SUCCESS;
+				ctx->last_auth_timestamp = timestampNTP_u64();
+				ctx->tries = 0;
+			}
 			return 0;
 			break;
 		case EAP_CODE_FAILURE:
@@ -553,6 +1072,10 @@ int eap_clone_ctx(struct eapsrp_ctx *in, struct rist_peer *peer)
 			memcpy(ctx->authenticator_bytes_salt, in->authenticator_bytes_salt, in->authenticator_len_salt);
 		ctx->authenticator_len_salt = in->authenticator_len_salt;
 		ctx->authenticator_len_verifier = in->authenticator_len_verifier;
+		// Lookups run on the workers, let them read our own copy of the single user
+		if (ctx->lookup_func == internal_user_verifier_lookup)
+			ctx->lookup_func_userdata = ctx;
+		eap_worker_ref(ctx);
 		if (!ctx->last_pkt)
 			eap_request_identity(ctx);//immediately request identity
 		return 0;
@@ -570,7 +1093,14 @@ void eap_delete_ctx(struct eapsrp_ctx **in)
 		return;
 
 	struct eapsrp_ctx *ctx = *in;
+	eap_worker_cancel(ctx);
+	eap_worker_unref(ctx);
 	eap_reset_data(ctx);
+	if (ctx->role == EAP_ROLE_AUTHENTICATOR)
+	{
+		free(ctx->authenticator_bytes_salt);
+		free(ctx->authenticator_bytes_verifier);
+	}
 
 	free(ctx);
 	*in = NULL;
@@ -589,7 +1119,7 @@ int eap_process_eapol(struct eapsrp_ctx* ctx, uint8_t pkt[], size_t len)
 			return process_eap_pkt(ctx, &pkt[sizeof(*hdr)], body_len);
 			break;
 		case EAPOL_TYPE_START:
-			if (ctx->role == EAP_ROLE_AUTHENTICATOR && !ctx->last_pkt)
+			if (ctx->role == EAP_ROLE_AUTHENTICATOR && !ctx->last_pkt && !ctx->job)
 				return eap_request_identity(ctx);
 			return 0;
 			break;
@@ -602,6 +1132,15 @@ int eap_process_eapol(struct eapsrp_ctx* ctx, uint8_t pkt[], size_t len)
 	return -1;
 }
 
+bool eap_get_handshake_stats(struct eapsrp_ctx *ctx, struct eap_handshake_stats *stats)
+{
+	if (ctx == NULL || ctx->role != EAP_ROLE_AUTHENTICATOR)
+		return false;
+	*stats = ctx->stats;
+	memset(&ctx->stats, 0, sizeof(ctx->stats));
+	return true;
+}
+
 bool eap_is_authenticated(struct eapsrp_ctx *ctx)
 {
 	if (ctx == NULL)
@@ -613,6 +1152,14 @@ void eap_periodic(struct eapsrp_ctx *ctx)
 {
 	if (ctx == NULL)
 		return;
+	struct eap_srp_job *job = ctx->job;
+	if (job)
+	{
+		if (atomic_load_explicit(&job->state, memory_order_acquire) != EAP_SRP_JOB_DONE)
+			return;
+		ctx->job = NULL;
+		eap_srp_job_finish(ctx, job);
+	}
 	uint64_t now = timestampNTP_u64();
 	uint64_t retry_period = EAP_AUTH_TIMEOUT * RIST_CLOCK;
 	uint64_t reauth_period = EAP_REAUTH_PERIOD * RIST_CLOCK;//3 seconds
@@ -620,6 +1167,22 @@ void eap_periodic(struct eapsrp_ctx *ctx)
 	if (ctx->role == EAP_ROLE_AUTHENTICATOR && ctx->authentication_state != 1 && ctx->last_timestamp + retry_period < now &&
 		ctx->timeout_retries < EAP_AUTH_TIMEOUT_RETRY_MAX && ctx->tries <= EAP_AUTH_RETRY_MAX)
 	{
+		if (ctx->lw_requested)
+		{
+			// Peers that predate the rechallenge drop it without an answer,
+			// the full exchange works with every peer
+			rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, EAP_LOG_PREFIX"Session key rechallenge unanswered by %s@%s, running full reauthentication\n", ctx->username, ctx->ip_string);
+			ctx->stats.lw_failures++;
+			ctx->lw_requested = false;
+			ctx->lw_ignored = !ctx->lw_answered;
+			ctx->has_session_key = false;
+			free(ctx->last_pkt);
+			ctx->last_pkt_size = 0;
+			ctx->last_pkt = NULL;
+			ctx->reauth_timestamp = now;
+			eap_request_identity(ctx);
+			return;
+		}
 		if (ctx->last_pkt)
 		{
 			sendto(ctx->peer->sd, (const char *)ctx->last_pkt, ctx->last_pkt_size, 0, &ctx->peer->u.address, ctx->peer->address_len);
@@ -634,7 +1197,11 @@ void eap_periodic(struct eapsrp_ctx *ctx)
 	} else if (ctx->role == EAP_ROLE_AUTHENTICATOR && ctx->authentication_state == EAP_AUTH_STATE_SUCCESS &&
 	           now > ctx->last_auth_timestamp + reauth_period) {
 		ctx->authentication_state = EAP_AUTH_STATE_REAUTH;
-		eap_request_identity(ctx);
+		ctx->reauth_timestamp = now;
+		if (ctx->has_session_key && !ctx->lw_ignored && ctx->lw_reauth_count < EAP_LW_REAUTH_MAX)
+			eap_request_lw_rechallenge(ctx);
+		else
+			eap_request_identity(ctx);
 		return;
 	}
 	else if (ctx->role == EAP_ROLE_AUTHENTICATEE && ctx->authentication_state ==  EAP_AUTH_STATE_SUCCESS &&
@@ -644,8 +1211,20 @@ void eap_periodic(struct eapsrp_ctx *ctx)
 		return;
 	}
 	uint64_t reauth_time_out = ctx->last_auth_timestamp + reauth_period + EAP_AUTH_RETRY_MAX * retry_period;
+	if (ctx->role == EAP_ROLE_AUTHENTICATOR)
+		reauth_time_out = ctx->reauth_timestamp + EAP_AUTH_RETRY_MAX * retry_period;
 	if (ctx->authentication_state == EAP_AUTH_STATE_REAUTH && now > reauth_time_out) {
 		ctx->authentication_state = EAP_AUTH_STATE_UNAUTH;
+		// Drop the unanswered request so the next EAPOL start or retry
+		// period begins a new exchange instead of repeating it forever
+		if (ctx->role == EAP_ROLE_AUTHENTICATOR)
+		{
+			free(ctx->last_pkt);
+			ctx->last_pkt_size = 0;
+			ctx->last_pkt = NULL;
+			ctx->lw_requested = false;
+			ctx->timeout_retries = 0;
+		}
 		return;
 	}
 
@@ -735,6 +1314,8 @@ int rist_enable_eap_srp(struct rist_peer *peer, const char *username, const char
 		ctx->lookup_func = lookup_func;
 		ctx->lookup_func_userdata = userdata;
 		ctx->role = EAP_ROLE_AUTHENTICATOR;
+		// Keep the worker pool up for as long as we are listening
+		eap_worker_ref(ctx);
 		peer->eap_ctx = ctx;
 		struct rist_peer *child = peer->child;
 		peer->eap_authentication_state = 1;
@@ -74,6 +74,26 @@ RIST_PACKED_STRUCT(eap_srp_hdr, {
 #define EAP_AUTH_STATE_SUCCESS 1
 #define EAP_AUTH_STATE_REAUTH 2
 
+struct eap_srp_job;
+
+/* Authenticator side handshake counters, reset every stats interval */
+struct eap_handshake_stats
+{
+	uint32_t handshakes;
+	// responses dropped because the worker queue was full, the peer retries
+	uint32_t deferred;
+	// identity response to success (us)
+	uint64_t latency_sum;
+	uint64_t latency_max;
+	// time jobs spent waiting for a worker (us)
+	uint32_t jobs;
+	uint64_t queue_time_sum;
+	// reauthentications by full SRP exchange vs session key rechallenge
+	uint32_t full_reauths;
+	uint32_t lw_reauths;
+	uint32_t lw_failures;
+};
+
 struct eapsrp_ctx
 {
 	uint_fast8_t role;
@@ -83,6 +103,9 @@ struct eapsrp_ctx
 
 	uint8_t *last_pkt;
 	size_t last_pkt_size;
+	// authenticatee: request last_pkt answered, repeats get the same answer
+	uint8_t *last_request;
+	size_t last_request_size;
 	uint8_t timeout_retries;
 	uint64_t last_timestamp;
 	uint64_t last_auth_timestamp;
@@ -113,6 +136,25 @@ struct eapsrp_ctx
 	char *authenticator_bytes_verifier;
 	size_t authenticator_len_salt;
 	char *authenticator_bytes_salt;
+
+	// authenticator SRP work offloaded to the worker pool (at most one per ctx)
+	bool worker_ref;
+	struct eap_srp_job *job;
+	uint64_t handshake_start;
+	struct eap_handshake_stats stats;
+
+	// session key of the last full exchange, lets reauth skip the SRP math
+	bool has_session_key;
+	uint8_t session_key[SHA256_DIGEST_LENGTH];
+	uint8_t lw_challenge[SHA256_DIGEST_LENGTH];
+	uint8_t lw_reauth_count;
+	bool lw_pending;
+	// authenticator: rechallenge outstanding, peer answered one before, peer
+	// never answered one (predates it) so reauth runs the full exchange
+	bool lw_requested;
+	bool lw_answered;
+	bool lw_ignored;
+	uint64_t reauth_timestamp;
 };
 
 #define EAP_LENERR -1
@@ -129,4 +171,6 @@ RIST_PRIV bool eap_is_authenticated(struct eapsrp_ctx *ctx);
 RIST_PRIV void eap_delete_ctx(struct eapsrp_ctx **in);
 RIST_PRIV int eap_clone_ctx(struct eapsrp_ctx *in, struct rist_peer *peer);
 RIST_PRIV void eap_set_ip_string(struct eapsrp_ctx *ctx, char ip_string[]);
+/* Copies out and resets the handshake counters, false when ctx is not an authenticator */
+RIST_PRIV bool eap_get_handshake_stats(struct eapsrp_ctx *ctx, struct eap_handshake_stats *stats);
 #endif
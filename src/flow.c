@@ -9,12 +9,55 @@
 #include "rist-private.h"
 #include "log-private.h"
 #include "udp-private.h"
+#include "mpegts.h"
 #include <assert.h>
 
-void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer,uint64_t nack_time, uint32_t seq, uint32_t rtt)
+void rist_receiver_path_update(struct rist_peer *peer, struct rist_buffer *first, uint64_t now)
+{
+	/* A copy of an already queued packet arrived, if it came in through a
+	   different path both paths are carrying the same stream */
+	struct rist_peer *first_peer = first->peer;
+	if (!first_peer || first_peer == peer || now < first->time)
+		return;
+	uint64_t lag = now - first->time;
+	if (lag > peer->path_skew)
+		peer->path_skew = lag;
+	else
+		peer->path_skew -= (peer->path_skew - lag) / 16;
+	first_peer->path_skew -= first_peer->path_skew / 16;
+	peer->path_last_dupe = now;
+	first_peer->path_last_dupe = now;
+}
+
+static uint64_t rist_receiver_redundant_path_delay(struct rist_flow *f, struct rist_peer *peer, uint64_t now)
+{
+	/* Longest time any other active duplicate (weight 0) path is expected to
+	   lag behind, a missing packet may still arrive through it */
+	uint64_t delay = 0;
+	for (size_t i = 0; i < f->peer_lst_len; i++)
+	{
+		struct rist_peer *p = f->peer_lst[i];
+		if (!p->is_data && p->peer_data)
+			p = p->peer_data;
+		if (p == peer || p->dead || p->config.weight != 0)
+			continue;
+		if ((now - p->path_last_dupe) > RIST_PATH_ACTIVE_TIME || (now - p->path_last_arrival) > RIST_PATH_ACTIVE_TIME)
+			continue;
+		if (p->path_skew > delay)
+			delay = p->path_skew;
+	}
+	if (delay == 0)
+		return 0;
+	delay += RIST_MAX_JITTER * RIST_CLOCK;
+	// Always leave room in the buffer for the actual retransmissions
+	if (delay > f->recovery_buffer_ticks / 4)
+		delay = f->recovery_buffer_ticks / 4;
+	return delay;
+}
+
+void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer, uint64_t now, uint64_t nack_time, uint32_t seq, uint32_t rtt)
 {
 	struct rist_missing_buffer *m = calloc(1, sizeof(*m));
-	uint64_t now = timestampNTP_u64();
 	if (nack_time > now)
 		nack_time = now;
 	if (nack_time < (now - f->recovery_buffer_ticks))
@@ -23,6 +66,9 @@ void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer,uint64_t
 	m->insertion_time = nack_time;
 
 	m->next_nack = now + (uint64_t)rtt * (uint64_t)RIST_CLOCK;
+	uint64_t path_delay = rist_receiver_redundant_path_delay(f, peer, now);
+	if (now + path_delay > m->next_nack)
+		m->next_nack = now + path_delay;
 	m->peer = peer;
 
 	if (get_cctx(peer)->debug)
@@ -76,6 +122,36 @@ void rist_flush_missing_flow_queue(struct rist_flow *flow)
 	flow->missing_counter = 0;
 }
 
+#define FLOW_COUNTER_TAKE(name) \
+	snapshot->name = atomic_exchange_explicit(&counters->name, 0, memory_order_relaxed)
+
+void rist_flow_counters_snapshot(struct rist_flow_counters *counters, struct rist_peer_flow_stats *snapshot)
+{
+	// Read and zero each counter in one step, increments racing with the
+	// snapshot land in the next report instead of being lost
+	FLOW_COUNTER_TAKE(lost);
+	FLOW_COUNTER_TAKE(received);
+	FLOW_COUNTER_TAKE(dupe);
+	FLOW_COUNTER_TAKE(dropped_full);
+	FLOW_COUNTER_TAKE(dropped_late);
+	FLOW_COUNTER_TAKE(buffer_duration_count);
+	FLOW_COUNTER_TAKE(buffer_duration_sum);
+	FLOW_COUNTER_TAKE(missing);
+	FLOW_COUNTER_TAKE(retries);
+	FLOW_COUNTER_TAKE(recovered);
+	FLOW_COUNTER_TAKE(reordered);
+	FLOW_COUNTER_TAKE(recovered_0nack);
+	FLOW_COUNTER_TAKE(recovered_1nack);
+	FLOW_COUNTER_TAKE(recovered_2nack);
+	FLOW_COUNTER_TAKE(recovered_3nack);
+	FLOW_COUNTER_TAKE(recovered_morenack);
+	FLOW_COUNTER_TAKE(recovered_sum);
+	FLOW_COUNTER_TAKE(recovered_redundancy);
+	FLOW_COUNTER_TAKE(wakeups);
+	FLOW_COUNTER_TAKE(wakeups_coalesced);
+	FLOW_COUNTER_TAKE(fifo_overflow);
+}
+
 void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f)
 {
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Triggering data output thread termination\n");
@@ -138,14 +214,15 @@ void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f)
 	empty_receiver_queue(f, &ctx->common);
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing data fifo queue\n");
-	for (size_t i = 0; i < ctx->fifo_queue_size; i++)
+	struct rist_data_block *block;
+	while (rist_data_fifo_pop(&f->dataout_fifo, &block, 1))
 	{
-		if (f->dataout_fifo_queue[i])
-		{
-			free_data_block(&f->dataout_fifo_queue[i]);
-		}
+		if (block)
+			free_data_block(&block);
 	}
-	free(f->dataout_fifo_queue);
+	rist_data_fifo_free(&f->dataout_fifo);
+	free(f->stats_report.json);
+	rist_metrics_forget(&ctx->common.metrics, RIST_STATS_RECEIVER_FLOW, f->flow_id);
 	// Delete flow
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Deleting flow\n");
 	struct rist_flow **prev_flow = &ctx->common.FLOWS;
@@ -194,9 +271,27 @@ static struct rist_flow *create_flow(struct rist_receiver *ctx, uint32_t flow_id
 	f->receiver_id = ctx->id;
 	f->stats_next_time = timestampNTP_u64();
 	f->max_output_jitter = ctx->common.rist_max_jitter;
-	f->dataout_fifo_queue = calloc(ctx->fifo_queue_size, sizeof(*f->dataout_fifo_queue));
+	rist_clock_drift_init(&f->clock_drift, 250 * RIST_CLOCK);
+	if (ctx->output_pacing == RIST_OUTPUT_PACING_MPEGTS_PCR) {
+		f->pcr_pacing = true;
+		f->pcr_pacing_margin = (uint64_t)ctx->output_pacing_jitter_ms * RIST_CLOCK;
+		rist_source_clock_init(&f->pcr_clock, MPEGTS_PCR_HZ, MPEGTS_PCR_WRAP, 250 * RIST_CLOCK);
+		// releases run late by up to one wake up of the data output thread
+		if ((uint64_t)f->max_output_jitter > f->pcr_pacing_margin)
+			f->max_output_jitter = (int)f->pcr_pacing_margin;
+	}
+	f->latency_adaptive = ctx->latency_mode == RIST_LATENCY_ADAPTIVE;
+	f->fast_start = ctx->fast_start_ms != 0;
+	f->fast_start_buffer = (uint64_t)ctx->fast_start_ms * RIST_CLOCK;
+	f->latency_slew = f->latency_adaptive || f->fast_start;
+	if (rist_data_fifo_init(&f->dataout_fifo, ctx->fifo_queue_size) != 0) {
+		free(f);
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create data output fifo of %" PRIu32 " blocks, OOM\n", ctx->fifo_queue_size);
+		return NULL;
+	}
 	int ret = pthread_cond_init(&f->condition, NULL);
 	if (ret) {
+		rist_data_fifo_free(&f->dataout_fifo);
 		free(f);
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d calling pthread_cond_init\n", ret);
 		return NULL;
@@ -205,6 +300,7 @@ static struct rist_flow *create_flow(struct rist_receiver *ctx, uint32_t flow_id
 	ret = pthread_mutex_init(&f->mutex, NULL);
 	if (ret){
 		pthread_cond_destroy(&f->condition);
+		rist_data_fifo_free(&f->dataout_fifo);
 		free(f);
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d calling pthread_mutex_init\n", ret);
 		return NULL;
@@ -212,9 +308,6 @@ static struct rist_flow *create_flow(struct rist_receiver *ctx, uint32_t flow_id
 
 	atomic_init(&f->receiver_queue_size, 0);
 	atomic_init(&f->receiver_queue_output_idx, 0);
-	atomic_init(&f->dataout_fifo_queue_write_index, 0);
-	atomic_init(&f->dataout_fifo_queue_read_index, 0);
-	atomic_init(&f->fifo_overflow, false);
 
 	f->session_timeout = RIST_DEFAULT_SESSION_TIMEOUT * RIST_CLOCK;
 	f->flow_timeout = 250 * RIST_CLOCK;
@@ -295,8 +388,8 @@ int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id)
 	}
 
 	// Transfer variables from peer to flow
-	// Set/update max flow buffer size
-	if (f->recovery_buffer_ticks < p->recovery_buffer_ticks) {
+	// Set/update max flow buffer size, a slewed buffer only moves its bounds
+	if (f->recovery_buffer_ticks < p->recovery_buffer_ticks && !(f->latency_slew && f->latency.ms)) {
 		if (f->stats_report_time == f->recovery_buffer_ticks)
 			f->stats_report_time = p->recovery_buffer_ticks;
 		f->recovery_buffer_ticks = p->recovery_buffer_ticks;
@@ -308,6 +401,22 @@ int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id)
 	// to make sure it is larger than the RTCP interval
 	if (f->recovery_buffer_ticks > f->flow_timeout)
 		f->flow_timeout = f->recovery_buffer_ticks;
+	if (f->latency_slew) {
+		// An adaptive buffer moves between the widest bounds of the peers,
+		// a fixed one converges to the largest buffer of the peers
+		uint64_t latency_min = p->recovery_buffer_ticks;
+		uint64_t latency_max = p->recovery_buffer_ticks;
+		if (f->latency_adaptive) {
+			latency_min = (uint64_t)p->config.recovery_length_min * RIST_CLOCK;
+			latency_max = (uint64_t)p->config.recovery_length_max * RIST_CLOCK;
+		}
+		if (!f->latency.ms)
+			rist_latency_control_init(&f->latency, RIST_CLOCK, latency_min, latency_max, f->recovery_buffer_ticks, timestampNTP_u64());
+		else
+			rist_latency_control_bounds(&f->latency, latency_min, latency_max);
+		if ((f->latency.max * 2ULL) > f->session_timeout)
+			f->session_timeout = 2ULL * f->latency.max;
+	}
 	uint64_t stats_report_time = get_cctx(p)->stats_report_time;
 	if (stats_report_time != 0 && stats_report_time != f->stats_report_time) 
 		f->stats_report_time = stats_report_time;
@@ -0,0 +1,54 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "histogram.h"
+#include <string.h>
+
+uint64_t rist_histogram_bucket_value(unsigned index)
+{
+	if (index < RIST_HISTOGRAM_SUB_COUNT)
+		return index;
+	unsigned shift = (index >> RIST_HISTOGRAM_SUB_BITS) - 1;
+	uint64_t low = (uint64_t)(RIST_HISTOGRAM_SUB_COUNT + (index & (RIST_HISTOGRAM_SUB_COUNT - 1))) << shift;
+	return low + (1ULL << shift) - 1;
+}
+
+void rist_histogram_take(struct rist_histogram *h, struct rist_stats_percentiles *out)
+{
+	uint32_t counts[RIST_HISTOGRAM_BUCKETS];
+	uint64_t total = 0;
+	unsigned highest = 0;
+	for (unsigned i = 0; i < RIST_HISTOGRAM_BUCKETS; i++)
+	{
+		// Samples racing with the read land in the next interval
+		counts[i] = atomic_exchange_explicit(&h->buckets[i], 0, memory_order_relaxed);
+		total += counts[i];
+		if (counts[i])
+			highest = i;
+	}
+	memset(out, 0, sizeof(*out));
+	out->count = total;
+	if (!total)
+		return;
+	// Rank of each percentile, rounded up: p50 of 3 samples is the 2nd one
+	const uint64_t ranks[4] = {
+		(total * 500 + 999) / 1000,
+		(total * 900 + 999) / 1000,
+		(total * 990 + 999) / 1000,
+		(total * 999 + 999) / 1000,
+	};
+	uint64_t *values[4] = { &out->p50, &out->p90, &out->p99, &out->p999 };
+	uint64_t seen = 0;
+	unsigned next = 0;
+	for (unsigned i = 0; i <= highest && next < 4; i++)
+	{
+		seen += counts[i];
+		while (next < 4 && seen >= ranks[next])
+			*values[next++] = rist_histogram_bucket_value(i);
+	}
+	out->max = rist_histogram_bucket_value(highest);
+}
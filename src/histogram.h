@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_HISTOGRAM_H
+#define RIST_HISTOGRAM_H
+
+#include "common/attributes.h"
+#include "librist/stats.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ * Log bucketed latency histogram (HDR style): values below 16 get a bucket each,
+ * above that every power of two is split in 16 linear sub buckets, so a reported
+ * percentile is at most 1/16th above the real value. Values are microseconds and
+ * saturate at UINT32_MAX.
+ *
+ * Samples are recorded with one relaxed atomic increment so the protocol and
+ * data output threads can feed the same histogram, rist_histogram_take() reads
+ * and clears it from the stats timer.
+ */
+#define RIST_HISTOGRAM_SUB_BITS 4
+#define RIST_HISTOGRAM_SUB_COUNT (1U << RIST_HISTOGRAM_SUB_BITS)
+#define RIST_HISTOGRAM_BUCKETS ((32 - RIST_HISTOGRAM_SUB_BITS + 1) * RIST_HISTOGRAM_SUB_COUNT)
+
+struct rist_histogram {
+	atomic_uint buckets[RIST_HISTOGRAM_BUCKETS];
+};
+
+static inline unsigned rist_histogram_index(uint64_t value)
+{
+	uint32_t v = value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+	if (v < RIST_HISTOGRAM_SUB_COUNT)
+		return v;
+#if defined(_MSC_VER)
+	unsigned long msb;
+	_BitScanReverse(&msb, v);
+#else
+	unsigned msb = 31 - (unsigned)__builtin_clz(v);
+#endif
+	unsigned shift = (unsigned)msb - RIST_HISTOGRAM_SUB_BITS;
+	return ((shift + 1) << RIST_HISTOGRAM_SUB_BITS) + ((v >> shift) - RIST_HISTOGRAM_SUB_COUNT);
+}
+
+static inline void rist_histogram_record(struct rist_histogram *h, uint64_t value)
+{
+	atomic_fetch_add_explicit(&h->buckets[rist_histogram_index(value)], 1, memory_order_relaxed);
+}
+
+/* Highest value that lands in bucket index */
+RIST_PRIV uint64_t rist_histogram_bucket_value(unsigned index);
+/* Computes the percentiles of everything recorded since the last call and
+ * clears the histogram */
+RIST_PRIV void rist_histogram_take(struct rist_histogram *h, struct rist_stats_percentiles *out);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "latency-control.h"
+
+static uint64_t latency_control_clamp(const struct rist_latency_control *lc, uint64_t value)
+{
+	if (value < lc->min)
+		return lc->min;
+	if (value > lc->max)
+		return lc->max;
+	return value;
+}
+
+void rist_latency_control_init(struct rist_latency_control *lc, uint64_t ms, uint64_t min, uint64_t max,
+							   uint64_t start, uint64_t now)
+{
+	lc->ms = ms;
+	lc->min = min;
+	lc->max = max < min ? min : max;
+	lc->target = latency_control_clamp(lc, start);
+	lc->applied = lc->target;
+	lc->last_slew = now;
+	lc->next_check = now + RIST_LATENCY_CHECK_INTERVAL_MS * ms;
+	lc->clean_checks = 0;
+	lc->recovery_max = 0;
+}
+
+void rist_latency_control_bounds(struct rist_latency_control *lc, uint64_t min, uint64_t max)
+{
+	if (min > lc->min)
+		lc->min = min;
+	if (max > lc->max)
+		lc->max = max;
+	if (lc->max < lc->min)
+		lc->max = lc->min;
+	lc->target = latency_control_clamp(lc, lc->target);
+}
+
+void rist_latency_control_recovered(struct rist_latency_control *lc, uint64_t duration)
+{
+	if (duration > lc->recovery_max)
+		lc->recovery_max = duration;
+}
+
+bool rist_latency_control_check(struct rist_latency_control *lc, uint32_t misses, uint64_t rtt, uint64_t now)
+{
+	if (now < lc->next_check)
+		return false;
+	lc->next_check = now + RIST_LATENCY_CHECK_INTERVAL_MS * lc->ms;
+	uint64_t target = lc->target;
+	if (misses) {
+		// grow fast, a quarter at a time
+		uint64_t step = target / 4;
+		if (step < 50 * lc->ms)
+			step = 50 * lc->ms;
+		target = latency_control_clamp(lc, target + step);
+		lc->clean_checks = 0;
+	} else if (++lc->clean_checks >= RIST_LATENCY_CLEAN_CHECKS) {
+		// shrink slowly, never below what the recoveries of the last
+		// stretch took plus room for one more retry
+		uint64_t step = target / 10;
+		if (step < 10 * lc->ms)
+			step = 10 * lc->ms;
+		uint64_t needed = lc->recovery_max * 3 / 2 + 2 * rtt;
+		if (needed < target)
+			target = latency_control_clamp(lc, target > needed + step ? target - step : needed);
+		lc->clean_checks = 0;
+		lc->recovery_max = 0;
+	}
+	if (target == lc->target)
+		return false;
+	lc->target = target;
+	return true;
+}
+
+void rist_latency_control_rebase(struct rist_latency_control *lc, uint64_t applied, uint64_t now)
+{
+	lc->applied = applied;
+	lc->last_slew = now;
+}
+
+uint64_t rist_latency_control_slew(struct rist_latency_control *lc, uint64_t now)
+{
+	if (now <= lc->last_slew || lc->applied == lc->target) {
+		if (now > lc->last_slew)
+			lc->last_slew = now;
+		return lc->applied;
+	}
+	uint64_t step = (now - lc->last_slew) * RIST_LATENCY_SLEW_PERCENT / 100;
+	// per packet calls keep the time that did not add up to a tick
+	if (!step)
+		return lc->applied;
+	lc->last_slew += step * 100 / RIST_LATENCY_SLEW_PERCENT;
+	uint64_t distance = lc->applied < lc->target ? lc->target - lc->applied : lc->applied - lc->target;
+	if (distance <= step) {
+		lc->applied = lc->target;
+		lc->last_slew = now;
+	} else if (lc->applied < lc->target) {
+		lc->applied += step;
+	} else {
+		lc->applied -= step;
+	}
+	return lc->applied;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_LATENCY_CONTROL_H
+#define RIST_LATENCY_CONTROL_H
+
+#include "common/attributes.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* the target is reconsidered once per interval */
+#define RIST_LATENCY_CHECK_INTERVAL_MS 1000
+/* intervals without deadline misses before a shrink step */
+#define RIST_LATENCY_CLEAN_CHECKS 10
+/* the applied buffer moves toward the target by this share of elapsed time */
+#define RIST_LATENCY_SLEW_PERCENT 2
+
+/*
+ * Adaptive receiver buffer between the recovery_length_min and
+ * recovery_length_max of the peers of a flow. Packets that missed their
+ * output deadline grow the target, long clean stretches shrink it toward what
+ * recoveries actually took. The applied buffer follows the target slowly so
+ * output only speeds up or slows down by a few percent, no packet is dropped
+ * or repeated for a change.
+ * Protocol thread only, times in clock ticks.
+ */
+struct rist_latency_control {
+	uint64_t ms;
+	uint64_t min;
+	uint64_t max;
+	uint64_t target;
+	uint64_t applied;
+	uint64_t last_slew;
+	uint64_t next_check;
+	uint32_t clean_checks;
+	/* longest recovery since the last shrink step */
+	uint64_t recovery_max;
+};
+
+/* ms is the number of clock ticks in a millisecond */
+RIST_PRIV void rist_latency_control_init(struct rist_latency_control *lc, uint64_t ms, uint64_t min, uint64_t max,
+										 uint64_t start, uint64_t now);
+/* Widens the bounds for a peer joining the flow */
+RIST_PRIV void rist_latency_control_bounds(struct rist_latency_control *lc, uint64_t min, uint64_t max);
+/* A missing packet arrived duration after it was detected missing */
+RIST_PRIV void rist_latency_control_recovered(struct rist_latency_control *lc, uint64_t duration);
+/* Reconsiders the target once per interval, misses are the packets that
+ * missed their deadline since the last call and rtt the round trip of the
+ * flow. Returns true when the target changed. */
+RIST_PRIV bool rist_latency_control_check(struct rist_latency_control *lc, uint32_t misses, uint64_t rtt, uint64_t now);
+/* Sets the applied buffer, which moves toward the target from there */
+RIST_PRIV void rist_latency_control_rebase(struct rist_latency_control *lc, uint64_t applied, uint64_t now);
+/* Buffer to apply to a packet queued at now */
+RIST_PRIV uint64_t rist_latency_control_slew(struct rist_latency_control *lc, uint64_t now);
+
+#endif
@@ -11,7 +11,43 @@
 #include "common/attributes.h"
 #include "rist-private.h"
 
-RIST_PRIV void rist_log_priv(struct rist_common_ctx *cctx, enum rist_log_level level, const char *format, ...);
-RIST_PRIV void rist_log_priv2(struct rist_logging_settings *logging_settings, enum rist_log_level level, const char *format, ...);
-RIST_PRIV void rist_log_priv3(enum rist_log_level level, const char *format, ...);
+RIST_PRIV void rist_log_priv_emit(struct rist_common_ctx *cctx, enum rist_log_level level, const char *format, ...);
+RIST_PRIV void rist_log_priv2_emit(struct rist_logging_settings *logging_settings, enum rist_log_level level, const char *format, ...);
+RIST_PRIV void rist_log_priv3_emit(enum rist_log_level level, const char *format, ...);
+
+/*
+ * The level is tested before any argument is evaluated, so the atomic loads,
+ * clock reads and queue walks feeding a discarded message cost nothing.
+ * Building with -Ddebug_logging=false drops RIST_LOG_DEBUG calls entirely.
+ */
+#ifdef RIST_DISABLE_DEBUG_LOGGING
+#define RIST_LOG_COMPILED(level) ((level) != RIST_LOG_DEBUG)
+#else
+#define RIST_LOG_COMPILED(level) 1
+#endif
+
+#define RIST_LOG_WANTED(settings, level) \
+	(RIST_LOG_COMPILED(level) && (settings) != NULL && (int)(level) <= (int)(settings)->log_level)
+
+//For places where we have access to common ctx
+#define rist_log_priv(cctx, level, ...) \
+	do { \
+		if (RIST_LOG_WANTED((cctx)->logging_settings, level)) \
+			rist_log_priv_emit(cctx, level, __VA_ARGS__); \
+	} while (0)
+
+#define rist_log_priv2(logging_settings, level, ...) \
+	do { \
+		if (RIST_LOG_WANTED(logging_settings, level)) \
+			rist_log_priv2_emit(logging_settings, level, __VA_ARGS__); \
+	} while (0)
+
+//Where we don't have access to either logging settings or common ctx (i.e.: udpsocket)
+#define rist_log_priv3(level, ...) \
+	do { \
+		if (RIST_LOG_COMPILED(level)) \
+			rist_log_priv3_emit(level, __VA_ARGS__); \
+	} while (0)
+/* Waits until the asynchronous logger delivered everything queued so far */
+RIST_PRIV void rist_log_async_flush(void);
 #endif
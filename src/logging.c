@@ -13,7 +13,9 @@
 #include "librist/logging.h"
 #include "pthread-shim.h"
 #include "config.h"
+#include "clock.h"
 #include <assert.h>
+#include <stdatomic.h>
 #if defined(_WIN32) && !HAVE_PTHREADS
 #include <windows.h>
 #endif
@@ -34,72 +36,294 @@ static struct {
 static INIT_ONCE once_var = INIT_ONCE_STATIC_INIT;
 #endif
 
-static inline void rist_log_impl(struct rist_logging_settings *log_settings,
-				 enum rist_log_level level, intptr_t sender_id,
-				 intptr_t receiver_id, const char *format,
-				 va_list argp)
-{
-	if (level > log_settings->log_level ||
-	    (!log_settings->log_cb && (log_settings->log_socket < 0) &&
-	     !log_settings->log_stream))
-		return;
+/* Where a message goes, copied into async records so the drain thread never
+ * dereferences the caller's settings */
+struct rist_log_target {
+	int (*log_cb)(void *arg, enum rist_log_level, const char *msg);
+	void *log_cb_arg;
+	int log_socket;
+	FILE *log_stream;
+};
 
-	char *msg;
-	int ret = vasprintf(&msg, format, argp);
-	if (ret <= 0) {
-		fprintf(stderr, "[ERROR] Could not format log message!\n");
-		return;
-	}
+/*
+ * Asynchronous mode: producers format into fixed size records of a bounded
+ * MPSC ring (per slot sequence numbers, one CAS to claim a slot) and a single
+ * thread delivers them. A full ring drops the message instead of blocking.
+ * The thread sleeps on a condvar once the ring is empty, producers only take
+ * its mutex to wake it when it announced that it is going to sleep.
+ */
+#define RIST_LOG_RECORD_SIZE 512
 
-	if (log_settings->log_cb) {
-		log_settings->log_cb(log_settings->log_cb_arg, level, msg);
-		free(msg);
-		return;
-	}
-	const char *prefix;
+struct rist_log_record {
+	atomic_size_t seq;
+	enum rist_log_level level;
+	intptr_t sender_id;
+	intptr_t receiver_id;
+	struct timeval tv;
+	struct rist_log_target target;
+	char msg[RIST_LOG_RECORD_SIZE - sizeof(atomic_size_t) - sizeof(enum rist_log_level) - 2 * sizeof(intptr_t) -
+			 sizeof(struct timeval) - sizeof(struct rist_log_target)];
+};
+
+/* Per call site limiter, keyed on the format string address */
+#define RIST_LOG_SITES 256
+#define RIST_LOG_SITE_PROBES 4
+
+struct rist_log_site {
+	atomic_uintptr_t key;
+	atomic_uint_fast64_t window_start;
+	atomic_uint count;
+	atomic_uint suppressed;
+};
+
+static struct {
+	atomic_bool enabled;
+	atomic_uint producers;
+	struct rist_log_record *ring;
+	size_t mask;
+	atomic_size_t enqueue_pos;
+	atomic_size_t dequeue_pos;
+	atomic_bool stop;
+	atomic_bool sleeping;
+	pthread_mutex_t wake_lock;
+	pthread_cond_t wake;
+	pthread_t thread;
+	atomic_uint rate_limit;
+	atomic_uint_fast64_t dropped;
+	struct rist_log_site sites[RIST_LOG_SITES];
+} log_async;
+
+#if !defined(_WIN32) || HAVE_PTHREADS
+static pthread_mutex_t log_async_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static pthread_mutex_t log_async_lock;
+static INIT_ONCE log_async_once = INIT_ONCE_STATIC_INIT;
+#endif
+
+static const char *rist_log_prefix(enum rist_log_level level)
+{
 	switch (level) {
 	case RIST_LOG_DEBUG:
-		prefix = "[DEBUG]";
-		break;
+		return "[DEBUG]";
 	case RIST_LOG_INFO:
-		prefix = "[INFO]";
-		break;
+		return "[INFO]";
 	case RIST_LOG_NOTICE:
-		prefix = "[NOTICE]";
-		break;
+		return "[NOTICE]";
 	case RIST_LOG_WARN:
-		prefix = "[WARNING]";
-		break;
+		return "[WARNING]";
 	case RIST_LOG_ERROR:
 		RIST_FALLTHROUGH;
 	default:
-		prefix = "[ERROR]";
-		break;
+		return "[ERROR]";
 	}
-	char *logmsg;
+}
 
-	ssize_t msglen;
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	msglen = asprintf(&logmsg, "%d.%6.6d|%"PRIdPTR".%"PRIdPTR"|%s %s", (int)tv.tv_sec,
-			 (int)tv.tv_usec, receiver_id, sender_id, prefix, msg);
+static void rist_log_deliver(const struct rist_log_target *target, enum rist_log_level level,
+			     intptr_t sender_id, intptr_t receiver_id, const struct timeval *tv, const char *msg)
+{
+	if (target->log_cb) {
+		target->log_cb(target->log_cb_arg, level, msg);
+		return;
+	}
+	char *logmsg;
+	ssize_t msglen = asprintf(&logmsg, "%d.%6.6d|%"PRIdPTR".%"PRIdPTR"|%s %s", (int)tv->tv_sec,
+			 (int)tv->tv_usec, receiver_id, sender_id, rist_log_prefix(level), msg);
 	if (RIST_UNLIKELY(msglen <= 0)) {
 		fprintf(stderr, "[ERROR] Failed to format log message\n");
-		goto out;
+		return;
 	}
-	if (log_settings->log_socket)
-		udpsocket_send_nonblocking(log_settings->log_socket, logmsg, msglen);
-	if (log_settings->log_stream) {
-		fputs(logmsg, log_settings->log_stream);
-		fflush(log_settings->log_stream);
+	if (target->log_socket)
+		udpsocket_send_nonblocking(target->log_socket, logmsg, msglen);
+	if (target->log_stream) {
+		fputs(logmsg, target->log_stream);
+		fflush(target->log_stream);
 	}
 	free(logmsg);
-out:
+}
+
+/* Returns false when the call site used up its budget for the current second,
+ * *suppressed is set to the count held back in the previous window */
+static bool rist_log_site_allow(const char *format, unsigned limit, unsigned *suppressed)
+{
+	uintptr_t key = (uintptr_t)format;
+	size_t hash = (size_t)((key >> 3) * 2654435761U);
+	struct rist_log_site *site = NULL;
+	for (size_t i = 0; i < RIST_LOG_SITE_PROBES; i++) {
+		struct rist_log_site *s = &log_async.sites[(hash + i) & (RIST_LOG_SITES - 1)];
+		uintptr_t expected = atomic_load_explicit(&s->key, memory_order_relaxed);
+		if (expected == key ||
+			(expected == 0 && (atomic_compare_exchange_strong(&s->key, &expected, key) || expected == key))) {
+			site = s;
+			break;
+		}
+	}
+	// too many distinct sites in this neighbourhood, let it through
+	if (!site)
+		return true;
+	uint64_t now = timestampNTP_u64();
+	uint64_t start = atomic_load_explicit(&site->window_start, memory_order_relaxed);
+	if (now - start >= (uint64_t)1000 * RIST_CLOCK &&
+		atomic_compare_exchange_strong(&site->window_start, &start, now)) {
+		atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+		*suppressed = atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+	}
+	if (atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed) < limit)
+		return true;
+	atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&log_async.dropped, 1, memory_order_relaxed);
+	return false;
+}
+
+static bool rist_log_async_push(const struct rist_log_target *target, enum rist_log_level level,
+				intptr_t sender_id, intptr_t receiver_id, const struct timeval *tv,
+				const char *format, va_list argp)
+{
+	size_t pos = atomic_load_explicit(&log_async.enqueue_pos, memory_order_relaxed);
+	struct rist_log_record *rec;
+	for (;;) {
+		rec = &log_async.ring[pos & log_async.mask];
+		size_t seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&log_async.enqueue_pos, &pos, pos + 1,
+								  memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			atomic_fetch_add_explicit(&log_async.dropped, 1, memory_order_relaxed);
+			return false;
+		} else {
+			pos = atomic_load_explicit(&log_async.enqueue_pos, memory_order_relaxed);
+		}
+	}
+	rec->level = level;
+	rec->sender_id = sender_id;
+	rec->receiver_id = receiver_id;
+	rec->tv = *tv;
+	rec->target = *target;
+	int len = vsnprintf(rec->msg, sizeof(rec->msg), format, argp);
+	// keep the line ending of truncated messages
+	size_t format_len = strlen(format);
+	if (len >= (int)sizeof(rec->msg) && format_len && format[format_len - 1] == '\n')
+		rec->msg[sizeof(rec->msg) - 2] = '\n';
+	else if (len < 0)
+		rec->msg[0] = '\0';
+	atomic_store_explicit(&rec->seq, pos + 1, memory_order_release);
+	// pairs with the fence in rist_log_async_thread(): either it sees the
+	// record before sleeping or we see it asleep
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&log_async.sleeping, memory_order_relaxed)) {
+		pthread_mutex_lock(&log_async.wake_lock);
+		pthread_cond_signal(&log_async.wake);
+		pthread_mutex_unlock(&log_async.wake_lock);
+	}
+	return true;
+}
+
+static void rist_log_async_pushf(const struct rist_log_target *target, enum rist_log_level level,
+				 intptr_t sender_id, intptr_t receiver_id, const struct timeval *tv,
+				 const char *format, ...)
+{
+	va_list argp;
+	va_start(argp, format);
+	rist_log_async_push(target, level, sender_id, receiver_id, tv, format, argp);
+	va_end(argp);
+}
+
+/* Delivers everything published so far, single consumer */
+static size_t rist_log_async_drain(void)
+{
+	size_t count = 0;
+	size_t pos = atomic_load_explicit(&log_async.dequeue_pos, memory_order_relaxed);
+	for (;;) {
+		struct rist_log_record *rec = &log_async.ring[pos & log_async.mask];
+		size_t seq = atomic_load_explicit(&rec->seq, memory_order_acquire);
+		if (seq != pos + 1)
+			break;
+		rist_log_deliver(&rec->target, rec->level, rec->sender_id, rec->receiver_id, &rec->tv, rec->msg);
+		atomic_store_explicit(&rec->seq, pos + log_async.mask + 1, memory_order_release);
+		pos++;
+		atomic_store_explicit(&log_async.dequeue_pos, pos, memory_order_release);
+		count++;
+	}
+	return count;
+}
+
+static bool rist_log_async_pending(void)
+{
+	size_t pos = atomic_load_explicit(&log_async.dequeue_pos, memory_order_relaxed);
+	return atomic_load_explicit(&log_async.ring[pos & log_async.mask].seq, memory_order_acquire) == pos + 1;
+}
+
+static PTHREAD_START_FUNC(rist_log_async_thread, arg)
+{
+	(void)arg;
+	while (!atomic_load_explicit(&log_async.stop, memory_order_acquire)) {
+		if (rist_log_async_drain())
+			continue;
+		pthread_mutex_lock(&log_async.wake_lock);
+		atomic_store_explicit(&log_async.sleeping, true, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (!rist_log_async_pending() && !atomic_load_explicit(&log_async.stop, memory_order_acquire))
+			pthread_cond_wait(&log_async.wake, &log_async.wake_lock);
+		atomic_store_explicit(&log_async.sleeping, false, memory_order_relaxed);
+		pthread_mutex_unlock(&log_async.wake_lock);
+	}
+	rist_log_async_drain();
+	return 0;
+}
+
+static void rist_log_impl(struct rist_logging_settings *log_settings,
+				 enum rist_log_level level, intptr_t sender_id,
+				 intptr_t receiver_id, const char *format,
+				 va_list argp)
+{
+	if (level > log_settings->log_level ||
+	    (!log_settings->log_cb && (log_settings->log_socket < 0) &&
+	     !log_settings->log_stream))
+		return;
+
+	unsigned suppressed = 0;
+	unsigned limit = atomic_load_explicit(&log_async.rate_limit, memory_order_relaxed);
+	if (limit && !rist_log_site_allow(format, limit, &suppressed))
+		return;
+
+	struct rist_log_target target = {
+		.log_cb = log_settings->log_cb,
+		.log_cb_arg = log_settings->log_cb_arg,
+		.log_socket = log_settings->log_socket,
+		.log_stream = log_settings->log_stream,
+	};
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	// seq_cst pairs with rist_log_async_stop(): either it sees us or we see it disabled
+	atomic_fetch_add(&log_async.producers, 1);
+	if (atomic_load(&log_async.enabled)) {
+		if (suppressed)
+			rist_log_async_pushf(&target, level, sender_id, receiver_id, &tv, "%u messages like the next one were suppressed\n", suppressed);
+		rist_log_async_push(&target, level, sender_id, receiver_id, &tv, format, argp);
+		atomic_fetch_sub_explicit(&log_async.producers, 1, memory_order_release);
+		return;
+	}
+	atomic_fetch_sub_explicit(&log_async.producers, 1, memory_order_release);
+
+	char *msg;
+	int ret = vasprintf(&msg, format, argp);
+	if (ret <= 0) {
+		fprintf(stderr, "[ERROR] Could not format log message!\n");
+		return;
+	}
+	if (suppressed) {
+		char note[64];
+		snprintf(note, sizeof(note), "%u messages like the next one were suppressed\n", suppressed);
+		rist_log_deliver(&target, level, sender_id, receiver_id, &tv, note);
+	}
+	rist_log_deliver(&target, level, sender_id, receiver_id, &tv, msg);
 	free(msg);
 }
 
 //For places where we have access to common ctx
-void rist_log_priv(struct rist_common_ctx *cctx, enum rist_log_level level, const char *format, ...)
+void rist_log_priv_emit(struct rist_common_ctx *cctx, enum rist_log_level level, const char *format, ...)
 {
 	if (RIST_UNLIKELY(cctx->logging_settings == NULL))
 		return;
@@ -109,7 +333,7 @@ void rist_log_priv(struct rist_common_ctx *cctx, enum rist_log_level level, cons
 	va_end(argp);
 }
 
-void rist_log_priv2(struct rist_logging_settings *logging_settings, enum rist_log_level level, const char *format, ...) {
+void rist_log_priv2_emit(struct rist_logging_settings *logging_settings, enum rist_log_level level, const char *format, ...) {
 	if (RIST_UNLIKELY(logging_settings == NULL ))
 		return;
 	va_list argp;
@@ -130,7 +354,7 @@ void rist_log(struct rist_logging_settings *logging_settings, enum rist_log_leve
 }
 
 //Where we don't have access to either logging settings or common ctx (i.e.: udpsocket)
-void rist_log_priv3(enum rist_log_level level, const char *format, ...)
+void rist_log_priv3_emit(enum rist_log_level level, const char *format, ...)
 {
 	va_list argp;
 	va_start(argp, format);
@@ -201,6 +425,7 @@ void rist_logging_unset_global(void)
 	{
 		return;
 	}
+	rist_log_async_flush();
 	pthread_mutex_lock(&global_logging_settings.global_logs_lock);
 	if (global_logging_settings.settings.log_socket >= 0 &&
 #ifndef _WIN32
@@ -225,6 +450,8 @@ int rist_logging_set(struct rist_logging_settings **logging_settings, enum rist_
 {
 	if (!logging_settings)
 		return -1;
+	// queued records may still point at the old socket/stream
+	rist_log_async_flush();
 	struct rist_logging_settings *settings = *logging_settings;
 	bool alloc = false;
 	if (!settings) {
@@ -311,3 +538,83 @@ err:
 	}
 	return -1;
 }
+
+static int log_async_init_once(void)
+{
+#if defined(_WIN32) && !HAVE_PTHREADS
+	return init_mutex_once(&log_async_lock, &log_async_once);
+#endif
+	return 0;
+}
+
+static void rist_log_async_stop(void)
+{
+	atomic_store(&log_async.enabled, false);
+	while (atomic_load(&log_async.producers))
+		usleep(100);
+	pthread_mutex_lock(&log_async.wake_lock);
+	atomic_store_explicit(&log_async.stop, true, memory_order_release);
+	pthread_cond_signal(&log_async.wake);
+	pthread_mutex_unlock(&log_async.wake_lock);
+	pthread_join(log_async.thread, NULL);
+	pthread_cond_destroy(&log_async.wake);
+	pthread_mutex_destroy(&log_async.wake_lock);
+	free(log_async.ring);
+	log_async.ring = NULL;
+}
+
+void rist_log_async_flush(void)
+{
+	if (!atomic_load(&log_async.enabled))
+		return;
+	size_t target = atomic_load(&log_async.enqueue_pos);
+	while (atomic_load(&log_async.enabled) && atomic_load(&log_async.dequeue_pos) < target)
+		usleep(500);
+}
+
+int rist_logging_set_async(size_t queue_size, unsigned rate_limit)
+{
+	if (log_async_init_once() != 0)
+		return -1;
+	size_t size = 16;
+	while (size < queue_size && size < (1U << 20))
+		size <<= 1;
+	pthread_mutex_lock(&log_async_lock);
+	atomic_store_explicit(&log_async.rate_limit, rate_limit, memory_order_relaxed);
+	if (log_async.ring && (!queue_size || size != log_async.mask + 1))
+		rist_log_async_stop();
+	int ret = 0;
+	if (queue_size && !log_async.ring) {
+		log_async.ring = malloc(size * sizeof(*log_async.ring));
+		if (!log_async.ring) {
+			ret = -1;
+			goto out;
+		}
+		for (size_t i = 0; i < size; i++)
+			atomic_init(&log_async.ring[i].seq, i);
+		log_async.mask = size - 1;
+		atomic_store(&log_async.enqueue_pos, 0);
+		atomic_store(&log_async.dequeue_pos, 0);
+		atomic_store(&log_async.stop, false);
+		atomic_store(&log_async.sleeping, false);
+		pthread_mutex_init(&log_async.wake_lock, NULL);
+		pthread_cond_init(&log_async.wake, NULL);
+		if (pthread_create(&log_async.thread, NULL, rist_log_async_thread, NULL) != 0) {
+			pthread_cond_destroy(&log_async.wake);
+			pthread_mutex_destroy(&log_async.wake_lock);
+			free(log_async.ring);
+			log_async.ring = NULL;
+			ret = -1;
+			goto out;
+		}
+		atomic_store(&log_async.enabled, true);
+	}
+out:
+	pthread_mutex_unlock(&log_async_lock);
+	return ret;
+}
+
+uint64_t rist_logging_get_dropped(void)
+{
+	return atomic_load_explicit(&log_async.dropped, memory_order_relaxed);
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "metrics.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum metrics_kind {
+	METRICS_COUNTER,
+	METRICS_GAUGE,
+	METRICS_SUMMARY,
+};
+
+enum metrics_field {
+	METRICS_U32,
+	METRICS_U64,
+	METRICS_SIZE,
+	METRICS_DOUBLE,
+	METRICS_PERCENTILES,
+};
+
+struct metrics_desc {
+	enum rist_stats_type type;
+	enum metrics_kind kind;
+	enum metrics_field field;
+	size_t offset;
+	const char *name;
+	const char *help;
+};
+
+#define SENDER(kind, field, member, name, help) \
+	{ RIST_STATS_SENDER_PEER, kind, field, offsetof(struct rist_stats_sender_peer, member), name, help }
+#define RECEIVER(kind, field, member, name, help) \
+	{ RIST_STATS_RECEIVER_FLOW, kind, field, offsetof(struct rist_stats_receiver_flow, member), name, help }
+
+static const struct metrics_desc metrics_descs[] = {
+	SENDER(METRICS_COUNTER, METRICS_U64, sent, "rist_sender_sent_packets", "Packets sent"),
+	SENDER(METRICS_COUNTER, METRICS_U64, received, "rist_sender_received_packets", "Packets received"),
+	SENDER(METRICS_COUNTER, METRICS_U64, retransmitted, "rist_sender_retransmitted_packets", "Packets retransmitted"),
+	SENDER(METRICS_GAUGE, METRICS_SIZE, bandwidth, "rist_sender_bandwidth", "Bitrate (bps)"),
+	SENDER(METRICS_GAUGE, METRICS_SIZE, retry_bandwidth, "rist_sender_retry_bandwidth", "Bitrate used by retransmissions (bps)"),
+	SENDER(METRICS_GAUGE, METRICS_DOUBLE, quality, "rist_sender_quality", "Share of packets sent without skips or retransmissions (percent)"),
+	SENDER(METRICS_GAUGE, METRICS_U32, rtt, "rist_sender_rtt_milliseconds", "Average round trip time"),
+	SENDER(METRICS_COUNTER, METRICS_U32, wakeups, "rist_sender_wakeups", "Data writes that woke the sender thread"),
+	SENDER(METRICS_COUNTER, METRICS_U32, wakeups_coalesced, "rist_sender_wakeups_coalesced", "Data writes taken without a wake up"),
+
+	RECEIVER(METRICS_COUNTER, METRICS_U64, received, "rist_receiver_received_packets", "Packets received"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, missing, "rist_receiver_missing_packets", "Packets detected missing, including reordered"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, reordered, "rist_receiver_reordered_packets", "Packets received out of order"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, recovered, "rist_receiver_recovered_packets", "Packets recovered by retransmission"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, recovered_one_retry, "rist_receiver_recovered_one_retry_packets", "Packets recovered on the first retry"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, recovered_redundancy, "rist_receiver_recovered_redundancy_packets", "Missing packets that arrived through another path"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, lost, "rist_receiver_lost_packets", "Packets lost"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, wakeups, "rist_receiver_wakeups", "Reader wake ups and notify fd writes"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, wakeups_coalesced, "rist_receiver_wakeups_coalesced", "Packets delivered without a wake up"),
+	RECEIVER(METRICS_COUNTER, METRICS_U32, fifo_overflow, "rist_receiver_fifo_overflow_packets", "Packets dropped because the output fifo was full"),
+	RECEIVER(METRICS_GAUGE, METRICS_U32, peer_count, "rist_receiver_peers", "Peers of the flow"),
+	RECEIVER(METRICS_GAUGE, METRICS_SIZE, bandwidth, "rist_receiver_bandwidth", "Bitrate (bps)"),
+	RECEIVER(METRICS_GAUGE, METRICS_DOUBLE, quality, "rist_receiver_quality", "Share of packets received without loss (percent)"),
+	RECEIVER(METRICS_GAUGE, METRICS_U32, rtt, "rist_receiver_rtt_milliseconds", "Average round trip time of the peers"),
+	RECEIVER(METRICS_GAUGE, METRICS_U32, latency, "rist_receiver_latency_milliseconds", "Receiver buffer applied to new packets"),
+	RECEIVER(METRICS_GAUGE, METRICS_U32, latency_target, "rist_receiver_latency_target_milliseconds", "Receiver buffer the adaptive latency moves toward"),
+	RECEIVER(METRICS_GAUGE, METRICS_DOUBLE, clock_drift, "rist_receiver_clock_drift_ppm", "Drift of the sender clock against the receiver clock"),
+	RECEIVER(METRICS_SUMMARY, METRICS_PERCENTILES, buffer_delay, "rist_receiver_buffer_delay_seconds", "Packet arrival to output"),
+	RECEIVER(METRICS_SUMMARY, METRICS_PERCENTILES, inter_packet_spacing, "rist_receiver_inter_packet_spacing_seconds", "Packet inter-arrival time"),
+	RECEIVER(METRICS_SUMMARY, METRICS_PERCENTILES, recovery_time, "rist_receiver_recovery_time_seconds", "Missing packet detection to recovery"),
+	RECEIVER(METRICS_SUMMARY, METRICS_PERCENTILES, rtt_percentiles, "rist_receiver_rtt_seconds", "Round trip time"),
+	RECEIVER(METRICS_SUMMARY, METRICS_PERCENTILES, pcr_jitter, "rist_receiver_pcr_jitter_seconds", "Output deviation from the PCR timeline"),
+};
+
+#define METRICS_DESC_COUNT (sizeof(metrics_descs) / sizeof(metrics_descs[0]))
+
+struct rist_metrics_series {
+	struct rist_metrics_series *next;
+	enum rist_stats_type type;
+	uint32_t id;
+	/* latest report */
+	struct rist_stats last;
+	/* counters and summary sample counts, indexed like metrics_descs */
+	uint64_t totals[METRICS_DESC_COUNT];
+};
+
+struct metrics_out {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static const void *metrics_field_ptr(const struct rist_stats *stats, const struct metrics_desc *desc)
+{
+	const char *base = stats->stats_type == RIST_STATS_SENDER_PEER ? (const char *)&stats->stats.sender_peer :
+																	 (const char *)&stats->stats.receiver_flow;
+	return base + desc->offset;
+}
+
+static uint64_t metrics_field_uint(const struct rist_stats *stats, const struct metrics_desc *desc)
+{
+	const void *ptr = metrics_field_ptr(stats, desc);
+	switch (desc->field) {
+		case METRICS_U32:
+			return *(const uint32_t *)ptr;
+		case METRICS_U64:
+			return *(const uint64_t *)ptr;
+		case METRICS_SIZE:
+			return *(const size_t *)ptr;
+		case METRICS_DOUBLE:
+			return (uint64_t)*(const double *)ptr;
+		case METRICS_PERCENTILES:
+			return ((const struct rist_stats_percentiles *)ptr)->count;
+	}
+	return 0;
+}
+
+static uint32_t metrics_stats_id(const struct rist_stats *stats)
+{
+	return stats->stats_type == RIST_STATS_SENDER_PEER ? stats->stats.sender_peer.peer_id :
+														 stats->stats.receiver_flow.flow_id;
+}
+
+int rist_metrics_init(struct rist_metrics *metrics)
+{
+	metrics->series = NULL;
+	return pthread_mutex_init(&metrics->lock, NULL);
+}
+
+void rist_metrics_destroy(struct rist_metrics *metrics)
+{
+	struct rist_metrics_series *s = metrics->series;
+	while (s) {
+		struct rist_metrics_series *next = s->next;
+		free(s);
+		s = next;
+	}
+	metrics->series = NULL;
+	pthread_mutex_destroy(&metrics->lock);
+}
+
+void rist_metrics_update(struct rist_metrics *metrics, const struct rist_stats *stats)
+{
+	uint32_t id = metrics_stats_id(stats);
+	pthread_mutex_lock(&metrics->lock);
+	struct rist_metrics_series **tail = &metrics->series;
+	struct rist_metrics_series *s = metrics->series;
+	while (s && !(s->type == stats->stats_type && s->id == id)) {
+		tail = &s->next;
+		s = s->next;
+	}
+	if (!s) {
+		s = calloc(1, sizeof(*s));
+		if (!s) {
+			pthread_mutex_unlock(&metrics->lock);
+			return;
+		}
+		s->type = stats->stats_type;
+		s->id = id;
+		*tail = s;
+	}
+	s->last = *stats;
+	s->last.stats_json = NULL;
+	s->last.json_size = 0;
+	for (size_t i = 0; i < METRICS_DESC_COUNT; i++) {
+		const struct metrics_desc *desc = &metrics_descs[i];
+		if (desc->type == stats->stats_type && desc->kind != METRICS_GAUGE)
+			s->totals[i] += metrics_field_uint(stats, desc);
+	}
+	pthread_mutex_unlock(&metrics->lock);
+}
+
+void rist_metrics_forget(struct rist_metrics *metrics, enum rist_stats_type type, uint32_t id)
+{
+	pthread_mutex_lock(&metrics->lock);
+	struct rist_metrics_series **prev = &metrics->series;
+	while (*prev) {
+		struct rist_metrics_series *s = *prev;
+		if (s->type == type && s->id == id) {
+			*prev = s->next;
+			free(s);
+			break;
+		}
+		prev = &s->next;
+	}
+	pthread_mutex_unlock(&metrics->lock);
+}
+
+static void metrics_printf(struct metrics_out *out, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	char *dst = out->len < out->size ? &out->buf[out->len] : NULL;
+	size_t room = out->len < out->size ? out->size - out->len : 0;
+	int len = vsnprintf(dst, room, fmt, args);
+	va_end(args);
+	if (len > 0)
+		out->len += (size_t)len;
+}
+
+static void metrics_labels(char *labels, size_t size, const struct rist_metrics_series *s, size_t ctx_index, bool multi)
+{
+	char context[32] = "";
+	if (multi)
+		snprintf(context, sizeof(context), "context=\"%zu\",", ctx_index);
+	if (s->type == RIST_STATS_RECEIVER_FLOW) {
+		snprintf(labels, size, "%sflow_id=\"%" PRIu32 "\"", context, s->id);
+		return;
+	}
+	// label values escape backslash, double quote and line feed
+	char cname[2 * RIST_MAX_STRING_SHORT + 1];
+	size_t len = 0;
+	const char *c = s->last.stats.sender_peer.cname;
+	for (size_t i = 0; i < RIST_MAX_STRING_SHORT && c[i]; i++) {
+		if (c[i] == '\\' || c[i] == '"' || c[i] == '\n')
+			cname[len++] = '\\';
+		cname[len++] = c[i] == '\n' ? 'n' : c[i];
+	}
+	cname[len] = '\0';
+	snprintf(labels, size, "%speer_id=\"%" PRIu32 "\",cname=\"%s\"", context, s->id, cname);
+}
+
+size_t rist_metrics_write(struct rist_metrics **metrics, size_t count, char *buf, size_t size)
+{
+	static const char *kinds[] = { "counter", "gauge", "summary" };
+	struct metrics_out out = { buf, size, 0 };
+	char labels[3 * RIST_MAX_STRING_SHORT + 96];
+	if (size)
+		buf[0] = '\0';
+	// metric families must not interleave, walk every registry per descriptor
+	for (size_t i = 0; i < METRICS_DESC_COUNT; i++) {
+		const struct metrics_desc *desc = &metrics_descs[i];
+		bool header = false;
+		for (size_t c = 0; c < count; c++) {
+			pthread_mutex_lock(&metrics[c]->lock);
+			for (struct rist_metrics_series *s = metrics[c]->series; s; s = s->next) {
+				if (s->type != desc->type)
+					continue;
+				if (!header) {
+					metrics_printf(&out, "# TYPE %s %s\n# HELP %s %s\n", desc->name, kinds[desc->kind], desc->name, desc->help);
+					header = true;
+				}
+				metrics_labels(labels, sizeof(labels), s, c, count > 1);
+				switch (desc->kind) {
+					case METRICS_COUNTER:
+						metrics_printf(&out, "%s_total{%s} %" PRIu64 "\n", desc->name, labels, s->totals[i]);
+						break;
+					case METRICS_GAUGE:
+						if (desc->field == METRICS_DOUBLE)
+							metrics_printf(&out, "%s{%s} %g\n", desc->name, labels, *(const double *)metrics_field_ptr(&s->last, desc));
+						else
+							metrics_printf(&out, "%s{%s} %" PRIu64 "\n", desc->name, labels, metrics_field_uint(&s->last, desc));
+						break;
+					case METRICS_SUMMARY: {
+						// quantiles of the last interval, microseconds to seconds
+						const struct rist_stats_percentiles *p = metrics_field_ptr(&s->last, desc);
+						metrics_printf(&out, "%s{%s,quantile=\"0.5\"} %.6f\n", desc->name, labels, (double)p->p50 / 1000000.0);
+						metrics_printf(&out, "%s{%s,quantile=\"0.9\"} %.6f\n", desc->name, labels, (double)p->p90 / 1000000.0);
+						metrics_printf(&out, "%s{%s,quantile=\"0.99\"} %.6f\n", desc->name, labels, (double)p->p99 / 1000000.0);
+						metrics_printf(&out, "%s{%s,quantile=\"0.999\"} %.6f\n", desc->name, labels, (double)p->p999 / 1000000.0);
+						metrics_printf(&out, "%s_count{%s} %" PRIu64 "\n", desc->name, labels, s->totals[i]);
+						break;
+					}
+				}
+			}
+			pthread_mutex_unlock(&metrics[c]->lock);
+		}
+	}
+	metrics_printf(&out, "# EOF\n");
+	return out.len;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_METRICS_H
+#define RIST_METRICS_H
+
+#include "common/attributes.h"
+#include "librist/stats.h"
+#include "pthread-shim.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Registry behind rist_metrics_render(). Every stats report of a sender peer or
+ * receiver flow is folded into the series of that peer/flow: per interval packet
+ * counts accumulate into counters, everything else is kept as the latest value.
+ * Reports arrive from the stats timer and scrapes only take the registry lock,
+ * neither path touches the data path.
+ */
+struct rist_metrics_series;
+
+struct rist_metrics {
+	pthread_mutex_t lock;
+	struct rist_metrics_series *series;
+};
+
+RIST_PRIV int rist_metrics_init(struct rist_metrics *metrics);
+RIST_PRIV void rist_metrics_destroy(struct rist_metrics *metrics);
+RIST_PRIV void rist_metrics_update(struct rist_metrics *metrics, const struct rist_stats *stats);
+/* Drops the series of a removed peer/flow */
+RIST_PRIV void rist_metrics_forget(struct rist_metrics *metrics, enum rist_stats_type type, uint32_t id);
+#define RIST_METRICS_MAX_CTX 64
+
+/* OpenMetrics text of count registries, returns the full length like snprintf */
+RIST_PRIV size_t rist_metrics_write(struct rist_metrics **metrics, size_t count, char *buf, size_t size);
+
+#endif
@@ -76,3 +76,19 @@ int expand_null_packets(uint8_t payload[], size_t *payload_len, uint8_t npd_bits
 	}
 	return counter;
 }
+
+bool mpegts_pcr(const uint8_t packet[], int *pid, uint64_t *pcr, bool *discontinuity) {
+	if (packet[0] != 0x47)
+		return false;
+	*pid = ((packet[1] & 0x1f) << 8) | packet[2];
+	// adaptation field present and long enough to hold a pcr
+	if (!(packet[3] & 0x20) || packet[4] < 7)
+		return false;
+	*discontinuity = packet[5] & 0x80;
+	if (!(packet[5] & 0x10))
+		return false;
+	uint64_t base = ((uint64_t)packet[6] << 25) | ((uint64_t)packet[7] << 17) | ((uint64_t)packet[8] << 9) |
+					((uint64_t)packet[9] << 1) | (packet[10] >> 7);
+	*pcr = base * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+	return true;
+}
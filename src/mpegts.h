@@ -9,9 +9,15 @@
 #define RIST_MPEGTS
 #include "udp-private.h"
 #include "common/attributes.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
+#define MPEGTS_PACKET_SIZE 188
+/* 27 MHz, 33 bit base at 90 kHz times 300 plus the 9 bit extension */
+#define MPEGTS_PCR_HZ 27000000
+#define MPEGTS_PCR_WRAP ((1ULL << 33) * 300)
+
 /*
 Needed for nullpacket deletion, values are for null packets:
 0                   1                   2                   3
@@ -37,5 +43,7 @@ RIST_PACKED_STRUCT(mpegts_header, {
 
 RIST_PRIV int suppress_null_packets(const uint8_t payload_in[], uint8_t payload_out[], size_t *payload_len, struct rist_rtp_hdr_ext *header_ext);
 RIST_PRIV int expand_null_packets(uint8_t payload[], size_t *payload_len, uint8_t npd_bits);
+/* PCR of a TS packet in 27 MHz ticks, false when it carries none */
+RIST_PRIV bool mpegts_pcr(const uint8_t packet[], int *pid, uint64_t *pcr, bool *discontinuity);
 
 #endif
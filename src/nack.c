@@ -0,0 +1,62 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "nack.h"
+#include "endian-shim.h"
+
+size_t rist_nack_compact_encode(const uint32_t seq_array[], size_t array_len, struct rist_rtcp_nack_compact_record *rec, size_t max_records, size_t *records)
+{
+	size_t i = 0;
+	size_t count = 0;
+	while (i < array_len && count < max_records)
+	{
+		uint32_t start = seq_array[i++];
+		uint32_t run = 0;
+		while (i < array_len && run < UINT16_MAX && seq_array[i] == start + run + 1) {
+			run++;
+			i++;
+		}
+		// start + run + 1 arrived (or the run is full), the bitmask covers the 16 seqs after it
+		uint32_t base = start + run + 2;
+		uint16_t bitmask = 0;
+		while (i < array_len) {
+			uint32_t bit = seq_array[i] - base;
+			if (bit >= 16)
+				break;
+			SET_BIT(bitmask, bit);
+			i++;
+		}
+		rec[count].start = htobe32(start);
+		rec[count].run = htobe16((uint16_t)run);
+		rec[count].bitmask = htobe16(bitmask);
+		count++;
+	}
+	*records = count;
+	return i;
+}
+
+size_t rist_nack_compact_decode(const struct rist_rtcp_nack_compact_record *rec, size_t records, void (*cb)(void *arg, uint32_t seq), void *arg)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < records; i++)
+	{
+		uint32_t start = be32toh(rec[i].start);
+		uint32_t run = be16toh(rec[i].run);
+		uint16_t bitmask = be16toh(rec[i].bitmask);
+		for (uint32_t j = 0; j <= run; j++)
+			cb(arg, start + j);
+		total += run + 1;
+		uint32_t base = start + run + 2;
+		for (uint32_t j = 0; bitmask != 0; j++, bitmask >>= 1) {
+			if (bitmask & 1) {
+				cb(arg, base + j);
+				total++;
+			}
+		}
+	}
+	return total;
+}
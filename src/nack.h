@@ -0,0 +1,49 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_NACK
+#define RIST_NACK
+#include "udp-private.h"
+#include "common/attributes.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Compact NACK (librist extension, only sent to peers that advertised RIST_RTCP_CAP_NACK_COMPACT)
+0                   1                   2                   3
+0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+|V=2|0| Subtype |   PT=APP=204  |            Length             |
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+|                  SSRC of media source                         |
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+|                         name (ASCII)                          |
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+|                   Start sequence number (32 bits)             |
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+|            Run length         |            Bitmask            |
++-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+                               ...
+Each record requests start up to start + run, followed by start + run + 2 + n
+for every bit n set in the bitmask (start + run + 1 is implicitly received).
+*/
+
+RIST_PACKED_STRUCT(rist_rtcp_nack_compact_record, {
+	uint32_t start;
+	uint16_t run;
+	uint16_t bitmask;
+})
+
+// Records per RTCP packet, keeps it the same size as a full legacy nack packet
+#define RIST_NACK_COMPACT_MAX_RECORDS (RIST_MAX_NACKS / 2)
+
+/* Encodes as many seqs as fit in max_records, returns the number of seqs consumed */
+RIST_PRIV size_t rist_nack_compact_encode(const uint32_t seq_array[], size_t array_len, struct rist_rtcp_nack_compact_record *rec, size_t max_records, size_t *records);
+/* Calls cb for every requested seq, returns the number of seqs */
+RIST_PRIV size_t rist_nack_compact_decode(const struct rist_rtcp_nack_compact_record *rec, size_t records, void (*cb)(void *arg, uint32_t seq), void *arg);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "payload-pool.h"
+#include "rist-private.h"
+#include "udp-private.h"
+#include <stdlib.h>
+
+/* Marks a payload that was handed out and not yet released, anything else
+ * in front of a pointer is not a header to trust */
+#define RIST_POOL_PAYLOAD_LIVE 0x52504c31u
+#define RIST_POOL_PAYLOAD_RELEASED 0x52504c30u
+
+/* Sits in front of the headroom of every payload handed out */
+struct rist_pool_payload {
+	uint32_t magic;
+	struct rist_payload_pool *pool;
+	struct rist_pool_payload *next;
+	size_t capacity;
+};
+
+static inline uint8_t *rist_pool_payload_data(struct rist_pool_payload *p)
+{
+	return (uint8_t *)(p + 1) + RIST_MAX_PAYLOAD_OFFSET;
+}
+
+int rist_payload_pool_init(struct rist_payload_pool *pool, size_t free_max)
+{
+	pool->free_list = NULL;
+	pool->free_count = 0;
+	pool->free_max = free_max;
+	return pthread_mutex_init(&pool->lock, NULL) == 0 ? 0 : -1;
+}
+
+void rist_payload_pool_destroy(struct rist_payload_pool *pool)
+{
+	struct rist_pool_payload *p = pool->free_list;
+	while (p) {
+		struct rist_pool_payload *next = p->next;
+		free(p);
+		p = next;
+	}
+	pool->free_list = NULL;
+	pool->free_count = 0;
+	pthread_mutex_destroy(&pool->lock);
+}
+
+void *rist_payload_pool_get(struct rist_payload_pool *pool, size_t size)
+{
+	struct rist_pool_payload *p = NULL;
+	if (!size)
+		return NULL;
+	if (size <= RIST_PAYLOAD_POOL_SIZE) {
+		pthread_mutex_lock(&pool->lock);
+		p = pool->free_list;
+		if (p) {
+			pool->free_list = p->next;
+			pool->free_count--;
+		}
+		pthread_mutex_unlock(&pool->lock);
+		size = RIST_PAYLOAD_POOL_SIZE;
+	}
+	if (!p) {
+		p = malloc(sizeof(*p) + RIST_MAX_PAYLOAD_OFFSET + size);
+		if (!p)
+			return NULL;
+		p->pool = pool;
+		p->capacity = size;
+	}
+	p->next = NULL;
+	p->magic = RIST_POOL_PAYLOAD_LIVE;
+	return rist_pool_payload_data(p);
+}
+
+static inline struct rist_pool_payload *rist_pool_payload_header(void *payload)
+{
+	return (struct rist_pool_payload *)((uint8_t *)payload - RIST_MAX_PAYLOAD_OFFSET) - 1;
+}
+
+bool rist_payload_pool_owns(struct rist_payload_pool *pool, void *payload)
+{
+	if (!payload)
+		return false;
+	struct rist_pool_payload *p = rist_pool_payload_header(payload);
+	return p->magic == RIST_POOL_PAYLOAD_LIVE && p->pool == pool;
+}
+
+void rist_payload_pool_put(void *payload)
+{
+	if (!payload)
+		return;
+	struct rist_pool_payload *p = rist_pool_payload_header(payload);
+	// a buffer that is not ours or was already released is left alone
+	if (p->magic != RIST_POOL_PAYLOAD_LIVE)
+		return;
+	p->magic = RIST_POOL_PAYLOAD_RELEASED;
+	struct rist_payload_pool *pool = p->pool;
+	if (p->capacity == RIST_PAYLOAD_POOL_SIZE) {
+		pthread_mutex_lock(&pool->lock);
+		if (pool->free_count < pool->free_max) {
+			p->next = pool->free_list;
+			pool->free_list = p;
+			pool->free_count++;
+			p = NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+	free(p);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_PAYLOAD_POOL_H
+#define RIST_PAYLOAD_POOL_H
+
+#include "common/attributes.h"
+#include "pthread-shim.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Payload buffers the application fills and hands over to the sender, laid
+ * out with the protocol headroom in front so the retransmission history can
+ * keep them as is. Released buffers of the common size are kept on a free
+ * list for reuse, larger ones go back to the heap.
+ */
+struct rist_pool_payload;
+
+struct rist_payload_pool {
+	pthread_mutex_t lock;
+	struct rist_pool_payload *free_list;
+	size_t free_count;
+	size_t free_max;
+};
+
+/* Payload sizes up to this come from the free list */
+#define RIST_PAYLOAD_POOL_SIZE 1500
+
+RIST_PRIV int rist_payload_pool_init(struct rist_payload_pool *pool, size_t free_max);
+RIST_PRIV void rist_payload_pool_destroy(struct rist_payload_pool *pool);
+/* Returns the payload pointer, RIST_MAX_PAYLOAD_OFFSET bytes in front of it are reserved */
+RIST_PRIV void *rist_payload_pool_get(struct rist_payload_pool *pool, size_t size);
+/* Only releases payloads of a pool that are still handed out */
+RIST_PRIV void rist_payload_pool_put(void *payload);
+/* True for a payload of this pool that is still handed out */
+RIST_PRIV bool rist_payload_pool_owns(struct rist_payload_pool *pool, void *payload);
+
+#endif
@@ -18,6 +18,7 @@
 #include "eap.h"
 #endif
 #include "mpegts.h"
+#include "nack.h"
 #include "rist_ref.h"
 #include "config.h"
 #include "rist-thread.h"
@@ -316,10 +317,21 @@ static void init_peer_settings(struct rist_peer *peer)
 			// TODO: adjust this size based on the dynamic RTT measurement
 		}
 
+		/* Retransmission history covering the buffer at the max bitrate */
+		size_t history_size = rist_sender_history_size(peer->config.recovery_maxbitrate, (uint32_t)ctx->sender_recover_min_time, ctx->sender_queue_max);
+		size_t history_wanted = atomic_load_explicit(&ctx->sender_history_wanted, memory_order_relaxed);
+		while (history_size > history_wanted) {
+			if (atomic_compare_exchange_weak_explicit(&ctx->sender_history_wanted, &history_wanted, history_size,
+													  memory_order_relaxed, memory_order_relaxed)) {
+				rist_log_priv(&ctx->common, RIST_LOG_INFO, "Setting retransmission history to %zu packets\n", history_size);
+				break;
+			}
+		}
+
 	}
 }
 
-struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf, size_t len, uint8_t type, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port)
+struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf, size_t len, uint8_t type, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t now)
 {
 	RIST_MARK_UNUSED(ctx);
 	// TODO: we will ran out of stack before heap and when that happens malloc will crash not just
@@ -351,7 +363,7 @@ struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf
 	b->size = len;
 	b->source_time = source_time;
 	b->seq = seq;
-	b->time = timestampNTP_u64();
+	b->time = now;
 	b->type = type;
 	b->src_port = src_port;
 	b->dst_port = dst_port;
@@ -359,13 +371,18 @@ struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf
 	b->transmit_count = 0;
 	b->use_seq = 0;
 	b->retry_queued = false;
+	b->pooled = false;
+	b->paced = false;
 	return b;
 }
 
 void free_rist_buffer(struct rist_common_ctx *ctx, struct rist_buffer *b)
 {
 	RIST_MARK_UNUSED(ctx);
-	free(b->data);
+	if (b->pooled)
+		rist_payload_pool_put((uint8_t *)b->data + RIST_MAX_PAYLOAD_OFFSET);
+	else
+		free(b->data);
 	free(b);
 
 }
@@ -388,7 +405,7 @@ static uint64_t receiver_calculate_packet_time(struct rist_flow *f, const uint64
 			else
 				f->time_offset += ((uint64_t)UINT32_MAX << 32) / RTP_PTYPE_MPEGTS_CLOCKHZ;
 			rist_log_priv(get_cctx(f->peer_lst[0]), RIST_LOG_INFO, "Clock wrapped, old offset: %" PRId64 " new offset %" PRId64 "\n", f->time_offset / RIST_CLOCK, f->time_offset_old / RIST_CLOCK);
-			f->offset_recalc_sample_count = 0;
+			rist_clock_drift_reset(&f->clock_drift);
 			f->max_source_time = 0;
 			f->time_offset_changed_ts = now;
 		}
@@ -405,34 +422,33 @@ static uint64_t receiver_calculate_packet_time(struct rist_flow *f, const uint64
 	return packet_time;
 }
 
-static int receiver_insert_queue_packet(struct rist_flow *f, struct rist_peer *peer, size_t idx, const void *buf, size_t len, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t packet_time)
+static int receiver_insert_queue_packet(struct rist_flow *f, struct rist_peer *peer, size_t idx, const void *buf, size_t len, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t packet_time, uint64_t now)
 {
 	/*
 	   rist_log_priv(get_cctx(peer), RIST_LOG_INFO,
 	   "Inserting seq %"PRIu32" len %zu source_time %"PRIu32" at idx %zu\n",
 	   seq, len, source_time, idx);
 	   */
-	f->receiver_queue[idx] = rist_new_buffer(get_cctx(peer), buf, len, RIST_PAYLOAD_TYPE_DATA_RAW, seq, source_time, src_port, dst_port);
+	f->receiver_queue[idx] = rist_new_buffer(get_cctx(peer), buf, len, RIST_PAYLOAD_TYPE_DATA_RAW, seq, source_time, src_port, dst_port, now);
 	if (RIST_UNLIKELY(!f->receiver_queue[idx])) {
 		rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Could not create packet buffer inside receiver buffer, OOM, decrease max bitrate or buffer time length\n");
 		return -1;
 	}
 	f->receiver_queue[idx]->peer = peer;
 	f->receiver_queue[idx]->packet_time = packet_time;
+	if (f->latency_slew)
+		f->recovery_buffer_ticks = rist_latency_control_slew(&f->latency, now);
 	f->receiver_queue[idx]->target_output_time = packet_time + f->recovery_buffer_ticks;
 	atomic_fetch_add_explicit(&f->receiver_queue_size, len, memory_order_release);
 
 	return 0;
 }
 
-static inline void receiver_mark_missing(struct rist_flow *f, struct rist_peer *peer, uint32_t current_seq, uint32_t rtt) {
+static inline void receiver_mark_missing(struct rist_flow *f, struct rist_peer *peer, uint32_t current_seq, uint32_t rtt, uint64_t now, uint64_t now_monotonic) {
 	uint32_t counter = 1;
 	uint64_t packet_time_last = 0;
 	if (RIST_UNLIKELY(!f->receiver_queue[f->last_seq_found]))
-		if (RIST_LIKELY(!f->rtc_timing_mode))
-			packet_time_last = timestampNTP_u64();
-		else
-			packet_time_last = timestampNTP_RTC_u64();
+		packet_time_last = now;
 	else
 		packet_time_last = f->receiver_queue[f->last_seq_found]->packet_time;
 	uint64_t packet_time_now = f->receiver_queue[current_seq]->packet_time;
@@ -462,7 +478,7 @@ static inline void receiver_mark_missing(struct rist_flow *f, struct rist_peer *
 					"Link has collapsed. Not queuing new retries until it recovers.\n");
 			break;
 		}
-		rist_receiver_missing(f, peer, nack_time, missing_seq, rtt);
+		rist_receiver_missing(f, peer, now_monotonic, nack_time, missing_seq, rtt);
 		if (RIST_UNLIKELY(counter == f->receiver_queue_max))
 			break;
 		counter++;
@@ -472,36 +488,40 @@ static inline void receiver_mark_missing(struct rist_flow *f, struct rist_peer *
 	}
 }
 
-int compare(const void *a, const void *b)
+static void recalculate_clock_offset(struct rist_flow *flow, uint64_t now)
 {
-	return ( *(uint64_t*)a < *(uint64_t*)b);
+	/* to counter clock drift the offset follows the estimate fitted through the
+	   least delayed in-order packets, updated every time a bucket of samples closes */
+	int64_t new_offset = rist_clock_drift_offset(&flow->clock_drift, now);
+	int64_t diff = new_offset - flow->time_offset;
+	rist_log_priv2(flow->logging_settings, RIST_LOG_DEBUG,
+		"Recalculated clock offset, old offset: %" PRId64 ", new offset: %" PRId64 " difference: %" PRId64 " usec, drift %.2f ppm\n",
+		flow->time_offset, new_offset, diff * 1000 / RIST_CLOCK, rist_clock_drift_ppm(&flow->clock_drift));
+	flow->time_offset_adjust += diff;
+	flow->time_offset = new_offset;
 }
 
-static void recalculate_clock_offset(struct rist_flow *flow)
+
+/* The first live packet after the history burst of a fast start shows how far
+   behind live the burst started: the offset taken from the burst is brought
+   back to the live one and the difference added to the buffer, which keeps the
+   output times of everything queued. The buffer converges to its target from
+   there. */
+static void receiver_fast_start_live(struct rist_flow *f, uint64_t source_time, uint64_t now)
 {
-	//arbitrarily chosen minimal sample count
-	if (flow->offset_recalc_sample_count < 100)
+	f->fast_start_pending = false;
+	int64_t live_offset = (int64_t)now - (int64_t)source_time;
+	if (live_offset >= f->time_offset)
 		return;
-
-	/* to counter clock drift we are recalculating our offset every 2048 inserted
-	   packets. Every "correctly" (in-order, no-discontinuities) packet's clock offset
-	   is inserted into an array. Of which we will take the median. */
-	qsort(flow->offset_recalc_samples, flow->offset_recalc_sample_count, sizeof(uint64_t), compare);
-	size_t middle = (flow->offset_recalc_sample_count +1)/2 +1;
-	uint64_t median_offset = flow->offset_recalc_samples[middle];
-	flow->offset_recalc_sample_count = 0;
-	uint64_t diff = 0;
-	uint64_t negative = (median_offset < (uint64_t)flow->time_offset);
-	if (negative)
-		diff = flow->time_offset - median_offset;
-	else
-		diff = median_offset - flow->time_offset;
-	rist_log_priv2(flow->logging_settings, RIST_LOG_DEBUG, "Recalculated clock offset, old offset: %lu, new offset: %lu difference: %c%lu usec\n",
-							flow->time_offset, median_offset, negative? '-': '+', (diff * 1000 / RIST_CLOCK));
-	flow->time_offset = median_offset;
+	uint64_t behind = (uint64_t)(f->time_offset - live_offset);
+	f->time_offset = live_offset;
+	f->last_packet_ts -= behind;
+	rist_latency_control_rebase(&f->latency, f->latency.applied + behind, now);
+	rist_log_priv2(f->logging_settings, RIST_LOG_INFO,
+		"Fast start burst was %" PRIu64 " ms behind live, buffer now %" PRIu64 " ms converging to %" PRIu64 " ms\n",
+		behind / RIST_CLOCK, f->latency.applied / RIST_CLOCK, f->latency.target / RIST_CLOCK);
 }
 
-
 static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64_t packet_recv_time, const void *buf, size_t len, uint32_t seq, uint32_t rtt, bool retry, uint16_t src_port, uint16_t dst_port, uint8_t payload_type)
 {
 	struct rist_flow *f = peer->flow;
@@ -515,7 +535,22 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 	else
 		now = timestampNTP_RTC_u64();
 	//fprintf(stderr, "Offset would've been: %llu\n", now - source_time);
-	if (RIST_UNLIKELY((!f->receiver_queue_has_items && retry) || (f->rtc_timing_mode && f->time_offset == 0)))
+	// With fast start, retransmissions starting a flow are the history burst of the sender
+	bool burst = retry && f->fast_start && !f->rtc_timing_mode && (!f->receiver_queue_has_items || f->fast_start_pending);
+	if (burst && f->receiver_queue_has_items) {
+		// recoveries of packets lost from the burst arrive behind it
+		uint32_t ahead = seq - f->last_seq_found;
+		if (f->short_seq)
+			ahead = (uint16_t)ahead;
+		burst = ahead != 0 && ahead < (f->short_seq ? UINT16_MAX / 2 : UINT32_MAX / 2);
+	}
+	if (!retry) {
+		peer->path_last_arrival = now_monotonic;
+	} else if (!burst) {
+		struct rist_peer *rtcp_peer = peer->peer_rtcp ? peer->peer_rtcp : peer;
+		rtcp_peer->path_nacks_recovered++;
+	}
+	if (RIST_UNLIKELY((!f->receiver_queue_has_items && retry && !burst) || (f->rtc_timing_mode && f->time_offset == 0)))
 		return -1;
 	if (RIST_UNLIKELY(!f->receiver_queue_has_items)) {
 		/* we just received our first packet for this flow */
@@ -537,10 +572,16 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		/* Calculate and store clock offset with respect to source */
 		if (!f->rtc_timing_mode)
 			f->time_offset = (int64_t)now_monotonic - (int64_t)source_time;
+		rist_clock_drift_reset(&f->clock_drift);
 		/* This ensures the next packet does not trigger nacks */
 		f->last_seq_output = seq - 1;
 		f->last_seq_found = seq;
 		f->max_source_time = source_time;
+		if (f->fast_start && !f->rtc_timing_mode) {
+			// output starts early, the buffer converges to its target from there
+			rist_latency_control_rebase(&f->latency, f->fast_start_buffer, now_monotonic);
+			f->fast_start_pending = burst;
+		}
 		/* This will synchronize idx and seq so we can insert packets into receiver buffer based on seq number */
 		size_t idx_initial = seq & (f->receiver_queue_max -1);
 			rist_log_priv(get_cctx(peer), RIST_LOG_INFO,
@@ -548,18 +589,19 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 				seq, idx_initial, source_time, peer->flow->time_offset / RIST_CLOCK, idx_initial);
 		uint64_t packet_time = source_time + f->time_offset;
 
-		receiver_insert_queue_packet(f, peer, idx_initial, buf, len, seq, source_time, src_port, dst_port, packet_time);
+		receiver_insert_queue_packet(f, peer, idx_initial, buf, len, seq, source_time, src_port, dst_port, packet_time, now_monotonic);
 		atomic_store_explicit(&f->receiver_queue_output_idx, idx_initial, memory_order_release);
 
 		/* reset stats */
-		pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
+		rist_flow_counters_snapshot(&f->counters, &f->stats_instant);
 		memset(&f->stats_instant, 0, sizeof(f->stats_instant));
-		pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
 		f->receiver_queue_has_items = true;
 		pthread_mutex_unlock(&f->mutex);
 		return 0; // not a dupe
 	}
 
+	if (RIST_UNLIKELY(f->fast_start_pending && !retry))
+		receiver_fast_start_live(f, source_time, now);
 	uint64_t packet_time = receiver_calculate_packet_time(f, source_time, now, retry, payload_type);
     size_t idx = seq & (f->receiver_queue_max - 1);
     if (RIST_UNLIKELY(peer->config.timing_mode == RIST_TIMING_MODE_ARRIVAL && retry))
@@ -611,16 +653,17 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		if (now > (packet_time + (f->recovery_buffer_ticks *1.1)))
 		{
 			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Packet %"PRIu32" too late, dropping!\n", seq);
-			pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-			f->stats_instant.dropped_late++;
-                        if (f->stats_instant.dropped_late > 5 * f->stats_instant.received)
+			rist_flow_counter_add(&f->counters.dropped_late, 1);
+			f->latency_misses++;
+			uint32_t dropped_late = rist_flow_counter_get(&f->counters.dropped_late);
+			uint32_t received = rist_flow_counter_get(&f->counters.received);
+                        if (dropped_late > 5 * received)
                             f->receiver_queue_has_items = false;
-			if ((f->stats_instant.dropped_late > (f->stats_instant.received * 5) && f->stats_instant.received > 100) ||
-				(f->stats_instant.dropped_late > 100 && f->stats_instant.received == 0)) {
+			if ((dropped_late > (received * 5) && received > 100) ||
+				(dropped_late > 100 && received == 0)) {
 					rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Too many late packets received, resetting flow");
 					f->receiver_queue_has_items = false;
 			}
-			pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
 			return -1;
 		}
 		if (!retry) {
@@ -637,11 +680,9 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Buffer is full, dropping packet %"PRIu32"/%zu\n", seq, idx);
 		if (packet_time > f->last_packet_ts)
 			f->last_seq_found  = seq;
-		pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-		f->stats_instant.dropped_full++;
-		pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+		rist_flow_counter_add(&f->counters.dropped_full, 1);
 		//Something is wrong, and we should reset
-		if (f->stats_instant.dropped_full > 100) {
+		if (rist_flow_counter_get(&f->counters.dropped_full) > 100) {
 			rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Buffer is full, resetting buffer\n");
 			f->receiver_queue_has_items = false;
 		}
@@ -652,9 +693,9 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 		struct rist_buffer *b = f->receiver_queue[idx];
 		if (b->source_time == source_time) {
 			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Dupe! %"PRIu32"/%zu\n", seq, idx);
-			pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-			f->stats_instant.dupe++;
-			pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+			if (!retry)
+				rist_receiver_path_update(peer, b, now_monotonic);
+			rist_flow_counter_add(&f->counters.dupe, 1);
 			return 1;
 		}
 		else {
@@ -666,17 +707,15 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 
 
 	/* Now, we insert the packet into receiver queue */
-	if (receiver_insert_queue_packet(f, peer, idx, buf, len, seq, source_time, src_port, dst_port, packet_time)) {
+	if (receiver_insert_queue_packet(f, peer, idx, buf, len, seq, source_time, src_port, dst_port, packet_time, now_monotonic)) {
 		// only error is OOM, safe to exit here ...
 		return 0;
 	}
-	pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
 	if (out_of_order)
-		f->stats_instant.reordered++;
-	f->stats_instant.received++;
-	pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
-	// Check for missing data and queue retries
-	if (!retry) {
+		rist_flow_counter_add(&f->counters.reordered, 1);
+	rist_flow_counter_add(&f->counters.received, 1);
+	// Check for missing data and queue retries, the history burst of a fast start included
+	if (!retry || burst) {
 		/* check for missing packets */
 		// We start at the last known good packet, and look forwards till we hit this seq
 		uint32_t missing_seq = seq - 1;
@@ -685,15 +724,13 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 
 		if (!out_of_order && missing_seq != f->last_seq_found)
 		{
-			receiver_mark_missing(f, peer, seq, rtt);
-		} else if (RIST_LIKELY(!f->rtc_timing_mode && !out_of_order))
+			receiver_mark_missing(f, peer, seq, rtt, now, now_monotonic);
+		} else if (RIST_LIKELY(!f->rtc_timing_mode && !out_of_order && !retry))
 		{
 			//packet received in order, use it's offset as a sample in calculation to
 			//correct clock drift
-			f->offset_recalc_samples[f->offset_recalc_sample_count] = (int64_t)now - (int64_t)source_time;
-			f->offset_recalc_sample_count++;
-			if (f->offset_recalc_sample_count == 2048)
-				recalculate_clock_offset(f);
+			if (rist_clock_drift_add(&f->clock_drift, now, (int64_t)now - (int64_t)source_time))
+				recalculate_clock_offset(f, now);
 		}
 		//If we stopped due to bloat or missing count max this will be incorrect.
 		if (!out_of_order)
@@ -702,14 +739,11 @@ static int receiver_enqueue(struct rist_peer *peer, uint64_t source_time, uint64
 	return 0;
 }
 
-static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b)
+static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b, uint64_t now)
 {
-	uint64_t now;
-	if (RIST_LIKELY(!f->rtc_timing_mode))
-		now = timestampNTP_u64();
-	else
-		now = timestampNTP_RTC_u64();
 	struct rist_peer *peer = b->peer;
+	// a slewed buffer is per flow, the peer keeps its configured one
+	uint64_t recovery_buffer_ticks = f->latency_slew ? f->recovery_buffer_ticks : peer->recovery_buffer_ticks;
 
 	if (b->nack_count >= peer->config.max_retries) {
 		rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Datagram %"PRIu32
@@ -723,12 +757,13 @@ static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b)
 				f->stats_total.recovered_average);
 		return 8;
 	} else {
-		if ((uint64_t)(now - b->insertion_time) > (peer->recovery_buffer_ticks *1.1)) {
+		if ((uint64_t)(now - b->insertion_time) > (recovery_buffer_ticks *1.1)) {
 			rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG,
 					"Datagram %" PRIu32 " is missing but it is too late (%" PRIu64
 					"ms) to send NACK!, retry #%lu, retry queue %d, max time %"PRIu64"\n",
 					b->seq, (now - b->insertion_time)/RIST_CLOCK, b->nack_count,
-					f->missing_counter, peer->recovery_buffer_ticks / RIST_CLOCK);
+					f->missing_counter, recovery_buffer_ticks / RIST_CLOCK);
+			f->latency_misses++;
 			return 9;
 		} else if (now >= b->next_nack) {
 			uint64_t rtt = (peer->eight_times_rtt / 8);
@@ -739,9 +774,7 @@ static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b)
 			}
 			if (b->nack_count == 0) {
 				f->missing_counter++;
-				pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-				f->stats_instant.missing++;
-				pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+				rist_flow_counter_add(&f->counters.missing, 1);
 			}
 
 			// TODO: make this 10% overhead configurable?
@@ -757,14 +790,12 @@ static int rist_process_nack(struct rist_flow *f, struct rist_missing_buffer *b)
 					b->seq, (b->next_nack - now) / RIST_CLOCK,
 					(now - b->insertion_time) / RIST_CLOCK,
 					b->nack_count,
-					peer->recovery_buffer_ticks / RIST_CLOCK);
+					recovery_buffer_ticks / RIST_CLOCK);
 
 			// update peer information
 			f->nacks.array[f->nacks.counter] = b->seq;
 			f->nacks.counter++;
-			pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-			f->stats_instant.retries++;
-			pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+			rist_flow_counter_add(&f->counters.retries, 1);
 		}
 	}
 
@@ -828,13 +859,92 @@ static struct rist_data_block *new_data_block(struct rist_data_block *output_buf
 	return output_buffer;
 }
 
+void rist_receiver_notify_fd_write(struct rist_receiver *ctx)
+{
+	// send a data ready signal by writing a single byte of value 0
+	char empty = '\0';
+	if(write(ctx->receiver_data_ready_notify_fd, &empty, 1) == -1)
+	{
+		// We ignore the error condition as missing data is not harmful here
+		// It is only a signaling mechanism
+	}
+}
+
+/* Wakes readers parked in rist_receiver_data_read() and writes to the notify fd
+ * once per drain of the fifo, deliveries to a reader that is busy need neither */
+static void receiver_fifo_wake(struct rist_receiver *ctx, struct rist_flow *f)
+{
+	int woken = rist_wakeup_notify(&ctx->reader_wakeup, &ctx->condition, &ctx->mutex);
+	if (woken < 0) {
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_broadcast failed.\n");
+		woken = 0;
+	}
+	// the notify above ordered the fifo write before this exchange
+	if (ctx->receiver_data_ready_notify_fd && atomic_exchange(&ctx->notify_armed, false)) {
+		rist_receiver_notify_fd_write(ctx);
+		woken++;
+	}
+	if (woken)
+		rist_flow_counter_add(&f->counters.wakeups, (uint32_t)woken);
+	else
+		rist_flow_counter_add(&f->counters.wakeups_coalesced, 1);
+}
+
+/* Release time of the packet at the head of the output queue. With PCR pacing
+ * the nominal time is moved onto the PCR timeline once, in output order. */
+static uint64_t receiver_output_time(struct rist_flow *f, struct rist_buffer *b)
+{
+	if (!f->pcr_pacing || b->paced || b->type != RIST_PAYLOAD_TYPE_DATA_RAW)
+		return b->target_output_time;
+	b->paced = true;
+	uint8_t *payload = b->data;
+	uint64_t pcr_time = rist_source_clock_mpegts(&f->pcr_clock, &payload[RIST_MAX_PAYLOAD_OFFSET], b->size, b->dst_port,
+												 b->target_output_time);
+	if (!pcr_time)
+		return b->target_output_time;
+	// the pcr mapping trails the nominal times by the sender jitter, a larger
+	// gap means the flow offset was reset under it
+	if (b->target_output_time - pcr_time > f->recovery_buffer_ticks / 2) {
+		rist_source_clock_reset(&f->pcr_clock);
+		return b->target_output_time;
+	}
+	b->target_output_time = pcr_time + f->pcr_pacing_margin;
+	return b->target_output_time;
+}
+
+/* Deviation of the released PCRs from their spacing, PCR to PCR */
+static void receiver_pcr_jitter(struct rist_flow *f, const uint8_t *payload, size_t len, uint64_t now)
+{
+	for (size_t i = 0; i + MPEGTS_PACKET_SIZE <= len; i += MPEGTS_PACKET_SIZE) {
+		int pid;
+		uint64_t pcr;
+		bool discontinuity;
+		if (!mpegts_pcr(&payload[i], &pid, &pcr, &discontinuity) || pid != f->pcr_clock.pcr_pid)
+			continue;
+		if (f->pcr_jitter_has_last && !discontinuity) {
+			uint64_t pcr_delta = (pcr + MPEGTS_PCR_WRAP - f->pcr_jitter_last) % MPEGTS_PCR_WRAP;
+			// PCRs are at most 100 ms apart, a second without one is a gap
+			if (pcr_delta < MPEGTS_PCR_HZ) {
+				int64_t expected = (int64_t)(pcr_delta * 1000000 / MPEGTS_PCR_HZ);
+				int64_t actual = (int64_t)rist_clock_ntp_to_us(now - f->pcr_jitter_last_output);
+				rist_histogram_record(&f->pcr_jitter_hist, (uint64_t)llabs(actual - expected));
+			}
+		}
+		f->pcr_jitter_has_last = true;
+		f->pcr_jitter_last = pcr;
+		f->pcr_jitter_last_output = now;
+	}
+}
+
 static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 {
 
 	uint64_t recovery_buffer_ticks = f->recovery_buffer_ticks;
+	// The clock is sampled once per output batch
+	uint64_t now_monotonic = timestampNTP_u64();
 	uint64_t now;
 	if (RIST_LIKELY(!f->rtc_timing_mode))
-		now = timestampNTP_u64();
+		now = now_monotonic;
 	else
 		now = timestampNTP_RTC_u64();
 	size_t output_idx = atomic_load_explicit(&f->receiver_queue_output_idx, memory_order_acquire);
@@ -861,17 +971,16 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 				}
 			}
 			if (b) {
-				uint64_t delay1 = (now - b->time);
+				// packets can be inserted after the batch clock sample
+				uint64_t delay1 = now > b->time ? (now - b->time) : 0;
 				if (RIST_UNLIKELY(delay1 > (2LLU * recovery_buffer_ticks))) {
 					// According to the real time clock, it is too late, continue.
-				} else if (b->target_output_time > now) {
+				} else if (receiver_output_time(f, b) > now) {
 					// The block we found is not ready for output, so we wait.
 					break;
 				}
 			}
-			pthread_mutex_lock(&ctx->common.stats_lock);
-			f->stats_instant.lost += holes;
-			pthread_mutex_unlock(&ctx->common.stats_lock);
+			rist_flow_counter_add(&f->counters.lost, (uint32_t)holes);
 			output_idx = counter;
 			rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 					"Empty buffer element, flushing %"PRIu32" hole(s), now at index %zu, size is %zu\n",
@@ -880,8 +989,8 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 		if (b) {
 			if (b->type == RIST_PAYLOAD_TYPE_DATA_RAW) {
 
-				now = timestampNTP_u64();
-				uint64_t delay_rtc = (now - b->time);
+				now = now_monotonic;
+				uint64_t delay_rtc = now > b->time ? (now - b->time) : 0;
 
 				if (RIST_UNLIKELY(delay_rtc > (1.1 * recovery_buffer_ticks))) {
 					// Double check the age of the packet within our receiver queue
@@ -907,7 +1016,7 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 							drop? "dropping" : "releasing");
 					
 				}
-				else if (b->target_output_time > now) {
+				else if (receiver_output_time(f, b) > now) {
 					// This is how we keep the buffer at the correct level
 					//rist_log_priv(&ctx->common, RIST_LOG_WARN, "age is %"PRIu64"/%"PRIu64" < %"PRIu64", size %zu\n",
 					//	delay_rtc / RIST_CLOCK , delay / RIST_CLOCK, recovery_buffer_ticks / RIST_CLOCK, f->receiver_queue_size);
@@ -927,9 +1036,7 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 					rist_log_priv(&ctx->common, RIST_LOG_ERROR,
 							"Discontinuity, expected %" PRIu32 " got %" PRIu32 "\n",
 							f->last_seq_output + 1, b->seq);
-					pthread_mutex_lock(&ctx->common.stats_lock);
-					f->stats_instant.lost++;
-					pthread_mutex_unlock(&ctx->common.stats_lock);
+					rist_flow_counter_add(&f->counters.lost, 1);
 					holes = 1;
 				}
 				if (b->type == RIST_PAYLOAD_TYPE_DATA_RAW) {
@@ -942,6 +1049,8 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 					}
 					/* insert into fifo queue */
 					uint8_t *payload = b->data;
+					if (f->pcr_pacing)
+						receiver_pcr_jitter(f, &payload[RIST_MAX_PAYLOAD_OFFSET], b->size, now);
 					struct rist_data_block *block = new_data_block(
 							NULL, b,
 							&payload[RIST_MAX_PAYLOAD_OFFSET], f->flow_id, flags);
@@ -953,38 +1062,17 @@ static void receiver_output(struct rist_receiver *ctx, struct rist_flow *f)
 								block);
 					}
 
-					size_t dataout_fifo_write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_relaxed);
-					size_t dataout_fifo_read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_acquire);
-					uint32_t fifo_count = (dataout_fifo_write_index - dataout_fifo_read_index)&(ctx->fifo_queue_size -1);
-					if (fifo_count +1 == ctx->fifo_queue_size || !ctx->fifo_queue_size) {
+					if (block && rist_data_fifo_push(&f->dataout_fifo, block)) {
+						receiver_fifo_wake(ctx, f);
+					} else if (block) {
 						if (!ctx->receiver_data_callback)
 							rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Rist data out fifo queue overflow\n");
 						rist_receiver_data_block_free2(&block);
-						atomic_store_explicit(&f->fifo_overflow, true, memory_order_release);
-					} else
-					{
-						f->dataout_fifo_queue[dataout_fifo_write_index] = block;
-						atomic_store_explicit(&f->dataout_fifo_queue_write_index, (dataout_fifo_write_index + 1)& (ctx->fifo_queue_size-1), memory_order_relaxed);
-						// Wake up the fifo read thread (poll)
-						if (ctx->receiver_data_ready_notify_fd) {
-							// send a data ready signal by writing a single byte of value 0
-							char empty = '\0';
-							if(write(ctx->receiver_data_ready_notify_fd, &empty, 1) == -1)
-							{
-								// We ignore the error condition as missing data is not harmful here
-								// It is only a signaling mechanism
-							}
-						}
+						rist_flow_counter_add(&f->counters.fifo_overflow, 1);
 					}
-					pthread_mutex_lock(&ctx->common.stats_lock);
-					if (f->stats_instant.buffer_duration_count < 2048)
-					{
-						f->stats_instant.buffer_duration[f->stats_instant.buffer_duration_count] = (uint32_t)(delay_rtc / RIST_CLOCK);
-						f->stats_instant.buffer_duration_count++;
-					}
-					pthread_mutex_unlock(&ctx->common.stats_lock);
-					if (pthread_cond_signal(&(ctx->condition)))
-						rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
+					atomic_fetch_add_explicit(&f->counters.buffer_duration_sum, (unsigned long)(delay_rtc / RIST_CLOCK), memory_order_relaxed);
+					rist_flow_counter_add(&f->counters.buffer_duration_count, 1);
+					rist_histogram_record(&f->buffer_delay_hist, rist_clock_ntp_to_us(delay_rtc));
 				}
 				// Track this one only for data
 				f->last_seq_output_source_time = b->source_time;
@@ -1021,39 +1109,116 @@ next:
 
 }
 
+struct nack_path {
+	struct rist_peer *peer;
+	uint64_t cost;
+	uint32_t loss;
+};
+
+static uint64_t nack_path_cost(struct rist_peer *p, uint32_t loss)
+{
+	/* Expected time to recover through this path: a retransmission is lost
+	   with probability loss, each attempt costs one round trip */
+	uint64_t rtt = p->eight_times_rtt / 8;
+	if (rtt == 0)
+		rtt = p->last_mrtt;
+	if (loss > 900)
+		loss = 900;
+	uint64_t cost = ((rtt + 1) * 1000000) / (1000 - loss);
+	// Paths that already use up their return bandwidth are only picked when nothing better is available
+	if (p->config.recovery_maxbitrate_return > 0 &&
+		p->bw.eight_times_bitrate_fast / 8 > (size_t)p->config.recovery_maxbitrate_return * 1000)
+		cost *= 4;
+	return cost;
+}
+
+static void send_nack_path(struct rist_peer *peer, uint32_t *seq_array, size_t array_len)
+{
+	if (array_len == 0)
+		return;
+	rist_receiver_send_nacks(peer, seq_array, array_len);
+	peer->stats_receiver_instant.nacks += (uint32_t)array_len;
+	peer->path_nacks += (uint32_t)array_len;
+	if (peer->path_nacks > RIST_NACK_PATH_WINDOW) {
+		peer->path_nacks /= 2;
+		peer->path_nacks_recovered /= 2;
+	}
+}
+
 static void send_nack_group(struct rist_receiver *ctx, struct rist_flow *f)
 {
 	// Now actually send all the nack IP packets for this flow (the above routing will process/group them)
 	if (f->nacks.counter == 0)
 		return;
 	pthread_mutex_lock(&ctx->common.peerlist_lock);
-	struct rist_peer *peer = NULL;
-	uint64_t last_rtt = UINT64_MAX;
+	struct nack_path paths[RIST_NACK_MAX_PATHS];
+	size_t path_count = 0;
 	if (f->peer_lst_len == 0 || f->peer_lst == NULL)
 		goto out;
 	for (size_t i = 0; i < f->peer_lst_len; i++)
 	{
 		struct rist_peer *check = f->peer_lst[i];
-		if (check->is_rtcp && !check->dead && check->last_mrtt < last_rtt)
-		{
-			peer = check;
-			last_rtt = peer->last_mrtt;
+		if (!check->is_rtcp || check->dead)
+			continue;
+		uint32_t loss = rist_peer_nack_loss(check);
+		uint64_t cost = nack_path_cost(check, loss);
+		// keep the array sorted, cheapest path first
+		size_t pos = path_count < RIST_NACK_MAX_PATHS ? path_count : RIST_NACK_MAX_PATHS - 1;
+		if (path_count == RIST_NACK_MAX_PATHS && cost >= paths[pos].cost)
+			continue;
+		while (pos > 0 && paths[pos - 1].cost > cost) {
+			paths[pos] = paths[pos - 1];
+			pos--;
 		}
+		paths[pos].peer = check;
+		paths[pos].cost = cost;
+		paths[pos].loss = loss;
+		if (path_count < RIST_NACK_MAX_PATHS)
+			path_count++;
 	}
-	if (peer != NULL)
-		rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter);
-	else
+	if (path_count == 0)
 	{
+		// No live path, try the one that died most recently
+		struct rist_peer *peer = NULL;
+		uint64_t dead_since = 0;
 		for (size_t i = 0; i < f->peer_lst_len; i++)
 		{
 			struct rist_peer *check = f->peer_lst[i];
-			uint64_t dead_since = 0;
-			if (check->is_rtcp && check->dead_since > dead_since)
+			if (check->is_rtcp && check->dead_since >= dead_since)
 			{
 				peer = check;
+				dead_since = check->dead_since;
 			}
-			if (peer != NULL)
-				rist_receiver_send_nacks(peer,f->nacks.array, f->nacks.counter);
+		}
+		if (peer != NULL)
+			send_nack_path(peer, f->nacks.array, f->nacks.counter);
+	}
+	else if (path_count > 1 && paths[0].loss >= RIST_NACK_DUPLICATE_LOSS)
+	{
+		// Even the best path is lossy, request the packets through the next best one as well
+		send_nack_path(paths[0].peer, f->nacks.array, f->nacks.counter);
+		send_nack_path(paths[1].peer, f->nacks.array, f->nacks.counter);
+	}
+	else
+	{
+		/* Spread the group over the paths that are at most twice as expensive as
+		   the best one, proportionally to their cost, in contiguous chunks so the
+		   range encoding stays compact */
+		uint64_t weights[RIST_NACK_MAX_PATHS];
+		uint64_t weight_sum = 0;
+		size_t split = 0;
+		for (; split < path_count && paths[split].cost <= paths[0].cost * 2; split++) {
+			weights[split] = (paths[0].cost * 1024) / paths[split].cost;
+			weight_sum += weights[split];
+		}
+		size_t offset = 0;
+		for (size_t i = 0; i < split; i++)
+		{
+			size_t len = (size_t)((f->nacks.counter * weights[i]) / weight_sum);
+			if (i == split - 1)
+				len = f->nacks.counter - offset;
+			send_nack_path(paths[i].peer, &f->nacks.array[offset], len);
+			offset += len;
 		}
 	}
 	f->nacks.counter = 0;
@@ -1061,14 +1226,35 @@ out:
 	pthread_mutex_unlock(&ctx->common.peerlist_lock);
 }
 
-void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
+static bool flow_nack_compact(struct rist_flow *f)
+{
+	// Only group beyond the legacy limits when every path can carry the compact format
+	bool compact = false;
+	for (size_t i = 0; i < f->peer_lst_len; i++)
+	{
+		struct rist_peer *check = f->peer_lst[i];
+		if (!check->is_rtcp)
+			continue;
+		if (!(check->remote_caps & RIST_RTCP_CAP_NACK_COMPACT))
+			return false;
+		compact = true;
+	}
+	return compact;
+}
+
+void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f, uint64_t now_monotonic)
 {
 
 	if (!f->authenticated) {
 		return;
 	}
 
-	const size_t maxcounter = RIST_MAX_NACKS;
+	uint64_t now = now_monotonic;
+	if (RIST_UNLIKELY(f->rtc_timing_mode))
+		now = timestampNTP_RTC_u64();
+
+	const bool compact = flow_nack_compact(f);
+	const size_t maxcounter = compact ? RIST_MAX_NACKS_COMPACT : RIST_MAX_NACKS;
 
 	/* Now loop through missing queue and process items */
 	struct rist_missing_buffer *mb = f->missing;
@@ -1088,36 +1274,42 @@ void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
 					"Nack processing is disabled for this peer, removing seq %"PRIu32" from queue ...\n",
 					mb->seq);
 			remove_from_queue_reason = 10;
-			f->stats_instant.missing--;
+			rist_flow_counter_sub(&f->counters.missing, 1);
 			goto nack_loop_continue;
 		} else if (f->receiver_queue[idx]) {
 			if (f->receiver_queue[idx]->seq == mb->seq) {
-				pthread_mutex_lock(&ctx->common.stats_lock);
 				// We filled in the hole already ... packet has been recovered
 				remove_from_queue_reason = 3;
-				if (mb->nack_count > 0)
-					f->stats_instant.recovered++;
+				if (mb->nack_count > 0) {
+					rist_flow_counter_add(&f->counters.recovered, 1);
+					uint64_t arrival = f->receiver_queue[idx]->time;
+					if (arrival > mb->insertion_time) {
+						rist_histogram_record(&f->recovery_hist, rist_clock_ntp_to_us(arrival - mb->insertion_time));
+						if (f->latency_adaptive)
+							rist_latency_control_recovered(&f->latency, arrival - mb->insertion_time);
+					}
+				} else if (f->receiver_queue[idx]->peer != peer)
+					rist_flow_counter_add(&f->counters.recovered_redundancy, 1);
 				switch(mb->nack_count) {
 					case 0:
 						break;
 					case 1:
-						f->stats_instant.recovered_0nack++;
+						rist_flow_counter_add(&f->counters.recovered_0nack, 1);
 						break;
 					case 2:
-						f->stats_instant.recovered_1nack++;
+						rist_flow_counter_add(&f->counters.recovered_1nack, 1);
 						break;
 					case 3:
-						f->stats_instant.recovered_2nack++;
+						rist_flow_counter_add(&f->counters.recovered_2nack, 1);
 						break;
 					case 4:
-						f->stats_instant.recovered_3nack++;
+						rist_flow_counter_add(&f->counters.recovered_3nack, 1);
 						break;
 					default:
-						f->stats_instant.recovered_morenack++;
+						rist_flow_counter_add(&f->counters.recovered_morenack, 1);
 						break;
 				}
-				f->stats_instant.recovered_sum += mb->nack_count;
-				pthread_mutex_unlock(&ctx->common.stats_lock);
+				rist_flow_counter_add(&f->counters.recovered_sum, mb->nack_count);
 			}
 			else {
 				// Message with wrong seq!!!
@@ -1125,9 +1317,7 @@ void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
 						"Retry queue has the wrong seq %"PRIu32" != %"PRIu32", removing ...\n",
 						f->receiver_queue[idx]->seq, mb->seq);
 				remove_from_queue_reason = 4;
-				pthread_mutex_lock(&ctx->common.stats_lock);
-				f->stats_instant.missing--;
-				pthread_mutex_unlock(&ctx->common.stats_lock);
+				rist_flow_counter_sub(&f->counters.missing, 1);
 				goto nack_loop_continue;
 			}
 		} else if (peer->buffer_bloat_active) {
@@ -1154,15 +1344,17 @@ void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
 			// Packet is still missing, re-stamp the expiration time so we can re-add to queue
 			// We reject the next retry for a number of reasons checked inside the function,
 			// in which case the nack will never be resent and we signal a queue removal
-			if (seq_msb != (mb->seq >> 16))
+			if (!compact && seq_msb != (mb->seq >> 16))
 			{
 				// We do not mix/group missing sequence numbers with different upper 2 bytes
+				// (the compact format carries full 32 bit sequence numbers)
 				if (ctx->common.debug)
 					rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 							"seq-msb changed from %"PRIu32" to %"PRIu32" (%"PRIu32", %zu, %"PRIu32")\n",
 							seq_msb, mb->seq >> 16, mb->seq, f->nacks.counter,
 							f->missing_counter);
 				send_nack_group(ctx, f);
+				seq_msb = mb->seq >> 16;
 			}
 			else if (f->nacks.counter == (maxcounter - 1)) {
 				rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
@@ -1178,14 +1370,14 @@ void receiver_nack_output(struct rist_receiver *ctx, struct rist_flow *f)
 				f->nacks.counter = 0;
 				//TODO: maybe assert is more appropriate here?
 			}
-			remove_from_queue_reason = rist_process_nack(f, mb);
+			remove_from_queue_reason = rist_process_nack(f, mb, now);
 		}
 nack_loop_continue:
 		if (remove_from_queue_reason != 0) {
 			if (ctx->common.debug)
 				rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 						"Removing seq %" PRIu32 " from missing, queue size is %d, retry #%u, age %"PRIu64"ms, reason %d\n",
-						mb->seq, f->missing_counter, mb->nack_count, (timestampNTP_u64() - mb->insertion_time) / RIST_CLOCK, remove_from_queue_reason);
+						mb->seq, f->missing_counter, mb->nack_count, (now - mb->insertion_time) / RIST_CLOCK, remove_from_queue_reason);
 			struct rist_missing_buffer *next = mb->next;
 			if (!next)
 				f->missing_tail = previous;
@@ -1387,14 +1579,13 @@ void rist_peer_authenticate(struct rist_peer *peer)
 			"Successfully Authenticated peer %"PRIu32"\n", peer->adv_peer_id);
 }
 
-void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw)
+void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw, uint64_t ntp_now)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	uint64_t now = tv.tv_sec * 1000000;
-	now += tv.tv_usec;
-	uint64_t time = now - bw->last_bitrate_calctime;
-	uint64_t time_fast = now - bw->last_bitrate_calctime_fast;
+	uint64_t now = rist_clock_ntp_to_us(ntp_now);
+	// callers pass a loop time that can be older than the last update, the
+	// bytes then count toward the next interval
+	uint64_t time = now > bw->last_bitrate_calctime ? now - bw->last_bitrate_calctime : 0;
+	uint64_t time_fast = now > bw->last_bitrate_calctime_fast ? now - bw->last_bitrate_calctime_fast : 0;
 
 	if (!bw->last_bitrate_calctime) {
 		bw->last_bitrate_calctime = now;
@@ -1432,14 +1623,11 @@ void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw)
 	}
 }
 
-static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, struct rist_bandwidth_estimation *bw)
+static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, struct rist_bandwidth_estimation *bw, uint64_t ntp_now)
 {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	uint64_t now = tv.tv_sec * 1000000;
-	now += tv.tv_usec;
-	uint64_t time = now - bw->last_bitrate_calctime;
-	uint64_t time_fast = now - bw->last_bitrate_calctime_fast;
+	uint64_t now = rist_clock_ntp_to_us(ntp_now);
+	uint64_t time = now > bw->last_bitrate_calctime ? now - bw->last_bitrate_calctime : 0;
+	uint64_t time_fast = now > bw->last_bitrate_calctime_fast ? now - bw->last_bitrate_calctime_fast : 0;
 
 	if (!bw->last_bitrate_calctime) {
 		bw->last_bitrate_calctime = now;
@@ -1459,7 +1647,7 @@ static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, stru
 		flow->stats_instant.max_ips = 0ULL;
 		flow->stats_instant.avg_count = 0UL;
 	} else {
-		flow->stats_instant.cur_ips = now - flow->last_ipstats_time;
+		flow->stats_instant.cur_ips = now > flow->last_ipstats_time ? now - flow->last_ipstats_time : 0;
 		/* Set new min */
 		if (flow->stats_instant.cur_ips < flow->stats_instant.min_ips)
 			flow->stats_instant.min_ips = flow->stats_instant.cur_ips;
@@ -1470,8 +1658,10 @@ static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, stru
 		/* Avg calculation */
 		flow->stats_instant.total_ips += flow->stats_instant.cur_ips;
 		flow->stats_instant.avg_count++;
+		rist_histogram_record(&flow->ips_hist, flow->stats_instant.cur_ips);
 	}
-	flow->last_ipstats_time = now;
+	if (now > flow->last_ipstats_time)
+		flow->last_ipstats_time = now;
 
 
 	if (time_fast < 100000 /* 100 ms */) {
@@ -1496,6 +1686,12 @@ static void rist_calculate_flow_bitrate(struct rist_flow *flow, size_t len, stru
 	}
 }
 
+static void rist_sender_nack_enqueue(void *arg, uint32_t seq)
+{
+	struct rist_peer *peer = arg;
+	rist_retry_enqueue(peer->sender_ctx, seq, peer);
+}
+
 static void rist_sender_recv_nack(struct rist_peer *peer,
 		uint32_t flow_id, uint16_t src_port, uint16_t dst_port, const uint8_t *payload,
 		size_t payload_len, uint32_t nack_seq_msb)
@@ -1531,6 +1727,14 @@ static void rist_sender_recv_nack(struct rist_peer *peer,
 			rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Non-Rist nack packet (%s).\n", rtcp_nack->name);
 			return; /* Ignore app-type not RIST */
 		}
+		if ((rtcp->flags & 0x1f) == NACK_FMT_COMPACT) {
+			if (ntohs(rtcp->len) < 2)
+				return;
+			size_t nrecords = (size_t)(ntohs(rtcp->len) - 2) / 2;
+			const struct rist_rtcp_nack_compact_record *rec = (const struct rist_rtcp_nack_compact_record *)(payload + sizeof(struct rist_rtcp_nack_range));
+			rist_nack_compact_decode(rec, nrecords, rist_sender_nack_enqueue, peer);
+			return;
+		}
 		uint16_t nrecords =	ntohs(rtcp->len) - 2;
 		//rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "Nack (RbRR), %d record(s)\n", nrecords);
 		for (i = 0; i < nrecords; i++) {
@@ -1871,9 +2075,8 @@ static void rist_receiver_recv_data(struct rist_peer *peer, uint32_t seq, uint32
 	if (pthread_cond_signal(&(peer->flow->condition)))
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
 	if (!receiver_enqueue(peer, source_time, packet_recv_time, payload->data, payload->size, seq, rtt, retry, payload->src_port, payload->dst_port, payload_type)) {
-		pthread_mutex_lock(&ctx->common.stats_lock);
-		rist_calculate_flow_bitrate(peer->flow, payload->size, &peer->flow->bw); // update bitrate only if not a dupe
-		pthread_mutex_unlock(&ctx->common.stats_lock);
+		// bw and inter-packet spacing are only touched by this thread, including the stats report
+		rist_calculate_flow_bitrate(peer->flow, payload->size, &peer->flow->bw, packet_recv_time); // update bitrate only if not a dupe
 
 	}
 }
@@ -1903,13 +2106,10 @@ static void rist_rtcp_handle_echo_request(struct rist_peer *peer, struct rist_rt
 	rist_respond_echoreq(peer, echo_request_time, ssrc);
 }
 
-static void rist_rtcp_handle_echo_response(struct rist_peer *peer, struct rist_rtcp_echoext *echoreq) {
-	peer->echo_enabled = true;
-	if (be32toh(echoreq->ssrc) != peer->peer_ssrc)
-		return;
-	uint64_t request_time = ((uint64_t)be32toh(echoreq->ntp_msw) << 32) | be32toh(echoreq->ntp_lsw);
-	uint64_t rtt = calculate_rtt_delay(request_time, timestampNTP_u64(), be32toh(echoreq->delay));
-	peer->last_mrtt = (uint32_t)rtt / RIST_CLOCK;
+/* New rtt measurement in NTP ticks */
+static void rist_peer_rtt_sample(struct rist_peer *peer, uint64_t rtt)
+{
+	peer->last_mrtt = (uint32_t)(rtt / RIST_CLOCK);
 	peer->eight_times_rtt -= peer->eight_times_rtt / 8;
 	peer->eight_times_rtt += peer->last_mrtt;
 	if (peer->peer_data && peer->peer_data != peer)
@@ -1917,6 +2117,20 @@ static void rist_rtcp_handle_echo_response(struct rist_peer *peer, struct rist_r
 		peer->peer_data->last_mrtt = peer->last_mrtt;
 		peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
 	}
+	struct rist_flow *flow = peer->flow;
+	if (!flow && peer->peer_data)
+		flow = peer->peer_data->flow;
+	if (flow)
+		rist_histogram_record(&flow->rtt_hist, rist_clock_ntp_to_us(rtt));
+}
+
+static void rist_rtcp_handle_echo_response(struct rist_peer *peer, struct rist_rtcp_echoext *echoreq) {
+	peer->echo_enabled = true;
+	if (be32toh(echoreq->ssrc) != peer->peer_ssrc)
+		return;
+	uint64_t request_time = ((uint64_t)be32toh(echoreq->ntp_msw) << 32) | be32toh(echoreq->ntp_lsw);
+	uint64_t rtt = calculate_rtt_delay(request_time, timestampNTP_u64(), be32toh(echoreq->delay));
+	rist_peer_rtt_sample(peer, rtt);
 }
 
 static void rist_handle_sr_pkt(struct rist_peer *peer, struct rist_rtcp_sr_pkt *sr) {
@@ -1954,14 +2168,7 @@ static void rist_handle_rr_pkt(struct rist_peer *peer, struct rist_rtcp_rr_pkt *
 			return;
 		rtt  = now - lsr_ntp  - ((uint64_t)be32toh(rr->dlsr) << 16);
 	}
-	peer->last_mrtt = (uint32_t)(rtt / RIST_CLOCK);
-	peer->eight_times_rtt -= peer->eight_times_rtt / 8;
-	peer->eight_times_rtt += peer->last_mrtt;
-	if (peer->peer_data && peer->peer_data != peer)
-	{
-		peer->peer_data->last_mrtt = peer->last_mrtt;
-		peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
-	}
+	rist_peer_rtt_sample(peer, rtt);
 }
 
 static void rist_handle_xr_pkt(struct rist_peer *peer, uint8_t xr_pkt[])
@@ -1998,14 +2205,7 @@ static void rist_handle_xr_pkt(struct rist_peer *peer, uint8_t xr_pkt[])
 					return;
 				rtt  = now - lrr  - ((uint64_t)be32toh(dlrr->delay) << 16);
 			}
-			peer->last_mrtt = (uint32_t)(rtt / RIST_CLOCK);
-			peer->eight_times_rtt -= peer->eight_times_rtt /8;
-			peer->eight_times_rtt += peer->last_mrtt;
-			if (peer->peer_data && peer->peer_data != peer)
-			{
-				peer->peer_data->last_mrtt = peer->last_mrtt;
-				peer->peer_data->eight_times_rtt = peer->eight_times_rtt;
-			}
+			rist_peer_rtt_sample(peer, rtt);
 		}
 		offset += block_length;
 		bytes_remaining -= block_length;
@@ -2093,7 +2293,14 @@ static void rist_recv_rtcp(struct rist_peer *peer, uint32_t seq,
 					rist_rtcp_handle_echo_request(peer, echorequest);
 					break;
 				}
-				else if (subtype == NACK_FMT_RANGE)	{
+				else if (subtype == RIST_RTCP_CAPS) {
+					if (bytes >= sizeof(struct rist_rtcp_caps)) {
+						struct rist_rtcp_caps *caps = (struct rist_rtcp_caps *)pkt;
+						peer->remote_caps = be32toh(caps->caps);
+					}
+					break;
+				}
+				else if (subtype == NACK_FMT_RANGE || subtype == NACK_FMT_COMPACT)	{
 					//Fallthrough
 					RIST_FALLTHROUGH;
 				}
@@ -2320,13 +2527,21 @@ void rist_peer_rtcp(struct evsocket_ctx *evctx, void *arg)
 			buffer_offset = RIST_GRE_PROTOCOL_REDUCED_SIZE;
 
 		if (peer->address_family == AF_INET6) {
-			recv_bufsize = recvfrom(peer->sd, (char*)recv_buf + buffer_offset, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *) &addr6, &addrlen);
 			family = AF_INET6;
 			addr = (struct sockaddr *) &addr6;
 		} else {
-			recv_bufsize = recvfrom(peer->sd, (char *)recv_buf + buffer_offset, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *)&addr4, &addrlen);
 			addr = (struct sockaddr *) &addr4;
 		}
+		// when the kernel stamped the packet, data arrival is that instead of now
+		uint64_t arrival = now;
+		if (peer->rx_timestamps) {
+			uint64_t kernel_ts;
+			recv_bufsize = udpsocket_recvfrom_ts(peer->sd, recv_buf + buffer_offset, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, addr, &addrlen, &kernel_ts);
+			if (kernel_ts && kernel_ts < now)
+				arrival = kernel_ts;
+		} else {
+			recv_bufsize = recvfrom(peer->sd, (char *)recv_buf + buffer_offset, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, addr, &addrlen);
+		}
 #ifndef _WIN32
 		if (recv_bufsize <= 0) {
 			int errorcode = errno;
@@ -2436,7 +2651,9 @@ void rist_peer_rtcp(struct evsocket_ctx *evctx, void *arg)
 					nonce = gre_key_seq->checksum_reserved1;
 					gre_size -= 4;
 				}
-				_librist_crypto_psk_decrypt(k, nonce, htobe32(seq), rist_gre_version,(unsigned char *)(recv_buf + gre_size),  (unsigned char *)(recv_buf + gre_size), (recv_bufsize - gre_size));
+				// The key for a new nonce is derived in the background, drop until it is ready
+				if (_librist_crypto_psk_decrypt(k, nonce, htobe32(seq), rist_gre_version,(unsigned char *)(recv_buf + gre_size),  (unsigned char *)(recv_buf + gre_size), (recv_bufsize - gre_size)) < 0)
+					return;
 				if (k->bad_decryption)
 					return;
 			} else if (has_seq) {
@@ -2638,8 +2855,8 @@ protocol_bypass:
 							rist_log_priv(get_cctx(peer), RIST_LOG_WARN,
 									"Received data packet on sender, ignoring (%d bytes)...\n", payload.size);
 						else {
-							rist_calculate_bitrate((recv_bufsize - gre_size - sizeof(*proto_hdr)), &p->bw);//use the unexpanded size to show real BW
-							rist_receiver_recv_data(p, seq, flow_id, source_time, now, &payload, retry, proto_hdr->rtp.payload_type);
+							rist_calculate_bitrate((recv_bufsize - gre_size - sizeof(*proto_hdr)), &p->bw, now);//use the unexpanded size to show real BW
+							rist_receiver_recv_data(p, seq, flow_id, source_time, arrival, &payload, retry, proto_hdr->rtp.payload_type);
 						}
 						break;
 					case RIST_PAYLOAD_TYPE_EAPOL:
@@ -2794,6 +3011,9 @@ protocol_bypass:
 				else {
 					// only profile > simple
 					sender_peer_append(peer->sender_ctx, p);
+					// its history burst goes out before any live data
+					if (peer->sender_ctx->fast_start_ms && p->is_data)
+						p->fast_start_pending = true;
 					// authenticate sender now that we have an address
 					rist_peer_authenticate(p);
 					rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Enabling reverse keepalive for peer %d\n", p->adv_peer_id);
@@ -2833,7 +3053,7 @@ protocol_bypass:
 
 		/* insert into oob fifo queue */
 		pthread_rwlock_wrlock(&ctx->oob_queue_lock);
-		ctx->oob_queue[ctx->oob_queue_write_index] = rist_new_buffer(ctx, buf, len, RIST_PAYLOAD_TYPE_DATA_OOB, 0, 0, 0, 0);
+		ctx->oob_queue[ctx->oob_queue_write_index] = rist_new_buffer(ctx, buf, len, RIST_PAYLOAD_TYPE_DATA_OOB, 0, 0, 0, 0, timestampNTP_u64());
 		if (RIST_UNLIKELY(!ctx->oob_queue[ctx->oob_queue_write_index])) {
 			rist_log_priv(get_cctx(peer), RIST_LOG_ERROR, "\t Could not create oob packet buffer, OOM\n");
 			pthread_rwlock_unlock(&ctx->oob_queue_lock);
@@ -2881,7 +3101,7 @@ protocol_bypass:
 		return;
 	}
 
-	static void sender_send_nacks(struct rist_sender *ctx)
+	static void sender_send_nacks(struct rist_sender *ctx, uint64_t now)
 	{
 		// Send retries from the queue (if any)
 		uint32_t counter = 1;
@@ -2895,9 +3115,10 @@ protocol_bypass:
 		// send fifo queue grows to 10 packets (we do not want to harm real-time data)
 		// We also stop on maxcounter (jitter control and max bandwidth protection)
 		size_t queued_items = (atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire) - atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire)) &ctx->sender_queue_max;
-		uint64_t start_time = timestampNTP_u64();
+		uint64_t start_time = now;
+		size_t loops = 0;
 		while (queued_items < 10) {
-			ssize_t ret = rist_retry_dequeue(ctx);
+			ssize_t ret = rist_retry_dequeue(ctx, now);
 			if (ret == 0) {
 				// ret == 0 is valid (nothing to send)
 				break;
@@ -2910,7 +3131,8 @@ protocol_bypass:
 			if (counter > ctx->max_nacksperloop) {
 				break;
 			}
-			if (((timestampNTP_u64() - start_time) / RIST_CLOCK) > 100)
+			// Only re-read the clock every 64 retries for the runaway check
+			if ((++loops & 63) == 0 && ((timestampNTP_u64() - start_time) / RIST_CLOCK) > 100)
 			{
 				rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Nack processing loop took longer than 100ms. Something is wrong!\n");
 				// TODO: clear out the nack queue here?
@@ -2928,10 +3150,72 @@ protocol_bypass:
 
 	}
 
-	static void sender_send_data(struct rist_sender *ctx, int maxcount)
+	/* Finds the oldest packet of the last fast_start_ms still in the history */
+	static void sender_fast_start_begin(struct rist_sender *ctx, struct rist_peer *peer, uint64_t now)
+	{
+		peer->fast_start_pending = false;
+		uint64_t window = (uint64_t)ctx->fast_start_ms * RIST_CLOCK;
+		uint32_t seq = ctx->sender_history.head;
+		size_t idx;
+		struct rist_buffer *b = rist_sender_history_get(&ctx->sender_history, ctx->sender_queue, seq, &idx);
+		if (!b)
+			return;
+		uint64_t origin = b->time;
+		for (size_t i = 0; i < ctx->sender_history.mask; i++) {
+			b = rist_sender_history_get(&ctx->sender_history, ctx->sender_queue, seq - 1, &idx);
+			if (!b || (now > b->time && now - b->time > window))
+				break;
+			seq--;
+			origin = b->time;
+		}
+		peer->fast_start = true;
+		peer->fast_start_seq = seq;
+		peer->fast_start_origin = origin;
+		peer->fast_start_begin = now;
+		rist_log_priv(&ctx->common, RIST_LOG_INFO, "Fast start for peer %"PRIu32", bursting %"PRIu32" packets (%"PRIu64" ms)\n",
+				peer->adv_peer_id, ctx->sender_history.head - seq + 1, now > origin ? (now - origin) / RIST_CLOCK : 0);
+	}
+
+	static void sender_fast_start(struct rist_sender *ctx, uint64_t now)
+	{
+		pthread_mutex_lock(&ctx->common.peerlist_lock);
+		for (size_t j = 0; j < ctx->peer_lst_len; j++) {
+			struct rist_peer *peer = ctx->peer_lst[j]->peer_data;
+			if (!peer || (!peer->fast_start_pending && !peer->fast_start))
+				continue;
+			if (peer->dead) {
+				peer->fast_start_pending = false;
+				peer->fast_start = false;
+				continue;
+			}
+			// the history is data, it is held until the peer is let in
+			if (peer->fast_start_pending && peer->authenticated
+#if HAVE_MBEDTLS
+				&& eap_is_authenticated(peer->eap_ctx)
+#endif
+				)
+				sender_fast_start_begin(ctx, peer, now);
+			if (peer->fast_start)
+				rist_sender_send_fast_start(ctx, peer, now);
+		}
+		pthread_mutex_unlock(&ctx->common.peerlist_lock);
+	}
+
+	static void sender_send_data(struct rist_sender *ctx, int maxcount, uint64_t now)
 	{
 		int counter = 0;
 
+		size_t history_wanted = atomic_load_explicit(&ctx->sender_history_wanted, memory_order_relaxed);
+		if (RIST_UNLIKELY(history_wanted > ctx->sender_history.mask + 1)) {
+			if (rist_sender_history_resize(&ctx->sender_history, ctx->sender_queue, history_wanted) != 0) {
+				rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not grow retransmission history to %zu packets, OOM\n",
+						history_wanted);
+				// keeps a larger size asked for in the meantime
+				atomic_compare_exchange_strong_explicit(&ctx->sender_history_wanted, &history_wanted, ctx->sender_history.mask + 1,
+														memory_order_relaxed, memory_order_relaxed);
+			}
+		}
+
 		while (1) {
 			// If we fall behind, only empty 100 every 5ms (master loop)
 			if (counter++ > maxcount) {
@@ -2965,9 +3249,8 @@ protocol_bypass:
 					buffer->seq_rtp = ctx->common.seq_rtp;
 				}
 				else {
-					rist_sender_send_data_balanced(ctx, buffer);
-					// For non-advanced mode seq to index mapping
-					ctx->seq_index[buffer->seq_rtp] = (uint32_t)idx;
+					ctx->common.seq = rist_sender_history_add(&ctx->sender_history, buffer, idx) + 1;
+					rist_sender_send_data_balanced(ctx, buffer, now);
 				}
 			}
 
@@ -3111,10 +3394,13 @@ protocol_bypass:
 		ctx->stats_next_time = now;
 		ctx->checks_next_time = now;
 		uint64_t nacks_next_time = now;
+		unsigned wakeup_seen = rist_wakeup_events(&ctx->wakeup);
 		while(!atomic_load_explicit(&ctx->common.shutdown, memory_order_acquire)) {
-			// Conditional 5ms sleep that is woken by data coming in
+			// Conditional 5ms sleep that is woken by data coming in, skipped when
+			// data was queued while the previous loop ran
 			pthread_mutex_lock(&(ctx->mutex));
-			int ret = pthread_cond_timedwait_ms(&(ctx->condition), &(ctx->mutex), max_jitter_ms);
+			int ret = rist_wakeup_wait(&ctx->wakeup, &ctx->condition, &ctx->mutex, wakeup_seen, max_jitter_ms);
+			wakeup_seen = rist_wakeup_events(&ctx->wakeup);
 			if (RIST_UNLIKELY(!atomic_load_explicit(&ctx->common.startup_complete, memory_order_acquire))) {
 				pthread_mutex_unlock(&(ctx->mutex));
 				continue;
@@ -3137,6 +3423,8 @@ protocol_bypass:
 			// stats timer
 			if (now > ctx->stats_next_time) {
 				ctx->stats_next_time += rist_stats_interval;
+				ctx->stats_wakeups = atomic_exchange_explicit(&ctx->wakeups, 0, memory_order_relaxed);
+				ctx->stats_wakeups_coalesced = atomic_exchange_explicit(&ctx->wakeups_coalesced, 0, memory_order_relaxed);
 
 				pthread_mutex_lock(&ctx->common.peerlist_lock);
 				for (size_t j = 0; j < ctx->peer_lst_len; j++) {
@@ -3155,6 +3443,8 @@ protocol_bypass:
 			pthread_mutex_lock(&ctx->common.peerlist_lock);
 			evsocket_loop_single(ctx->common.evctx, 0, 100);
 			pthread_mutex_unlock(&ctx->common.peerlist_lock);
+			// resample once after the socket poll, shared by everything below
+			now = timestampNTP_u64();
 
 			// keepalive timer
 			sender_peer_events(ctx, now);
@@ -3163,14 +3453,16 @@ protocol_bypass:
 			// Send data and process nacks
 			pthread_mutex_lock(&ctx->queue_lock);
 			if (ctx->sender_queue_bytesize > 0) {
-				sender_send_data(ctx, max_dataperloop);
+				if (ctx->fast_start_ms)
+					sender_fast_start(ctx, now);
+				sender_send_data(ctx, max_dataperloop, now);
 				// Group nacks and send them all at rist_max_jitter intervals
 				if (now > nacks_next_time) {
-					sender_send_nacks(ctx);
+					sender_send_nacks(ctx, now);
 					nacks_next_time += ctx->common.rist_max_jitter;
 				}
 				/* perform queue cleanup */
-				rist_clean_sender_enqueue(ctx);
+				rist_clean_sender_enqueue(ctx, now);
 			}
 			pthread_mutex_unlock(&ctx->queue_lock);
 			// Send oob data
@@ -3199,6 +3491,8 @@ protocol_bypass:
 			return -1;
 		}
 #endif
+		if (rist_clock_init())
+			rist_log_priv3(RIST_LOG_INFO, "Using calibrated TSC as monotonic clock source\n");
 		ctx->evctx = evsocket_create();
 		ctx->rist_max_jitter = RIST_MAX_JITTER * RIST_CLOCK;
 		if (profile > RIST_PROFILE_ADVANCED) {
@@ -3231,6 +3525,10 @@ protocol_bypass:
 			rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->stats_lock\n");
 			return -1;
 		}
+		if (rist_metrics_init(&ctx->metrics) != 0) {
+			rist_log_priv3( RIST_LOG_ERROR, "Failed to init ctx->metrics\n");
+			return -1;
+		}
 		return 0;
 	}
 
@@ -3390,6 +3688,9 @@ int rist_peer_remove(struct rist_common_ctx *ctx, struct rist_peer *peer, struct
 	if (next != NULL)
 		*next = peer->next;
 	rist_log_priv2(ctx->logging_settings, RIST_LOG_INFO, "[CLEANUP] cleanup done for peer %u\n", peer->adv_peer_id);
+	if (peer->sender_ctx)
+		rist_metrics_forget(&ctx->metrics, RIST_STATS_SENDER_PEER, peer->adv_peer_id);
+	free(peer->stats_report.json);
 	free(peer);
 	return 0;
 }
@@ -3627,6 +3928,7 @@ void rist_receiver_destroy_local(struct rist_receiver *ctx)
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Removing peerlist_lock\n");
 	pthread_mutex_destroy(&ctx->common.peerlist_lock);
+	rist_metrics_destroy(&ctx->common.metrics);
 	if (ctx->common.oob_data_enabled) {
 		rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing oob fifo queue\n");
 		rist_empty_oob_queue(&ctx->common);
@@ -3642,6 +3944,21 @@ void rist_receiver_destroy_local(struct rist_receiver *ctx)
 	ctx = NULL;
 }
 
+static void receiver_latency_check(struct rist_receiver *ctx, struct rist_flow *f, uint64_t now)
+{
+	if (now < f->latency.next_check)
+		return;
+	uint64_t rtt = 0;
+	if (f->peer_lst_len)
+		rtt = (uint64_t)(f->peer_lst[rist_best_rtt_index(f)]->eight_times_rtt / 8) * RIST_CLOCK;
+	uint32_t misses = f->latency_misses;
+	f->latency_misses = 0;
+	if (rist_latency_control_check(&f->latency, misses, rtt, now))
+		rist_log_priv(&ctx->common, RIST_LOG_INFO,
+				"Flow %"PRIu32" buffer target now %"PRIu64" ms, %"PRIu32" late packet(s), rtt %"PRIu64" ms\n",
+				f->flow_id, f->latency.target / RIST_CLOCK, misses, rtt / RIST_CLOCK);
+}
+
 PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 {
 	struct rist_receiver *ctx = (struct rist_receiver *) arg;
@@ -3711,6 +4028,8 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 						continue;
 					}
 				}
+				if (f->latency_adaptive)
+					receiver_latency_check(ctx, f, now);
 				if (now > f->stats_next_time) {
 					f->stats_next_time += f->stats_report_time;
 					rist_receiver_flow_statistics(ctx, f);
@@ -3731,6 +4050,8 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 		pthread_mutex_lock(&ctx->common.peerlist_lock);
 		evsocket_loop_single(ctx->common.evctx, max_jitter_ms, 100);
 		pthread_mutex_unlock(&ctx->common.peerlist_lock);
+		// resample after the socket wait so nack timing covers everything received in it
+		now = timestampNTP_u64();
 		// keepalive timer
 		receiver_peer_events(ctx, now);
 
@@ -3740,7 +4061,7 @@ PTHREAD_START_FUNC(receiver_pthread_protocol, arg)
 			// process nacks on every loop (5 ms interval max)
 			struct rist_flow *f = ctx->common.FLOWS;
 			while (f) {
-				receiver_nack_output(ctx, f);
+				receiver_nack_output(ctx, f, now);
 				f = f->next;
 			}
 		}
@@ -3788,6 +4109,7 @@ void rist_sender_destroy_local(struct rist_sender *ctx)
 
 	pthread_mutex_unlock(&ctx->common.peerlist_lock);
 	pthread_mutex_destroy(&ctx->common.peerlist_lock);
+	rist_metrics_destroy(&ctx->common.metrics);
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Peers cleanup complete\n");
 
 	if (ctx->common.oob_data_enabled) {
@@ -3799,6 +4121,7 @@ void rist_sender_destroy_local(struct rist_sender *ctx)
 
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Freeing up context memory allocations\n");
 	free(ctx->sender_retry_queue);
+	rist_sender_history_free(&ctx->sender_history);
 	struct rist_buffer *b = NULL;
 	while(1) {
 		b = ctx->sender_queue[ctx->sender_queue_delete_index];
@@ -3818,6 +4141,7 @@ void rist_sender_destroy_local(struct rist_sender *ctx)
 		}
 		ctx->sender_queue_delete_index = (ctx->sender_queue_delete_index + 1)& (ctx->sender_queue_max -1);
 	}
+	rist_payload_pool_destroy(&ctx->payload_pool);
 	free(ctx);
 	ctx = NULL;
 	}
@@ -28,6 +28,15 @@
 #include "udpsocket.h"
 #include "aes.h"
 #include "crypto/psk.h"
+#include "histogram.h"
+#include "metrics.h"
+#include "sender-history.h"
+#include "payload-pool.h"
+#include "wakeup.h"
+#include "data-fifo.h"
+#include "clock-drift.h"
+#include "source-clock.h"
+#include "latency-control.h"
 #include <errno.h>
 #include <stdatomic.h>
 #include "librist/logging.h"
@@ -40,6 +49,12 @@
 #define RIST_SERVER_QUEUE_BUFFERS ((UINT16_SIZE) * 8)
 #define RIST_RETRY_QUEUE_BUFFERS ((UINT16_SIZE) * 4)
 #define RIST_OOB_QUEUE_BUFFERS ((UINT16_SIZE) * 2)
+/* Blocks rist_sender_data_writev() queues per queue_lock acquisition */
+#define RIST_SENDER_WRITEV_CHUNK 64
+/* Released payloads the sender keeps for reuse */
+#define RIST_PAYLOAD_POOL_FREE_MAX 8192
+/* Expired packets the sender retires per loop */
+#define RIST_SENDER_CLEANUP_MAX 1024
 #define RIST_DATAOUT_QUEUE_BUFFERS (1024)
 // This will restrict the use of the library to the configured maximum packet size
 #define RIST_MAX_PACKET_SIZE (10000)
@@ -59,6 +74,12 @@
 #define RTCP_FB_FCI_GENERIC_NACK_SIZE (4)
 #define RIST_MAX_NACKS (200)
 #define RIST_MAX_NACKS_BYTES RIST_MAX_NACKS*RTCP_FB_FCI_GENERIC_NACK_SIZE
+// Nacks grouped per flush when every path of the flow understands the compact nack format
+#define RIST_MAX_NACKS_COMPACT (1024)
+// Paths considered when spreading a nack group, and the loss (per mille) above which it gets duplicated
+#define RIST_NACK_MAX_PATHS (8)
+#define RIST_NACK_DUPLICATE_LOSS (100)
+#define RIST_NACK_PATH_WINDOW (1024)
 // Maximum offset before the payload that the code can use to put in headers
 //#define RIST_MAX_PAYLOAD_OFFSET (sizeof(struct rist_gre_key_seq) + sizeof(struct rist_protocol_hdr))
 #define RIST_MAX_HEADER_SIZE 32
@@ -76,6 +97,8 @@
 	(byte & 0x01 ? '1' : '0')
 
 #define STALE_FLOW_TIME (60L * 1000L * RIST_CLOCK) /* in milliseconds */
+#define RIST_PATH_ACTIVE_TIME (2 * ONE_SECOND) /* a duplicate path counts as active for this long after its last redundant packet */
+#define RIST_FAST_START_RATE (2) /* the sender history burst of a fast start runs at this multiple of real time */
 
 enum rist_peer_state {
 	RIST_PEER_STATE_IDLE = 0,
@@ -108,6 +131,10 @@ struct rist_buffer {
 	size_t alloc_size;
 	bool free;
 	bool retry_queued;
+	/* data came from the sender payload pool */
+	bool pooled;
+	/* receiver: target_output_time was moved onto the PCR timeline */
+	bool paced;
 };
 
 struct rist_missing_buffer {
@@ -137,7 +164,7 @@ struct rist_peer_flow_stats {
 	uint32_t dropped_full;
 	uint32_t dropped_late;
 	size_t buffer_duration_count;
-	uint32_t buffer_duration[2048];
+	uint64_t buffer_duration_sum;
 
 	uint32_t missing;
 	uint32_t retries;
@@ -150,7 +177,12 @@ struct rist_peer_flow_stats {
 	uint32_t recovered_3nack;
 	uint32_t recovered_morenack;
 	uint32_t recovered_sum;
+	uint32_t recovered_redundancy;
 	uint32_t recovered_average;
+	/* deliveries that woke a reader, and those that needed no wake up */
+	uint32_t wakeups;
+	uint32_t wakeups_coalesced;
+	uint32_t fifo_overflow;
 	int32_t  recovered_slope;
 	uint32_t recovered_slope_inverted;
 
@@ -162,6 +194,34 @@ struct rist_peer_flow_stats {
 	uint64_t total_ips;
 };
 
+/* Flow counters bumped from the protocol and data output threads without taking
+ * stats_lock. Each counter is independent so relaxed ordering is enough, the
+ * stats timer moves them into stats_instant with rist_flow_counters_snapshot(). */
+struct rist_flow_counters {
+	atomic_uint lost;
+	atomic_uint received;
+	atomic_uint dupe;
+	atomic_uint dropped_full;
+	atomic_uint dropped_late;
+	atomic_uint buffer_duration_count;
+	atomic_ulong buffer_duration_sum; /* ms */
+
+	atomic_uint missing;
+	atomic_uint retries;
+	atomic_uint recovered;
+	atomic_uint reordered;
+	atomic_uint recovered_0nack;
+	atomic_uint recovered_1nack;
+	atomic_uint recovered_2nack;
+	atomic_uint recovered_3nack;
+	atomic_uint recovered_morenack;
+	atomic_uint recovered_sum;
+	atomic_uint recovered_redundancy;
+	atomic_uint wakeups;
+	atomic_uint wakeups_coalesced;
+	atomic_uint fifo_overflow;
+};
+
 struct rist_peer_sender_stats {
 	uint64_t sent;
 	uint32_t received;
@@ -175,13 +235,24 @@ struct rist_peer_receiver_stats {
 	uint32_t sent_rtcp;
 	uint32_t received_rtcp;
 	uint64_t received;
+	uint32_t nacks;
 };
 
 struct nacks {
-	uint32_t array[RIST_MAX_NACKS];
+	uint32_t array[RIST_MAX_NACKS_COMPACT];
 	size_t counter;
 };
 
+/* Per peer/flow stats report. The public container comes first so
+ * rist_stats_free() can tell an allocated report from a reused one */
+struct rist_stats_report {
+	struct rist_stats container;
+	bool allocated;
+	char *json;
+	size_t json_len;
+	size_t json_cap;
+};
+
 struct rist_flow {
 	atomic_int shutdown;
 	int max_output_jitter;
@@ -203,8 +274,16 @@ struct rist_flow {
 	struct rist_missing_buffer *missing_tail;
 	uint32_t missing_counter;
 
+	struct rist_flow_counters counters;
+	/* Latency distributions, microseconds */
+	struct rist_histogram buffer_delay_hist;
+	struct rist_histogram ips_hist;
+	struct rist_histogram recovery_hist;
+	struct rist_histogram rtt_hist;
+	/* Report scratch and inter-packet spacing, protocol thread only */
 	struct rist_peer_flow_stats stats_instant;
 	struct rist_peer_flow_stats stats_total;
+	struct rist_stats_report stats_report;
 	struct rist_bandwidth_estimation bw;
 	uint64_t stats_next_time;
 	uint64_t checks_next_time;
@@ -228,8 +307,33 @@ struct rist_flow {
 	uint64_t max_source_time;
 	uint64_t too_late_ctr;
 
-	size_t offset_recalc_sample_count;
-	uint64_t offset_recalc_samples[2048];
+	/* source clock offset and drift, fed by in-order packets */
+	struct rist_clock_drift clock_drift;
+	/* time_offset corrections applied since the last stats report */
+	int64_t time_offset_adjust;
+
+	/* PCR output pacing, data output thread only */
+	bool pcr_pacing;
+	uint64_t pcr_pacing_margin;
+	struct rist_source_clock_recovery pcr_clock;
+	bool pcr_jitter_has_last;
+	uint64_t pcr_jitter_last;
+	uint64_t pcr_jitter_last_output;
+	/* microseconds */
+	struct rist_histogram pcr_jitter_hist;
+
+	/* adaptive buffer, protocol thread only */
+	bool latency_adaptive;
+	/* the buffer follows latency, adaptive or after a fast start */
+	bool latency_slew;
+	struct rist_latency_control latency;
+	/* packets that missed their deadline since the last check */
+	uint32_t latency_misses;
+	/* output starts after fast_start_buffer, pending until the first live
+	   packet after a history burst of the sender */
+	bool fast_start;
+	bool fast_start_pending;
+	uint64_t fast_start_buffer;
 
 	int64_t time_offset;//Current offset between our clock and RTP packets.
 	int64_t time_offset_old;//Old offset between our clock and RTP packets.
@@ -255,11 +359,7 @@ struct rist_flow {
 	uint64_t last_recv_ts;
 
 	/* Receiver timed async data output */
-	struct rist_data_block **dataout_fifo_queue;
-	size_t dataout_fifo_queue_bytesize;
-	atomic_ulong dataout_fifo_queue_read_index;
-	atomic_ulong dataout_fifo_queue_write_index;
-	atomic_bool fifo_overflow;
+	struct rist_data_fifo dataout_fifo;
 
 	/* Temporary buffer for grouping and sending nacks */
 	struct nacks nacks;
@@ -338,6 +438,8 @@ struct rist_common_ctx {
 
 	int (*stats_callback)(void *arg, const struct rist_stats *stats_container);
 	void *stats_callback_argument;
+	enum rist_stats_format stats_format;
+	struct rist_metrics metrics;
 	pthread_mutex_t stats_lock;
 
 	pthread_rwlock_t oob_queue_lock;
@@ -355,17 +457,23 @@ struct rist_common_ctx {
 
 	rist_thread_callback_func_t thread_callback;
 	void *thread_callback_arg;
+
+	/* enum udpsocket_timestamp_mode asked for with RIST_OPT_RECEIVE_TIMESTAMPS */
+	int receive_timestamps;
 };
 
 struct rist_receiver {
 	/* data out thread signaling for fifo */
 	pthread_cond_t condition;
 	pthread_mutex_t mutex;
+	struct rist_wakeup reader_wakeup;
 
 	/* Receiver data callback */
 	receiver_data_callback2_t receiver_data_callback;
 	void *receiver_data_callback_argument;
 	int receiver_data_ready_notify_fd;
+	/* set once the reader drained the fifo, the next delivery writes to the fd */
+	atomic_bool notify_armed;
 
 	/* Receiver thread variables */
 	bool protocol_running;
@@ -382,6 +490,10 @@ struct rist_receiver {
 	bool simulate_loss;
 	uint16_t loss_percentage;
 	uint32_t fifo_queue_size;
+	enum rist_output_pacing output_pacing;
+	uint32_t output_pacing_jitter_ms;
+	enum rist_latency_mode latency_mode;
+	uint32_t fast_start_ms;
 };
 
 struct rist_sender {
@@ -392,6 +504,11 @@ struct rist_sender {
 	uint32_t recovery_maxbitrate_max;
 	uint32_t max_nacksperloop;
 	bool null_packet_suppression;
+	/* ts_ntp recovery for packets written without one */
+	enum rist_source_clock source_clock_mode;
+	struct rist_source_clock_recovery source_clock;
+	/* history burst to receivers joining, ms */
+	uint32_t fast_start_ms;
 
 	/* Sender thread variables */
 	bool protocol_running;
@@ -399,6 +516,12 @@ struct rist_sender {
 	/* data/nacks out thread signaling */
 	pthread_cond_t condition;
 	pthread_mutex_t mutex;
+	struct rist_wakeup wakeup;
+	atomic_uint wakeups;
+	atomic_uint wakeups_coalesced;
+	/* taken by the stats timer, reported with every peer */
+	uint32_t stats_wakeups;
+	uint32_t stats_wakeups_coalesced;
 
 	bool sender_initialized;
 	uint32_t total_weight;
@@ -425,7 +548,12 @@ struct rist_sender {
 	int cooldown_mode;
 
 	/* Recovery */
-	uint32_t seq_index[UINT16_SIZE];
+	struct rist_sender_history sender_history;
+	/* payloads handed over with RIST_DATA_FLAGS_HAND_OVER */
+	struct rist_payload_pool payload_pool;
+	/* history size the configured peers need, set by the application threads
+	 * and applied by the sender thread */
+	atomic_size_t sender_history_wanted;
 	size_t sender_recover_min_time;
 
 	/* Reporting id */
@@ -497,6 +625,8 @@ struct rist_peer {
 	bool receiver_mode;
 
 	int sd;
+	/* the kernel timestamps packets received on sd */
+	bool rx_timestamps;
 
 	/* State */
 	bool authenticated;
@@ -509,9 +639,22 @@ struct rist_peer {
 	/* RTT statistics */
 	uint32_t last_mrtt;
 
+	/* Receiver path tracking for bonded/duplicated links */
+	uint64_t path_last_arrival;
+	uint64_t path_last_dupe; /* last time this path was seen carrying the same seq as another path */
+	uint64_t path_skew; /* smoothed lag behind the first copy of a packet, in ticks */
+
+	/* Receiver nack routing, decaying window of nacks sent through this path
+	   and retransmissions that came back for them */
+	uint32_t path_nacks;
+	uint32_t path_nacks_recovered;
+
 	/* Missing queue max size */
 	uint32_t missing_counter_max;
 
+	/* Capabilities advertised by a librist peer (RIST_RTCP_CAP_*) */
+	uint32_t remote_caps;
+
 	/* Encryption */
 	struct rist_key key_tx; // used for transmitted packets
 	struct rist_key key_rx; // used for received packets
@@ -556,6 +699,7 @@ struct rist_peer {
 	/* Statistics Sender */
 	struct rist_peer_sender_stats stats_sender_instant;
 	struct rist_peer_sender_stats stats_sender_total;
+	struct rist_stats_report stats_report;
 
 
 	/* Statistics Receiver */
@@ -587,6 +731,14 @@ struct rist_peer {
 	char cname[RIST_MAX_HOSTNAME];
 	bool send_first_connection_event;
 
+	/* Sender history burst to a receiver joining, on the data peer. Its live
+	   data is held while bursting, sender thread only */
+	bool fast_start_pending;
+	bool fast_start;
+	uint32_t fast_start_seq;
+	uint64_t fast_start_origin;
+	uint64_t fast_start_begin;
+
 	uint64_t log_repeat_timer;
 };
 
@@ -605,14 +757,16 @@ static inline struct rist_common_ctx *rist_struct_get_common(struct rist_ctx *ct
 RIST_PRIV void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *flow);
 RIST_PRIV void rist_sender_peer_statistics(struct rist_peer *peer);
 RIST_PRIV void rist_delete_flow(struct rist_receiver *ctx, struct rist_flow *f);
-RIST_PRIV void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer,uint64_t nack_time, uint32_t seq, uint32_t rtt);
+RIST_PRIV void rist_receiver_missing(struct rist_flow *f, struct rist_peer *peer, uint64_t now, uint64_t nack_time, uint32_t seq, uint32_t rtt);
+RIST_PRIV void rist_receiver_path_update(struct rist_peer *peer, struct rist_buffer *first, uint64_t now);
 RIST_PRIV int rist_receiver_associate_flow(struct rist_peer *p, uint32_t flow_id);
 RIST_PRIV size_t rist_best_rtt_index(struct rist_flow *f);
-RIST_PRIV struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf, size_t len, uint8_t type, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port);
+RIST_PRIV struct rist_buffer *rist_new_buffer(struct rist_common_ctx *ctx, const void *buf, size_t len, uint8_t type, uint32_t seq, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint64_t now);
 RIST_PRIV void free_rist_buffer(struct rist_common_ctx *ctx, struct rist_buffer *b);
-RIST_PRIV void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw);
+RIST_PRIV void rist_calculate_bitrate(size_t len, struct rist_bandwidth_estimation *bw, uint64_t now);
 RIST_PRIV void empty_receiver_queue(struct rist_flow *f, struct rist_common_ctx *ctx);
 RIST_PRIV void rist_flush_missing_flow_queue(struct rist_flow *flow);
+RIST_PRIV void rist_flow_counters_snapshot(struct rist_flow_counters *counters, struct rist_peer_flow_stats *snapshot);
 
 /* defined in rist-common.c */
 RIST_PRIV void rist_peer_authenticate(struct rist_peer *peer);
@@ -621,6 +775,7 @@ RIST_PRIV void rist_print_inet_info(char *prefix, struct rist_peer *peer);
 RIST_PRIV void rist_peer_rtcp(struct evsocket_ctx *ctx, void *arg);
 RIST_PRIV void rist_populate_cname(struct rist_peer *peer);
 RIST_PRIV void free_data_block(struct rist_data_block **const block);
+RIST_PRIV void rist_receiver_notify_fd_write(struct rist_receiver *ctx);
 
 /* needed after splitting up */
 RIST_PRIV PTHREAD_START_FUNC(sender_pthread_protocol, arg);
@@ -648,6 +803,29 @@ RIST_PRIV void sender_peer_append(struct rist_sender *ctx, struct rist_peer *pee
 RIST_PRIV struct rist_common_ctx *get_cctx(struct rist_peer *peer);
 
 /*static inline in header file */
+static inline void rist_flow_counter_add(atomic_uint *counter, uint32_t value)
+{
+	atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+static inline void rist_flow_counter_sub(atomic_uint *counter, uint32_t value)
+{
+	atomic_fetch_sub_explicit(counter, value, memory_order_relaxed);
+}
+
+static inline uint32_t rist_flow_counter_get(atomic_uint *counter)
+{
+	return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static inline uint32_t rist_peer_nack_loss(struct rist_peer *p)
+{
+	// Share of nacked packets that never came back through this path, per mille
+	if (p->path_nacks < 16 || p->path_nacks_recovered >= p->path_nacks)
+		return 0;
+	return (uint32_t)(((uint64_t)(p->path_nacks - p->path_nacks_recovered) * 1000) / p->path_nacks);
+}
+
 static inline void peer_append(struct rist_peer *p)
 {
 	struct rist_common_ctx *cctx = get_cctx(p);
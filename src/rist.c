@@ -10,11 +10,13 @@
 #include "rist-private.h"
 #include "log-private.h"
 #include "udp-private.h"
+#include "mpegts.h"
 #include "vcs_version.h"
 #include "rist-thread.h"
 #include <librist/version.h>
 #include "crypto/crypto-private.h"
 #include <assert.h>
+#include <limits.h>
 #ifdef _WIN32
 #include <processthreadsapi.h>
 #endif
@@ -83,6 +85,8 @@ int rist_receiver_create(struct rist_ctx **_ctx, enum rist_profile profile,
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d calling pthread_mutex_init\n", ret);
 		goto fail;
 	}
+	rist_wakeup_init(&ctx->reader_wakeup);
+	atomic_init(&ctx->notify_armed, true);
 
 	*_ctx = rist_ctx;
 
@@ -121,10 +125,7 @@ static struct rist_flow *rist_get_longest_flow(struct rist_receiver *ctx, ssize_
 	struct rist_flow *f_loop = ctx->common.FLOWS;
 	while (f_loop) {
 		struct rist_flow *nextflow = f_loop->next;
-		unsigned long reader_index = atomic_load_explicit(&f_loop->dataout_fifo_queue_read_index, memory_order_relaxed);
-		unsigned long write_index = atomic_load_explicit(&f_loop->dataout_fifo_queue_write_index, memory_order_acquire);
-
-		num_loop = (write_index - reader_index)&(ctx->fifo_queue_size -1);
+		num_loop = (ssize_t)rist_data_fifo_count(&f_loop->dataout_fifo);
 		if (num_loop > *num)
 		{
 			f = f_loop;
@@ -136,6 +137,53 @@ static struct rist_flow *rist_get_longest_flow(struct rist_receiver *ctx, ssize_
 	return f;
 }
 
+/* The reader drained the fifos, the next delivery writes to the notify fd again */
+static void rist_receiver_notify_rearm(struct rist_receiver *ctx)
+{
+	if (!ctx->receiver_data_ready_notify_fd || atomic_load_explicit(&ctx->notify_armed, memory_order_relaxed))
+		return;
+	atomic_store(&ctx->notify_armed, true);
+	atomic_thread_fence(memory_order_seq_cst);
+	// a delivery racing with the drain found the fd disarmed and wrote nothing
+	ssize_t num = 0;
+	rist_get_longest_flow(ctx, &num);
+	if (num > 0 && atomic_exchange(&ctx->notify_armed, false))
+		rist_receiver_notify_fd_write(ctx);
+}
+
+/* Pops up to count blocks of one flow, flagging the first after blocks were dropped */
+static size_t rist_receiver_flow_take(struct rist_flow *f, struct rist_data_block **blocks, size_t count)
+{
+	size_t n = rist_data_fifo_pop(&f->dataout_fifo, blocks, count);
+	if (n && rist_data_fifo_overflow_take(&f->dataout_fifo))
+		blocks[0]->flags |= RIST_DATA_FLAGS_OVERFLOW;
+	return n;
+}
+
+/* Longest flow first to minimize jitter, then the others, with one pass over the flows */
+static size_t rist_receiver_fifo_take(struct rist_receiver *ctx, struct rist_data_block **blocks, size_t count)
+{
+	size_t n = 0;
+	pthread_mutex_lock(&ctx->common.flows_lock);
+	struct rist_flow *longest = NULL;
+	size_t longest_count = 0;
+	for (struct rist_flow *f = ctx->common.FLOWS; f; f = f->next) {
+		size_t queued = rist_data_fifo_count(&f->dataout_fifo);
+		if (queued > longest_count) {
+			longest = f;
+			longest_count = queued;
+		}
+	}
+	if (longest)
+		n = rist_receiver_flow_take(longest, blocks, count);
+	for (struct rist_flow *f = ctx->common.FLOWS; f && longest && n < count; f = f->next) {
+		if (f != longest)
+			n += rist_receiver_flow_take(f, &blocks[n], count - n);
+	}
+	pthread_mutex_unlock(&ctx->common.flows_lock);
+	return n;
+}
+
 int rist_receiver_data_read(struct rist_ctx *ctx, const struct rist_data_block **data_block, int timeout)
 {
 	return rist_receiver_data_read2(ctx, (struct rist_data_block **)data_block, timeout);
@@ -163,12 +211,14 @@ int rist_receiver_data_read2(struct rist_ctx *rist_ctx, struct rist_data_block *
 	   risks are tolerable */
 
 	ssize_t num = 0;
+	// Deliveries after this point wake us up or keep us from sleeping
+	unsigned wakeup_seen = rist_wakeup_events(&ctx->reader_wakeup);
 	// Select the flow with highest queue count to minimize jitter for calling app
 	struct rist_flow *f = rist_get_longest_flow(ctx, &num);
 	if (!num && timeout > 0)
 	{
 		pthread_mutex_lock(&(ctx->mutex));
-		pthread_cond_timedwait_ms(&(ctx->condition), &(ctx->mutex), timeout);
+		rist_wakeup_wait(&ctx->reader_wakeup, &ctx->condition, &ctx->mutex, wakeup_seen, timeout);
 		pthread_mutex_unlock(&(ctx->mutex));
 		f = rist_get_longest_flow(ctx, &num);
 	}
@@ -177,37 +227,59 @@ int rist_receiver_data_read2(struct rist_ctx *rist_ctx, struct rist_data_block *
 	{
 		//No need to log, these can be triggered by gaps in data or low bitrate stream with low timeout values
 		//rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_data_read call with no flow data, %d/%"PRIu32"\n", num, f);
+		rist_receiver_notify_rearm(ctx);
 		return 0;
 	}
 
-	unsigned long dataout_read_index = atomic_load_explicit(&f->dataout_fifo_queue_read_index, memory_order_relaxed);
-	size_t write_index = atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire);
-	if (write_index != dataout_read_index)
+	if (!rist_receiver_flow_take(f, &data_block, 1))
 	{
-		do {
-			num = (atomic_load_explicit(&f->dataout_fifo_queue_write_index, memory_order_acquire) - dataout_read_index) &(ctx->fifo_queue_size -1);
-			if (atomic_compare_exchange_weak(&f->dataout_fifo_queue_read_index, &dataout_read_index, (dataout_read_index +1)&(ctx->fifo_queue_size -1)))
-			{
-				data_block = f->dataout_fifo_queue[dataout_read_index];
-				f->dataout_fifo_queue[dataout_read_index] = NULL;
-				break;
-			}
-		} while (num > 0);
+		// Another reader got there first
+		rist_receiver_notify_rearm(ctx);
+		return 0;
 	}
-	assert(!(data_block == NULL && num > 0));
 
 	*data_buffer = data_block;
 
-	bool overflow = false;
-	while (!atomic_compare_exchange_weak(&f->fifo_overflow, &overflow, false)) {
-		//
-	}
-	if (overflow)
-		data_block->flags |= RIST_DATA_FLAGS_OVERFLOW;
+	// That was the last one of the longest flow
+	if (num <= 1)
+		rist_receiver_notify_rearm(ctx);
 
 	return (int)num;
 }
 
+int rist_receiver_data_readv(struct rist_ctx *rist_ctx, struct rist_data_block **data_blocks, size_t count, int timeout)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "ctx is null on rist_receiver_data_readv call!\n");
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_RECEIVER_MODE || !rist_ctx->receiver_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_data_readv call with CTX not set up for receiving\n");
+		return -2;
+	}
+	if (RIST_UNLIKELY(!data_blocks && count))
+		return -1;
+	if (count > INT_MAX)
+		count = INT_MAX;
+
+	struct rist_receiver *ctx = rist_ctx->receiver_ctx;
+	unsigned wakeup_seen = rist_wakeup_events(&ctx->reader_wakeup);
+	size_t n = rist_receiver_fifo_take(ctx, data_blocks, count);
+	if (!n && count && timeout > 0)
+	{
+		pthread_mutex_lock(&(ctx->mutex));
+		rist_wakeup_wait(&ctx->reader_wakeup, &ctx->condition, &ctx->mutex, wakeup_seen, timeout);
+		pthread_mutex_unlock(&(ctx->mutex));
+		n = rist_receiver_fifo_take(ctx, data_blocks, count);
+	}
+	// A short read drained every flow
+	if (n < count)
+		rist_receiver_notify_rearm(ctx);
+	return (int)n;
+}
+
 void rist_receiver_data_block_free(struct rist_data_block **const block)
 {
 	rist_receiver_data_block_free2((struct rist_data_block **)block);
@@ -242,6 +314,7 @@ int rist_receiver_data_notify_fd_set(struct rist_ctx *rist_ctx, int fd)
 	}
 	struct rist_receiver *ctx = rist_ctx->receiver_ctx;
 	ctx->receiver_data_ready_notify_fd = fd;
+	atomic_store(&ctx->notify_armed, true);
 	return 0;
 }
 
@@ -364,6 +437,14 @@ int rist_sender_create(struct rist_ctx **_ctx, enum rist_profile profile,
 	atomic_init(&ctx->sender_queue_write_index, 1);
 	atomic_init(&ctx->sender_queue_read_index, 0);
 
+	atomic_init(&ctx->sender_history_wanted, UINT16_SIZE);
+	if (rist_sender_history_init(&ctx->sender_history, UINT16_SIZE) != 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not create sender retransmission history, OOM\n");
+		ret = -1;
+		goto free_ctx_and_ret;
+	}
+
 	rist_log_priv(&ctx->common, RIST_LOG_INFO, "RIST Sender Library %s\n", LIBRIST_VERSION);
 
 	ctx->common.sender_id = ctx->id;
@@ -399,6 +480,9 @@ int rist_sender_create(struct rist_ctx **_ctx, enum rist_profile profile,
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Error %d initializing pthread_mutex\n", ret);
 		goto free_ctx_and_ret;
 	}
+	rist_wakeup_init(&ctx->wakeup);
+	atomic_init(&ctx->wakeups, 0);
+	atomic_init(&ctx->wakeups_coalesced, 0);
 
 	ret = pthread_mutex_init(&ctx->queue_lock, NULL);
 	if (ret)
@@ -407,6 +491,13 @@ int rist_sender_create(struct rist_ctx **_ctx, enum rist_profile profile,
 		goto free_ctx_and_ret;
 	}
 
+	if (rist_payload_pool_init(&ctx->payload_pool, RIST_PAYLOAD_POOL_FREE_MAX) != 0)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Could not initialize the payload pool\n");
+		ret = -1;
+		goto free_ctx_and_ret;
+	}
+
 	ctx->sender_initialized = true;
 
 	*_ctx = rist_ctx;
@@ -414,6 +505,7 @@ int rist_sender_create(struct rist_ctx **_ctx, enum rist_profile profile,
 
 	// Failed!
 free_ctx_and_ret:
+	rist_sender_history_free(&ctx->sender_history);
 	free(ctx);
 	free(rist_ctx);
 	return ret;
@@ -495,19 +587,60 @@ int rist_sender_flow_id_set(struct rist_ctx *rist_ctx, uint32_t flow_id)
 	return 0;
 }
 
-int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_block *data_block)
+int rist_sender_source_clock_set(struct rist_ctx *rist_ctx, enum rist_source_clock source_clock, uint32_t clock_rate)
 {
-	if (RIST_UNLIKELY(!rist_ctx))
+	if (RIST_UNLIKELY(!rist_ctx || rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
 	{
-		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_write call with null context\n");
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_source_clock_set call with ctx not set up for sending\n");
 		return -1;
 	}
-	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	switch (source_clock) {
+	case RIST_SOURCE_CLOCK_NONE:
+		break;
+	case RIST_SOURCE_CLOCK_MPEGTS_PCR:
+		rist_source_clock_init(&ctx->source_clock, MPEGTS_PCR_HZ, MPEGTS_PCR_WRAP, 250 * RIST_CLOCK);
+		break;
+	case RIST_SOURCE_CLOCK_RTP:
+		rist_source_clock_init(&ctx->source_clock, clock_rate ? clock_rate : RTP_PTYPE_MPEGTS_CLOCKHZ, 1ULL << 32, 250 * RIST_CLOCK);
+		break;
+	default:
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Unknown source clock %d\n", source_clock);
+		return -1;
+	}
+	ctx->source_clock_mode = source_clock;
+	return 0;
+}
+
+uint64_t rist_sender_source_clock_ts(struct rist_ctx *rist_ctx, uint32_t rtp_timestamp)
+{
+	if (RIST_UNLIKELY(!rist_ctx || rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+		return 0;
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	if (ctx->source_clock_mode != RIST_SOURCE_CLOCK_RTP)
+		return 0;
+	return rist_source_clock_map(&ctx->source_clock, rtp_timestamp, timestampNTP_u64());
+}
+
+int rist_sender_fast_start_set(struct rist_ctx *rist_ctx, uint32_t burst_ms)
+{
+	if (RIST_UNLIKELY(!rist_ctx || rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
 	{
-		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_write call with ctx not set up for sending\n");
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_fast_start_set call with ctx not set up for sending\n");
 		return -1;
 	}
 	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	if (ctx->protocol_running)
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "rist_sender_fast_start_set must be called before starting\n");
+		return -1;
+	}
+	ctx->fast_start_ms = burst_ms;
+	return 0;
+}
+
+static int rist_sender_check_block(struct rist_sender *ctx, const struct rist_data_block *data_block)
+{
 	// max protocol overhead for data is gre-header plus gre-reduced-mode-header plus rtp-header
 	// 16 + 4 + 12 = 32
 
@@ -517,25 +650,178 @@ int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_blo
 					  "Dropping pipe packet of size %d, max is %d.\n", data_block->payload_len, RIST_MAX_PACKET_SIZE - 32);
 		return -1;
 	}
+	return 0;
+}
 
-	uint64_t ts_ntp = data_block->ts_ntp == 0 ? timestampNTP_u64() : data_block->ts_ntp;
+static uint32_t rist_sender_block_seq(struct rist_sender *ctx, const struct rist_data_block *data_block)
+{
 	uint32_t seq_rtp;
 	if (data_block->flags & RIST_DATA_FLAGS_USE_SEQ)
 		seq_rtp = (uint32_t)data_block->seq;
 	else
 		seq_rtp = ctx->common.seq_rtp++;
 	//When we support 32bit seq this should be changed
-	seq_rtp = seq_rtp & (UINT16_MAX);
+	return seq_rtp & (UINT16_MAX);
+}
+
+static struct rist_buffer *rist_sender_block_buffer(struct rist_sender *ctx, const struct rist_data_block *data_block, uint64_t now)
+{
+	uint64_t ts_ntp = data_block->ts_ntp;
+	if (ts_ntp == 0 && ctx->source_clock_mode == RIST_SOURCE_CLOCK_MPEGTS_PCR)
+		ts_ntp = rist_source_clock_mpegts(&ctx->source_clock, data_block->payload, data_block->payload_len,
+										  data_block->virt_src_port, now);
+	if (ts_ntp == 0)
+		ts_ntp = now;
+	uint32_t seq_rtp = rist_sender_block_seq(ctx, data_block);
+	ctx->last_datagram_time = ts_ntp;
+	if ((data_block->flags & RIST_DATA_FLAGS_HAND_OVER) &&
+		rist_payload_pool_owns(&ctx->payload_pool, (void *)data_block->payload))
+		return rist_sender_buffer_adopt(ctx, (void *)data_block->payload, data_block->payload_len, ts_ntp,
+										data_block->virt_src_port, data_block->virt_dst_port, seq_rtp, now);
+	if (data_block->flags & RIST_DATA_FLAGS_HAND_OVER)
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Handed over payload was not allocated by this sender, copying it\n");
+	return rist_sender_buffer_new(ctx, data_block->payload, data_block->payload_len, ts_ntp,
+								  data_block->virt_src_port, data_block->virt_dst_port, seq_rtp, now);
+}
+
+/* Handed over payloads are ours even when they are not queued */
+static void rist_sender_block_release(struct rist_sender *ctx, const struct rist_data_block *data_block)
+{
+	if (!(data_block->flags & RIST_DATA_FLAGS_HAND_OVER))
+		return;
+	// without a sender the pool only checks the payload is one it handed out
+	if (!ctx || rist_payload_pool_owns(&ctx->payload_pool, (void *)data_block->payload))
+		rist_payload_pool_put((void *)data_block->payload);
+}
+
+/* Signals the sender thread only if it is parked, a busy one picks the data up by itself */
+static void rist_sender_wake(struct rist_sender *ctx)
+{
+	int ret = rist_wakeup_notify(&ctx->wakeup, &ctx->condition, &ctx->mutex);
+	if (ret > 0)
+		atomic_fetch_add_explicit(&ctx->wakeups, 1, memory_order_relaxed);
+	else if (ret == 0)
+		atomic_fetch_add_explicit(&ctx->wakeups_coalesced, 1, memory_order_relaxed);
+	else
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_broadcast failed.\n");
+}
+
+int rist_sender_data_write(struct rist_ctx *rist_ctx, const struct rist_data_block *data_block)
+{
+	if (RIST_UNLIKELY(!rist_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_write call with null context\n");
+		rist_sender_block_release(NULL, data_block);
+		return -1;
+	}
+	if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_write call with ctx not set up for sending\n");
+		rist_sender_block_release(NULL, data_block);
+		return -1;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	// Do not cache data if the lib user has not added peers
+	if (rist_sender_check_block(ctx, data_block) != 0 || ctx->common.PEERS == NULL)
+	{
+		rist_sender_block_release(ctx, data_block);
+		return -1;
+	}
 
-	int ret = rist_sender_enqueue(ctx, data_block->payload, data_block->payload_len, ts_ntp, data_block->virt_src_port, data_block->virt_dst_port, seq_rtp);
+	uint64_t now = timestampNTP_u64();
+	struct rist_buffer *buffer = rist_sender_block_buffer(ctx, data_block, now);
+	if (RIST_UNLIKELY(!buffer))
+		return -1;
+	rist_sender_enqueue_buffers(ctx, &buffer, 1);
 	// Wake up data/nack output thread when data comes in
-	if (pthread_cond_signal(&ctx->condition))
-		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Call to pthread_cond_signal failed.\n");
+	rist_sender_wake(ctx);
 
-	if (ret < 0)
-		return ret;
+	return (int)data_block->payload_len;
+}
+
+int rist_sender_data_writev(struct rist_ctx *rist_ctx, const struct rist_data_block *data_blocks, size_t count)
+{
+	if (RIST_UNLIKELY(count && !data_blocks))
+		return -1;
+	struct rist_sender *ctx = NULL;
+	if (RIST_UNLIKELY(!rist_ctx))
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_writev call with null context\n");
+	else if (RIST_UNLIKELY(rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_data_writev call with ctx not set up for sending\n");
 	else
-		return (int)data_block->payload_len;
+		ctx = rist_ctx->sender_ctx;
+	// Do not cache data if the lib user has not added peers
+	if (!ctx || ctx->common.PEERS == NULL)
+	{
+		for (size_t i = 0; i < count; i++)
+			rist_sender_block_release(ctx, &data_blocks[i]);
+		return -1;
+	}
+
+	// Buffers are allocated and copied outside the lock, then queued per chunk
+	struct rist_buffer *buffers[RIST_SENDER_WRITEV_CHUNK];
+	uint64_t now = timestampNTP_u64();
+	size_t written = 0;
+	bool dropped = false;
+	bool oom = false;
+	bool capped = false;
+	size_t i = 0;
+	while (i < count && !oom && !capped) {
+		size_t n = 0;
+		for (; i < count && n < RIST_SENDER_WRITEV_CHUNK && !oom; i++) {
+			const struct rist_data_block *data_block = &data_blocks[i];
+			if (rist_sender_check_block(ctx, data_block) != 0) {
+				rist_sender_block_release(ctx, data_block);
+				dropped = true;
+				continue;
+			}
+			// the byte count has to fit the return value, leave the rest to the caller
+			if (RIST_UNLIKELY(data_block->payload_len > (size_t)INT_MAX - written)) {
+				capped = true;
+				break;
+			}
+			buffers[n] = rist_sender_block_buffer(ctx, data_block, now);
+			if (RIST_UNLIKELY(!buffers[n])) {
+				oom = true;
+				continue;
+			}
+			written += data_block->payload_len;
+			n++;
+		}
+		if (n)
+			rist_sender_enqueue_buffers(ctx, buffers, n);
+	}
+	for (; i < count && !capped; i++)
+		rist_sender_block_release(ctx, &data_blocks[i]);
+	// One wake up of the data/nack output thread for the whole batch
+	if (written)
+		rist_sender_wake(ctx);
+
+	if (!written && (dropped || oom))
+		return -1;
+	return (int)written;
+}
+
+void *rist_sender_payload_alloc(struct rist_ctx *rist_ctx, size_t size)
+{
+	if (RIST_UNLIKELY(!rist_ctx || rist_ctx->mode != RIST_SENDER_MODE || !rist_ctx->sender_ctx))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_sender_payload_alloc call with ctx not set up for sending\n");
+		return NULL;
+	}
+	struct rist_sender *ctx = rist_ctx->sender_ctx;
+	if (size > (RIST_MAX_PACKET_SIZE - 32))
+	{
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Payload size %zu is too large, max is %d.\n", size, RIST_MAX_PACKET_SIZE - 32);
+		return NULL;
+	}
+	return rist_payload_pool_get(&ctx->payload_pool, size);
+}
+
+void rist_sender_payload_free(struct rist_ctx *rist_ctx, void *payload)
+{
+	RIST_MARK_UNUSED(rist_ctx);
+	rist_payload_pool_put(payload);
 }
 
 /* Shared OOB functions -> Tunneled IP packets within GRE */
@@ -646,9 +932,13 @@ int rist_stats_free(const struct rist_stats *stats_container)
 {
 	if (!stats_container)
 		return -1;
+	// Reused reports stay with their peer/flow
+	const struct rist_stats_report *report = (const struct rist_stats_report *)stats_container;
+	if (!report->allocated)
+		return 0;
 	if (stats_container->stats_json)
 		free(stats_container->stats_json);
-	free((void *)stats_container);
+	free((void *)report);
 	return 0;
 }
 
@@ -673,6 +963,7 @@ int rist_logging_settings_free(const struct rist_logging_settings **logging_sett
 
 int rist_logging_settings_free2(struct rist_logging_settings **logging_settings)
 {
+	rist_log_async_flush();
 	if (*logging_settings) {
 		free((void *)*logging_settings);
 		*logging_settings = NULL;
@@ -695,12 +986,22 @@ int rist_udp_config_free2(struct rist_udp_config **udp_config)
 }
 
 int rist_stats_callback_set(struct rist_ctx *ctx, int statsinterval, int (*stats_cb)(void *arg, const struct rist_stats *stats_container), void *arg)
+{
+	return rist_stats_callback_set2(ctx, statsinterval, RIST_STATS_FORMAT_JSON, stats_cb, arg);
+}
+
+int rist_stats_callback_set2(struct rist_ctx *ctx, int statsinterval, enum rist_stats_format format, int (*stats_cb)(void *arg, const struct rist_stats *stats_container), void *arg)
 {
 	if (RIST_UNLIKELY(!ctx))
 	{
 		rist_log_priv3(RIST_LOG_ERROR, "rist_stats_callback_set call with null ctx!\n");
 		return -1;
 	}
+	if (format != RIST_STATS_FORMAT_JSON && format != RIST_STATS_FORMAT_JSON_REUSED && format != RIST_STATS_FORMAT_BINARY)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_stats_callback_set2 called with unknown format %d\n", (int)format);
+		return -1;
+	}
 	struct rist_common_ctx *cctx = rist_struct_get_common(ctx);
 	pthread_mutex_lock(&cctx->stats_lock);
 	if (RIST_UNLIKELY(!cctx))
@@ -710,6 +1011,7 @@ int rist_stats_callback_set(struct rist_ctx *ctx, int statsinterval, int (*stats
 	{
 		cctx->stats_callback = stats_cb;
 		cctx->stats_callback_argument = arg;
+		cctx->stats_format = format;
 		cctx->stats_report_time = statsinterval * RIST_CLOCK;
 		if (ctx->mode == RIST_RECEIVER_MODE)
 		{
@@ -725,6 +1027,25 @@ int rist_stats_callback_set(struct rist_ctx *ctx, int statsinterval, int (*stats
 	return 0;
 }
 
+int rist_metrics_render(struct rist_ctx **ctxs, size_t count, char *buf, size_t size)
+{
+	if (RIST_UNLIKELY(!ctxs || !count || count > RIST_METRICS_MAX_CTX) || (!buf && size))
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_metrics_render call with null ctx or buffer!\n");
+		return -1;
+	}
+	struct rist_metrics *metrics[RIST_METRICS_MAX_CTX];
+	for (size_t i = 0; i < count; i++)
+	{
+		struct rist_common_ctx *cctx = ctxs[i] ? rist_struct_get_common(ctxs[i]) : NULL;
+		if (RIST_UNLIKELY(!cctx))
+			return -1;
+		metrics[i] = &cctx->metrics;
+	}
+	size_t len = rist_metrics_write(metrics, count, buf, size);
+	return len > INT_MAX ? -1 : (int)len;
+}
+
 /* Utility functions */
 const char *librist_version(void)
 {
@@ -1128,6 +1449,8 @@ int rist_destroy(struct rist_ctx *ctx) {
 	else
 		return -1;
 	free(ctx);
+	// the logging settings may be freed by the caller next
+	rist_log_async_flush();
 	return 0;
 }
 
@@ -1157,6 +1480,68 @@ int rist_receiver_set_output_fifo_size(struct rist_ctx *ctx, uint32_t desired_si
 	return 0;
 }
 
+int rist_receiver_output_pacing_set(struct rist_ctx *ctx, enum rist_output_pacing pacing, uint32_t jitter_ms)
+{
+	if (!ctx || ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_output_pacing_set can only be called on receiver\n");
+		return -1;
+	}
+	struct rist_receiver *receiver_ctx = ctx->receiver_ctx;
+	if (receiver_ctx->receiver_thread)
+	{
+		rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "rist_receiver_output_pacing_set must be called before starting\n");
+		return -1;
+	}
+	if (pacing != RIST_OUTPUT_PACING_NONE && pacing != RIST_OUTPUT_PACING_MPEGTS_PCR)
+	{
+		rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "Unknown output pacing %d\n", pacing);
+		return -1;
+	}
+	receiver_ctx->output_pacing = pacing;
+	receiver_ctx->output_pacing_jitter_ms = jitter_ms ? jitter_ms : 2;
+	return 0;
+}
+
+int rist_receiver_latency_mode_set(struct rist_ctx *ctx, enum rist_latency_mode mode)
+{
+	if (!ctx || ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_latency_mode_set can only be called on receiver\n");
+		return -1;
+	}
+	struct rist_receiver *receiver_ctx = ctx->receiver_ctx;
+	if (receiver_ctx->receiver_thread)
+	{
+		rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "rist_receiver_latency_mode_set must be called before starting\n");
+		return -1;
+	}
+	if (mode != RIST_LATENCY_FIXED && mode != RIST_LATENCY_ADAPTIVE)
+	{
+		rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "Unknown latency mode %d\n", mode);
+		return -1;
+	}
+	receiver_ctx->latency_mode = mode;
+	return 0;
+}
+
+int rist_receiver_fast_start_set(struct rist_ctx *ctx, uint32_t start_ms)
+{
+	if (!ctx || ctx->mode != RIST_RECEIVER_MODE || !ctx->receiver_ctx)
+	{
+		rist_log_priv3(RIST_LOG_ERROR, "rist_receiver_fast_start_set can only be called on receiver\n");
+		return -1;
+	}
+	struct rist_receiver *receiver_ctx = ctx->receiver_ctx;
+	if (receiver_ctx->receiver_thread)
+	{
+		rist_log_priv(&receiver_ctx->common, RIST_LOG_ERROR, "rist_receiver_fast_start_set must be called before starting\n");
+		return -1;
+	}
+	receiver_ctx->fast_start_ms = start_ms;
+	return 0;
+}
+
 int rist_set_opt(struct rist_ctx *ctx, enum rist_opt opt, void* optval1, void* optval2, void* optval3)
 {
 	struct rist_common_ctx *cctx = NULL;
@@ -1178,6 +1563,15 @@ int rist_set_opt(struct rist_ctx *ctx, enum rist_opt opt, void* optval1, void* o
 		cctx->thread_callback = thread_callback->thread_callback;
 		cctx->thread_callback_arg = optval2;
 		break;
+	case RIST_OPT_RECEIVE_TIMESTAMPS:
+		;
+		int *mode = optval1;
+		if (mode == NULL || optval2 != NULL || optval3 != NULL)
+			return -1;
+		if (*mode < UDPSOCKET_TIMESTAMP_NONE || *mode > UDPSOCKET_TIMESTAMP_HARDWARE)
+			return -1;
+		cctx->receive_timestamps = *mode;
+		break;
 	default:
 		return -1;
 	}
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "sender-history.h"
+#include "rist-private.h"
+#include "udp-private.h"
+#include <stdlib.h>
+
+int rist_sender_history_init(struct rist_sender_history *history, size_t size)
+{
+	history->entries = calloc(size, sizeof(*history->entries));
+	if (!history->entries)
+		return -1;
+	history->mask = size - 1;
+	history->head = 0;
+	return 0;
+}
+
+void rist_sender_history_free(struct rist_sender_history *history)
+{
+	free(history->entries);
+	history->entries = NULL;
+	history->mask = 0;
+}
+
+int rist_sender_history_resize(struct rist_sender_history *history, struct rist_buffer **queue, size_t size)
+{
+	if (size <= history->mask + 1)
+		return 0;
+	struct rist_sender_history_entry *entries = calloc(size, sizeof(*entries));
+	if (!entries)
+		return -1;
+	// distinct slots of the smaller table stay distinct in the larger one,
+	// slots never filled hold seq 0 and must not land on the new slot 0
+	for (size_t i = 0; i <= history->mask; i++) {
+		struct rist_sender_history_entry *e = &history->entries[i];
+		struct rist_buffer *buffer = queue[e->idx];
+		if ((e->seq & history->mask) != i || !buffer || buffer->seq != e->seq)
+			continue;
+		entries[e->seq & (size - 1)] = *e;
+	}
+	free(history->entries);
+	history->entries = entries;
+	history->mask = size - 1;
+	return 0;
+}
+
+size_t rist_sender_history_size(uint32_t maxbitrate, uint32_t length_ms, size_t limit)
+{
+	// kbps * ms is bits, twice the packets for smaller datagrams and bursts
+	uint64_t packets = (uint64_t)maxbitrate * length_ms / 8 / RIST_SENDER_HISTORY_PACKET_SIZE * 2;
+	size_t size = UINT16_SIZE;
+	while (size < packets && size < limit)
+		size <<= 1;
+	return size;
+}
+
+uint32_t rist_sender_history_add(struct rist_sender_history *history, struct rist_buffer *buffer, size_t idx)
+{
+	// Application supplied sequence numbers may step back a little
+	uint32_t seq = history->head + (uint32_t)(int16_t)(buffer->seq_rtp - (uint16_t)history->head);
+	if ((int32_t)(seq - history->head) > 0)
+		history->head = seq;
+	buffer->seq = seq;
+	struct rist_sender_history_entry *e = &history->entries[seq & history->mask];
+	e->seq = seq;
+	e->idx = (uint32_t)idx;
+	return seq;
+}
+
+struct rist_buffer *rist_sender_history_get(struct rist_sender_history *history, struct rist_buffer **queue, uint32_t seq, size_t *idx)
+{
+	struct rist_sender_history_entry *e = &history->entries[seq & history->mask];
+	if (e->seq != seq)
+		return NULL;
+	// the slot may have been cleaned up and reused since
+	struct rist_buffer *buffer = queue[e->idx];
+	if (!buffer || buffer->seq != seq || buffer->type == RIST_PAYLOAD_TYPE_RTCP)
+		return NULL;
+	*idx = e->idx;
+	return buffer;
+}
+
+static bool rist_sender_history_requested(struct rist_sender_history *history, struct rist_buffer **queue, uint32_t seq,
+										  uint64_t now, uint64_t repeat_window)
+{
+	size_t idx;
+	struct rist_buffer *buffer = rist_sender_history_get(history, queue, seq, &idx);
+	return buffer && buffer->last_retry_request != 0 && now - buffer->last_retry_request < repeat_window;
+}
+
+struct rist_buffer *rist_sender_history_resolve(struct rist_sender_history *history, struct rist_buffer **queue, uint16_t seq_rtp,
+												uint64_t now, uint64_t min_age, uint64_t repeat_window, uint32_t *seq, size_t *idx)
+{
+	uint32_t candidate = history->head - (uint16_t)(history->head - seq_rtp);
+	size_t aliases = (history->mask >> 16) + 1;
+	struct rist_buffer *newest = NULL;
+	uint32_t newest_seq = 0;
+	size_t newest_idx = 0;
+	for (size_t i = 0; i < aliases; i++, candidate -= UINT16_SIZE) {
+		size_t slot;
+		struct rist_buffer *buffer = rist_sender_history_get(history, queue, candidate, &slot);
+		if (!buffer)
+			break;
+		if (!newest) {
+			newest = buffer;
+			newest_seq = candidate;
+			newest_idx = slot;
+		}
+		if (now < buffer->time || now - buffer->time < min_age)
+			continue;
+		// A receiver keeps asking for a packet until its buffer expires, a
+		// repeat for an older alias beats a first request for this one
+		if (buffer->last_retry_request == 0 && i + 1 < aliases &&
+			rist_sender_history_requested(history, queue, candidate - UINT16_SIZE, now, repeat_window))
+			continue;
+		*seq = candidate;
+		*idx = slot;
+		return buffer;
+	}
+	if (newest) {
+		*seq = newest_seq;
+		*idx = newest_idx;
+	}
+	return newest;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_SENDER_HISTORY_H
+#define RIST_SENDER_HISTORY_H
+
+#include "common/attributes.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct rist_buffer;
+
+/*
+ * Retransmission lookup of the sender: the sender_queue slot of every data
+ * packet sent, direct mapped by its 32-bit extended RTP sequence number. The
+ * table is sized from the configured bitrate and buffer so the whole recovery
+ * window resolves, even when it holds more than 65536 packets. Only the sender
+ * thread touches it.
+ */
+struct rist_sender_history_entry {
+	uint32_t seq;
+	uint32_t idx;
+};
+
+struct rist_sender_history {
+	struct rist_sender_history_entry *entries;
+	size_t mask;
+	/* newest extended sequence sent */
+	uint32_t head;
+};
+
+/* Average datagram the table is sized for, 7 TS packets */
+#define RIST_SENDER_HISTORY_PACKET_SIZE 1316
+
+RIST_PRIV int rist_sender_history_init(struct rist_sender_history *history, size_t size);
+RIST_PRIV void rist_sender_history_free(struct rist_sender_history *history);
+/* Grows the table keeping the entries still queued, size is a power of two */
+RIST_PRIV int rist_sender_history_resize(struct rist_sender_history *history, struct rist_buffer **queue, size_t size);
+/* Entries needed for a buffer of length_ms at maxbitrate kbps, rounded to a power of two */
+RIST_PRIV size_t rist_sender_history_size(uint32_t maxbitrate, uint32_t length_ms, size_t limit);
+
+/* Extends buffer->seq_rtp, stores it in buffer->seq and records the slot */
+RIST_PRIV uint32_t rist_sender_history_add(struct rist_sender_history *history, struct rist_buffer *buffer, size_t idx);
+/* Buffer sent with the extended seq if it is still queued, NULL otherwise */
+RIST_PRIV struct rist_buffer *rist_sender_history_get(struct rist_sender_history *history, struct rist_buffer **queue, uint32_t seq, size_t *idx);
+/*
+ * Maps the 16-bit sequence of a NACK to the packet it asks for: the newest one
+ * with those low bits sent at least min_age ticks ago, as nothing younger can
+ * have been reported missing yet, unless it was never requested while an older
+ * one was within repeat_window. Falls back to the newest match.
+ */
+RIST_PRIV struct rist_buffer *rist_sender_history_resolve(struct rist_sender_history *history, struct rist_buffer **queue, uint16_t seq_rtp,
+														  uint64_t now, uint64_t min_age, uint64_t repeat_window, uint32_t *seq, size_t *idx);
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "source-clock.h"
+#include "mpegts.h"
+
+/* a jump of the source clock beyond this is a discontinuity, not jitter */
+#define SOURCE_CLOCK_MAX_STEP_S 5
+
+void rist_source_clock_init(struct rist_source_clock_recovery *c, uint64_t clock_hz, uint64_t wrap, uint64_t bucket_length)
+{
+	c->clock_hz = clock_hz;
+	c->wrap = wrap;
+	rist_clock_drift_init(&c->drift, bucket_length);
+	rist_source_clock_reset(c);
+}
+
+void rist_source_clock_reset(struct rist_source_clock_recovery *c)
+{
+	c->has_ticks = false;
+	c->ticks = 0;
+	c->pcr_pid = -1;
+	c->ticks_per_byte = 0.0;
+	c->has_offset = false;
+	rist_clock_drift_reset(&c->drift);
+}
+
+static int64_t source_ticks_to_ntp(const struct rist_source_clock_recovery *c, int64_t ticks)
+{
+	uint64_t t = (uint64_t)(ticks < 0 ? -ticks : ticks);
+	uint64_t ntp = ((t / c->clock_hz) << 32) + (((t % c->clock_hz) << 32) / c->clock_hz);
+	return ticks < 0 ? -(int64_t)ntp : (int64_t)ntp;
+}
+
+/* Continuous tick count for a wrapping timestamp, false on a discontinuity */
+static bool source_clock_unwrap(struct rist_source_clock_recovery *c, uint64_t raw, int64_t *ticks)
+{
+	raw %= c->wrap;
+	if (!c->has_ticks) {
+		c->has_ticks = true;
+		c->last_raw = raw;
+		c->ticks = 0;
+		*ticks = 0;
+		return true;
+	}
+	uint64_t forward = (raw + c->wrap - c->last_raw) % c->wrap;
+	// timestamps may step back a little (reordered frames), never by half a wrap
+	int64_t delta = forward > c->wrap / 2 ? (int64_t)forward - (int64_t)c->wrap : (int64_t)forward;
+	uint64_t step = (uint64_t)(delta < 0 ? -delta : delta);
+	if (step > SOURCE_CLOCK_MAX_STEP_S * c->clock_hz)
+		return false;
+	c->last_raw = raw;
+	c->ticks += delta;
+	*ticks = c->ticks;
+	return true;
+}
+
+/* sample is false for interpolated ticks, their error would pull the least
+ * delayed edge the mapping follows */
+static uint64_t source_clock_time(struct rist_source_clock_recovery *c, int64_t ticks, uint64_t now, bool sample)
+{
+	int64_t source_ntp = source_ticks_to_ntp(c, ticks);
+	int64_t offset = (int64_t)now - source_ntp;
+	if (sample) {
+		// until a fit exists the least delayed write so far anchors the mapping
+		if (!c->has_offset || offset < c->min_offset) {
+			c->has_offset = true;
+			c->min_offset = offset;
+		}
+		rist_clock_drift_add(&c->drift, now, offset);
+	}
+	int64_t mapped_offset = c->drift.valid ? rist_clock_drift_offset(&c->drift, now) : c->min_offset;
+	uint64_t ts = (uint64_t)(source_ntp + mapped_offset);
+	// a write earlier than the fit expects is on time, not from the future
+	return ts > now ? now : ts;
+}
+
+uint64_t rist_source_clock_map(struct rist_source_clock_recovery *c, uint64_t raw, uint64_t now)
+{
+	int64_t ticks;
+	if (!source_clock_unwrap(c, raw, &ticks)) {
+		rist_source_clock_reset(c);
+		source_clock_unwrap(c, raw, &ticks);
+	}
+	return source_clock_time(c, ticks, now, true);
+}
+
+uint64_t rist_source_clock_mpegts(struct rist_source_clock_recovery *c, const uint8_t *payload, size_t len, uint16_t stream_port,
+								  uint64_t now)
+{
+	if (len < MPEGTS_PACKET_SIZE || len % MPEGTS_PACKET_SIZE || payload[0] != 0x47)
+		return 0;
+	// one program clock per sender, other multiplexed streams keep the write time
+	if (c->pcr_pid >= 0 && stream_port != c->stream_port)
+		return 0;
+	uint64_t start = c->bytes;
+	for (size_t i = 0; i < len; i += MPEGTS_PACKET_SIZE) {
+		int pid;
+		uint64_t pcr;
+		bool discontinuity;
+		if (!mpegts_pcr(&payload[i], &pid, &pcr, &discontinuity))
+			continue;
+		if (c->pcr_pid < 0) {
+			c->pcr_pid = pid;
+			c->stream_port = stream_port;
+		} else if (pid != c->pcr_pid) {
+			continue;
+		}
+		int64_t ticks;
+		if (discontinuity || !source_clock_unwrap(c, pcr, &ticks)) {
+			rist_source_clock_reset(c);
+			c->pcr_pid = pid;
+			c->stream_port = stream_port;
+			source_clock_unwrap(c, pcr, &ticks);
+		} else if (c->bytes + i > c->pcr_pos && ticks > c->pcr_ticks) {
+			// the bytes between two pcrs went out at a constant rate
+			c->ticks_per_byte = (double)(ticks - c->pcr_ticks) / (double)(c->bytes + i - c->pcr_pos);
+		}
+		c->pcr_ticks = ticks;
+		c->pcr_pos = c->bytes + i;
+	}
+	c->bytes += len;
+	// interpolating needs the byte rate between two pcrs
+	if (c->pcr_pid < 0 || !c->has_ticks || c->ticks_per_byte <= 0.0)
+		return 0;
+	int64_t ticks = c->pcr_ticks - (int64_t)((double)(int64_t)(c->pcr_pos - start) * c->ticks_per_byte);
+	// only a payload carrying the pcr has an exact source time
+	return source_clock_time(c, ticks, now, c->pcr_pos >= start);
+}
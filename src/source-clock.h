@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_SOURCE_CLOCK_H
+#define RIST_SOURCE_CLOCK_H
+
+#include "common/attributes.h"
+#include "clock-drift.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sender side recovery of the clock the source was produced with, so packets
+ * get timestamped when the source emitted them instead of when the producer got
+ * around to writing them. Source timestamps (MPEG-TS PCR, RTP) are unwrapped to
+ * a continuous count of ticks and moved into our clock domain along the least
+ * delayed writes, the drift between the two clocks is followed with the same
+ * estimator the receiver uses.
+ * Not thread safe, data is written to a sender from one thread.
+ */
+struct rist_source_clock_recovery {
+	uint64_t clock_hz;
+	/* source timestamps wrap at this many ticks */
+	uint64_t wrap;
+	bool has_ticks;
+	uint64_t last_raw;
+	int64_t ticks;
+	/* MPEG-TS: PCR pid and stream port locked on, byte position of the last
+	 * PCR for interpolation between them */
+	int pcr_pid;
+	uint16_t stream_port;
+	uint64_t bytes;
+	uint64_t pcr_pos;
+	int64_t pcr_ticks;
+	double ticks_per_byte;
+	/* source time to our time */
+	struct rist_clock_drift drift;
+	bool has_offset;
+	int64_t min_offset;
+};
+
+/* clock_hz of the timestamps given to rist_source_clock_map(), wrap is where
+ * they roll over */
+RIST_PRIV void rist_source_clock_init(struct rist_source_clock_recovery *c, uint64_t clock_hz, uint64_t wrap, uint64_t bucket_length);
+/* Drops the mapping, for discontinuities of the source clock */
+RIST_PRIV void rist_source_clock_reset(struct rist_source_clock_recovery *c);
+/* Our time for a source timestamp, the packet was written at now */
+RIST_PRIV uint64_t rist_source_clock_map(struct rist_source_clock_recovery *c, uint64_t raw, uint64_t now);
+/* Our time for the first byte of an MPEG-TS payload, 0 until two PCRs were seen
+ * on the stream or when the payload is not MPEG-TS */
+RIST_PRIV uint64_t rist_source_clock_mpegts(struct rist_source_clock_recovery *c, const uint8_t *payload, size_t len,
+											uint16_t stream_port, uint64_t now);
+
+#endif
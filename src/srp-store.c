@@ -0,0 +1,368 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "librist/librist_srp.h"
+#include "rist-private.h"
+#include "pthread-shim.h"
+
+#include <mbedtls/base64.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * In-memory copy of a ristsrppasswd file (username:verifier:salt:3 per line,
+ * base64 without padding), decoded once into a hash table.
+ *
+ * Lookups take a reference on the current table under a short lock and copy
+ * the entry out. A thread of the store checks the file contents for changes
+ * once per SRP_STORE_CHECK_INTERVAL, as a password rotated within the same
+ * second keeps both the mtime and the size. It builds the new table outside
+ * the lock and swaps it in, lookups still holding the old one finish on it.
+ */
+#define SRP_STORE_CHECK_INTERVAL 1000 // ms
+#define SRP_STORE_MAX_FIELD 1024
+#define SRP_STORE_MAX_LINE (256 + 2 * SRP_STORE_MAX_FIELD + 16)
+
+struct srp_store_entry {
+	struct srp_store_entry *next;
+	uint32_t hash;
+	size_t verifier_len;
+	size_t salt_len;
+	char *verifier;
+	char *salt;
+	char username[];
+};
+
+struct srp_store_table {
+	int refcount;
+	size_t size;
+	size_t count;
+	struct srp_store_entry **buckets;
+};
+
+struct rist_srp_verifier_store {
+	pthread_mutex_t lock;
+	char *path;
+	struct srp_store_table *table;
+	/* of the file contents the table was loaded from, reload thread only */
+	uint64_t fingerprint;
+	pthread_t reload_thread;
+	pthread_cond_t reload_cond;
+	bool stop;
+};
+
+static uint32_t srp_store_hash(const char *username)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261U;
+	for (const unsigned char *c = (const unsigned char *)username; *c; c++) {
+		hash ^= *c;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void srp_store_table_free(struct srp_store_table *table)
+{
+	if (!table)
+		return;
+	for (size_t i = 0; i < table->size; i++) {
+		struct srp_store_entry *e = table->buckets[i];
+		while (e) {
+			struct srp_store_entry *next = e->next;
+			free(e->verifier);
+			free(e->salt);
+			free(e);
+			e = next;
+		}
+	}
+	free(table->buckets);
+	free(table);
+}
+
+static bool srp_store_table_grow(struct srp_store_table *table)
+{
+	size_t size = table->size ? table->size * 2 : 64;
+	struct srp_store_entry **buckets = calloc(size, sizeof(*buckets));
+	if (!buckets)
+		return false;
+	for (size_t i = 0; i < table->size; i++) {
+		struct srp_store_entry *e = table->buckets[i];
+		while (e) {
+			struct srp_store_entry *next = e->next;
+			e->next = buckets[e->hash & (size - 1)];
+			buckets[e->hash & (size - 1)] = e;
+			e = next;
+		}
+	}
+	free(table->buckets);
+	table->buckets = buckets;
+	table->size = size;
+	return true;
+}
+
+static struct srp_store_entry *srp_store_table_find(struct srp_store_table *table, const char *username, uint32_t hash)
+{
+	if (!table->size)
+		return NULL;
+	for (struct srp_store_entry *e = table->buckets[hash & (table->size - 1)]; e; e = e->next) {
+		if (e->hash == hash && strcmp(e->username, username) == 0)
+			return e;
+	}
+	return NULL;
+}
+
+/* Decodes an unpadded base64 field, returns a heap copy */
+static char *srp_store_decode(const char *field, size_t field_len, size_t *out_len)
+{
+	if (field_len == 0 || field_len > SRP_STORE_MAX_FIELD)
+		return NULL;
+	unsigned char padded[SRP_STORE_MAX_FIELD + 4];
+	memcpy(padded, field, field_len);
+	while (field_len % 4)
+		padded[field_len++] = '=';
+	size_t len = 0;
+	mbedtls_base64_decode(NULL, 0, &len, padded, field_len);
+	char *out = malloc(len ? len : 1);
+	if (!out)
+		return NULL;
+	if (mbedtls_base64_decode((unsigned char *)out, len, out_len, padded, field_len) != 0 || *out_len == 0) {
+		free(out);
+		return NULL;
+	}
+	return out;
+}
+
+static bool srp_store_parse_line(struct srp_store_table *table, char *line)
+{
+	//expected format: username:verifier:salt:3
+	char *fields[3];
+	size_t lens[3];
+	char *pos = line;
+	for (int i = 0; i < 3; i++) {
+		char *sep = strchr(pos, ':');
+		if (!sep)
+			return false;
+		fields[i] = pos;
+		lens[i] = (size_t)(sep - pos);
+		pos = sep + 1;
+	}
+	if (lens[0] == 0 || lens[0] > 255)
+		return false;
+	fields[0][lens[0]] = '\0';
+	uint32_t hash = srp_store_hash(fields[0]);
+	// first line wins, same as the sequential scan did
+	if (srp_store_table_find(table, fields[0], hash))
+		return true;
+	struct srp_store_entry *e = calloc(1, sizeof(*e) + lens[0] + 1);
+	if (!e)
+		return false;
+	memcpy(e->username, fields[0], lens[0] + 1);
+	e->hash = hash;
+	e->verifier = srp_store_decode(fields[1], lens[1], &e->verifier_len);
+	e->salt = srp_store_decode(fields[2], lens[2], &e->salt_len);
+	if (!e->verifier || !e->salt) {
+		free(e->verifier);
+		free(e->salt);
+		free(e);
+		return false;
+	}
+	if (table->count >= table->size && !srp_store_table_grow(table)) {
+		free(e->verifier);
+		free(e->salt);
+		free(e);
+		return false;
+	}
+	e->next = table->buckets[hash & (table->size - 1)];
+	table->buckets[hash & (table->size - 1)] = e;
+	table->count++;
+	return true;
+}
+
+static struct srp_store_table *srp_store_load(const char *path)
+{
+	FILE *fh = fopen(path, "r");
+	if (!fh)
+		return NULL;
+	struct srp_store_table *table = calloc(1, sizeof(*table));
+	char *line = malloc(SRP_STORE_MAX_LINE);
+	if (!table || !line || !srp_store_table_grow(table)) {
+		free(line);
+		free(table);
+		fclose(fh);
+		return NULL;
+	}
+	table->refcount = 1;
+	while (fgets(line, SRP_STORE_MAX_LINE, fh)) {
+		size_t len = strlen(line);
+		if (len && line[len - 1] != '\n' && !feof(fh)) {
+			// overlong line, skip the remainder
+			int c;
+			while ((c = getc(fh)) != EOF && c != '\n');
+			continue;
+		}
+		srp_store_parse_line(table, line);
+	}
+	free(line);
+	fclose(fh);
+	return table;
+}
+
+/* FNV-1a over the whole file */
+static bool srp_store_fingerprint(const char *path, uint64_t *fingerprint)
+{
+	FILE *fh = fopen(path, "rb");
+	if (!fh)
+		return false;
+	uint64_t hash = 14695981039346656037ULL;
+	unsigned char buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fh)) > 0) {
+		for (size_t i = 0; i < len; i++) {
+			hash ^= buf[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	bool ok = !ferror(fh);
+	fclose(fh);
+	*fingerprint = hash;
+	return ok;
+}
+
+static void srp_store_reload(struct rist_srp_verifier_store *store)
+{
+	uint64_t fingerprint;
+	struct srp_store_table *table = NULL;
+	if (srp_store_fingerprint(store->path, &fingerprint) && fingerprint != store->fingerprint)
+		table = srp_store_load(store->path);
+	// keep serving the previous contents when the new file can't be read
+	if (!table)
+		return;
+	store->fingerprint = fingerprint;
+	pthread_mutex_lock(&store->lock);
+	struct srp_store_table *old = store->table;
+	store->table = table;
+	if (--old->refcount > 0)
+		old = NULL;
+	pthread_mutex_unlock(&store->lock);
+	srp_store_table_free(old);
+}
+
+static PTHREAD_START_FUNC(srp_store_reload_thread, arg)
+{
+	struct rist_srp_verifier_store *store = arg;
+	pthread_mutex_lock(&store->lock);
+	while (!store->stop) {
+		pthread_cond_timedwait_ms(&store->reload_cond, &store->lock, SRP_STORE_CHECK_INTERVAL);
+		if (store->stop)
+			break;
+		pthread_mutex_unlock(&store->lock);
+		srp_store_reload(store);
+		pthread_mutex_lock(&store->lock);
+	}
+	pthread_mutex_unlock(&store->lock);
+	return 0;
+}
+
+int rist_srp_verifier_store_create(struct rist_srp_verifier_store **store, const char *path)
+{
+	if (!store || !path)
+		return -1;
+	*store = NULL;
+	struct rist_srp_verifier_store *s = calloc(1, sizeof(*s));
+	if (!s)
+		return -1;
+	s->path = strdup(path);
+	if (!s->path) {
+		free(s);
+		return -1;
+	}
+	srp_store_fingerprint(path, &s->fingerprint);
+	s->table = srp_store_load(path);
+	if (!s->table) {
+		free(s->path);
+		free(s);
+		return -1;
+	}
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->reload_cond, NULL);
+	if (pthread_create(&s->reload_thread, NULL, srp_store_reload_thread, s) != 0) {
+		pthread_cond_destroy(&s->reload_cond);
+		pthread_mutex_destroy(&s->lock);
+		srp_store_table_free(s->table);
+		free(s->path);
+		free(s);
+		return -1;
+	}
+	*store = s;
+	return 0;
+}
+
+void rist_srp_verifier_store_destroy(struct rist_srp_verifier_store *store)
+{
+	if (!store)
+		return;
+	pthread_mutex_lock(&store->lock);
+	store->stop = true;
+	pthread_cond_signal(&store->reload_cond);
+	pthread_mutex_unlock(&store->lock);
+	pthread_join(store->reload_thread, NULL);
+	pthread_cond_destroy(&store->reload_cond);
+	pthread_mutex_destroy(&store->lock);
+	srp_store_table_free(store->table);
+	free(store->path);
+	free(store);
+}
+
+void rist_srp_verifier_store_lookup(char *username,
+									size_t *verifier_len, char **verifier,
+									size_t *salt_len, char **salt,
+									bool *use_default_2048_bit_n_modulus,
+									char **n_modulus_ascii,
+									char **generator_ascii,
+									void *user_data)
+{
+	(void)n_modulus_ascii;
+	(void)generator_ascii;
+	struct rist_srp_verifier_store *store = user_data;
+	*verifier_len = 0;
+	*salt_len = 0;
+	if (!store || !username)
+		return;
+
+	uint32_t hash = srp_store_hash(username);
+	pthread_mutex_lock(&store->lock);
+	struct srp_store_table *table = store->table;
+	table->refcount++;
+	pthread_mutex_unlock(&store->lock);
+
+	// entries never change once published, copy without holding the lock
+	struct srp_store_entry *e = srp_store_table_find(table, username, hash);
+	if (e) {
+		char *v = malloc(e->verifier_len);
+		char *s = malloc(e->salt_len);
+		if (v && s) {
+			memcpy(v, e->verifier, e->verifier_len);
+			memcpy(s, e->salt, e->salt_len);
+			*verifier = v;
+			*verifier_len = e->verifier_len;
+			*salt = s;
+			*salt_len = e->salt_len;
+			*use_default_2048_bit_n_modulus = true;
+		} else {
+			free(v);
+			free(s);
+		}
+	}
+
+	pthread_mutex_lock(&store->lock);
+	bool last = --table->refcount == 0;
+	pthread_mutex_unlock(&store->lock);
+	if (last)
+		srp_store_table_free(table);
+}
@@ -10,8 +10,29 @@
 #include "rist-private.h"
 #include "log-private.h"
 #include "udp-private.h"
+#if HAVE_MBEDTLS
+#include "eap.h"
+#endif
 #include <string.h>
-#include "cjson/cJSON.h"
+
+/*
+ * Reports are serialized with a small streaming JSON writer into a buffer kept
+ * in the peer/flow stats_report, so after the first few reports the buffer has
+ * grown to size and building a report does not allocate. Only
+ * RIST_STATS_FORMAT_JSON copies the result out into a report the application
+ * frees, the other formats hand out the reused report directly.
+ */
+struct stats_json_writer {
+	struct rist_stats_report *report;
+	bool comma;
+	bool failed;
+};
+
+struct stats_callback {
+	int (*func)(void *arg, const struct rist_stats *stats_container);
+	void *arg;
+	enum rist_stats_format format;
+};
 
 static double round_two_digits(double number)
 {
@@ -19,6 +40,173 @@ static double round_two_digits(double number)
 	return (double)(new_number) / 100;
 }
 
+static void stats_json_begin(struct stats_json_writer *w, struct rist_stats_report *report)
+{
+	w->report = report;
+	w->comma = false;
+	w->failed = false;
+	report->json_len = 0;
+}
+
+static bool stats_json_reserve(struct stats_json_writer *w, size_t len)
+{
+	struct rist_stats_report *r = w->report;
+	if (w->failed)
+		return false;
+	// always leave room for the terminator
+	if (r->json_len + len < r->json_cap)
+		return true;
+	size_t cap = r->json_cap ? r->json_cap : 1024;
+	while (cap <= r->json_len + len)
+		cap *= 2;
+	char *json = realloc(r->json, cap);
+	if (!json) {
+		w->failed = true;
+		return false;
+	}
+	r->json = json;
+	r->json_cap = cap;
+	return true;
+}
+
+static void stats_json_append(struct stats_json_writer *w, const char *str, size_t len)
+{
+	if (!stats_json_reserve(w, len))
+		return;
+	memcpy(&w->report->json[w->report->json_len], str, len);
+	w->report->json_len += len;
+	w->report->json[w->report->json_len] = '\0';
+}
+
+static void stats_json_key(struct stats_json_writer *w, const char *key)
+{
+	if (w->comma)
+		stats_json_append(w, ",", 1);
+	w->comma = true;
+	if (!key)
+		return;
+	stats_json_append(w, "\"", 1);
+	stats_json_append(w, key, strlen(key));
+	stats_json_append(w, "\":", 2);
+}
+
+static void stats_json_open(struct stats_json_writer *w, const char *key, char bracket)
+{
+	stats_json_key(w, key);
+	stats_json_append(w, &bracket, 1);
+	w->comma = false;
+}
+
+static void stats_json_close(struct stats_json_writer *w, char bracket)
+{
+	stats_json_append(w, &bracket, 1);
+	w->comma = true;
+}
+
+/* Same output as cJSON: integers without fraction, otherwise the shortest of
+ * %1.15g/%1.17g that reads back to the same value */
+static void stats_json_number(struct stats_json_writer *w, const char *key, double value)
+{
+	char num[32];
+	int len;
+	stats_json_key(w, key);
+	if (value != value || value > 1.7976931348623157e308 || value < -1.7976931348623157e308) {
+		len = snprintf(num, sizeof(num), "null");
+	} else if (value > -1e15 && value < 1e15 && (double)(int64_t)value == value) {
+		len = snprintf(num, sizeof(num), "%" PRId64, (int64_t)value);
+	} else {
+		len = snprintf(num, sizeof(num), "%1.15g", value);
+		if (strtod(num, NULL) != value)
+			len = snprintf(num, sizeof(num), "%1.17g", value);
+	}
+	stats_json_append(w, num, (size_t)len);
+}
+
+static void stats_json_string(struct stats_json_writer *w, const char *key, const char *value)
+{
+	stats_json_key(w, key);
+	stats_json_append(w, "\"", 1);
+	for (const unsigned char *c = (const unsigned char *)value; *c; c++) {
+		char esc[8];
+		int len = 2;
+		esc[0] = '\\';
+		switch (*c) {
+			case '"': esc[1] = '"'; break;
+			case '\\': esc[1] = '\\'; break;
+			case '\b': esc[1] = 'b'; break;
+			case '\f': esc[1] = 'f'; break;
+			case '\n': esc[1] = 'n'; break;
+			case '\r': esc[1] = 'r'; break;
+			case '\t': esc[1] = 't'; break;
+			default:
+				if (*c < 32) {
+					len = snprintf(esc, sizeof(esc), "\\u%04x", *c);
+				} else {
+					esc[0] = (char)*c;
+					len = 1;
+				}
+				break;
+		}
+		stats_json_append(w, esc, (size_t)len);
+	}
+	stats_json_append(w, "\"", 1);
+}
+
+static void stats_json_percentiles(struct stats_json_writer *w, const char *key, const struct rist_stats_percentiles *p)
+{
+	stats_json_open(w, key, '{');
+	stats_json_number(w, "count", (double)p->count);
+	stats_json_number(w, "p50", (double)p->p50);
+	stats_json_number(w, "p90", (double)p->p90);
+	stats_json_number(w, "p99", (double)p->p99);
+	stats_json_number(w, "p99.9", (double)p->p999);
+	stats_json_number(w, "max", (double)p->max);
+	stats_json_close(w, '}');
+}
+
+/* Hands the report to the stats callback in the configured format, called
+ * without stats_lock so a slow callback does not hold up the protocol thread
+ * or rist_stats_callback_set */
+static void stats_report_deliver(const struct stats_callback *cb, struct rist_stats_report *report, struct stats_json_writer *w)
+{
+	struct rist_stats *container = &report->container;
+	container->version = RIST_STATS_VERSION;
+	container->stats_json = NULL;
+	container->json_size = 0;
+	if (w && !w->failed && report->json_len) {
+		container->stats_json = report->json;
+		container->json_size = (uint32_t)report->json_len;
+	}
+	if (cb->format != RIST_STATS_FORMAT_JSON) {
+		cb->func(cb->arg, container);
+		return;
+	}
+	struct rist_stats_report *copy = malloc(sizeof(*copy));
+	char *json = container->stats_json ? malloc(container->json_size + 1) : NULL;
+	if (!copy || (container->stats_json && !json)) {
+		free(copy);
+		free(json);
+		return;
+	}
+	copy->container = *container;
+	copy->allocated = true;
+	copy->json = NULL;
+	copy->json_len = copy->json_cap = 0;
+	if (json) {
+		memcpy(json, container->stats_json, container->json_size + 1);
+		copy->container.stats_json = json;
+	}
+	cb->func(cb->arg, &copy->container);
+}
+
+/* Callback settings taken under stats_lock along with the report */
+static void stats_callback_get(struct rist_common_ctx *cctx, struct stats_callback *cb)
+{
+	cb->func = cctx->stats_callback;
+	cb->arg = cctx->stats_callback_argument;
+	cb->format = cctx->stats_format;
+}
+
 void rist_sender_peer_statistics(struct rist_peer *peer)
 {
 	// TODO: print warning here?? stale flow?
@@ -27,9 +215,9 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 		return;
 	}
 	pthread_mutex_lock(&(get_cctx(peer)->stats_lock));
-	struct rist_stats *stats_container = malloc(sizeof(struct rist_stats));
+	struct rist_stats_report *report = &peer->stats_report;
+	struct rist_stats *stats_container = &report->container;
 	stats_container->stats_type = RIST_STATS_SENDER_PEER;
-	stats_container->version = RIST_STATS_VERSION;
 
 	peer->stats_sender_total.received += peer->stats_sender_instant.received;
 
@@ -38,8 +226,9 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	struct rist_bandwidth_estimation *cli_bw = &peer->bw;
 	struct rist_bandwidth_estimation *retry_bw = &peer->retry_bw;
 	// Refresh stats value just in case
-	rist_calculate_bitrate(0, cli_bw);
-	rist_calculate_bitrate(0, retry_bw);
+	uint64_t now = timestampNTP_u64();
+	rist_calculate_bitrate(0, cli_bw, now);
+	rist_calculate_bitrate(0, retry_bw, now);
 
 	double Q = 100;
 	if (peer->stats_sender_instant.sent > 0)
@@ -61,32 +250,56 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 
 	struct rist_common_ctx *cctx = get_cctx(peer);
 
-	cJSON *stats = cJSON_CreateObject();
-	cJSON *rist_sender_stats = cJSON_AddObjectToObject(stats, "sender-stats");
-	cJSON *peer_obj = cJSON_AddObjectToObject(rist_sender_stats, "peer");
-	cJSON_AddNumberToObject(peer_obj, "flow_id", peer->adv_flow_id);
-	cJSON_AddNumberToObject(peer_obj, "id", peer->adv_peer_id);
-	cJSON_AddStringToObject(peer_obj, "cname", peer->receiver_name);
-	cJSON_AddStringToObject(peer_obj, "type", peer->is_data ? "data" : "rtcp");
-	cJSON *json_stats = cJSON_AddObjectToObject(peer_obj, "stats");
-	cJSON_AddNumberToObject(json_stats, "quality", Q);
-	cJSON_AddNumberToObject(json_stats, "sent", (double)peer->stats_sender_instant.sent);
-	cJSON_AddNumberToObject(json_stats, "received", (double)peer->stats_sender_instant.received);
-	cJSON_AddNumberToObject(json_stats, "retransmitted", (double)peer->stats_sender_instant.retrans);
-	cJSON_AddNumberToObject(json_stats, "bandwidth", (double)bitrate);
-	cJSON_AddNumberToObject(json_stats, "retry_bandwidth", (double)retry_bitrate);
-	cJSON_AddNumberToObject(json_stats, "bandwidth_skipped", (double)peer->stats_sender_instant.bandwidth_skip);
-	cJSON_AddNumberToObject(json_stats, "bloat_skipped", (double)peer->stats_sender_instant.bloat_skip);
-	cJSON_AddNumberToObject(json_stats, "retransmit_skipped", (double)peer->stats_sender_instant.retrans_skip);
-	cJSON_AddNumberToObject(json_stats, "rtt", (double)peer->last_mrtt);
-	cJSON_AddNumberToObject(json_stats, "avg_rtt", (double)avg_rtt);
-	cJSON_AddNumberToObject(json_stats, "retry_buffer_size", (double)retry_buf_size);
-	cJSON_AddNumberToObject(json_stats, "cooldown_time", (double)time_left);
-	char *stats_string = cJSON_PrintUnformatted(stats);
-	cJSON_Delete(stats);
-
-	stats_container->stats_json = stats_string;
-	stats_container->json_size = (uint32_t)strlen(stats_string);
+	struct stats_json_writer writer;
+	struct stats_json_writer *w = NULL;
+	if (cctx->stats_callback != NULL && cctx->stats_format != RIST_STATS_FORMAT_BINARY)
+	{
+		w = &writer;
+		stats_json_begin(w, report);
+		stats_json_open(w, NULL, '{');
+		stats_json_open(w, "sender-stats", '{');
+		stats_json_open(w, "peer", '{');
+		stats_json_number(w, "flow_id", peer->adv_flow_id);
+		stats_json_number(w, "id", peer->adv_peer_id);
+		stats_json_string(w, "cname", peer->receiver_name);
+		stats_json_string(w, "type", peer->is_data ? "data" : "rtcp");
+		stats_json_open(w, "stats", '{');
+		stats_json_number(w, "quality", Q);
+		stats_json_number(w, "sent", (double)peer->stats_sender_instant.sent);
+		stats_json_number(w, "received", (double)peer->stats_sender_instant.received);
+		stats_json_number(w, "retransmitted", (double)peer->stats_sender_instant.retrans);
+		stats_json_number(w, "bandwidth", (double)bitrate);
+		stats_json_number(w, "retry_bandwidth", (double)retry_bitrate);
+		stats_json_number(w, "bandwidth_skipped", (double)peer->stats_sender_instant.bandwidth_skip);
+		stats_json_number(w, "bloat_skipped", (double)peer->stats_sender_instant.bloat_skip);
+		stats_json_number(w, "retransmit_skipped", (double)peer->stats_sender_instant.retrans_skip);
+		stats_json_number(w, "rtt", (double)peer->last_mrtt);
+		stats_json_number(w, "avg_rtt", (double)avg_rtt);
+		stats_json_number(w, "retry_buffer_size", (double)retry_buf_size);
+		stats_json_number(w, "cooldown_time", (double)time_left);
+		stats_json_number(w, "wakeups", (double)peer->sender_ctx->stats_wakeups);
+		stats_json_number(w, "wakeups_coalesced", (double)peer->sender_ctx->stats_wakeups_coalesced);
+#if HAVE_MBEDTLS
+		struct eap_handshake_stats eap_stats;
+		if (eap_get_handshake_stats(peer->eap_ctx, &eap_stats)) {
+			stats_json_open(w, "eap", '{');
+			stats_json_number(w, "handshakes", (double)eap_stats.handshakes);
+			stats_json_number(w, "deferred", (double)eap_stats.deferred);
+			stats_json_number(w, "avg_handshake_time", eap_stats.handshakes ? (double)(eap_stats.latency_sum / eap_stats.handshakes) : 0.0);
+			stats_json_number(w, "max_handshake_time", (double)eap_stats.latency_max);
+			stats_json_number(w, "avg_queue_time", eap_stats.jobs ? (double)(eap_stats.queue_time_sum / eap_stats.jobs) : 0.0);
+			stats_json_number(w, "full_reauths", (double)eap_stats.full_reauths);
+			stats_json_number(w, "lw_reauths", (double)eap_stats.lw_reauths);
+			stats_json_number(w, "lw_reauth_failures", (double)eap_stats.lw_failures);
+			stats_json_close(w, '}');
+		}
+#endif
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
+	}
+
 	stats_container->stats.sender_peer.cname[0] = '\0';
 	strncpy(stats_container->stats.sender_peer.cname, peer->receiver_name, RIST_MAX_STRING_SHORT);
 	stats_container->stats.sender_peer.peer_id = peer->adv_peer_id;
@@ -97,14 +310,18 @@ void rist_sender_peer_statistics(struct rist_peer *peer)
 	stats_container->stats.sender_peer.retransmitted = peer->stats_sender_instant.retrans;
 	stats_container->stats.sender_peer.quality = Q;
 	stats_container->stats.sender_peer.rtt = avg_rtt;
+	stats_container->stats.sender_peer.wakeups = peer->sender_ctx->stats_wakeups;
+	stats_container->stats.sender_peer.wakeups_coalesced = peer->sender_ctx->stats_wakeups_coalesced;
 
-	if (cctx->stats_callback != NULL)
-		cctx->stats_callback(cctx->stats_callback_argument, stats_container);
-	else
-		rist_stats_free(stats_container);
+	rist_metrics_update(&cctx->metrics, stats_container);
+	struct stats_callback cb;
+	stats_callback_get(cctx, &cb);
 
 	memset(&peer->stats_sender_instant, 0, sizeof(peer->stats_sender_instant));
 	pthread_mutex_unlock(&(get_cctx(peer)->stats_lock));
+
+	if (cb.func != NULL)
+		stats_report_deliver(&cb, report, w);
 }
 
 void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *flow)
@@ -112,6 +329,8 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 	if (!flow)
 		return;
 	pthread_mutex_lock(&ctx->common.stats_lock);
+	// The data path never takes stats_lock, take its counters over in one go
+	rist_flow_counters_snapshot(&flow->counters, &flow->stats_instant);
 	//Log errors that used to be packet
 	if (flow->stats_instant.dropped_full)
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Dropped %u packets due to buffers being full\n", flow->stats_instant.dropped_full );
@@ -120,52 +339,15 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 	if (flow->stats_instant.lost)
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "Lost %u packets\n", flow->stats_instant.lost);
 
-	struct rist_stats *stats_container = malloc(sizeof(struct rist_stats));
+	struct rist_stats_report *report = &flow->stats_report;
+	struct rist_stats *stats_container = &report->container;
 	stats_container->stats_type = RIST_STATS_RECEIVER_FLOW;
-	stats_container->version = RIST_STATS_VERSION;
 
 	if (flow->stats_instant.avg_count)
 	{
 		flow->stats_instant.cur_ips = (flow->stats_instant.total_ips / flow->stats_instant.avg_count);
 	}
 
-	cJSON *stats = cJSON_CreateObject();
-	cJSON *stats_obj = cJSON_AddObjectToObject(stats, "receiver-stats");
-	cJSON *flow_obj = cJSON_AddObjectToObject(stats_obj, "flowinstant");
-	cJSON_AddNumberToObject(flow_obj, "flow_id", flow->flow_id);
-	cJSON_AddNumberToObject(flow_obj, "dead",  flow->dead);
-	cJSON *json_stats = cJSON_AddObjectToObject(flow_obj, "stats");
-	cJSON *peers = cJSON_AddArrayToObject(flow_obj, "peers");
-	uint32_t flow_rtt = 0;
-	uint32_t flow_sent_instant = 0;
-	for (size_t i = 0; i < flow->peer_lst_len; i++)
-	{
-		struct rist_peer *peer = flow->peer_lst[i];
-		if (!peer->is_data && peer->peer_data)
-			peer = peer->peer_data;
-		uint32_t avg_rtt = (peer->eight_times_rtt / 8);
-
-		size_t bitrate = peer->bw.eight_times_bitrate_fast / 8;
-		size_t avg_bitrate = peer->bw.eight_times_bitrate / 8;
-		flow_sent_instant += peer->stats_receiver_instant.sent_rtcp;
-		flow_rtt =+ peer->eight_times_rtt / 8;
-
-		cJSON *peer_obj = cJSON_CreateObject();
-		cJSON_AddNumberToObject(peer_obj, "id", peer->adv_peer_id);
-		cJSON_AddNumberToObject(peer_obj, "dead", peer->dead);
-		cJSON *peer_stats = cJSON_AddObjectToObject(peer_obj, "stats");
-		cJSON_AddNumberToObject(peer_stats, "received_data", (double)peer->stats_receiver_instant.received);
-		cJSON_AddNumberToObject(peer_stats, "received_rtcp", (double)peer->stats_receiver_instant.received_rtcp);
-		cJSON_AddNumberToObject(peer_stats, "sent_rtcp", (double)peer->stats_receiver_instant.sent_rtcp);
-		cJSON_AddNumberToObject(peer_stats, "rtt", (double)peer->last_mrtt);
-		cJSON_AddNumberToObject(peer_stats, "avg_rtt", (double)avg_rtt);
-		cJSON_AddNumberToObject(peer_stats, "bitrate", (double)bitrate);
-		cJSON_AddNumberToObject(peer_stats, "avg_bitrate", (double)avg_bitrate);
-		cJSON_AddItemToArray(peers, peer_obj);
-		// Clear peer instant stats
-		memset(&peer->stats_receiver_instant, 0, sizeof(peer->stats_receiver_instant));
-	}
-
 	flow->stats_instant.recovered_average = (flow->stats_instant.recovered_sum * 100) - flow->stats_instant.recovered;
 	flow->stats_instant.recovered_slope = flow->stats_instant.recovered_3nack - flow->stats_instant.recovered_0nack;
 	if ((int32_t)(flow->stats_instant.recovered_1nack - flow->stats_instant.recovered_0nack) > 0 &&
@@ -206,45 +388,127 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 		rist_flush_missing_flow_queue(flow);
 	}
 
+	double clock_drift = round_two_digits(rist_clock_drift_ppm(&flow->clock_drift));
+	double clock_offset_adjust = (double)flow->time_offset_adjust * 1000.0 / RIST_CLOCK;
+	flow->time_offset_adjust = 0;
+	uint32_t latency = (uint32_t)(flow->recovery_buffer_ticks / RIST_CLOCK);
+	uint32_t latency_target = flow->latency_slew ? (uint32_t)(flow->latency.target / RIST_CLOCK) : latency;
+
 	uint64_t avg_buffer_duration = 0;
 	if (flow->stats_instant.buffer_duration_count > 0)
+		avg_buffer_duration = flow->stats_instant.buffer_duration_sum / flow->stats_instant.buffer_duration_count;
+
+	struct rist_stats_receiver_flow *flow_stats = &stats_container->stats.receiver_flow;
+	rist_histogram_take(&flow->buffer_delay_hist, &flow_stats->buffer_delay);
+	rist_histogram_take(&flow->ips_hist, &flow_stats->inter_packet_spacing);
+	rist_histogram_take(&flow->recovery_hist, &flow_stats->recovery_time);
+	rist_histogram_take(&flow->rtt_hist, &flow_stats->rtt_percentiles);
+	rist_histogram_take(&flow->pcr_jitter_hist, &flow_stats->pcr_jitter);
+
+	// Streamed in output order: the flow totals precede the per peer array
+	struct stats_json_writer writer;
+	struct stats_json_writer *w = NULL;
+	if (ctx->common.stats_callback != NULL && ctx->common.stats_format != RIST_STATS_FORMAT_BINARY)
 	{
+		w = &writer;
+		stats_json_begin(w, report);
+		stats_json_open(w, NULL, '{');
+		stats_json_open(w, "receiver-stats", '{');
+		stats_json_open(w, "flowinstant", '{');
+		stats_json_number(w, "flow_id", flow->flow_id);
+		stats_json_number(w, "dead", flow->dead);
+		stats_json_open(w, "stats", '{');
+		stats_json_number(w, "quality", Q);
+		stats_json_number(w, "received", (double)flow->stats_instant.received);
+		stats_json_number(w, "dropped_late", (double)flow->stats_instant.dropped_late);
+		stats_json_number(w, "dropped_full", (double)flow->stats_instant.dropped_full);
+		stats_json_number(w, "missing", (double)flow->stats_instant.missing);
+		stats_json_number(w, "recovered_total", (double)flow->stats_instant.recovered);
+		stats_json_number(w, "reordered", (double)flow->stats_instant.reordered);
+		stats_json_number(w, "retries", (double)flow->stats_instant.retries);
+		stats_json_number(w, "recovered_one_nack", (double)flow->stats_instant.recovered_0nack);
+		stats_json_number(w, "recovered_two_nacks", (double)flow->stats_instant.recovered_1nack);
+		stats_json_number(w, "recovered_three_nacks", (double)flow->stats_instant.recovered_2nack);
+		stats_json_number(w, "recovered_four_nacks", (double)flow->stats_instant.recovered_3nack);
+		stats_json_number(w, "recovered_more_nacks", (double)flow->stats_instant.recovered_morenack);
+		stats_json_number(w, "recovered_redundancy", (double)flow->stats_instant.recovered_redundancy);
+		stats_json_number(w, "lost", (double)flow->stats_instant.lost);
+		stats_json_number(w, "avg_buffer_time", (double)avg_buffer_duration);
+		stats_json_number(w, "duplicates", (double)flow->stats_instant.dupe);
+		stats_json_number(w, "missing_queue", (double)flow->missing_counter);
+		stats_json_number(w, "missing_queue_max", (double)flow->missing_counter_max);
+		stats_json_number(w, "min_inter_packet_spacing", (double)flow->stats_instant.min_ips);
+		stats_json_number(w, "cur_inter_packet_spacing", (double)flow->stats_instant.cur_ips);
+		stats_json_number(w, "max_inter_packet_spacing", (double)flow->stats_instant.max_ips);
+		stats_json_number(w, "bitrate", (double)flow->bw.bitrate);
+		stats_json_number(w, "wakeups", (double)flow->stats_instant.wakeups);
+		stats_json_number(w, "wakeups_coalesced", (double)flow->stats_instant.wakeups_coalesced);
+		stats_json_number(w, "fifo_overflow", (double)flow->stats_instant.fifo_overflow);
+		// ppm and microseconds
+		stats_json_number(w, "clock_drift", clock_drift);
+		stats_json_number(w, "clock_offset_adjust", clock_offset_adjust);
+		// milliseconds
+		stats_json_number(w, "latency", (double)latency);
+		stats_json_number(w, "latency_target", (double)latency_target);
+		// microseconds
+		stats_json_open(w, "percentiles", '{');
+		stats_json_percentiles(w, "buffer_delay", &flow_stats->buffer_delay);
+		stats_json_percentiles(w, "inter_packet_spacing", &flow_stats->inter_packet_spacing);
+		stats_json_percentiles(w, "recovery_time", &flow_stats->recovery_time);
+		stats_json_percentiles(w, "rtt", &flow_stats->rtt_percentiles);
+		if (flow->pcr_pacing)
+			stats_json_percentiles(w, "pcr_jitter", &flow_stats->pcr_jitter);
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
+		stats_json_open(w, "peers", '[');
+	}
 
-		for (size_t i = 0; i < flow->stats_instant.buffer_duration_count; i++)
+	uint32_t flow_rtt = 0;
+	uint32_t flow_sent_instant = 0;
+	for (size_t i = 0; i < flow->peer_lst_len; i++)
+	{
+		struct rist_peer *peer = flow->peer_lst[i];
+		if (!peer->is_data && peer->peer_data)
+			peer = peer->peer_data;
+		uint32_t avg_rtt = (peer->eight_times_rtt / 8);
+
+		size_t bitrate = peer->bw.eight_times_bitrate_fast / 8;
+		size_t avg_bitrate = peer->bw.eight_times_bitrate / 8;
+		flow_sent_instant += peer->stats_receiver_instant.sent_rtcp;
+		flow_rtt =+ peer->eight_times_rtt / 8;
+
+		struct rist_peer *rtcp_peer = peer->peer_rtcp ? peer->peer_rtcp : peer;
+		if (w)
 		{
-			avg_buffer_duration += flow->stats_instant.buffer_duration[i];
+			stats_json_open(w, NULL, '{');
+			stats_json_number(w, "id", peer->adv_peer_id);
+			stats_json_number(w, "dead", peer->dead);
+			stats_json_open(w, "stats", '{');
+			stats_json_number(w, "received_data", (double)peer->stats_receiver_instant.received);
+			stats_json_number(w, "received_rtcp", (double)peer->stats_receiver_instant.received_rtcp);
+			stats_json_number(w, "sent_rtcp", (double)peer->stats_receiver_instant.sent_rtcp);
+			stats_json_number(w, "rtt", (double)peer->last_mrtt);
+			stats_json_number(w, "avg_rtt", (double)avg_rtt);
+			stats_json_number(w, "bitrate", (double)bitrate);
+			stats_json_number(w, "avg_bitrate", (double)avg_bitrate);
+			stats_json_number(w, "path_skew", (double)(peer->path_skew / RIST_CLOCK));
+			stats_json_number(w, "nacks", (double)rtcp_peer->stats_receiver_instant.nacks);
+			stats_json_number(w, "nack_loss", (double)rist_peer_nack_loss(rtcp_peer) / 10.0);
+			stats_json_close(w, '}');
+			stats_json_close(w, '}');
 		}
-		avg_buffer_duration /= flow->stats_instant.buffer_duration_count;
-		flow->stats_instant.buffer_duration_count = 0;
+		rtcp_peer->stats_receiver_instant.nacks = 0;
+		// Clear peer instant stats
+		memset(&peer->stats_receiver_instant, 0, sizeof(peer->stats_receiver_instant));
+	}
+
+	if (w)
+	{
+		stats_json_close(w, ']');
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
+		stats_json_close(w, '}');
 	}
-	cJSON_AddNumberToObject(json_stats, "quality", Q);
-	cJSON_AddNumberToObject(json_stats, "received", (double)flow->stats_instant.received);
-	cJSON_AddNumberToObject(json_stats, "dropped_late", (double)flow->stats_instant.dropped_late);
-	cJSON_AddNumberToObject(json_stats, "dropped_full", (double)flow->stats_instant.dropped_full);
-	cJSON_AddNumberToObject(json_stats, "missing", (double)flow->stats_instant.missing);
-	cJSON_AddNumberToObject(json_stats, "recovered_total", (double)flow->stats_instant.recovered);
-	cJSON_AddNumberToObject(json_stats, "reordered", (double)flow->stats_instant.reordered);
-	cJSON_AddNumberToObject(json_stats, "retries", (double)flow->stats_instant.retries);
-	cJSON_AddNumberToObject(json_stats, "recovered_one_nack", (double)flow->stats_instant.recovered_0nack);
-	cJSON_AddNumberToObject(json_stats, "recovered_two_nacks", (double)flow->stats_instant.recovered_1nack);
-	cJSON_AddNumberToObject(json_stats, "recovered_three_nacks", (double)flow->stats_instant.recovered_2nack);
-	cJSON_AddNumberToObject(json_stats, "recovered_four_nacks", (double)flow->stats_instant.recovered_3nack);
-	cJSON_AddNumberToObject(json_stats, "recovered_more_nacks", (double)flow->stats_instant.recovered_morenack);
-	cJSON_AddNumberToObject(json_stats, "lost", (double)flow->stats_instant.lost);
-	cJSON_AddNumberToObject(json_stats, "avg_buffer_time", (double)avg_buffer_duration);
-	cJSON_AddNumberToObject(json_stats, "duplicates", (double)flow->stats_instant.dupe);
-	cJSON_AddNumberToObject(json_stats, "missing_queue", (double)flow->missing_counter);
-	cJSON_AddNumberToObject(json_stats, "missing_queue_max", (double)flow->missing_counter_max);
-	cJSON_AddNumberToObject(json_stats, "min_inter_packet_spacing", (double)flow->stats_instant.min_ips);
-	cJSON_AddNumberToObject(json_stats, "cur_inter_packet_spacing", (double)flow->stats_instant.cur_ips);
-	cJSON_AddNumberToObject(json_stats, "max_inter_packet_spacing", (double)flow->stats_instant.max_ips);
-	cJSON_AddNumberToObject(json_stats, "bitrate", (double)flow->bw.bitrate);
-
-	char *stats_string = cJSON_PrintUnformatted(stats);
-	cJSON_Delete(stats);
-
-	stats_container->stats_json = stats_string;
-	stats_container->json_size = (uint32_t)strlen(stats_string);
 
 	stats_container->stats.receiver_flow.peer_count = (uint32_t)flow->peer_lst_len;
 	// TODO: populate stats_receiver_flow->cname
@@ -266,14 +530,24 @@ void rist_receiver_flow_statistics(struct rist_receiver *ctx, struct rist_flow *
 	stats_container->stats.receiver_flow.cur_inter_packet_spacing = flow->stats_instant.cur_ips;
 	stats_container->stats.receiver_flow.max_inter_packet_spacing = flow->stats_instant.max_ips;
 	stats_container->stats.receiver_flow.rtt = flow->peer_lst_len ? flow_rtt / flow->peer_lst_len : 0;
-
-	/* CALLBACK CALL */
-	if (ctx->common.stats_callback != NULL)
-		ctx->common.stats_callback(ctx->common.stats_callback_argument, stats_container);
-	else
-		rist_stats_free(stats_container);
+	stats_container->stats.receiver_flow.recovered_redundancy = flow->stats_instant.recovered_redundancy;
+	stats_container->stats.receiver_flow.wakeups = flow->stats_instant.wakeups;
+	stats_container->stats.receiver_flow.wakeups_coalesced = flow->stats_instant.wakeups_coalesced;
+	stats_container->stats.receiver_flow.fifo_overflow = flow->stats_instant.fifo_overflow;
+	stats_container->stats.receiver_flow.clock_drift = clock_drift;
+	stats_container->stats.receiver_flow.clock_offset_adjust = clock_offset_adjust;
+	stats_container->stats.receiver_flow.latency = latency;
+	stats_container->stats.receiver_flow.latency_target = latency_target;
+
+	rist_metrics_update(&ctx->common.metrics, stats_container);
+	struct stats_callback cb;
+	stats_callback_get(&ctx->common, &cb);
 
 	memset(&flow->stats_instant, 0, sizeof(flow->stats_instant));
 	flow->stats_instant.min_ips = 0xFFFFFFFFFFFFFFFFULL;
 	pthread_mutex_unlock(&ctx->common.stats_lock);
+
+	/* CALLBACK CALL */
+	if (cb.func != NULL)
+		stats_report_deliver(&cb, report, w);
 }
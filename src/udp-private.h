@@ -10,6 +10,7 @@
 
 #include "common/attributes.h"
 #include "rist-private.h"
+#include "clock.h"
 
 #define SET_BIT(value, pos) (value |= (1U<< pos))
 #define UNSET_BIT(value, pos) (value &= (1U << pos))
@@ -49,6 +50,11 @@
 
 #define ECHO_REQUEST 2
 #define ECHO_RESPONSE 3
+#define RIST_RTCP_CAPS 4
+#define NACK_FMT_COMPACT 5
+
+/* librist capability bits, advertised by senders in the RIST_RTCP_CAPS message */
+#define RIST_RTCP_CAP_NACK_COMPACT (1U << 0)
 
 #define RTCP_SDES_SIZE 10
 #define RTP_MPEGTS_FLAGS 0x80
@@ -60,6 +66,8 @@
 #define RTCP_NACK_SEQEXT_FLAGS 0x81
 #define RTCP_ECHOEXT_REQ_FLAGS 0x82
 #define RTCP_ECHOEXT_RESP_FLAGS 0x83
+#define RTCP_CAPS_FLAGS 0x84
+#define RTCP_NACK_COMPACT_FLAGS 0x85
 
 // RTP Payload types and clocks
 // March 1995 (page 9): https://tools.ietf.org/html/draft-ietf-avt-profile-04
@@ -317,6 +325,15 @@ RIST_PACKED_STRUCT(rist_rtcp_echoext, {
 	uint32_t delay;
 })
 
+RIST_PACKED_STRUCT(rist_rtcp_caps, {
+	uint8_t flags;
+	uint8_t ptype;
+	uint16_t len;
+	uint32_t ssrc;
+	uint8_t name[4];
+	uint32_t caps;
+})
+
 RIST_PACKED_STRUCT(rist_rtcp_sr_pkt,{
 	struct rist_rtcp_hdr rtcp;
 	uint32_t ntp_msw;
@@ -380,17 +397,21 @@ RIST_PRIV void rist_sender_periodic_rtcp(struct rist_peer *peer);
 RIST_PRIV int rist_respond_echoreq(struct rist_peer *peer, const uint64_t echo_request_time, uint32_t ssrc);
 RIST_PRIV int rist_request_echo(struct rist_peer *peer);
 RIST_PRIV int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *payload, size_t payload_len, uint64_t source_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp);
-RIST_PRIV void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer);
-RIST_PRIV int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp);
-RIST_PRIV void rist_clean_sender_enqueue(struct rist_sender *ctx);
+RIST_PRIV void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer, uint64_t now);
+RIST_PRIV struct rist_buffer *rist_sender_buffer_new(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp, uint64_t now);
+/* Takes ownership of a payload from the sender payload pool, no copy */
+RIST_PRIV struct rist_buffer *rist_sender_buffer_adopt(struct rist_sender *ctx, void *payload, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp, uint64_t now);
+/* Appends buffers to the sender fifo under a single queue_lock acquisition */
+RIST_PRIV void rist_sender_enqueue_buffers(struct rist_sender *ctx, struct rist_buffer **buffers, size_t count);
+RIST_PRIV void rist_clean_sender_enqueue(struct rist_sender *ctx, uint64_t now);
 RIST_PRIV void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer);
-RIST_PRIV ssize_t rist_retry_dequeue(struct rist_sender *ctx);
+RIST_PRIV ssize_t rist_retry_dequeue(struct rist_sender *ctx, uint64_t now);
+/* Replays the history to a fast starting peer, as retransmissions */
+RIST_PRIV void rist_sender_send_fast_start(struct rist_sender *ctx, struct rist_peer *peer, uint64_t now);
 RIST_PRIV int rist_set_url(struct rist_peer *peer);
 RIST_PRIV void rist_create_socket(struct rist_peer *peer);
 RIST_PRIV size_t rist_get_sender_retry_queue_size(struct rist_sender *ctx);
 
-RIST_PRIV uint64_t timestampNTP_u64(void);
-RIST_PRIV uint64_t timestampNTP_RTC_u64(void);
 RIST_PRIV uint32_t timestampRTP_u32(int advanced, uint64_t i_ntp);
 RIST_PRIV uint64_t convertRTPtoNTP(uint8_t ptype, uint32_t time_extension, uint32_t i_rtp);
 RIST_PRIV uint64_t calculate_rtt_delay(uint64_t request, uint64_t response, uint32_t delay);
@@ -16,6 +16,7 @@
 #endif
 #include "crypto/psk.h"
 #include "mpegts.h"
+#include "nack.h"
 #include <stdlib.h>
 #include <stddef.h>
 #include <errno.h>
@@ -23,50 +24,6 @@
 #include <assert.h>
 #include <fcntl.h>
 
-uint64_t timestampNTP_u64(void)
-{
-
-	// We use clock_gettime instead of gettimeofday even though we only need microseconds
-	// because gettimeofday implementation under linux is dependent on the kernel clock
-	// and can produce duplicate times (too close to kernel timer)
-
-	// We use the NTP time standard: rfc5905 (https://tools.ietf.org/html/rfc5905#section-6)
-	// The 64-bit timestamps used by NTP consist of a 32-bit part for seconds
-	// and a 32-bit part for fractional second, giving a time scale that rolls
-	// over every 232 seconds (136 years) and a theoretical resolution of
-	// 2−32 seconds (233 picoseconds). NTP uses an epoch of January 1, 1900.
-	// Therefore, the first rollover occurs on February 7, 2036.
-	timespec_t ts;
-#if defined (__APPLE__)
-	clock_gettime_osx(CLOCK_MONOTONIC_OSX, &ts);
-#else
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-#endif
-	// Convert nanoseconds to 32-bits fraction (232 picosecond units)
-	uint64_t t = (uint64_t)(ts.tv_nsec) << 32;
-	t /= 1000000000;
-	// There is 70 years (incl. 17 leap ones) offset to the Unix Epoch.
-	// No leap seconds during that period since they were not invented yet.
-	t |= (uint64_t)((70LL * 365 + 17) * 24 * 60 * 60 + ts.tv_sec) << 32;
-	return t; // nanoseconds (technically, 232.831 picosecond units)
-}
-
-uint64_t timestampNTP_RTC_u64(void) {
-	timespec_t ts;
-#if defined (__APPLE__)
-	clock_gettime_osx(CLOCK_REALTIME_OSX, &ts);
-#else
-	clock_gettime(CLOCK_REALTIME, &ts);
-#endif
-	// Convert nanoseconds to 32-bits fraction (232 picosecond units)
-	uint64_t t = (uint64_t)(ts.tv_nsec) << 32;
-	t /= 1000000000;
-	// There is 70 years (incl. 17 leap ones) offset to the Unix Epoch.
-	// No leap seconds during that period since they were not invented yet.
-	t |= (uint64_t)((70LL * 365 + 17) * 24 * 60 * 60 + ts.tv_sec) << 32;
-	return t;
-}
-
 uint32_t timestampRTP_u32( int advanced, uint64_t i_ntp )
 {
 	if (!advanced) {
@@ -115,12 +72,13 @@ uint64_t calculate_rtt_delay(uint64_t request, uint64_t response, uint32_t delay
 	return rtt;
 }
 
-void rist_clean_sender_enqueue(struct rist_sender *ctx)
+void rist_clean_sender_enqueue(struct rist_sender *ctx, uint64_t now)
 {
 	int delete_count = 1;
 
-	// Delete old packets (max 10 entries per function call)
-	while (delete_count++ < 10) {
+	// Delete old packets, bounded per call to keep the queue_lock hold short but
+	// enough to keep up with batched writes that wake this thread once per batch
+	while (delete_count++ < RIST_SENDER_CLEANUP_MAX) {
 		struct rist_buffer *b = ctx->sender_queue[ctx->sender_queue_delete_index];
 
 		/* our buffer size is zero, it must be just building up */
@@ -143,7 +101,8 @@ void rist_clean_sender_enqueue(struct rist_sender *ctx)
 			return;
 
 		/* perform the deletion based on the buffer size plus twice the configured/measured avg_rtt */
-		uint64_t delay = (timestampNTP_u64() - b->time) / RIST_CLOCK;
+		// the buffer may have been enqueued after the loop sampled the clock
+		uint64_t delay = now > b->time ? (now - b->time) / RIST_CLOCK : 0;
 		if (delay < ctx->sender_recover_min_time) {
 			break;
 		}
@@ -356,7 +315,7 @@ int rist_send_common_rtcp(struct rist_peer *p, uint8_t payload_type, uint8_t *pa
 	else
 	{
 		// update bandwidth value
-		rist_calculate_bitrate(ret, &p->bw);
+		rist_calculate_bitrate(ret, &p->bw, timestampNTP_u64());
 	}
 
 	// TODO:
@@ -553,6 +512,17 @@ void rist_create_socket(struct rist_peer *peer)
 			current_sendbuf);
 	}
 
+	int timestamps = get_cctx(peer)->receive_timestamps;
+	if (timestamps != UDPSOCKET_TIMESTAMP_NONE && peer->sd >= 0) {
+		int enabled = udpsocket_set_timestamping(peer->sd, timestamps);
+		peer->rx_timestamps = enabled > UDPSOCKET_TIMESTAMP_NONE;
+		if (enabled < 0)
+			rist_log_priv(get_cctx(peer), RIST_LOG_WARN, "Kernel receive timestamps unavailable on socket %d. %s\n",
+				peer->sd, strerror(errno));
+		else if (enabled != timestamps)
+			rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Using software receive timestamps on socket %d\n", peer->sd);
+	}
+
 	if (peer->cname[0] == 0)
 		rist_populate_cname(peer);
 	rist_log_priv(get_cctx(peer), RIST_LOG_INFO, "Peer cname is %s\n", peer->cname);
@@ -662,6 +632,18 @@ static inline void rist_rtcp_write_echoresp(uint8_t *buf,int *offset, const uint
 	echo->delay = 0;
 }
 
+static inline void rist_rtcp_write_caps(uint8_t *buf, int *offset, const uint32_t flow_id, uint32_t caps)
+{
+	struct rist_rtcp_caps *rtcp = (struct rist_rtcp_caps *)(buf + RIST_MAX_PAYLOAD_OFFSET + *offset);
+	*offset += sizeof(struct rist_rtcp_caps);
+	rtcp->flags = RTCP_CAPS_FLAGS;
+	rtcp->ptype = PTYPE_NACK_CUSTOM;
+	rtcp->len = htons(3);
+	rtcp->ssrc = htobe32(flow_id);
+	memcpy(rtcp->name, "RIST", 4);
+	rtcp->caps = htobe32(caps);
+}
+
 static inline void rist_rtcp_write_xr_echoreq(uint8_t *buf, int *offset,struct rist_peer *peer)
 {
 	struct rist_rtcp_hdr *xr_hdr = (struct rist_rtcp_hdr *)(buf + RIST_MAX_PAYLOAD_OFFSET + *offset);
@@ -694,11 +676,38 @@ int rist_receiver_periodic_rtcp(struct rist_peer *peer) {
 	return rist_send_common_rtcp(peer, payload_type, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
 }
 
+static int rist_receiver_send_nacks_compact(struct rist_peer *peer, uint32_t seq_array[], size_t array_len)
+{
+	uint8_t *rtcp_buf = get_cctx(peer)->buf.rtcp;
+	size_t offset = 0;
+	int ret = 0;
+	while (offset < array_len)
+	{
+		int payload_len = 0;
+		rist_rtcp_write_empty_rr(rtcp_buf, &payload_len, peer->adv_flow_id);
+		rist_rtcp_write_sdes(rtcp_buf, &payload_len, peer->cname, peer->adv_flow_id);
+		struct rist_rtcp_nack_range *rtcp = (struct rist_rtcp_nack_range *)(rtcp_buf + RIST_MAX_PAYLOAD_OFFSET + payload_len);
+		rtcp->flags = RTCP_NACK_COMPACT_FLAGS;
+		rtcp->ptype = PTYPE_NACK_CUSTOM;
+		rtcp->ssrc_source = htobe32(peer->adv_flow_id);
+		memcpy(rtcp->name, "RIST", 4);
+		struct rist_rtcp_nack_compact_record *rec = (struct rist_rtcp_nack_compact_record *)(rtcp_buf + RIST_MAX_PAYLOAD_OFFSET + payload_len + RTCP_FB_HEADER_SIZE);
+		size_t records = 0;
+		offset += rist_nack_compact_encode(&seq_array[offset], array_len - offset, rec, RIST_NACK_COMPACT_MAX_RECORDS, &records);
+		rtcp->len = htons((uint16_t)(2 + records * 2));
+		payload_len += (int)(RTCP_FB_HEADER_SIZE + records * sizeof(*rec));
+		ret = rist_send_common_rtcp(peer, RIST_PAYLOAD_TYPE_RTCP_NACK, &rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, 0, peer->local_port, peer->remote_port, 0);
+	}
+	return ret;
+}
+
 int rist_receiver_send_nacks(struct rist_peer *peer, uint32_t seq_array[], size_t array_len)
 {
 	if (get_cctx(peer)->debug)
 		rist_log_priv(get_cctx(peer), RIST_LOG_DEBUG, "Sending %d nacks starting with %"PRIu32"\n",
 		array_len, seq_array[0]);
+	if (array_len > 0 && (peer->remote_caps & RIST_RTCP_CAP_NACK_COMPACT))
+		return rist_receiver_send_nacks_compact(peer, seq_array, array_len);
 	uint8_t payload_type = RIST_PAYLOAD_TYPE_RTCP;
 	uint8_t *rtcp_buf = get_cctx(peer)->buf.rtcp;
 
@@ -799,6 +808,7 @@ void rist_sender_periodic_rtcp(struct rist_peer *peer) {
 	rist_rtcp_write_sdes(rtcp_buf, &payload_len, peer->cname, peer->adv_flow_id);
 	if (peer->echo_enabled)
 		rist_rtcp_write_echoreq(rtcp_buf, &payload_len, peer->peer_ssrc);
+	rist_rtcp_write_caps(rtcp_buf, &payload_len, peer->adv_flow_id, RIST_RTCP_CAP_NACK_COMPACT);
 	// Push it to the FIFO buffer to be sent ASAP (even in the simple profile case)
 	rist_sender_send_rtcp(&rtcp_buf[RIST_MAX_PAYLOAD_OFFSET], payload_len, peer);
 	return;
@@ -838,16 +848,10 @@ int rist_request_echo(struct rist_peer *peer) {
 	}
 }
 
-int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp)
+struct rist_buffer *rist_sender_buffer_new(struct rist_sender *ctx, const void *data, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp, uint64_t now)
 {
 	uint8_t payload_type = RIST_PAYLOAD_TYPE_DATA_RAW;
 	const void * payload = data;
-	if (ctx->common.PEERS == NULL) {
-		// Do not cache data if the lib user has not added peers
-		return -1;
-	}
-
-	ctx->last_datagram_time = datagram_time;
 	uint8_t tmp_buf[6 * 204 + 4];//Max size needed with at least 1 pkt suppressed
 	if (ctx->null_packet_suppression && len <= 7 * 204)
 	{
@@ -864,24 +868,54 @@ int rist_sender_enqueue(struct rist_sender *ctx, const void *data, size_t len, u
 		}
 	}
 
+	struct rist_buffer *buffer = rist_new_buffer(&ctx->common, payload, len, payload_type, 0, datagram_time, src_port, dst_port, now);
+	if (RIST_UNLIKELY(!buffer)) {
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "\t Could not create packet buffer inside sender buffer, OOM, decrease max bitrate or buffer time length\n");
+		return NULL;
+	}
+	buffer->seq_rtp = (uint16_t)seq_rtp;
+	return buffer;
+}
+
+struct rist_buffer *rist_sender_buffer_adopt(struct rist_sender *ctx, void *payload, size_t len, uint64_t datagram_time, uint16_t src_port, uint16_t dst_port, uint32_t seq_rtp, uint64_t now)
+{
+	// Null packet suppression rewrites the payload, take the copying path
+	if (ctx->null_packet_suppression) {
+		struct rist_buffer *buffer = rist_sender_buffer_new(ctx, payload, len, datagram_time, src_port, dst_port, seq_rtp, now);
+		rist_payload_pool_put(payload);
+		return buffer;
+	}
+
+	struct rist_buffer *buffer = rist_new_buffer(&ctx->common, NULL, 0, RIST_PAYLOAD_TYPE_DATA_RAW, 0, datagram_time, src_port, dst_port, now);
+	if (RIST_UNLIKELY(!buffer)) {
+		rist_payload_pool_put(payload);
+		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "\t Could not create packet buffer inside sender buffer, OOM, decrease max bitrate or buffer time length\n");
+		return NULL;
+	}
+	// The pool reserved the protocol headroom in front of the payload
+	buffer->data = (uint8_t *)payload - RIST_MAX_PAYLOAD_OFFSET;
+	buffer->size = len;
+	buffer->alloc_size = len;
+	buffer->pooled = true;
+	buffer->seq_rtp = (uint16_t)seq_rtp;
+	return buffer;
+}
+
+void rist_sender_enqueue_buffers(struct rist_sender *ctx, struct rist_buffer **buffers, size_t count)
+{
 	/* insert into sender fifo queue */
 	pthread_mutex_lock(&ctx->queue_lock);
 	size_t sender_write_index = atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire);
-	ctx->sender_queue[sender_write_index] = rist_new_buffer(&ctx->common, payload, len, payload_type, 0, datagram_time, src_port, dst_port);
-	if (RIST_UNLIKELY(!ctx->sender_queue[sender_write_index])) {
-		rist_log_priv(&ctx->common, RIST_LOG_ERROR, "\t Could not create packet buffer inside sender buffer, OOM, decrease max bitrate or buffer time length\n");
-		pthread_mutex_unlock(&ctx->queue_lock);
-		return -1;
+	for (size_t i = 0; i < count; i++) {
+		ctx->sender_queue[sender_write_index] = buffers[i];
+		ctx->sender_queue_bytesize += buffers[i]->size;
+		sender_write_index = (sender_write_index + 1) & (ctx->sender_queue_max - 1);
 	}
-	ctx->sender_queue[sender_write_index]->seq_rtp = (uint16_t)seq_rtp;
-	ctx->sender_queue_bytesize += len;
-	atomic_store_explicit(&ctx->sender_queue_write_index, (sender_write_index + 1) & (ctx->sender_queue_max - 1), memory_order_release);
+	atomic_store_explicit(&ctx->sender_queue_write_index, sender_write_index, memory_order_release);
 	pthread_mutex_unlock(&ctx->queue_lock);
-
-	return 0;
 }
 
-void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer)
+void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer *buffer, uint64_t now)
 {
 	struct rist_peer *peer;
 	struct rist_peer *selected_peer_by_weight = NULL;
@@ -889,10 +923,6 @@ void rist_sender_send_data_balanced(struct rist_sender *ctx, struct rist_buffer
 	int peercnt;
 	bool looped = false;
 
-	//We can do it safely here, since this function is only to be called once per packet
-	buffer->seq = ctx->common.seq++;
-	uint64_t now = timestampNTP_u64();
-
 peer_select:
 
 	peercnt = 0;
@@ -931,13 +961,13 @@ peer_select:
 						//do nothing
 					} else
 #endif
-					if (child->is_data && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
+					if (child->is_data && !child->fast_start && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
 						uint8_t *payload = buffer->data;
 						rist_send_common_rtcp(child, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
 					}
 					child = child->sibling_next;
 				}
-			} else if (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now)) {
+			} else if (!peer->fast_start && (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now))) {
 				uint8_t *payload = buffer->data;
 				rist_send_common_rtcp(peer, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
 			}
@@ -963,13 +993,13 @@ peer_select:
 						//do nothing
 					} else
 #endif
-				if (child->is_data && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
+				if (child->is_data && !child->fast_start && (!child->dead || (child->dead && (child->dead_since + peer->recovery_buffer_ticks) < now))) {
 					uint8_t *payload = buffer->data;
 					rist_send_common_rtcp(child, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port,  buffer->seq_rtp);
 				}
 				child = child->sibling_next;
 			}
-		} else if (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now)) {
+		} else if (!peer->fast_start && (!peer->dead || (peer->dead && (peer->dead_since + peer->recovery_buffer_ticks) < now))) {
 			uint8_t *payload = buffer->data;
 			rist_send_common_rtcp(peer, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, buffer->src_port, buffer->dst_port, buffer->seq_rtp);
 		}
@@ -988,12 +1018,6 @@ peer_select:
 	}
 }
 
-static size_t rist_sender_index_get(struct rist_sender *ctx, uint32_t seq)
-{
-	size_t idx = ctx->seq_index[(uint16_t)seq];
-	return idx;
-}
-
 size_t rist_get_sender_retry_queue_size(struct rist_sender *ctx)
 {
 	size_t retry_queue_size = (ctx->sender_retry_queue_write_index - ctx->sender_retry_queue_read_index)
@@ -1001,8 +1025,39 @@ size_t rist_get_sender_retry_queue_size(struct rist_sender *ctx)
 	return retry_queue_size;
 }
 
+/* Runs RIST_FAST_START_RATE times the pace the history was written at until it
+   caught up with the live data, which is held for the peer meanwhile */
+void rist_sender_send_fast_start(struct rist_sender *ctx, struct rist_peer *peer, uint64_t now)
+{
+	// a peer that lost its authentication mid burst gets nothing until it is back
+	if (!peer->authenticated)
+		return;
+#if HAVE_MBEDTLS
+	if (!eap_is_authenticated(peer->eap_ctx))
+		return;
+#endif
+	uint64_t horizon = peer->fast_start_origin + (now - peer->fast_start_begin) * RIST_FAST_START_RATE;
+	while ((int32_t)(peer->fast_start_seq - ctx->sender_history.head) <= 0) {
+		size_t idx;
+		struct rist_buffer *buffer = rist_sender_history_get(&ctx->sender_history, ctx->sender_queue, peer->fast_start_seq, &idx);
+		if (buffer) {
+			if (buffer->time > horizon)
+				return;
+			uint8_t *payload = buffer->data;
+			uint16_t src_port = buffer->src_port;
+			if (src_port == 0)
+				src_port = 32768 + peer->adv_peer_id;
+			size_t ret = rist_send_seq_rtcp(peer, buffer->seq_rtp, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, src_port, (peer->config.virt_dst_port & ~1UL), true);
+			rist_calculate_bitrate(ret, &peer->retry_bw, now);
+		}
+		peer->fast_start_seq++;
+	}
+	peer->fast_start = false;
+	rist_log_priv(&ctx->common, RIST_LOG_INFO, "Fast start for peer %"PRIu32" caught up with live data\n", peer->adv_peer_id);
+}
+
 /* This function must return, 0 when there is nothing to send, < 0 on error and > 0 for bytes sent */
-ssize_t rist_retry_dequeue(struct rist_sender *ctx)
+ssize_t rist_retry_dequeue(struct rist_sender *ctx, uint64_t now)
 {
 	size_t sender_retry_queue_read_index = (ctx->sender_retry_queue_read_index + 1)& (ctx->sender_retry_queue_size -1);
 
@@ -1013,24 +1068,15 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	ctx->sender_retry_queue_read_index = sender_retry_queue_read_index;
 	struct rist_retry *retry = &ctx->sender_retry_queue[ctx->sender_retry_queue_read_index];
 
-	// If they request a non-sense seq number, we will catch it when we check the seq number against
-	// the one on that buffer position and it does not match
-	
-	size_t idx = rist_sender_index_get(ctx, retry->seq);
-	if (RIST_UNLIKELY(ctx->sender_queue[idx] == NULL)) {
+	// The seq was resolved on enqueue, the packet may have been cleaned up since
+	size_t idx = 0;
+	if (RIST_UNLIKELY(!rist_sender_history_get(&ctx->sender_history, ctx->sender_queue, retry->seq, &idx))) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
-			" Couldn't find block %" PRIu32 " (i=%zu/r=%zu/w=%zu/d=%zu/rs=%zu), consider increasing the buffer size\n",
-			retry->seq, idx, atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire), atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire), ctx->sender_queue_delete_index,
+			" Couldn't find block %" PRIu32 " (r=%zu/w=%zu/d=%zu/rs=%zu), consider increasing the buffer size\n",
+			retry->seq, atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire), atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire), ctx->sender_queue_delete_index,
 			rist_get_sender_retry_queue_size(ctx));
 		retry->peer->stats_sender_instant.retrans_skip++;
 		return -1;
-	} else if (RIST_UNLIKELY((uint16_t)retry->seq != ctx->sender_queue[idx]->seq_rtp)) {
-		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
-			" Couldn't find block %" PRIu16 " (i=%zu/r=%zu/w=%zu/d=%zu/rs=%zu), found an old one instead %" PRIu32 " (%" PRIu64 "), bitrate is too high\n",
-			(uint16_t)retry->seq, idx, atomic_load_explicit(&ctx->sender_queue_read_index, memory_order_acquire), atomic_load_explicit(&ctx->sender_queue_write_index, memory_order_acquire), ctx->sender_queue_delete_index,
-			rist_get_sender_retry_queue_size(ctx), ctx->sender_queue[idx]->seq_rtp, ctx->sender_queue_max);
-		retry->peer->stats_sender_instant.retrans_skip++;
-		return -1;
 	}
 	/* we're consuming the retry for an existing buffer, set it to false to allow new retries to come in */
 	ctx->sender_queue[idx]->retry_queued = false;
@@ -1045,8 +1091,8 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 		retry_bw = &retry->peer->peer_data->retry_bw;
 	}
 	// update bandwidth values
-	rist_calculate_bitrate(0, cli_bw);
-	rist_calculate_bitrate(0, retry_bw);
+	rist_calculate_bitrate(0, cli_bw, now);
+	rist_calculate_bitrate(0, retry_bw, now);
 
 	// Make sure we do not flood the network with retries
 	size_t current_bitrate = 0;
@@ -1072,10 +1118,9 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	}
 
 	// Check buffer element age
-	uint64_t now = timestampNTP_u64();
 	/* queue_time holds the original insertion time for this seq */
-	uint64_t data_age = (now - ctx->sender_queue[idx]->time) / RIST_CLOCK;
-	uint64_t retry_age = (now - retry->insert_time) / RIST_CLOCK;
+	uint64_t data_age = now > ctx->sender_queue[idx]->time ? (now - ctx->sender_queue[idx]->time) / RIST_CLOCK : 0;
+	uint64_t retry_age = now > retry->insert_time ? (now - retry->insert_time) / RIST_CLOCK : 0;
 	if (RIST_UNLIKELY(retry_age > retry->peer->config.recovery_length_max)) {
 		rist_log_priv(&ctx->common, RIST_LOG_DEBUG,
 			"Retry-request of element %" PRIu32 " (idx %zu) that was sent %" PRIu64
@@ -1109,7 +1154,7 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 		src_port = 32768 + retry->peer->peer_data->adv_peer_id;
 	ret = (size_t)rist_send_seq_rtcp(retry->peer->peer_data, buffer->seq_rtp, buffer->type, &payload[RIST_MAX_PAYLOAD_OFFSET], buffer->size, buffer->source_time, src_port, (retry->peer->peer_data->config.virt_dst_port & ~1UL), true);
 	// update bandwidth value
-	rist_calculate_bitrate(ret, retry_bw);
+	rist_calculate_bitrate(ret, retry_bw, now);
 
 	if (ret < buffer->size) {
 		rist_log_priv(&ctx->common, RIST_LOG_ERROR,
@@ -1126,13 +1171,24 @@ ssize_t rist_retry_dequeue(struct rist_sender *ctx)
 	return ret;
 }
 
-void rist_retry_enqueue(struct rist_sender *ctx, uint32_t seq, struct rist_peer *peer)
+void rist_retry_enqueue(struct rist_sender *ctx, uint32_t nack_seq, struct rist_peer *peer)
 {
 	uint64_t now = timestampNTP_u64();
-	size_t idx = rist_sender_index_get(ctx, seq);
-	struct rist_buffer *buffer = ctx->sender_queue[idx];
 	struct rist_retry *retry;
 
+	// NACKs carry the 16 bits the receiver saw, a packet younger than half the
+	// round trip cannot have been reported missing yet and receivers repeat
+	// their requests about once per round trip
+	uint64_t nack_rtt = peer->last_mrtt;
+	if (peer->config.recovery_rtt_min > nack_rtt)
+		nack_rtt = peer->config.recovery_rtt_min;
+	if (peer->config.recovery_rtt_max < nack_rtt)
+		nack_rtt = peer->config.recovery_rtt_max;
+	uint32_t seq = nack_seq;
+	size_t idx = 0;
+	struct rist_buffer *buffer = rist_sender_history_resolve(&ctx->sender_history, ctx->sender_queue, (uint16_t)nack_seq,
+															 now, nack_rtt * RIST_CLOCK / 2, nack_rtt * RIST_CLOCK * 4, &seq, &idx);
+
 	// Even though all the checks are on the dequeue function, we leave one here
 	// to prevent the flooding of our fifo .. It is based on the date of the
 	// last queued item with the same seq for this peer.
@@ -7,6 +7,11 @@
 
 #include "librist/udpsocket.h"
 #include "log-private.h"
+#include "clock.h"
+#ifdef __linux__
+#include <time.h>
+#include <linux/net_tstamp.h>
+#endif
 #ifdef _WIN32
 #include <ws2ipdef.h>
 #ifndef MCAST_JOIN_GROUP
@@ -17,6 +22,24 @@
 /* Private functions */
 static const int yes = 1; // no = 0;
 
+#ifdef __linux__
+/* Kernel timestamps are CLOCK_REALTIME (or the NIC clock synced to it), the
+ * library runs on a monotonic clock: move the packet's age over instead of the
+ * absolute time. Ages outside of a second mean an unsynced NIC clock or a step
+ * of the wall clock, those timestamps are not used. */
+static uint64_t kernel_ts_to_ntp(const struct timespec *ts)
+{
+	struct timespec now;
+	if (ts->tv_sec == 0 && ts->tv_nsec == 0)
+		return 0;
+	clock_gettime(CLOCK_REALTIME, &now);
+	int64_t age_ns = ((int64_t)now.tv_sec - (int64_t)ts->tv_sec) * 1000000000LL + (now.tv_nsec - ts->tv_nsec);
+	if (age_ns < 0 || age_ns > 1000000000LL)
+		return 0;
+	return timestampNTP_u64() - rist_clock_ns_to_ntp((uint64_t)age_ns);
+}
+#endif
+
 /* Public API */
 
 int udpsocket_resolve_host(const char *host, uint16_t port, struct sockaddr *addr)
@@ -382,6 +405,83 @@ int udpsocket_recvfrom(int sd, void *buf, size_t size, int flags, struct sockadd
 	return (int)recvfrom(sd, buf, size, flags, addr, addr_len);
 }
 
+int udpsocket_set_timestamping(int sd, enum udpsocket_timestamp_mode mode)
+{
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+	const int off = 0;
+	switch (mode) {
+	case UDPSOCKET_TIMESTAMP_NONE:
+		setsockopt(sd, SOL_SOCKET, SO_TIMESTAMPING, &off, sizeof(off));
+		if (setsockopt(sd, SOL_SOCKET, SO_TIMESTAMPNS, &off, sizeof(off)) < 0)
+			return -1;
+		return UDPSOCKET_TIMESTAMP_NONE;
+	case UDPSOCKET_TIMESTAMP_HARDWARE: {
+		int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+					SOF_TIMESTAMPING_SOFTWARE;
+		if (setsockopt(sd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+			return UDPSOCKET_TIMESTAMP_HARDWARE;
+	}
+		/* fall through */
+	case UDPSOCKET_TIMESTAMP_SOFTWARE:
+		if (setsockopt(sd, SOL_SOCKET, SO_TIMESTAMPNS, &yes, sizeof(yes)) < 0)
+			return -1;
+		return UDPSOCKET_TIMESTAMP_SOFTWARE;
+	}
+	errno = EINVAL;
+	return -1;
+#else
+	(void)sd;
+	if (mode == UDPSOCKET_TIMESTAMP_NONE)
+		return UDPSOCKET_TIMESTAMP_NONE;
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+int udpsocket_recvfrom_ts(int sd, void *buf, size_t size, int flags, struct sockaddr *addr, socklen_t *addr_len,
+						  uint64_t *ts_ntp)
+{
+	*ts_ntp = 0;
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+	struct iovec iov = { .iov_base = buf, .iov_len = size };
+	union {
+		char buf[CMSG_SPACE(3 * sizeof(struct timespec))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr msg = {
+		.msg_name = addr,
+		.msg_namelen = addr_len ? *addr_len : 0,
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof(control.buf),
+	};
+	ssize_t ret = recvmsg(sd, &msg, flags);
+	if (ret < 0)
+		return (int)ret;
+	if (addr_len)
+		*addr_len = msg.msg_namelen;
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET)
+			continue;
+		struct timespec ts[3];
+		if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			memcpy(ts, CMSG_DATA(cmsg), sizeof(ts[0]));
+			*ts_ntp = kernel_ts_to_ntp(&ts[0]);
+		} else if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+			// [0] software, [2] raw hardware, whichever the kernel filled in
+			memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+			*ts_ntp = kernel_ts_to_ntp(&ts[2]);
+			if (!*ts_ntp)
+				*ts_ntp = kernel_ts_to_ntp(&ts[0]);
+		}
+	}
+	return (int)ret;
+#else
+	return (int)recvfrom(sd, buf, size, flags, addr, addr_len);
+#endif
+}
+
 int udpsocket_close(int sd)
 {
 #ifndef _WIN32
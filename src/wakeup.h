@@ -0,0 +1,85 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_WAKEUP_H
+#define RIST_WAKEUP_H
+
+#include "common/attributes.h"
+#include "pthread-shim.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * Coalesced wake ups of a consumer thread sleeping on a condition variable.
+ * Producers publish their data and then call rist_wakeup_notify(), which only
+ * takes the mutex and signals when a consumer is actually parked, so a consumer
+ * busy draining its queue costs them an atomic increment instead of a futex
+ * call per packet.
+ *
+ * The consumer takes rist_wakeup_events() before it looks at its queue and
+ * passes it to rist_wakeup_wait(), which skips the sleep when a notify came in
+ * since. Both sides order their publish against the other side's check with a
+ * full fence, so either the consumer sees the new event or the producer sees
+ * the consumer parked.
+ */
+struct rist_wakeup {
+	/* bumped by every notify */
+	atomic_uint events;
+	/* consumers parked and not yet signalled, changed under the mutex */
+	atomic_uint sleeping;
+	/* signal round, under the mutex */
+	unsigned round;
+};
+
+static inline void rist_wakeup_init(struct rist_wakeup *w)
+{
+	atomic_init(&w->events, 0);
+	atomic_init(&w->sleeping, 0);
+	w->round = 0;
+}
+
+static inline unsigned rist_wakeup_events(struct rist_wakeup *w)
+{
+	return atomic_load_explicit(&w->events, memory_order_acquire);
+}
+
+/* Consumer side, mutex held: sleeps unless a notify arrived after seen */
+static inline int rist_wakeup_wait(struct rist_wakeup *w, pthread_cond_t *condition, pthread_mutex_t *mutex,
+								   unsigned seen, uint32_t timeout_ms)
+{
+	atomic_fetch_add_explicit(&w->sleeping, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	unsigned round = w->round;
+	int ret = 0;
+	if (atomic_load_explicit(&w->events, memory_order_relaxed) == seen)
+		ret = pthread_cond_timedwait_ms(condition, mutex, timeout_ms);
+	// a signal for our round already took us off the count
+	if (w->round == round)
+		atomic_fetch_sub_explicit(&w->sleeping, 1, memory_order_relaxed);
+	return ret;
+}
+
+/* Producer side, after publishing: 1 if a parked consumer was signalled, 0 if
+ * none was waiting, -1 if signalling failed */
+static inline int rist_wakeup_notify(struct rist_wakeup *w, pthread_cond_t *condition, pthread_mutex_t *mutex)
+{
+	atomic_fetch_add_explicit(&w->events, 1, memory_order_release);
+	atomic_thread_fence(memory_order_seq_cst);
+	if (!atomic_load_explicit(&w->sleeping, memory_order_relaxed))
+		return 0;
+	int ret = 0;
+	pthread_mutex_lock(mutex);
+	if (atomic_load_explicit(&w->sleeping, memory_order_relaxed)) {
+		atomic_store_explicit(&w->sleeping, 0, memory_order_relaxed);
+		w->round++;
+		ret = pthread_cond_broadcast(condition) ? -1 : 1;
+	}
+	pthread_mutex_unlock(mutex);
+	return ret;
+}
+
+#endif
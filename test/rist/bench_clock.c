@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Monotonic clock microbenchmark, compares the legacy per-call clock_gettime plus
+ * 64-bit division against the current time source and against sampling it once
+ * per batch the way the protocol loops do. Also checks it agrees with the legacy
+ * conversion. */
+
+#include "clock.h"
+#include "time-shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define ITERATIONS 2000000
+#define BATCH 100
+/* Clock reads the data path used to do per packet (enqueue, new buffer, balanced
+ * send, bitrate, retry dequeue/cleanup) */
+#define READS_PER_PACKET 5
+/* 1 microsecond in NTP ticks */
+#define TOLERANCE 4295
+
+static uint64_t legacy_timestampNTP_u64(void)
+{
+	timespec_t ts;
+#if defined (__APPLE__)
+	clock_gettime_osx(CLOCK_MONOTONIC_OSX, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	uint64_t t = (uint64_t)(ts.tv_nsec) << 32;
+	t /= 1000000000;
+	t |= (uint64_t)((70LL * 365 + 17) * 24 * 60 * 60 + ts.tv_sec) << 32;
+	return t;
+}
+
+static double elapsed_ns(uint64_t start, uint64_t end, uint64_t count)
+{
+	return (double)(end - start) * 1e9 / 4294967296.0 / (double)count;
+}
+
+int main(void)
+{
+	int errors = 0;
+	volatile uint64_t sink = 0;
+
+	bool tsc = rist_clock_init();
+	fprintf(stdout, "clock source: %s\n", tsc ? "calibrated TSC" : "clock_gettime");
+
+	/* The new conversion must land between two legacy samples */
+	for (int i = 0; i < 100000; i++) {
+		uint64_t before = legacy_timestampNTP_u64();
+		uint64_t now = timestampNTP_u64();
+		uint64_t after = legacy_timestampNTP_u64();
+		if (now + TOLERANCE < before || now > after + TOLERANCE) {
+			if (errors++ < 5)
+				fprintf(stderr, "clock mismatch: %"PRIu64" not in [%"PRIu64", %"PRIu64"]\n", now, before, after);
+		}
+	}
+	uint64_t us = rist_clock_ntp_to_us(((uint64_t)3 << 32) | 0x80000000);
+	if (us != 3500000) {
+		fprintf(stderr, "ntp to us conversion failed: %"PRIu64"\n", us);
+		errors++;
+	}
+
+	uint64_t start = legacy_timestampNTP_u64();
+	for (int i = 0; i < ITERATIONS; i++)
+		sink += legacy_timestampNTP_u64();
+	uint64_t end = legacy_timestampNTP_u64();
+	double legacy_ns = elapsed_ns(start, end, ITERATIONS);
+
+	start = legacy_timestampNTP_u64();
+	for (int i = 0; i < ITERATIONS; i++)
+		sink += timestampNTP_u64();
+	end = legacy_timestampNTP_u64();
+	double current_ns = elapsed_ns(start, end, ITERATIONS);
+
+	/* One sample per loop iteration shared by a batch of packets */
+	start = legacy_timestampNTP_u64();
+	for (int i = 0; i < ITERATIONS; i += BATCH) {
+		uint64_t now = timestampNTP_u64();
+		for (int j = 0; j < BATCH; j++)
+			sink += now;
+	}
+	end = legacy_timestampNTP_u64();
+	double batched_ns = elapsed_ns(start, end, ITERATIONS);
+
+	fprintf(stdout, "legacy clock_gettime + div : %6.2f ns/call, %6.2f ns/packet\n", legacy_ns, legacy_ns * READS_PER_PACKET);
+	fprintf(stdout, "timestampNTP_u64           : %6.2f ns/call, %6.2f ns/packet\n", current_ns, current_ns * READS_PER_PACKET);
+	fprintf(stdout, "sampled once per %d       : %6.2f ns/packet\n", BATCH, batched_ns);
+
+	(void)sink;
+	return errors ? 1 : 0;
+}
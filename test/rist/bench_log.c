@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Debug logging overhead on a synthetic packet loop with the log level at INFO.
+ * Compares calling the log function with evaluated arguments (the old
+ * behaviour) against the level checking macros; the bench_log_nodebug build
+ * compiles the DEBUG calls out entirely. The loop does not run the sender's
+ * retry or nack code, it only measures the cost of the log calls. */
+
+#include "log-private.h"
+#include "clock.h"
+#include <stdio.h>
+#include <inttypes.h>
+
+#define PACKETS 5000000
+#define QUEUE_SIZE 4096
+
+struct bench_queue {
+	atomic_size_t read_index;
+	atomic_size_t write_index;
+	atomic_uint_fast64_t bytes;
+};
+
+static size_t bench_queue_size(struct bench_queue *q)
+{
+	size_t w = atomic_load_explicit(&q->write_index, memory_order_acquire);
+	size_t r = atomic_load_explicit(&q->read_index, memory_order_acquire);
+	return (w - r) & (QUEUE_SIZE - 1);
+}
+
+/* Stand-in per packet bookkeeping with two DEBUG sites whose arguments are
+ * shaped like the retry and nack ones: atomic loads, a queue size and a clock
+ * read */
+#define PACKET_LOOP(LOG)                                                                                   \
+	for (uint32_t seq = 0; seq < PACKETS; seq++) {                                                         \
+		size_t idx = atomic_fetch_add_explicit(&q.write_index, 1, memory_order_release) & (QUEUE_SIZE - 1); \
+		atomic_fetch_add_explicit(&q.bytes, 1316, memory_order_relaxed);                                   \
+		LOG(&cctx, RIST_LOG_DEBUG, "Packet %" PRIu32 " queued at %zu, read index %zu\n", seq, idx,         \
+			atomic_load_explicit(&q.read_index, memory_order_acquire));                                    \
+		LOG(&cctx, RIST_LOG_DEBUG, "Resending %" PRIu32 " queue size %zu at %" PRIu64 "\n", seq,           \
+			bench_queue_size(&q), timestampNTP_u64());                                                     \
+		if ((seq & 63) == 0)                                                                               \
+			atomic_fetch_add_explicit(&q.read_index, 64, memory_order_release);                            \
+		sink += idx;                                                                                       \
+	}
+
+static double run_eager(struct rist_common_ctx *ctx)
+{
+	struct rist_common_ctx cctx = *ctx;
+	struct bench_queue q = { 0 };
+	volatile size_t sink = 0;
+	uint64_t start = timestampNTP_u64();
+	PACKET_LOOP(rist_log_priv_emit)
+	uint64_t end = timestampNTP_u64();
+	(void)sink;
+	return (double)(end - start) * 1e9 / 4294967296.0 / PACKETS;
+}
+
+static double run_macro(struct rist_common_ctx *ctx)
+{
+	struct rist_common_ctx cctx = *ctx;
+	struct bench_queue q = { 0 };
+	volatile size_t sink = 0;
+	uint64_t start = timestampNTP_u64();
+	PACKET_LOOP(rist_log_priv)
+	uint64_t end = timestampNTP_u64();
+	(void)sink;
+	return (double)(end - start) * 1e9 / 4294967296.0 / PACKETS;
+}
+
+int main(void)
+{
+	rist_clock_init();
+	struct rist_logging_settings settings = LOGGING_SETTINGS_INITIALIZER;
+	settings.log_level = RIST_LOG_INFO;
+	settings.log_stream = stderr;
+	struct rist_common_ctx cctx = { 0 };
+	cctx.logging_settings = &settings;
+
+	double eager = run_eager(&cctx);
+	double macro = run_macro(&cctx);
+#ifdef RIST_DISABLE_DEBUG_LOGGING
+	const char *label = "compiled out";
+#else
+	const char *label = "level check";
+#endif
+	fprintf(stdout, "%-22s %7.2f ns/packet %8.2f Mpps\n", "arguments evaluated", eager, 1000.0 / eager);
+	fprintf(stdout, "%-22s %7.2f ns/packet %8.2f Mpps (%.1fx)\n", label, macro, 1000.0 / macro, eager / macro);
+	return 0;
+}
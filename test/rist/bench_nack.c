@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Compact nack encoder/decoder microbenchmark, also checks the round trip */
+
+#include "nack.h"
+#include "time-shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SEQ_COUNT RIST_MAX_NACKS_COMPACT
+#define ITERATIONS 20000
+
+struct decode_check {
+	const uint32_t *expected;
+	size_t index;
+	int errors;
+};
+
+static void decode_cb(void *arg, uint32_t seq)
+{
+	struct decode_check *check = arg;
+	if (check->expected[check->index] != seq)
+		check->errors++;
+	check->index++;
+}
+
+static void count_cb(void *arg, uint32_t seq)
+{
+	(void)seq;
+	(*(size_t *)arg)++;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static size_t legacy_packets(size_t count)
+{
+	// receiver_nack_output() flushes legacy groups at RIST_MAX_NACKS - 1 seqs
+	return (count + RIST_MAX_NACKS - 2) / (RIST_MAX_NACKS - 1);
+}
+
+static int run(const char *name, const uint32_t *seqs, size_t count)
+{
+	struct rist_rtcp_nack_compact_record rec[SEQ_COUNT];
+	size_t packets = 0;
+	size_t offset = 0;
+	size_t total_records = 0;
+	struct decode_check check = { seqs, 0, 0 };
+	while (offset < count) {
+		size_t records = 0;
+		offset += rist_nack_compact_encode(&seqs[offset], count - offset, &rec[total_records], RIST_NACK_COMPACT_MAX_RECORDS, &records);
+		total_records += records;
+		packets++;
+	}
+	rist_nack_compact_decode(rec, total_records, decode_cb, &check);
+	if (check.errors || check.index != count) {
+		fprintf(stderr, "%s: round trip failed (%zu/%zu seqs, %d errors)\n", name, check.index, count, check.errors);
+		return 1;
+	}
+
+	uint64_t start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++) {
+		size_t records = 0;
+		rist_nack_compact_encode(seqs, count, rec, SEQ_COUNT, &records);
+	}
+	uint64_t encode_ns = now_ns() - start;
+	size_t decoded = 0;
+	start = now_ns();
+	for (int i = 0; i < ITERATIONS; i++)
+		rist_nack_compact_decode(rec, total_records, count_cb, &decoded);
+	uint64_t decode_ns = now_ns() - start;
+
+	fprintf(stdout, "%-16s %5zu seqs: %4zu records, %3zu packets (legacy %3zu), encode %6.1f ns, decode %6.1f ns per batch\n",
+			name, count, total_records, packets, legacy_packets(count),
+			(double)encode_ns / ITERATIONS, (double)decode_ns / ITERATIONS);
+	return 0;
+}
+
+int main(void)
+{
+	uint32_t seqs[SEQ_COUNT];
+	int ret = 0;
+
+	// One long burst crossing the 16 bit boundary
+	for (size_t i = 0; i < SEQ_COUNT; i++)
+		seqs[i] = 0xFFFFFE00 + (uint32_t)i;
+	ret |= run("burst", seqs, SEQ_COUNT);
+
+	// Every third packet lost
+	for (size_t i = 0; i < SEQ_COUNT; i++)
+		seqs[i] = 0x0000FF00 + (uint32_t)i * 3;
+	ret |= run("periodic", seqs, SEQ_COUNT);
+
+	// Random ~10% loss
+	uint32_t seq = 1000;
+	srand(1);
+	for (size_t i = 0; i < SEQ_COUNT; i++) {
+		seq += 1 + (uint32_t)(rand() % 19);
+		seqs[i] = seq;
+	}
+	ret |= run("random", seqs, SEQ_COUNT);
+
+	return ret;
+}
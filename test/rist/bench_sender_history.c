@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Retransmission lookups of a 500 Mbps sender with a 2 s buffer, about 95000
+ * packets in the recovery window. Lost packets are requested once per round
+ * trip until the receiver buffer expires and each request is resolved through
+ * the old 16-bit seq to index table and through the sender history, then both
+ * are timed over the whole window. */
+
+#include "rist-private.h"
+#include "clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BITRATE_KBPS 500000
+#define BUFFER_MS 2000
+#define RTT_MS 100
+#define SECONDS 30
+#define LOSS_PER_MILLE 1
+#define PENDING_MAX 65536
+#define LOOKUPS 10000000
+
+struct pending {
+	uint32_t seq;
+	uint64_t sent;
+	uint64_t due;
+};
+
+struct lookup_stats {
+	uint64_t requests;
+	uint64_t hits;
+	double ns;
+};
+
+static void report(const char *label, struct lookup_stats *stats)
+{
+	fprintf(stdout, "%-16s %8.3f%% of %" PRIu64 " requests resolved to the lost packet, %6.2f ns/lookup\n", label,
+			100.0 * (double)stats->hits / (double)stats->requests, stats->requests, stats->ns);
+}
+
+int main(void)
+{
+	rist_clock_init();
+	const uint64_t pps = (uint64_t)BITRATE_KBPS * 1000 / 8 / RIST_SENDER_HISTORY_PACKET_SIZE;
+	const uint64_t packets = pps * SECONDS;
+	const uint64_t kept = pps * (BUFFER_MS + 2 * RTT_MS) / 1000;
+	const uint64_t rtt = (uint64_t)RTT_MS * RIST_CLOCK;
+
+	struct rist_buffer **queue = calloc(RIST_SERVER_QUEUE_BUFFERS, sizeof(*queue));
+	struct rist_buffer *pool = calloc(RIST_SERVER_QUEUE_BUFFERS, sizeof(*pool));
+	uint32_t *seq_index = calloc(UINT16_SIZE, sizeof(*seq_index));
+	struct pending *pending = calloc(PENDING_MAX, sizeof(*pending));
+	struct rist_sender_history history;
+	size_t size = rist_sender_history_size(BITRATE_KBPS, BUFFER_MS + 2 * RTT_MS, RIST_SERVER_QUEUE_BUFFERS);
+	if (!queue || !pool || !seq_index || !pending || rist_sender_history_init(&history, size) != 0)
+		return 99;
+
+	struct lookup_stats old_table = { 0 };
+	struct lookup_stats sized = { 0 };
+	size_t head = 0, tail = 0;
+	uint32_t rng = 0x12345678;
+	for (uint64_t n = 0; n < packets; n++) {
+		uint64_t now = (n * RIST_CLOCK * 1000) / pps;
+		size_t idx = n & (RIST_SERVER_QUEUE_BUFFERS - 1);
+		// cleanup of the sender queue past the buffer
+		if (n >= kept)
+			queue[(n - kept) & (RIST_SERVER_QUEUE_BUFFERS - 1)] = NULL;
+		struct rist_buffer *b = &pool[idx];
+		memset(b, 0, sizeof(*b));
+		b->seq_rtp = (uint16_t)n;
+		b->time = now;
+		queue[idx] = b;
+		rist_sender_history_add(&history, b, idx);
+		seq_index[b->seq_rtp] = (uint32_t)idx;
+
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		if (rng % 1000 < LOSS_PER_MILLE && (head - tail) < PENDING_MAX) {
+			pending[head & (PENDING_MAX - 1)] = (struct pending){ (uint32_t)n, now, now + rtt };
+			head++;
+		}
+
+		// every request comes back one round trip after the previous one
+		while (tail != head && pending[tail & (PENDING_MAX - 1)].due <= now) {
+			struct pending p = pending[tail & (PENDING_MAX - 1)];
+			tail++;
+
+			struct rist_buffer *found = queue[seq_index[(uint16_t)p.seq]];
+			old_table.requests++;
+			if (found && found->seq == p.seq)
+				old_table.hits++;
+
+			uint32_t seq;
+			size_t slot;
+			found = rist_sender_history_resolve(&history, queue, (uint16_t)p.seq, now, rtt / 2, rtt * 4, &seq, &slot);
+			sized.requests++;
+			if (found && found->seq == p.seq)
+				sized.hits++;
+			if (found)
+				found->last_retry_request = now;
+
+			p.due += rtt;
+			if (p.due - p.sent <= (uint64_t)BUFFER_MS * RIST_CLOCK) {
+				pending[head & (PENDING_MAX - 1)] = p;
+				head++;
+			}
+		}
+	}
+
+	// Lookup cost over the whole window on the final state
+	uint64_t now = (packets * RIST_CLOCK * 1000) / pps;
+	volatile uintptr_t sink = 0;
+	uint64_t start = timestampNTP_u64();
+	for (uint32_t i = 0; i < LOOKUPS; i++) {
+		uint16_t seq_rtp = (uint16_t)(packets - 1 - (i * 7919ULL) % kept);
+		sink += (uintptr_t)queue[seq_index[seq_rtp]];
+	}
+	old_table.ns = (double)(timestampNTP_u64() - start) * 1e9 / 4294967296.0 / LOOKUPS;
+	start = timestampNTP_u64();
+	for (uint32_t i = 0; i < LOOKUPS; i++) {
+		uint16_t seq_rtp = (uint16_t)(packets - 1 - (i * 7919ULL) % kept);
+		uint32_t seq;
+		size_t slot;
+		sink += (uintptr_t)rist_sender_history_resolve(&history, queue, seq_rtp, now, rtt / 2, rtt * 4, &seq, &slot);
+	}
+	sized.ns = (double)(timestampNTP_u64() - start) * 1e9 / 4294967296.0 / LOOKUPS;
+	(void)sink;
+
+	fprintf(stdout, "%" PRIu64 " packets/s, %" PRIu64 " packets in the recovery window, history of %zu\n", pps, kept, size);
+	report("16-bit table", &old_table);
+	report("sender history", &sized);
+	rist_sender_history_free(&history);
+	free(pending);
+	free(seq_index);
+	free(pool);
+	free(queue);
+	return sized.hits > old_table.hits ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Producer cost of queueing 7x188 byte TS chunks into a running sender, one
+ * rist_sender_data_write() per packet against rist_sender_data_writev() of
+ * encoder sized batches, copied or handed over from the payload pool. */
+
+#include "librist/librist.h"
+#include "clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define ROUNDS 60
+#define WARMUP_ROUNDS 15
+#define ROUND_PACKETS 8192
+#define BATCH 32
+#define PACKET_SIZE 1316
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+/* What the encoder produces, every mode writes it out once per packet */
+static uint8_t source[PACKET_SIZE];
+static uint8_t payload[BATCH][PACKET_SIZE];
+
+static uint64_t run_single(struct rist_ctx *ctx, struct rist_data_block *blocks)
+{
+	uint64_t start = timestampNTP_u64();
+	for (int i = 0; i < ROUND_PACKETS; i++) {
+		memcpy(payload[i % BATCH], source, PACKET_SIZE);
+		if (rist_sender_data_write(ctx, &blocks[i % BATCH]) != PACKET_SIZE)
+			return 0;
+	}
+	return timestampNTP_u64() - start;
+}
+
+static uint64_t run_batch(struct rist_ctx *ctx, struct rist_data_block *blocks)
+{
+	uint64_t start = timestampNTP_u64();
+	for (int i = 0; i < ROUND_PACKETS; i += BATCH) {
+		for (int j = 0; j < BATCH; j++)
+			memcpy(payload[j], source, PACKET_SIZE);
+		if (rist_sender_data_writev(ctx, blocks, BATCH) != BATCH * PACKET_SIZE)
+			return 0;
+	}
+	return timestampNTP_u64() - start;
+}
+
+static uint64_t run_zero_copy(struct rist_ctx *ctx, struct rist_data_block *blocks)
+{
+	struct rist_data_block owned[BATCH];
+	memcpy(owned, blocks, sizeof(owned));
+	uint64_t start = timestampNTP_u64();
+	for (int i = 0; i < ROUND_PACKETS; i += BATCH) {
+		for (int j = 0; j < BATCH; j++) {
+			void *p = rist_sender_payload_alloc(ctx, PACKET_SIZE);
+			if (!p)
+				return 0;
+			memcpy(p, source, PACKET_SIZE);
+			owned[j].payload = p;
+			owned[j].flags = RIST_DATA_FLAGS_HAND_OVER;
+		}
+		if (rist_sender_data_writev(ctx, owned, BATCH) != BATCH * PACKET_SIZE)
+			return 0;
+	}
+	return timestampNTP_u64() - start;
+}
+
+int main(void)
+{
+	rist_clock_init();
+	struct rist_logging_settings *logging_settings = NULL;
+	if (rist_logging_set(&logging_settings, RIST_LOG_DISABLE, NULL, NULL, NULL, NULL) != 0)
+		return 99;
+	struct rist_ctx *ctx = NULL;
+	if (rist_sender_create(&ctx, RIST_PROFILE_MAIN, 0, logging_settings) != 0)
+		return 99;
+	const struct rist_peer_config *peer_config = NULL;
+	if (rist_parse_address2("rist://127.0.0.1:7310?buffer=100&rtt-max=10", (void *)&peer_config))
+		return 99;
+	struct rist_peer *peer;
+	if (rist_peer_create(ctx, &peer, peer_config) == -1)
+		return 99;
+	free((void *)peer_config);
+	if (rist_start(ctx) == -1)
+		return 99;
+
+	for (int ts = 0; ts < PACKET_SIZE; ts += 188)
+		source[ts] = 0x47;
+	struct rist_data_block blocks[BATCH];
+	memset(blocks, 0, sizeof(blocks));
+	for (int i = 0; i < BATCH; i++) {
+		blocks[i].payload = payload[i];
+		blocks[i].payload_len = PACKET_SIZE;
+	}
+
+	// Alternate the two in rounds the sender thread drains in between, the
+	// short buffer recycles packet memory as it would in steady state
+	uint64_t ticks[3] = { 0 };
+	bool failed = false;
+	for (int round = 0; round < ROUNDS && !failed; round++) {
+		uint64_t t;
+		if (round % 3 == 0)
+			t = run_single(ctx, blocks);
+		else if (round % 3 == 1)
+			t = run_batch(ctx, blocks);
+		else
+			t = run_zero_copy(ctx, blocks);
+		failed = t == 0;
+		if (round >= WARMUP_ROUNDS)
+			ticks[round % 3] += t;
+		sleep_ms(25);
+	}
+	rist_destroy(ctx);
+	rist_logging_settings_free2(&logging_settings);
+	if (failed) {
+		fprintf(stderr, "Write failed\n");
+		return 1;
+	}
+	const double packets = (double)ROUND_PACKETS * (ROUNDS - WARMUP_ROUNDS) / 3;
+	double single_ns = (double)ticks[0] * 1e9 / 4294967296.0 / packets;
+	double batch_ns = (double)ticks[1] * 1e9 / 4294967296.0 / packets;
+	double zero_copy_ns = (double)ticks[2] * 1e9 / 4294967296.0 / packets;
+	fprintf(stdout, "%-30s %7.2f ns/packet\n", "rist_sender_data_write", single_ns);
+	fprintf(stdout, "%-30s %7.2f ns/packet (%.1fx)\n", "rist_sender_data_writev x32", batch_ns, single_ns / batch_ns);
+	fprintf(stdout, "%-30s %7.2f ns/packet (%.1fx)\n", "writev x32, handed over pool", zero_copy_ns, single_ns / zero_copy_ns);
+	return 0;
+}
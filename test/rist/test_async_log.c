@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Logs through the asynchronous queue from several threads, then checks the
+ * per call site rate limit and the drop accounting of a full queue. */
+
+#include "librist/logging.h"
+#include "pthread-shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+#define PRODUCERS 4
+#define PER_PRODUCER 200
+
+static int errors = 0;
+static pthread_mutex_t lock;
+static unsigned delivered = 0;
+static unsigned suppressed_notes = 0;
+static unsigned slow_ms = 0;
+static bool main_thread_delivery = false;
+static pthread_t main_thread;
+static struct rist_logging_settings *settings = NULL;
+
+static int log_cb(void *arg, enum rist_log_level level, const char *msg)
+{
+	(void)arg;
+	(void)level;
+	pthread_mutex_lock(&lock);
+	if (strstr(msg, "were suppressed"))
+		suppressed_notes++;
+	else
+		delivered++;
+	if (pthread_equal(pthread_self(), main_thread))
+		main_thread_delivery = true;
+	unsigned ms = slow_ms;
+	pthread_mutex_unlock(&lock);
+	if (ms)
+		sleep_ms(ms);
+	return 0;
+}
+
+static unsigned take_delivered(void)
+{
+	pthread_mutex_lock(&lock);
+	unsigned count = delivered;
+	delivered = 0;
+	pthread_mutex_unlock(&lock);
+	return count;
+}
+
+static PTHREAD_START_FUNC(producer, arg)
+{
+	int id = *(int *)arg;
+	for (int i = 0; i < PER_PRODUCER; i++)
+		rist_log(settings, RIST_LOG_INFO, "producer %d message %d\n", id, i);
+	return 0;
+}
+
+int main(void)
+{
+	pthread_mutex_init(&lock, NULL);
+	main_thread = pthread_self();
+	if (rist_logging_set(&settings, RIST_LOG_INFO, log_cb, NULL, NULL, NULL) != 0)
+		return 99;
+
+	// Every message reaches the callback, from the background thread
+	if (rist_logging_set_async(4096, 0) != 0) {
+		fprintf(stderr, "Could not enable asynchronous logging\n");
+		return 1;
+	}
+	pthread_t threads[PRODUCERS];
+	int ids[PRODUCERS];
+	for (int i = 0; i < PRODUCERS; i++) {
+		ids[i] = i;
+		pthread_create(&threads[i], NULL, producer, &ids[i]);
+	}
+	for (int i = 0; i < PRODUCERS; i++)
+		pthread_join(threads[i], NULL);
+	rist_logging_set_async(0, 0);
+	unsigned count = take_delivered();
+	if (count != PRODUCERS * PER_PRODUCER || rist_logging_get_dropped() != 0 || main_thread_delivery) {
+		fprintf(stderr, "async: delivered %u dropped %llu main thread %d\n", count,
+				(unsigned long long)rist_logging_get_dropped(), main_thread_delivery);
+		errors++;
+	}
+
+	// A call site is held to its budget and the excess is reported later
+	rist_logging_set_async(0, 10);
+	for (int i = 0; i < 100; i++)
+		rist_log(settings, RIST_LOG_INFO, "storm %d\n", i);
+	count = take_delivered();
+	uint64_t dropped = rist_logging_get_dropped();
+	if (count != 10 || dropped != 90) {
+		fprintf(stderr, "rate limit: delivered %u dropped %llu\n", count, (unsigned long long)dropped);
+		errors++;
+	}
+	rist_log(settings, RIST_LOG_INFO, "other site\n");
+	sleep_ms(1100);
+	for (int i = 0; i < 2; i++)
+		rist_log(settings, RIST_LOG_INFO, "storm %d\n", i);
+	count = take_delivered();
+	if (count != 3 || suppressed_notes != 1) {
+		fprintf(stderr, "rate limit window: delivered %u notes %u\n", count, suppressed_notes);
+		errors++;
+	}
+
+	// A full queue drops instead of blocking, nothing is lost unaccounted
+	rist_logging_set_async(16, 0);
+	slow_ms = 2;
+	for (int i = 0; i < 200; i++)
+		rist_log(settings, RIST_LOG_INFO, "burst %d\n", i);
+	rist_logging_set_async(0, 0);
+	count = take_delivered();
+	uint64_t burst_dropped = rist_logging_get_dropped() - dropped;
+	if (burst_dropped == 0 || count + burst_dropped != 200) {
+		fprintf(stderr, "overflow: delivered %u dropped %llu\n", count, (unsigned long long)burst_dropped);
+		errors++;
+	}
+
+	rist_logging_unset_global();
+	rist_logging_settings_free2(&settings);
+	if (errors)
+		return 1;
+	fprintf(stdout, "OK\n");
+	return 0;
+}
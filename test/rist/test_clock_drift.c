@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Synthetic flows whose source clock drifts against ours, seen through a link
+ * with heavy one sided jitter: the estimate must find the drift rate and follow
+ * the least delayed packets. */
+
+#include "clock-drift.h"
+#include <stdio.h>
+
+#define MS (((uint64_t)1 << 32) / 1000)
+#define US_PER_TICK (1000.0 / (double)MS)
+#define PACKETS 30000
+#define BASE_DELAY (5 * MS)
+
+static uint32_t rng = 0x2545F491;
+
+static uint32_t next_random(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static int run(double drift_ppm)
+{
+	struct rist_clock_drift d;
+	rist_clock_drift_init(&d, 250 * MS);
+	const uint64_t start = 1000000 * MS;
+	const int64_t source_start = 123456789 * (int64_t)MS;
+	unsigned updates = 0;
+	uint64_t now = start;
+	int64_t queue = 0;
+	for (int i = 0; i < PACKETS; i++) {
+		now = start + (uint64_t)i * MS;
+		double elapsed = (double)(now - start);
+		// source clock behind ours by drift_ppm, delay of 5 ms plus a queue that
+		// wanders between empty and 20 ms with the occasional burst, plus up to
+		// 200 us of noise
+		int64_t source_time = source_start + (int64_t)(elapsed * (1.0 - drift_ppm / 1e6));
+		queue += ((int64_t)(next_random() % 1000) - 600) * (int64_t)MS / 1000;
+		if (next_random() % 500 == 0)
+			queue += 15 * MS;
+		if (queue < 0)
+			queue = 0;
+		if (queue > (int64_t)(20 * MS))
+			queue = 20 * MS;
+		uint64_t arrival = now + BASE_DELAY + (uint64_t)queue + next_random() % (MS / 5);
+		if (rist_clock_drift_add(&d, arrival, (int64_t)arrival - source_time))
+			updates++;
+	}
+	double elapsed = (double)(now - start);
+	int64_t expected = (int64_t)now - (source_start + (int64_t)(elapsed * (1.0 - drift_ppm / 1e6)));
+	double error_us = (double)(rist_clock_drift_offset(&d, now) - expected - (int64_t)BASE_DELAY) * US_PER_TICK;
+	double ppm = rist_clock_drift_ppm(&d);
+	fprintf(stdout, "drift %+.1f ppm: estimated %+.2f ppm, offset error %.1f us, %u updates\n", drift_ppm, ppm, error_us,
+			updates);
+	int errors = 0;
+	if (ppm < drift_ppm - 1.0 || ppm > drift_ppm + 1.0) {
+		fprintf(stderr, "Drift estimate off\n");
+		errors++;
+	}
+	if (error_us < -50.0 || error_us > 150.0) {
+		fprintf(stderr, "Offset does not follow the least delayed packets\n");
+		errors++;
+	}
+	if (updates != PACKETS / 250 - 1 && updates != PACKETS / 250) {
+		fprintf(stderr, "Expected an update per bucket\n");
+		errors++;
+	}
+
+	// a discontinuity starts over from the next sample
+	rist_clock_drift_reset(&d);
+	if (d.valid || rist_clock_drift_ppm(&d) != 0.0 || rist_clock_drift_add(&d, now, 42)) {
+		fprintf(stderr, "Reset kept state\n");
+		errors++;
+	}
+	return errors;
+}
+
+int main(void)
+{
+	int errors = 0;
+	errors += run(0.0);
+	errors += run(50.0);
+	errors += run(-80.0);
+	errors += run(300.0);
+	return errors ? 1 : 0;
+}
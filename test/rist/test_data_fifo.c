@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* One writer and several batch readers on a receiver output fifo: every block
+ * must come out exactly once, in order within each read, and drops must be
+ * counted when the readers fall behind. */
+
+#include "data-fifo.h"
+#include "librist/headers.h"
+#include "pthread-shim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define yield() Sleep(0)
+#else
+#include <sched.h>
+#define yield() sched_yield()
+#endif
+
+#define FIFO_SIZE 256
+#define BLOCKS 400000
+#define READERS 4
+#define BATCH 16
+
+static struct rist_data_fifo fifo;
+static struct rist_data_block *blocks;
+static unsigned char *seen;
+static atomic_bool done;
+static atomic_uint out_of_order;
+
+static PTHREAD_START_FUNC(reader, arg)
+{
+	(void)arg;
+	struct rist_data_block *batch[BATCH];
+	for (;;) {
+		bool finished = atomic_load_explicit(&done, memory_order_acquire);
+		size_t n = rist_data_fifo_pop(&fifo, batch, BATCH);
+		for (size_t i = 0; i < n; i++) {
+			seen[batch[i]->seq]++;
+			if (i && batch[i]->seq <= batch[i - 1]->seq)
+				atomic_fetch_add(&out_of_order, 1);
+		}
+		if (!n && finished)
+			break;
+		if (!n)
+			yield();
+	}
+	return 0;
+}
+
+int main(void)
+{
+	int errors = 0;
+	blocks = calloc(BLOCKS, sizeof(*blocks));
+	seen = calloc(BLOCKS, 1);
+	if (!blocks || !seen || rist_data_fifo_init(&fifo, FIFO_SIZE) != 0)
+		return 99;
+
+	// Single threaded: fills up, overflows, drains in order
+	for (uint32_t i = 0; i < FIFO_SIZE + 10; i++) {
+		blocks[i].seq = i;
+		bool pushed = rist_data_fifo_push(&fifo, &blocks[i]);
+		if (pushed != (i < FIFO_SIZE)) {
+			fprintf(stderr, "push %u: %d\n", i, pushed);
+			errors++;
+		}
+	}
+	if (rist_data_fifo_count(&fifo) != FIFO_SIZE || rist_data_fifo_overflow_take(&fifo) != 10 ||
+		rist_data_fifo_overflow_take(&fifo) != 0) {
+		fprintf(stderr, "count or overflow wrong when full\n");
+		errors++;
+	}
+	struct rist_data_block *batch[FIFO_SIZE];
+	size_t n = rist_data_fifo_pop(&fifo, batch, 100);
+	n += rist_data_fifo_pop(&fifo, &batch[n], FIFO_SIZE);
+	if (n != FIFO_SIZE || rist_data_fifo_pop(&fifo, batch, 1) != 0) {
+		fprintf(stderr, "drained %zu of %d\n", n, FIFO_SIZE);
+		errors++;
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (batch[i]->seq != i) {
+			fprintf(stderr, "block %zu out of order\n", i);
+			errors++;
+			break;
+		}
+	}
+
+	// Concurrent readers against a writer that retries when full
+	atomic_init(&done, false);
+	atomic_init(&out_of_order, 0);
+	pthread_t threads[READERS];
+	for (int i = 0; i < READERS; i++) {
+		if (pthread_create(&threads[i], NULL, reader, NULL))
+			return 99;
+	}
+	uint64_t full = 0;
+	for (uint32_t i = 0; i < BLOCKS; i++) {
+		blocks[i].seq = i;
+		while (!rist_data_fifo_push(&fifo, &blocks[i])) {
+			full++;
+			yield();
+		}
+	}
+	atomic_store_explicit(&done, true, memory_order_release);
+	for (int i = 0; i < READERS; i++)
+		pthread_join(threads[i], NULL);
+
+	unsigned missing = 0, repeated = 0;
+	for (uint32_t i = 0; i < BLOCKS; i++) {
+		if (seen[i] == 0)
+			missing++;
+		else if (seen[i] > 1)
+			repeated++;
+	}
+	if (missing || repeated || atomic_load(&out_of_order)) {
+		fprintf(stderr, "%u missing, %u repeated, %u out of order\n", missing, repeated, atomic_load(&out_of_order));
+		errors++;
+	}
+	if (rist_data_fifo_overflow_take(&fifo) != full) {
+		fprintf(stderr, "overflow count does not match failed pushes\n");
+		errors++;
+	}
+	fprintf(stdout, "%d blocks through %d readers, writer found the fifo full %llu times\n", BLOCKS, READERS,
+			(unsigned long long)full);
+
+	rist_data_fifo_free(&fifo);
+	free(seen);
+	free(blocks);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Periodic reauthentication must keep a peer authenticated whether or not it
+ * answers the session key rechallenge. Two pairs run side by side over
+ * loopback: one answers the rechallenge, the other drops it the way peers
+ * that predate it do, and has to be reauthenticated by the full exchange. */
+
+#include "rist-private.h"
+#include "udp-private.h"
+#include "eap.h"
+#include "clock.h"
+#include "librist/udpsocket.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define sleep_ms(ms) Sleep(ms)
+#else
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+// three reauth periods
+#define RUN_MS 11000
+
+static struct rist_common_ctx test_cctx;
+
+// eap.c only asks the common ctx for the profile and the logging settings
+struct rist_common_ctx *get_cctx(struct rist_peer *peer)
+{
+	(void)peer;
+	return &test_cctx;
+}
+
+struct pair {
+	const char *name;
+	bool drop_lw;
+	int sd_authenticator;
+	int sd_authenticatee;
+	struct rist_peer listener;
+	struct rist_peer authenticator;
+	struct rist_peer authenticatee;
+	bool authenticated;
+	bool lost;
+	uint32_t dropped;
+	struct eap_handshake_stats stats;
+};
+
+static int bind_loopback(struct sockaddr_in *addr)
+{
+	int sd = udpsocket_open_bind("127.0.0.1", 0, NULL);
+	if (sd < 0)
+		return -1;
+	socklen_t addrlen = sizeof(*addr);
+	if (getsockname(sd, (struct sockaddr *)addr, &addrlen) != 0)
+		return -1;
+	return sd;
+}
+
+static void set_remote(struct rist_peer *peer, int sd, const struct sockaddr_in *addr)
+{
+	peer->sd = sd;
+	peer->u.inaddr = *addr;
+	peer->address_len = sizeof(*addr);
+}
+
+static int pair_init(struct pair *p, const char *name, bool drop_lw)
+{
+	memset(p, 0, sizeof(*p));
+	p->name = name;
+	p->drop_lw = drop_lw;
+	struct sockaddr_in addr_authenticator, addr_authenticatee;
+	p->sd_authenticator = bind_loopback(&addr_authenticator);
+	p->sd_authenticatee = bind_loopback(&addr_authenticatee);
+	if (p->sd_authenticator < 0 || p->sd_authenticatee < 0)
+		return -1;
+	// the listening peer holds the credentials, the peer it spawns for the
+	// remote gets a clone that starts by requesting the identity
+	p->listener.listening = true;
+	set_remote(&p->listener, p->sd_authenticator, &addr_authenticatee);
+	set_remote(&p->authenticator, p->sd_authenticator, &addr_authenticatee);
+	set_remote(&p->authenticatee, p->sd_authenticatee, &addr_authenticator);
+	if (rist_enable_eap_srp(&p->listener, "user", "secretpass", NULL, NULL) != 0 ||
+		rist_enable_eap_srp(&p->authenticatee, "user", "secretpass", NULL, NULL) != 0 ||
+		eap_clone_ctx(p->listener.eap_ctx, &p->authenticator) != 0)
+		return -1;
+	return 0;
+}
+
+static bool is_lw_request(const uint8_t *pkt, int len)
+{
+	size_t offset = sizeof(struct eapol_hdr) + sizeof(struct eap_hdr);
+	if (len < (int)(offset + sizeof(struct eap_srp_hdr)))
+		return false;
+	const struct eapol_hdr *eapol = (const struct eapol_hdr *)pkt;
+	const struct eap_hdr *eap = (const struct eap_hdr *)&pkt[sizeof(*eapol)];
+	const struct eap_srp_hdr *srp = (const struct eap_srp_hdr *)&pkt[offset];
+	return eapol->eaptype == EAPOL_TYPE_EAP && eap->code == EAP_CODE_REQUEST &&
+		   srp->type == EAP_TYPE_SRP_SHA1 && srp->subtype == EAP_SRP_SUBTYPE_LWRECHALLENGE;
+}
+
+static void pair_pump(struct pair *p)
+{
+	uint8_t buf[1500];
+	int len;
+	size_t gre_size = sizeof(struct rist_gre_hdr);
+	eap_periodic(p->authenticator.eap_ctx);
+	eap_periodic(p->authenticatee.eap_ctx);
+	while ((len = udpsocket_recvfrom(p->sd_authenticator, buf, sizeof(buf), MSG_DONTWAIT, NULL, NULL)) > (int)gre_size)
+		eap_process_eapol(p->authenticator.eap_ctx, &buf[gre_size], len - gre_size);
+	while ((len = udpsocket_recvfrom(p->sd_authenticatee, buf, sizeof(buf), MSG_DONTWAIT, NULL, NULL)) > (int)gre_size)
+	{
+		if (p->drop_lw && is_lw_request(&buf[gre_size], len - (int)gre_size))
+		{
+			p->dropped++;
+			continue;
+		}
+		eap_process_eapol(p->authenticatee.eap_ctx, &buf[gre_size], len - gre_size);
+	}
+	bool authenticated = eap_is_authenticated(p->authenticator.eap_ctx) &&
+						 eap_is_authenticated(p->authenticatee.eap_ctx);
+	if (p->authenticated && !eap_is_authenticated(p->authenticator.eap_ctx))
+		p->lost = true;
+	p->authenticated |= authenticated;
+	struct eap_handshake_stats stats;
+	if (eap_get_handshake_stats(p->authenticator.eap_ctx, &stats))
+	{
+		p->stats.full_reauths += stats.full_reauths;
+		p->stats.lw_reauths += stats.lw_reauths;
+		p->stats.lw_failures += stats.lw_failures;
+	}
+}
+
+static int pair_check(struct pair *p, bool expect_lw)
+{
+	fprintf(stdout, "%s: authenticated %d lost %d full reauths %u rechallenges %u unanswered %u dropped %u\n",
+			p->name, p->authenticated, p->lost, p->stats.full_reauths, p->stats.lw_reauths,
+			p->stats.lw_failures, p->dropped);
+	int errors = 0;
+	if (!p->authenticated || p->lost) {
+		fprintf(stderr, "%s: authentication did not hold\n", p->name);
+		errors++;
+	}
+	if (expect_lw && p->stats.lw_reauths < 2) {
+		fprintf(stderr, "%s: reauthentication did not use the rechallenge\n", p->name);
+		errors++;
+	}
+	// one unanswered rechallenge marks the peer, every later reauth is full
+	if (!expect_lw && (p->stats.lw_reauths != 0 || p->stats.full_reauths < 2 || p->dropped != 1)) {
+		fprintf(stderr, "%s: expected full reauthentications after one unanswered rechallenge\n", p->name);
+		errors++;
+	}
+	return errors;
+}
+
+static void pair_close(struct pair *p)
+{
+	eap_delete_ctx(&p->authenticator.eap_ctx);
+	eap_delete_ctx(&p->authenticatee.eap_ctx);
+	eap_delete_ctx(&p->listener.eap_ctx);
+	udpsocket_close(p->sd_authenticator);
+	udpsocket_close(p->sd_authenticatee);
+}
+
+int main(void)
+{
+	rist_clock_init();
+	test_cctx.profile = RIST_PROFILE_MAIN;
+	struct pair current, old;
+	if (pair_init(&current, "answering peer", false) != 0 || pair_init(&old, "silent peer", true) != 0)
+		return 99;
+	uint64_t end = timestampNTP_u64() + (uint64_t)RUN_MS * RIST_CLOCK;
+	while (timestampNTP_u64() < end)
+	{
+		pair_pump(&current);
+		pair_pump(&old);
+		sleep_ms(1);
+	}
+	int errors = pair_check(&current, true) + pair_check(&old, false);
+	pair_close(&current);
+	pair_close(&old);
+	return errors ? 1 : 0;
+}
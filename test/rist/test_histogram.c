@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Checks the latency histogram bucketing and percentiles against exact values. */
+
+#include "histogram.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int errors = 0;
+
+static struct rist_histogram hist;
+
+/* Reported value must not be below the real one and at most 1/16th above */
+static void expect_close(const char *name, uint64_t got, uint64_t exact)
+{
+	if (got < exact || got > exact + exact / RIST_HISTOGRAM_SUB_COUNT) {
+		fprintf(stderr, "%s: got %llu, expected %llu\n", name, (unsigned long long)got, (unsigned long long)exact);
+		errors++;
+	}
+}
+
+int main(void)
+{
+	// Every value must land in a bucket whose range contains it
+	for (uint64_t v = 0; v < (1ULL << 20); v++) {
+		unsigned idx = rist_histogram_index(v);
+		if (rist_histogram_bucket_value(idx) < v || (idx > 0 && rist_histogram_bucket_value(idx - 1) >= v)) {
+			fprintf(stderr, "value %llu in wrong bucket %u\n", (unsigned long long)v, idx);
+			errors++;
+			break;
+		}
+	}
+	if (rist_histogram_index(UINT64_MAX) != RIST_HISTOGRAM_BUCKETS - 1) {
+		fprintf(stderr, "large values do not saturate into the last bucket\n");
+		errors++;
+	}
+
+	struct rist_stats_percentiles p;
+	for (uint64_t v = 1; v <= 100000; v++)
+		rist_histogram_record(&hist, v);
+	rist_histogram_take(&hist, &p);
+	if (p.count != 100000) {
+		fprintf(stderr, "count %llu\n", (unsigned long long)p.count);
+		errors++;
+	}
+	expect_close("p50", p.p50, 50000);
+	expect_close("p90", p.p90, 90000);
+	expect_close("p99", p.p99, 99000);
+	expect_close("p99.9", p.p999, 99900);
+	expect_close("max", p.max, 100000);
+
+	// Tail of a few slow samples among many fast ones
+	for (int i = 0; i < 990; i++)
+		rist_histogram_record(&hist, 10);
+	for (int i = 0; i < 10; i++)
+		rist_histogram_record(&hist, 250000);
+	rist_histogram_take(&hist, &p);
+	expect_close("tail p50", p.p50, 10);
+	expect_close("tail p99", p.p99, 10);
+	expect_close("tail p99.9", p.p999, 250000);
+
+	// take() clears
+	rist_histogram_take(&hist, &p);
+	if (p.count != 0 || p.p50 != 0 || p.max != 0) {
+		fprintf(stderr, "histogram not cleared\n");
+		errors++;
+	}
+	if (errors)
+		return 1;
+	fprintf(stdout, "OK\n");
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Adaptive receiver buffer: grows on deadline misses, shrinks after clean
+ * stretches toward what recoveries took and moves the applied buffer slowly. */
+
+#include "latency-control.h"
+#include <stdio.h>
+
+#define MS (((uint64_t)1 << 32) / 1000)
+#define SECOND (1000 * MS)
+
+static int errors = 0;
+
+static void expect_ms(const char *what, uint64_t value, uint64_t expected_ms)
+{
+	if (value / MS != expected_ms) {
+		fprintf(stderr, "%s: %llu ms, expected %llu ms\n", what, (unsigned long long)(value / MS),
+				(unsigned long long)expected_ms);
+		errors++;
+	}
+}
+
+/* Runs the once per second checks of a stretch of seconds */
+static uint64_t run_checks(struct rist_latency_control *lc, uint64_t now, int seconds, uint32_t misses, uint64_t rtt)
+{
+	for (int i = 0; i < seconds; i++) {
+		now += SECOND;
+		rist_latency_control_check(lc, misses, rtt, now);
+	}
+	return now;
+}
+
+static void test_target(void)
+{
+	struct rist_latency_control lc;
+	uint64_t now = 1000 * SECOND;
+	rist_latency_control_init(&lc, MS, 100 * MS, 2000 * MS, 5000 * MS, now);
+	expect_ms("start clamped", lc.target, 2000);
+	rist_latency_control_init(&lc, MS, 100 * MS, 2000 * MS, 200 * MS, now);
+	expect_ms("start", lc.applied, 200);
+
+	// nothing happens before the interval is over
+	if (rist_latency_control_check(&lc, 5, 0, now + SECOND / 2)) {
+		fprintf(stderr, "checked before the interval\n");
+		errors++;
+	}
+
+	// misses grow by at least 50 ms, then by a quarter, up to the max
+	now = run_checks(&lc, now, 1, 3, 0);
+	expect_ms("first growth", lc.target, 250);
+	now = run_checks(&lc, now, 1, 1, 0);
+	expect_ms("second growth", lc.target, 312);
+	now = run_checks(&lc, now, 20, 1, 0);
+	expect_ms("growth capped", lc.target, 2000);
+
+	// 9 clean seconds change nothing, the 10th takes a tenth off
+	now = run_checks(&lc, now, RIST_LATENCY_CLEAN_CHECKS - 1, 0, 0);
+	expect_ms("before shrink", lc.target, 2000);
+	now = run_checks(&lc, now, 1, 0, 0);
+	expect_ms("first shrink", lc.target, 1800);
+
+	// a miss restarts the clean stretch
+	now = run_checks(&lc, now, RIST_LATENCY_CLEAN_CHECKS - 1, 0, 0);
+	now = run_checks(&lc, now, 1, 1, 0);
+	expect_ms("grown again", lc.target, 2000);
+	now = run_checks(&lc, now, RIST_LATENCY_CLEAN_CHECKS - 1, 0, 0);
+	expect_ms("clean stretch restarted", lc.target, 2000);
+
+	// shrinking stops at 1.5 times the slowest recovery plus two rtt
+	rist_latency_control_recovered(&lc, 400 * MS);
+	rist_latency_control_recovered(&lc, 200 * MS);
+	now = run_checks(&lc, now, 1, 0, 0);
+	expect_ms("shrink with recoveries", lc.target, 1800);
+	for (int i = 0; i < 40; i++) {
+		rist_latency_control_recovered(&lc, 400 * MS);
+		now = run_checks(&lc, now, RIST_LATENCY_CLEAN_CHECKS, 0, 100 * MS);
+	}
+	expect_ms("shrink floor", lc.target, 800);
+
+	// and at the min once recoveries are quick
+	for (int i = 0; i < 40; i++)
+		now = run_checks(&lc, now, RIST_LATENCY_CLEAN_CHECKS, 0, 10 * MS);
+	expect_ms("min floor", lc.target, 100);
+
+	// a peer with wider bounds lets it grow further
+	rist_latency_control_bounds(&lc, 50 * MS, 3000 * MS);
+	now = run_checks(&lc, now, 40, 1, 0);
+	expect_ms("widened bounds", lc.target, 3000);
+	expect_ms("min kept", lc.min, 100);
+}
+
+static void test_slew(void)
+{
+	struct rist_latency_control lc;
+	uint64_t now = 1000 * SECOND;
+	rist_latency_control_init(&lc, MS, 100 * MS, 2000 * MS, 1000 * MS, now);
+	lc.target = 1500 * MS;
+
+	// per packet calls at 0.1 ms add up like one call per second
+	uint64_t start = now;
+	uint64_t last = lc.applied;
+	for (int i = 0; i < 10000; i++) {
+		now += MS / 10;
+		uint64_t applied = rist_latency_control_slew(&lc, now);
+		if (applied < last || applied - last > MS) {
+			fprintf(stderr, "slew step of %llu ticks\n", (unsigned long long)(applied - last));
+			errors++;
+			break;
+		}
+		last = applied;
+	}
+	now = start + SECOND;
+	expect_ms("slewed up one second", rist_latency_control_slew(&lc, now), 1020);
+	now += 100 * SECOND;
+	expect_ms("reached target", rist_latency_control_slew(&lc, now), 1500);
+
+	lc.target = 1400 * MS;
+	now += SECOND;
+	expect_ms("slewed down", rist_latency_control_slew(&lc, now), 1480);
+	now += 10 * SECOND;
+	expect_ms("no overshoot", rist_latency_control_slew(&lc, now), 1400);
+	// time going back is ignored
+	expect_ms("clock step back", rist_latency_control_slew(&lc, now - SECOND), 1400);
+
+	// a fast start begins below the target and converges from there
+	rist_latency_control_rebase(&lc, 100 * MS, now);
+	now += 10 * SECOND;
+	expect_ms("rebased", rist_latency_control_slew(&lc, now), 300);
+}
+
+int main(void)
+{
+	test_target();
+	test_slew();
+	return errors ? 1 : 0;
+}
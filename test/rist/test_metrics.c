@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Folds stats reports into metrics registries and checks the OpenMetrics text. */
+
+#include "metrics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int errors = 0;
+
+static void expect_line(const char *text, const char *line)
+{
+	const char *pos = strstr(text, line);
+	size_t len = strlen(line);
+	if (!pos || (pos != text && pos[-1] != '\n') || pos[len] != '\n') {
+		fprintf(stderr, "missing line: %s\n", line);
+		errors++;
+	}
+}
+
+static void expect_absent(const char *text, const char *needle)
+{
+	if (strstr(text, needle)) {
+		fprintf(stderr, "unexpected: %s\n", needle);
+		errors++;
+	}
+}
+
+static void receiver_report(struct rist_metrics *metrics, uint32_t flow_id, uint64_t received, uint32_t lost)
+{
+	struct rist_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.stats_type = RIST_STATS_RECEIVER_FLOW;
+	stats.stats.receiver_flow.flow_id = flow_id;
+	stats.stats.receiver_flow.received = received;
+	stats.stats.receiver_flow.lost = lost;
+	stats.stats.receiver_flow.bandwidth = 1000 * received;
+	stats.stats.receiver_flow.quality = 99.5;
+	stats.stats.receiver_flow.buffer_delay.count = received;
+	stats.stats.receiver_flow.buffer_delay.p50 = 1000;
+	stats.stats.receiver_flow.buffer_delay.p999 = 250000;
+	rist_metrics_update(metrics, &stats);
+}
+
+static char *render(struct rist_metrics **metrics, size_t count)
+{
+	size_t len = rist_metrics_write(metrics, count, NULL, 0);
+	char *text = malloc(len + 1);
+	if (!text)
+		exit(99);
+	if (rist_metrics_write(metrics, count, text, len + 1) != len || strlen(text) != len) {
+		fprintf(stderr, "length mismatch\n");
+		errors++;
+	}
+	return text;
+}
+
+int main(void)
+{
+	struct rist_metrics receiver;
+	struct rist_metrics sender;
+	rist_metrics_init(&receiver);
+	rist_metrics_init(&sender);
+	struct rist_metrics *one[] = { &receiver };
+
+	char *text = render(one, 1);
+	if (strcmp(text, "# EOF\n") != 0) {
+		fprintf(stderr, "empty registry rendered %s\n", text);
+		errors++;
+	}
+	free(text);
+
+	// Counters accumulate the per interval counts, gauges keep the latest report
+	receiver_report(&receiver, 7, 100, 1);
+	receiver_report(&receiver, 7, 50, 2);
+	receiver_report(&receiver, 9, 10, 0);
+	text = render(one, 1);
+	expect_line(text, "# TYPE rist_receiver_received_packets counter");
+	expect_line(text, "rist_receiver_received_packets_total{flow_id=\"7\"} 150");
+	expect_line(text, "rist_receiver_lost_packets_total{flow_id=\"7\"} 3");
+	expect_line(text, "rist_receiver_received_packets_total{flow_id=\"9\"} 10");
+	expect_line(text, "rist_receiver_bandwidth{flow_id=\"7\"} 50000");
+	expect_line(text, "rist_receiver_quality{flow_id=\"7\"} 99.5");
+	expect_line(text, "rist_receiver_buffer_delay_seconds{flow_id=\"7\",quantile=\"0.5\"} 0.001000");
+	expect_line(text, "rist_receiver_buffer_delay_seconds{flow_id=\"7\",quantile=\"0.999\"} 0.250000");
+	expect_line(text, "rist_receiver_buffer_delay_seconds_count{flow_id=\"7\"} 150");
+	expect_absent(text, "rist_sender_");
+	if (strlen(text) < 6 || strcmp(text + strlen(text) - 6, "# EOF\n") != 0) {
+		fprintf(stderr, "missing # EOF terminator\n");
+		errors++;
+	}
+
+	// Truncated output keeps the snprintf contract
+	char small[16];
+	size_t full = rist_metrics_write(one, 1, small, sizeof(small));
+	if (full != strlen(text) || strlen(small) != sizeof(small) - 1) {
+		fprintf(stderr, "truncation: full %zu, wrote %zu\n", full, strlen(small));
+		errors++;
+	}
+	free(text);
+
+	rist_metrics_forget(&receiver, RIST_STATS_RECEIVER_FLOW, 9);
+	text = render(one, 1);
+	expect_absent(text, "flow_id=\"9\"");
+	free(text);
+
+	// Label values escape quotes and backslashes
+	struct rist_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.stats_type = RIST_STATS_SENDER_PEER;
+	stats.stats.sender_peer.peer_id = 3;
+	stats.stats.sender_peer.sent = 42;
+	strcpy(stats.stats.sender_peer.cname, "a\"b\\c");
+	rist_metrics_update(&sender, &stats);
+
+	// Several registries share one family block and gain a context label
+	struct rist_metrics *two[] = { &receiver, &sender };
+	text = render(two, 2);
+	expect_line(text, "rist_sender_sent_packets_total{context=\"1\",peer_id=\"3\",cname=\"a\\\"b\\\\c\"} 42");
+	expect_line(text, "rist_receiver_received_packets_total{context=\"0\",flow_id=\"7\"} 150");
+	const char *first = strstr(text, "# TYPE rist_receiver_received_packets ");
+	if (!first || strstr(first + 1, "# TYPE rist_receiver_received_packets "))
+		errors++;
+	free(text);
+
+	rist_metrics_destroy(&receiver);
+	rist_metrics_destroy(&sender);
+	if (errors)
+		return 1;
+	fprintf(stdout, "OK\n");
+	return 0;
+}
@@ -7,6 +7,9 @@
 
 #include "librist/librist.h"
 #include "rist-private.h"
+#if HAVE_MBEDTLS
+#include "librist/librist_srp.h"
+#endif
 #include <stdatomic.h>
 
 #ifdef _WIN32
@@ -20,8 +23,38 @@ struct rist_logging_settings *logging_settings_sender = NULL;
 struct rist_logging_settings *logging_settings_receiver = NULL;
 char* senderstring = "sender";
 char* receiverstring = "receiver";
+/* hand pool buffers over to the sender instead of having them copied */
+bool zero_copy = false;
+/* take receiver arrival times from kernel timestamps */
+bool receive_timestamps = false;
+/* send MPEG-TS with PCRs and pace the receiver output on them */
+bool pcr_pacing = false;
+atomic_ulong pcr_jitter_samples;
+/* p99 of the output deviation: the 2 ms jitter bound of the pacer plus slack
+ * for thread scheduling, which a loaded machine misses in a few intervals */
+#define PCR_JITTER_P99_MAX_US 5000
+atomic_ulong pcr_jitter_intervals;
+atomic_ulong pcr_jitter_intervals_over;
+/* let the receiver buffer follow the network between buffer-min and buffer-max */
+bool adaptive_latency = false;
+atomic_ulong latency_reports;
+/* join a running sender, which bursts its history for an early output */
+bool fast_start = false;
+/* peers authenticate with SRP, the sender may only burst to an authenticated one */
+bool srp_enabled = false;
+atomic_ulong srp_sender_authenticated;
+/* the test string follows the TS header of the first packet */
+size_t payload_offset = 0;
 
 int log_callback(void *arg, int level, const char *msg) {
+    if (srp_enabled && arg == senderstring) {
+        if (strstr(msg, "[EAP-SRP] Successfully authenticated"))
+            atomic_store(&srp_sender_authenticated, 1);
+        if (strstr(msg, "Fast start for peer") && strstr(msg, "bursting") && !atomic_load(&srp_sender_authenticated)) {
+            fprintf(stderr, "Fast start burst began before the peer authenticated\n");
+            atomic_store(&failed, 1);
+        }
+    }
     if (level > RIST_LOG_ERROR)
         fprintf(stdout, "[%s] %s",(char*)arg, msg);
     if (level <= RIST_LOG_ERROR) {
@@ -38,12 +71,89 @@ int log_callback(void *arg, int level, const char *msg) {
     return 0;
 }
 
+static int pcr_jitter_stats(void *arg, const struct rist_stats *stats) {
+    (void)arg;
+    if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+        const struct rist_stats_percentiles *p = &stats->stats.receiver_flow.pcr_jitter;
+        if (p->count) {
+            fprintf(stdout, "PCR jitter: %" PRIu64 " samples, p99 %" PRIu64 " us, max %" PRIu64 " us\n", p->count, p->p99, p->max);
+            atomic_fetch_add(&pcr_jitter_intervals, 1);
+            if (p->p99 > PCR_JITTER_P99_MAX_US)
+                atomic_fetch_add(&pcr_jitter_intervals_over, 1);
+        }
+        atomic_fetch_add(&pcr_jitter_samples, (unsigned long)p->count);
+    }
+    rist_stats_free(stats);
+    return 0;
+}
+
+static int latency_stats(void *arg, const struct rist_stats *stats) {
+    (void)arg;
+    if (stats->stats_type == RIST_STATS_RECEIVER_FLOW) {
+        uint32_t latency = stats->stats.receiver_flow.latency;
+        uint32_t target = stats->stats.receiver_flow.latency_target;
+        fprintf(stdout, "Latency: %" PRIu32 " ms, target %" PRIu32 " ms\n", latency, target);
+        // within the buffer-min and buffer-max of the test urls
+        if (latency >= 100 && latency <= 1000 && target >= 100 && target <= 1000)
+            atomic_fetch_add(&latency_reports, 1);
+    }
+    rist_stats_free(stats);
+    return 0;
+}
+
+/* TS packet with pid 0x100 carrying a PCR of the sender clock */
+static void pcr_packet(uint8_t *p) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t pcr = ((uint64_t)ts.tv_sec * 27000000 + (uint64_t)ts.tv_nsec * 27 / 1000) % ((1ULL << 33) * 300);
+    uint64_t base = pcr / 300;
+    uint64_t ext = pcr % 300;
+    memset(p, 0xff, 188);
+    p[0] = 0x47;
+    p[1] = 0x01;
+    p[2] = 0x00;
+    p[3] = 0x30;
+    p[4] = 7;
+    p[5] = 0x10;
+    p[6] = (uint8_t)(base >> 25);
+    p[7] = (uint8_t)(base >> 17);
+    p[8] = (uint8_t)(base >> 9);
+    p[9] = (uint8_t)(base >> 1);
+    p[10] = (uint8_t)(((base & 1) << 7) | 0x7e | (ext >> 8));
+    p[11] = (uint8_t)ext;
+}
+
 struct rist_ctx *setup_rist_receiver(int profile, const char *url) {
     struct rist_ctx *ctx;
 	if (rist_receiver_create(&ctx, profile, logging_settings_receiver) != 0) {
 		rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not create rist receiver context\n");
 		return NULL;
 	}
+    if (receive_timestamps) {
+        int mode = UDPSOCKET_TIMESTAMP_SOFTWARE;
+        if (rist_set_opt(ctx, RIST_OPT_RECEIVE_TIMESTAMPS, &mode, NULL, NULL) != 0) {
+            rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not enable receive timestamps\n");
+            return NULL;
+        }
+    }
+    if (pcr_pacing) {
+        if (rist_receiver_output_pacing_set(ctx, RIST_OUTPUT_PACING_MPEGTS_PCR, 0) != 0 ||
+            rist_stats_callback_set(ctx, 1000, pcr_jitter_stats, NULL) != 0) {
+            rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not enable PCR output pacing\n");
+            return NULL;
+        }
+    }
+    if (adaptive_latency) {
+        if (rist_receiver_latency_mode_set(ctx, RIST_LATENCY_ADAPTIVE) != 0 ||
+            rist_stats_callback_set(ctx, 1000, latency_stats, NULL) != 0) {
+            rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not enable adaptive latency\n");
+            return NULL;
+        }
+    }
+    if (fast_start && rist_receiver_fast_start_set(ctx, 200) != 0) {
+        rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not enable fast start\n");
+        return NULL;
+    }
     // Rely on the library to parse the url
     struct rist_peer_config *peer_config = NULL;
     if (rist_parse_address2(url, (void *)&peer_config))
@@ -56,6 +166,15 @@ struct rist_ctx *setup_rist_receiver(int profile, const char *url) {
 		rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not add peer connector to receiver\n");
 		return NULL;
 	}
+#if HAVE_MBEDTLS
+    if (strlen(peer_config->srp_username) > 0 && strlen(peer_config->srp_password) > 0) {
+        if (rist_enable_eap_srp(peer, peer_config->srp_username, peer_config->srp_password, NULL, NULL) != 0) {
+            rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not enable SRP authentication for receiver\n");
+            return NULL;
+        }
+        srp_enabled = true;
+    }
+#endif
     free((void *)peer_config);
 	if (rist_start(ctx) == -1) {
 		rist_log(logging_settings_receiver, RIST_LOG_ERROR, "Could not start rist sender\n");
@@ -71,6 +190,10 @@ struct rist_ctx *setup_rist_sender(int profile, const char *url) {
 		rist_log(logging_settings_sender, RIST_LOG_ERROR, "Could not create rist sender context\n");
 		return NULL;
 	}
+    if (fast_start && rist_sender_fast_start_set(ctx, 500) != 0) {
+		rist_log(logging_settings_sender, RIST_LOG_ERROR, "Could not enable fast start bursts\n");
+		return NULL;
+    }
 
     const struct rist_peer_config *peer_config_link = NULL;
     if (rist_parse_address2(url, (void *)&peer_config_link))
@@ -84,6 +207,15 @@ struct rist_ctx *setup_rist_sender(int profile, const char *url) {
 		rist_log(logging_settings_sender, RIST_LOG_ERROR, "Could not add peer connector to sender\n");
 		return NULL;
 	}
+#if HAVE_MBEDTLS
+    if (strlen(peer_config_link->srp_username) > 0 && strlen(peer_config_link->srp_password) > 0) {
+        if (rist_enable_eap_srp(peer, peer_config_link->srp_username, peer_config_link->srp_password, NULL, NULL) != 0) {
+            rist_log(logging_settings_sender, RIST_LOG_ERROR, "Could not enable SRP authentication for sender\n");
+            return NULL;
+        }
+        srp_enabled = true;
+    }
+#endif
 	free((void *)peer_config_link);
 	if (rist_start(ctx) == -1) {
 		rist_log(logging_settings_sender, RIST_LOG_ERROR, "Could not start rist sender\n");
@@ -101,9 +233,36 @@ static PTHREAD_START_FUNC(send_data, arg) {
     while (send_counter < 16000) {
         if (atomic_load(&stop))
             break;
-        sprintf(buffer, "DEADBEAF TEST PACKET #%i", send_counter);
+        if (pcr_pacing) {
+            memset(buffer, 0xff, sizeof(buffer));
+            // null packets behind one on pid 0x101 carrying the test string
+            for (size_t i = 0; i < sizeof(buffer); i += 188) {
+                buffer[i] = 0x47;
+                buffer[i + 1] = 0x1f;
+                buffer[i + 2] = (char)0xff;
+                buffer[i + 3] = 0x10;
+            }
+            buffer[1] = 0x01;
+            buffer[2] = 0x01;
+            // a PCR every 20 ms
+            if (send_counter % 40 == 0)
+                pcr_packet((uint8_t *)&buffer[188]);
+        }
+        sprintf(&buffer[payload_offset], "DEADBEAF TEST PACKET #%i", send_counter);
         data.payload = &buffer;
         data.payload_len = 1316;
+        if (zero_copy) {
+            void *payload = rist_sender_payload_alloc(rist_sender, sizeof(buffer));
+            if (!payload) {
+                fprintf(stderr, "Failed to allocate a sender payload!\n");
+                atomic_store(&failed, 1);
+                atomic_store(&stop, 1);
+                break;
+            }
+            memcpy(payload, buffer, sizeof(buffer));
+            data.payload = payload;
+            data.flags = RIST_DATA_FLAGS_HAND_OVER;
+        }
         int ret = rist_sender_data_write(rist_sender, &data);
         if (ret < 0) {
             fprintf(stderr, "Failed to send test packet with error code %d!\n", ret);
@@ -136,9 +295,16 @@ static PTHREAD_START_FUNC(send_data, arg) {
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 5) {
+    if (argc != 5 && argc != 6) {
         return 99;
     }
+    zero_copy = argc == 6 && strcmp(argv[5], "zerocopy") == 0;
+    receive_timestamps = argc == 6 && strcmp(argv[5], "timestamps") == 0;
+    pcr_pacing = argc == 6 && strcmp(argv[5], "pcrpacing") == 0;
+    adaptive_latency = argc == 6 && strcmp(argv[5], "adaptive") == 0;
+    fast_start = argc == 6 && strcmp(argv[5], "faststart") == 0;
+    if (pcr_pacing)
+        payload_offset = 4;
     int profile = atoi(argv[1]);
     char *url1 = strdup(argv[2]);
     char *url2 = strdup(argv[3]);
@@ -150,6 +316,11 @@ int main(int argc, char *argv[]) {
 
     atomic_init(&failed, 0);
     atomic_init(&stop, 0);
+    atomic_init(&pcr_jitter_samples, 0);
+    atomic_init(&pcr_jitter_intervals, 0);
+    atomic_init(&pcr_jitter_intervals_over, 0);
+    atomic_init(&latency_reports, 0);
+    atomic_init(&srp_sender_authenticated, 0);
 
 
     fprintf(stdout, "Testing profile %i with receiver url %s and sender url %s and losspercentage: %i\n", profile, url1, url2, losspercent);
@@ -166,16 +337,16 @@ int main(int argc, char *argv[]) {
 		ret = 99;
 		goto out;
 	}
-	receiver_ctx = setup_rist_receiver(profile, url1);
+	// a fast starting receiver joins a second into the stream
+	if (!fast_start)
+		receiver_ctx = setup_rist_receiver(profile, url1);
     sender_ctx = setup_rist_sender(profile, url2);
-	if (!sender_ctx || !receiver_ctx) {
+	if (!sender_ctx || (!fast_start && !receiver_ctx)) {
 		ret = 99;
 		goto out;
 	}
 
     if (losspercent > 0) {
-        receiver_ctx->receiver_ctx->simulate_loss = true;
-        receiver_ctx->receiver_ctx->loss_percentage = losspercent;
         sender_ctx->sender_ctx->simulate_loss = true;
         sender_ctx->sender_ctx->loss_percentage = losspercent;
     }
@@ -186,6 +357,26 @@ int main(int argc, char *argv[]) {
 		ret = 99;
 		goto out;
 	}
+    struct timespec joined;
+    if (fast_start) {
+#ifdef _WIN32
+        Sleep(1000);
+#else
+        sleep(1);
+#endif
+        receiver_ctx = setup_rist_receiver(profile, url1);
+        if (!receiver_ctx) {
+            atomic_store(&stop, 1);
+            pthread_join(send_loop, NULL);
+            ret = 99;
+            goto out;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &joined);
+    if (losspercent > 0) {
+        receiver_ctx->receiver_ctx->simulate_loss = true;
+        receiver_ctx->receiver_ctx->loss_percentage = losspercent;
+    }
 
     struct rist_data_block *b = NULL;
     char rcompare[1316];
@@ -199,11 +390,21 @@ int main(int argc, char *argv[]) {
             if (!got_first) {
                 receive_count = (int)b->seq;
 				got_first = true;
+				struct timespec first;
+				clock_gettime(CLOCK_MONOTONIC, &first);
+				long wait_ms = (first.tv_sec - joined.tv_sec) * 1000 + (first.tv_nsec - joined.tv_nsec) / 1000000;
+				fprintf(stdout, "First packet #%i after %ld ms\n", receive_count, wait_ms);
+				// well before the 1000 ms buffer of a receiver waiting for it to fill
+				if (fast_start && wait_ms > 500) {
+					fprintf(stderr, "Fast start output only began after %ld ms\n", wait_ms);
+					atomic_store(&failed, 1);
+				}
 			}
             sprintf(rcompare, "DEADBEAF TEST PACKET #%i", receive_count);
-            if (strcmp(rcompare, b->payload)) {
+            const char *payload = (const char *)b->payload + payload_offset;
+            if (strcmp(rcompare, payload)) {
                 fprintf(stderr, "Packet contents not as expected!\n");
-                fprintf(stderr, "Got : %s\n", (char*)b->payload);
+                fprintf(stderr, "Got : %s\n", payload);
                 fprintf(stderr, "Expected : %s\n", (char*)rcompare);
                 atomic_store(&failed, 1);
                 atomic_store(&stop, 1);
@@ -215,6 +416,19 @@ int main(int argc, char *argv[]) {
     }
 	if (!got_first || receive_count < 12500)
 		atomic_store(&failed, 1);
+	if (pcr_pacing && atomic_load(&pcr_jitter_samples) == 0) {
+		fprintf(stderr, "No PCR jitter reported with PCR output pacing\n");
+		atomic_store(&failed, 1);
+	}
+	if (pcr_pacing && atomic_load(&pcr_jitter_intervals_over) * 4 > atomic_load(&pcr_jitter_intervals)) {
+		fprintf(stderr, "PCR jitter p99 above %d us in %lu of %lu intervals\n", PCR_JITTER_P99_MAX_US,
+				atomic_load(&pcr_jitter_intervals_over), atomic_load(&pcr_jitter_intervals));
+		atomic_store(&failed, 1);
+	}
+	if (adaptive_latency && atomic_load(&latency_reports) == 0) {
+		fprintf(stderr, "No adaptive latency within the url bounds reported\n");
+		atomic_store(&failed, 1);
+	}
 	if (atomic_load(&failed))
 		ret = 1;
 	pthread_join(send_loop, NULL);
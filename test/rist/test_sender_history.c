@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Growing the retransmission history must keep every packet still queued
+ * resolvable, including the one on slot 0 while most slots were never used. */
+
+#include "rist-private.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SENT 1000
+#define CLEANED 100
+
+int main(void)
+{
+	int errors = 0;
+	struct rist_buffer **queue = calloc(RIST_SERVER_QUEUE_BUFFERS, sizeof(*queue));
+	struct rist_buffer *pool = calloc(SENT, sizeof(*pool));
+	struct rist_sender_history history;
+	if (!queue || !pool || rist_sender_history_init(&history, UINT16_SIZE) != 0)
+		return 99;
+	// the sender queue starts writing at index 1
+	for (size_t n = 0; n < SENT; n++) {
+		struct rist_buffer *b = &pool[n];
+		b->seq_rtp = (uint16_t)n;
+		queue[n + 1] = b;
+		rist_sender_history_add(&history, b, n + 1);
+	}
+	// cleaned up past the buffer, their slots go stale
+	for (size_t n = 0; n < CLEANED; n++)
+		queue[n + 1] = NULL;
+	// the first packets are still queued in a later buffer
+	queue[1] = &pool[0];
+
+	if (rist_sender_history_resize(&history, queue, 4 * UINT16_SIZE) != 0)
+		return 99;
+	if (history.mask != 4 * UINT16_SIZE - 1) {
+		fprintf(stderr, "history not grown\n");
+		errors++;
+	}
+	for (uint32_t seq = 0; seq < SENT; seq++) {
+		size_t idx;
+		struct rist_buffer *b = rist_sender_history_get(&history, queue, seq, &idx);
+		bool queued = seq == 0 || seq >= CLEANED;
+		if (queued && (b != &pool[seq] || idx != seq + 1)) {
+			fprintf(stderr, "seq %u lost by the resize\n", seq);
+			errors++;
+		} else if (!queued && b) {
+			fprintf(stderr, "seq %u resolved after cleanup\n", seq);
+			errors++;
+		}
+	}
+	rist_sender_history_free(&history);
+	free(pool);
+	free(queue);
+	return errors ? 1 : 0;
+}
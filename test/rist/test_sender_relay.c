@@ -0,0 +1,226 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Relays received blocks into a second sender the way ristsender does: the
+ * block is written as the receiver returned it, flags included, and freed
+ * right after. None of the receiver flags may make the sender take over the
+ * payload. Also checks that only payloads of the writing sender are handed
+ * over and anything else is copied. */
+
+#include "librist/librist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+#define PACKET_SIZE 1316
+#define PACKETS 500
+#define RECEIVER_FLAGS (RIST_DATA_FLAGS_DISCONTINUITY | RIST_DATA_FLAGS_FLOW_BUFFER_START | RIST_DATA_FLAGS_OVERFLOW)
+
+static int log_errors = 0;
+
+static int log_cb(void *arg, enum rist_log_level level, const char *msg)
+{
+	(void)arg;
+	if (level == RIST_LOG_ERROR) {
+		log_errors++;
+		fprintf(stderr, "%s", msg);
+	}
+	return 0;
+}
+
+static struct rist_ctx *setup_sender(const char *url, struct rist_logging_settings *logging_settings)
+{
+	struct rist_ctx *ctx = NULL;
+	if (rist_sender_create(&ctx, RIST_PROFILE_MAIN, 0, logging_settings) != 0)
+		return NULL;
+	const struct rist_peer_config *peer_config = NULL;
+	struct rist_peer *peer;
+	if (rist_parse_address2(url, (void *)&peer_config) || rist_peer_create(ctx, &peer, peer_config) == -1) {
+		rist_destroy(ctx);
+		return NULL;
+	}
+	free((void *)peer_config);
+	if (rist_start(ctx) == -1) {
+		rist_destroy(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+static struct rist_ctx *setup_receiver(const char *url, struct rist_logging_settings *logging_settings)
+{
+	struct rist_ctx *ctx = NULL;
+	if (rist_receiver_create(&ctx, RIST_PROFILE_MAIN, logging_settings) != 0)
+		return NULL;
+	const struct rist_peer_config *peer_config = NULL;
+	struct rist_peer *peer;
+	if (rist_parse_address2(url, (void *)&peer_config) || rist_peer_create(ctx, &peer, peer_config) == -1) {
+		rist_destroy(ctx);
+		return NULL;
+	}
+	free((void *)peer_config);
+	if (rist_start(ctx) == -1) {
+		rist_destroy(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+/* Writes every block the input hands out into the relay, as ristsender does */
+static void relay_step(struct rist_ctx *input, struct rist_ctx *relay, struct rist_ctx *output, int *relayed, int *received)
+{
+	struct rist_data_block *b = NULL;
+	while (rist_receiver_data_read2(input, &b, 0) > 0 && b) {
+		if (rist_sender_data_write(relay, b) == (int)b->payload_len)
+			(*relayed)++;
+		rist_receiver_data_block_free2(&b);
+	}
+	while (rist_receiver_data_read2(output, &b, 0) > 0 && b) {
+		(*received)++;
+		rist_receiver_data_block_free2(&b);
+	}
+}
+
+/* Blocks as a receiver hands them out: heap payload and receiver flags */
+static int write_receiver_flags(struct rist_ctx *relay)
+{
+	for (int flags = 1; flags <= RECEIVER_FLAGS; flags++) {
+		struct rist_data_block block;
+		memset(&block, 0, sizeof(block));
+		void *payload = malloc(PACKET_SIZE);
+		if (!payload)
+			return -1;
+		memset(payload, 0x47, PACKET_SIZE);
+		block.payload = payload;
+		block.payload_len = PACKET_SIZE;
+		block.flags = flags;
+		int ret = rist_sender_data_write(relay, &block);
+		free(payload);
+		if (ret != PACKET_SIZE) {
+			fprintf(stderr, "Write with receiver flags %d returned %d\n", flags, ret);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* A payload of another sender is copied and the caller still owns it */
+static int write_foreign_payload(struct rist_ctx *relay, struct rist_ctx *other)
+{
+	struct rist_data_block block;
+	memset(&block, 0, sizeof(block));
+	void *payload = rist_sender_payload_alloc(other, PACKET_SIZE);
+	if (!payload)
+		return -1;
+	memset(payload, 0x47, PACKET_SIZE);
+	block.payload = payload;
+	block.payload_len = PACKET_SIZE;
+	block.flags = RIST_DATA_FLAGS_HAND_OVER;
+	int ret = rist_sender_data_write(relay, &block);
+	rist_sender_payload_free(other, payload);
+	if (ret != PACKET_SIZE) {
+		fprintf(stderr, "Write of a foreign payload returned %d\n", ret);
+		return -1;
+	}
+	// the copy is reported, nothing else should have been
+	if (log_errors != 1) {
+		fprintf(stderr, "Expected one error for the foreign payload, got %d\n", log_errors);
+		return -1;
+	}
+	log_errors = 0;
+	return 0;
+}
+
+/* The regular hand over still works, single and batched */
+static int write_hand_over(struct rist_ctx *relay)
+{
+	struct rist_data_block blocks[4];
+	memset(blocks, 0, sizeof(blocks));
+	for (int i = 0; i < 4; i++) {
+		void *payload = rist_sender_payload_alloc(relay, PACKET_SIZE);
+		if (!payload)
+			return -1;
+		memset(payload, 0x47, PACKET_SIZE);
+		blocks[i].payload = payload;
+		blocks[i].payload_len = PACKET_SIZE;
+		blocks[i].flags = RIST_DATA_FLAGS_HAND_OVER | RECEIVER_FLAGS;
+	}
+	if (rist_sender_data_write(relay, &blocks[0]) != PACKET_SIZE)
+		return -1;
+	if (rist_sender_data_writev(relay, &blocks[1], 3) != 3 * PACKET_SIZE)
+		return -1;
+	return 0;
+}
+
+int main(void)
+{
+	struct rist_logging_settings *logging_settings = NULL;
+	if (rist_logging_set(&logging_settings, RIST_LOG_ERROR, log_cb, NULL, NULL, stderr) != 0)
+		return 99;
+
+	struct rist_ctx *output = setup_receiver("rist://@127.0.0.1:5011?rtt-max=10&rtt-min=1&buffer=50", logging_settings);
+	struct rist_ctx *relay = setup_sender("rist://127.0.0.1:5011?rtt-max=10&rtt-min=1&buffer=50", logging_settings);
+	struct rist_ctx *input = setup_receiver("rist://@127.0.0.1:5010?rtt-max=10&rtt-min=1&buffer=50", logging_settings);
+	struct rist_ctx *source = setup_sender("rist://127.0.0.1:5010?rtt-max=10&rtt-min=1&buffer=50", logging_settings);
+	if (!output || !relay || !input || !source) {
+		fprintf(stderr, "Could not set up the relay\n");
+		return 99;
+	}
+
+	int ret = 0;
+	uint8_t packet[PACKET_SIZE];
+	memset(packet, 0x47, sizeof(packet));
+	struct rist_data_block block;
+	memset(&block, 0, sizeof(block));
+	block.payload = packet;
+	block.payload_len = sizeof(packet);
+
+	int relayed = 0;
+	int received = 0;
+	for (int i = 0; i < PACKETS; i++) {
+		if (rist_sender_data_write(source, &block) != PACKET_SIZE) {
+			fprintf(stderr, "Source write failed\n");
+			ret = 1;
+			break;
+		}
+		relay_step(input, relay, output, &relayed, &received);
+		sleep_ms(1);
+	}
+	// Let the buffers of both hops drain
+	for (int i = 0; i < 500 && !ret; i++) {
+		relay_step(input, relay, output, &relayed, &received);
+		sleep_ms(1);
+	}
+
+	if (!ret && (write_receiver_flags(relay) || write_hand_over(relay) || write_foreign_payload(relay, source)))
+		ret = 1;
+
+	rist_destroy(source);
+	rist_destroy(input);
+	rist_destroy(relay);
+	rist_destroy(output);
+	rist_logging_settings_free2(&logging_settings);
+
+	fprintf(stdout, "Relayed %d blocks, %d arrived\n", relayed, received);
+	if (!relayed || !received) {
+		fprintf(stderr, "Nothing went through the relay\n");
+		ret = 1;
+	}
+	if (log_errors) {
+		fprintf(stderr, "%d unexpected errors logged\n", log_errors);
+		ret = 1;
+	}
+	return ret;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Constant rate sources whose clock drifts against ours, written by a producer
+ * that stalls and then catches up in bursts: the recovered timestamps must keep
+ * the source spacing, never be ahead of the write and survive clock wraps. */
+
+#include "source-clock.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MS (((uint64_t)1 << 32) / 1000)
+#define US_PER_TICK (1000.0 / (double)MS)
+#define SECONDS 60
+#define WARMUP_S 5
+#define DRIFT_PPM 30.0
+#define PCR_HZ 27000000
+#define PCR_WRAP (((uint64_t)1 << 33) * 300)
+#define PCR_PID 0x100
+/* 7 packets per datagram at 4 Mbps, 54 ticks of 27 MHz per byte */
+#define TS_PACKETS 7
+#define TS_DATAGRAM (TS_PACKETS * 188)
+#define TICKS_PER_BYTE 54
+
+static uint32_t rng = 0x2545F491;
+
+static uint32_t next_random(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+/* Write delay of the producer: mostly in time, about once a second stalled for
+ * up to 20 ms after which it catches up */
+static int64_t stall = 0;
+static uint64_t last_emitted = 0;
+
+static uint64_t write_time(uint64_t emitted, uint64_t last_write)
+{
+	int64_t elapsed = last_emitted && emitted > last_emitted ? (int64_t)(emitted - last_emitted) : 0;
+	last_emitted = emitted;
+	// drains 25 ms per second on average
+	stall += ((int64_t)(next_random() % 1000) - 600) * elapsed / 4000;
+	if (next_random() % 1000 < (uint32_t)(elapsed / (int64_t)MS))
+		stall += 15 * MS;
+	if (stall < 0)
+		stall = 0;
+	if (stall > (int64_t)(20 * MS))
+		stall = 20 * MS;
+	uint64_t now = emitted + (uint64_t)stall + next_random() % (MS / 10);
+	// a stalled producer catches up, writes never go back in time
+	return now < last_write ? last_write : now;
+}
+
+/* Our time at which the source emitted something at source_s seconds */
+static uint64_t emit_time(uint64_t start, double source_s)
+{
+	return start + (uint64_t)(source_s * (1.0 + DRIFT_PPM / 1e6) * (double)((uint64_t)1 << 32));
+}
+
+struct spread {
+	int64_t min;
+	int64_t max;
+	bool has;
+	unsigned ahead;
+	unsigned missing;
+};
+
+static void spread_add(struct spread *s, uint64_t ts, uint64_t emitted, uint64_t now, bool warm)
+{
+	if (!ts) {
+		s->missing++;
+		return;
+	}
+	if (ts > now)
+		s->ahead++;
+	if (!warm)
+		return;
+	int64_t error = (int64_t)(ts - emitted);
+	if (!s->has || error < s->min)
+		s->min = error;
+	if (!s->has || error > s->max)
+		s->max = error;
+	s->has = true;
+}
+
+static int spread_check(const char *name, const struct spread *s, unsigned expected_missing)
+{
+	double spread_us = (double)(s->max - s->min) * US_PER_TICK;
+	fprintf(stdout, "%s: timestamp spread %.1f us\n", name, spread_us);
+	int errors = 0;
+	if (!s->has || spread_us > 1000.0) {
+		fprintf(stderr, "%s: timestamps do not follow the source clock\n", name);
+		errors++;
+	}
+	if (s->ahead) {
+		fprintf(stderr, "%s: %u timestamps ahead of the write\n", name, s->ahead);
+		errors++;
+	}
+	if (s->missing != expected_missing) {
+		fprintf(stderr, "%s: %u datagrams without timestamp, expected %u\n", name, s->missing, expected_missing);
+		errors++;
+	}
+	return errors;
+}
+
+static void ts_packet(uint8_t *p, int pid, bool has_pcr, uint64_t pcr, bool discontinuity)
+{
+	memset(p, 0xff, 188);
+	p[0] = 0x47;
+	p[1] = (uint8_t)(pid >> 8);
+	p[2] = (uint8_t)pid;
+	if (!has_pcr) {
+		p[3] = 0x10;
+		return;
+	}
+	uint64_t base = pcr / 300;
+	uint64_t ext = pcr % 300;
+	p[3] = 0x30;
+	p[4] = 7;
+	p[5] = 0x10 | (discontinuity ? 0x80 : 0);
+	p[6] = (uint8_t)(base >> 25);
+	p[7] = (uint8_t)(base >> 17);
+	p[8] = (uint8_t)(base >> 9);
+	p[9] = (uint8_t)(base >> 1);
+	p[10] = (uint8_t)(((base & 1) << 7) | 0x7e | (ext >> 8));
+	p[11] = (uint8_t)ext;
+}
+
+static int run_mpegts(void)
+{
+	struct rist_source_clock_recovery c;
+	rist_source_clock_init(&c, PCR_HZ, PCR_WRAP, 250 * MS);
+	const uint64_t start = 1000000 * MS;
+	// wraps 10 s in
+	const uint64_t pcr_start = PCR_WRAP - 10ULL * PCR_HZ;
+	const uint64_t datagrams = (uint64_t)SECONDS * PCR_HZ / (TS_DATAGRAM * TICKS_PER_BYTE);
+	struct spread s = { 0 };
+	uint8_t datagram[TS_DATAGRAM];
+	uint64_t now = 0;
+	for (uint64_t k = 0; k < datagrams; k++) {
+		uint64_t first_byte = k * TS_DATAGRAM;
+		for (int i = 0; i < TS_PACKETS; i++) {
+			// pcr about every 40 ms, in the middle of a datagram
+			bool has_pcr = k % 15 == 0 && i == 3;
+			uint64_t pcr = (pcr_start + (first_byte + (uint64_t)i * 188) * TICKS_PER_BYTE) % PCR_WRAP;
+			ts_packet(&datagram[i * 188], i == 5 ? 0x200 : PCR_PID, has_pcr, pcr, false);
+		}
+		double source_s = (double)(first_byte * TICKS_PER_BYTE) / PCR_HZ;
+		uint64_t emitted = emit_time(start, source_s);
+		now = write_time(emitted, now);
+		uint64_t ts = rist_source_clock_mpegts(&c, datagram, sizeof(datagram), 1968, now);
+		spread_add(&s, ts, emitted, now, source_s > WARMUP_S);
+		// other streams of the sender are left alone
+		if (rist_source_clock_mpegts(&c, datagram, sizeof(datagram), 1970, now)) {
+			fprintf(stderr, "mpegts: second stream was timestamped\n");
+			return 1;
+		}
+	}
+	// no timestamps before the second pcr gives the byte rate
+	int errors = spread_check("mpegts", &s, 15);
+	double ppm = rist_clock_drift_ppm(&c.drift);
+	fprintf(stdout, "mpegts: drift estimated %+.2f ppm\n", ppm);
+	if (ppm < DRIFT_PPM - 2.0 || ppm > DRIFT_PPM + 2.0) {
+		fprintf(stderr, "mpegts: drift estimate off\n");
+		errors++;
+	}
+
+	// a flagged discontinuity starts over from that pcr
+	ts_packet(datagram, PCR_PID, true, 12345, true);
+	now += MS;
+	if (rist_source_clock_mpegts(&c, datagram, 188, 1968, now) || c.drift.valid) {
+		fprintf(stderr, "mpegts: discontinuity kept the old mapping\n");
+		errors++;
+	}
+	// not MPEG-TS
+	datagram[0] = 0;
+	if (rist_source_clock_mpegts(&c, datagram, 188, 1968, now)) {
+		fprintf(stderr, "mpegts: timestamped a non TS payload\n");
+		errors++;
+	}
+	return errors;
+}
+
+static int run_rtp(void)
+{
+	struct rist_source_clock_recovery c;
+	last_emitted = 0;
+	rist_source_clock_init(&c, 90000, (uint64_t)1 << 32, 250 * MS);
+	const uint64_t start = 5000000 * MS;
+	// wraps 5 s in
+	const uint32_t rtp_start = 0xffffffffu - 5 * 90000;
+	struct spread s = { 0 };
+	uint64_t now = 0;
+	// 25 frames per second, 4 packets per frame sharing the frame timestamp
+	for (uint32_t frame = 0; frame < SECONDS * 25; frame++) {
+		double source_s = (double)frame / 25.0;
+		uint64_t emitted = emit_time(start, source_s);
+		for (int i = 0; i < 4; i++) {
+			now = write_time(emitted, now);
+			uint64_t ts = rist_source_clock_map(&c, rtp_start + frame * 3600, now);
+			spread_add(&s, ts, emitted, now, source_s > WARMUP_S);
+		}
+	}
+	int errors = spread_check("rtp", &s, 0);
+
+	// a jump of the source clock is a new stream, not a 10 s stall
+	now += MS;
+	uint64_t ts = rist_source_clock_map(&c, rtp_start + SECONDS * 25 * 3600 + 10 * 90000, now);
+	if (ts != now || c.drift.valid) {
+		fprintf(stderr, "rtp: jump kept the old mapping\n");
+		errors++;
+	}
+	return errors;
+}
+
+int main(void)
+{
+	int errors = 0;
+	errors += run_mpegts();
+	errors += run_rtp();
+	return errors ? 1 : 0;
+}
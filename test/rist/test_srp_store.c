@@ -0,0 +1,129 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* Loads a password file into a verifier store, looks users up and checks the
+ * store picks up a rewritten file. */
+
+#include "librist/librist_srp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+static int errors = 0;
+
+static void write_file(const char *path, const char *contents)
+{
+	FILE *fh = fopen(path, "w");
+	if (!fh) {
+		fprintf(stderr, "Could not write %s\n", path);
+		exit(99);
+	}
+	fputs(contents, fh);
+	fclose(fh);
+}
+
+static void expect(struct rist_srp_verifier_store *store, const char *username, size_t exp_verifier_len, size_t exp_salt_len, unsigned char first_verifier_byte)
+{
+	char user[256];
+	strcpy(user, username);
+	size_t verifier_len = 0;
+	size_t salt_len = 0;
+	char *verifier = NULL;
+	char *salt = NULL;
+	bool std_ng = false;
+	char *n = NULL;
+	char *g = NULL;
+	rist_srp_verifier_store_lookup(user, &verifier_len, &verifier, &salt_len, &salt, &std_ng, &n, &g, store);
+	if (verifier_len != exp_verifier_len || salt_len != exp_salt_len ||
+		(exp_verifier_len && ((unsigned char)verifier[0] != first_verifier_byte || !std_ng))) {
+		fprintf(stderr, "lookup %s: got verifier %zu salt %zu, expected %zu %zu\n", username, verifier_len, salt_len, exp_verifier_len, exp_salt_len);
+		errors++;
+	}
+	if (verifier_len)
+		free(verifier);
+	if (salt_len)
+		free(salt);
+}
+
+/* The store reloads in the background, give it a few check intervals */
+static void wait_for_reload(struct rist_srp_verifier_store *store, const char *username, unsigned char first_verifier_byte)
+{
+	char user[256];
+	strcpy(user, username);
+	for (int i = 0; i < 50; i++) {
+		size_t verifier_len = 0;
+		size_t salt_len = 0;
+		char *verifier = NULL;
+		char *salt = NULL;
+		bool std_ng = false;
+		char *n = NULL;
+		char *g = NULL;
+		rist_srp_verifier_store_lookup(user, &verifier_len, &verifier, &salt_len, &salt, &std_ng, &n, &g, store);
+		bool reloaded = verifier_len && (unsigned char)verifier[0] == first_verifier_byte;
+		if (verifier_len)
+			free(verifier);
+		if (salt_len)
+			free(salt);
+		if (reloaded)
+			return;
+		sleep_ms(100);
+	}
+}
+
+int main(void)
+{
+	const char *path = "test_srp_store.passwd";
+	write_file(path,
+			   "alice:AQID:BAUG:3\n"
+			   "bob:CQo:BQ:3\n"
+			   "broken line\n"
+			   "alice:Bwg:CQ:3\n");
+	struct rist_srp_verifier_store *store = NULL;
+	if (rist_srp_verifier_store_create(&store, path) != 0) {
+		fprintf(stderr, "Could not create verifier store\n");
+		return 1;
+	}
+	expect(store, "alice", 3, 3, 0x01);
+	expect(store, "bob", 2, 1, 0x09);
+	expect(store, "carol", 0, 0, 0);
+	expect(store, "ali", 0, 0, 0);
+
+	write_file(path,
+			   "carol:DA0O:Dw:3\n"
+			   "bob:EBES:Ew:3\n");
+	wait_for_reload(store, "carol", 0x0c);
+	expect(store, "carol", 3, 1, 0x0c);
+	expect(store, "bob", 3, 1, 0x10);
+	expect(store, "alice", 0, 0, 0);
+
+	// A rotated verifier has the same size, usually within the same mtime second
+	write_file(path,
+			   "carol:FBUW:Dw:3\n"
+			   "bob:EBES:Ew:3\n");
+	wait_for_reload(store, "carol", 0x14);
+	expect(store, "carol", 3, 1, 0x14);
+
+	rist_srp_verifier_store_destroy(store);
+	remove(path);
+	if (rist_srp_verifier_store_create(&store, path) == 0) {
+		fprintf(stderr, "Store created from a missing file\n");
+		errors++;
+		rist_srp_verifier_store_destroy(store);
+	}
+	if (errors)
+		return 1;
+	fprintf(stdout, "OK\n");
+	return 0;
+}
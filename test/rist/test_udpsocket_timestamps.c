@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* A packet left waiting in the socket must come out with the time the kernel
+ * received it, not the time it was read. */
+
+#include "librist/udpsocket.h"
+#include "clock.h"
+#include <inttypes.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define sleep_ms(ms) Sleep(ms)
+#else
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+
+#define WAIT_MS 50
+
+int main(void)
+{
+	rist_clock_init();
+	int rx = udpsocket_open_bind("127.0.0.1", 0, NULL);
+	if (rx < 0)
+		return 99;
+	if (udpsocket_set_timestamping(rx, UDPSOCKET_TIMESTAMP_SOFTWARE) != UDPSOCKET_TIMESTAMP_SOFTWARE) {
+		fprintf(stderr, "No kernel receive timestamps on this platform\n");
+		udpsocket_close(rx);
+		return 77;
+	}
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	if (getsockname(rx, (struct sockaddr *)&addr, &addrlen) != 0)
+		return 99;
+	int tx = udpsocket_open_connect("127.0.0.1", ntohs(addr.sin_port), NULL);
+	if (tx < 0)
+		return 99;
+
+	int errors = 0;
+	char buf[64];
+	for (int i = 0; i < 3; i++) {
+		uint64_t sent = timestampNTP_u64();
+		if (udpsocket_send(tx, "timestamp", 9) != 9)
+			return 99;
+		sleep_ms(WAIT_MS);
+		uint64_t ts_ntp;
+		addrlen = sizeof(addr);
+		int ret = udpsocket_recvfrom_ts(rx, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &addrlen, &ts_ntp);
+		uint64_t read = timestampNTP_u64();
+		if (ret != 9 || !ts_ntp) {
+			fprintf(stderr, "Packet %d: ret %d without timestamp\n", i, ret);
+			errors++;
+			continue;
+		}
+		uint64_t queued_us = ts_ntp < read ? rist_clock_ntp_to_us(read - ts_ntp) : 0;
+		int64_t after_send_us = ts_ntp >= sent ? (int64_t)rist_clock_ntp_to_us(ts_ntp - sent) : -(int64_t)rist_clock_ntp_to_us(sent - ts_ntp);
+		fprintf(stdout, "Packet %d: stamped %" PRId64 " us after send, read %" PRIu64 " us later\n", i, after_send_us, queued_us);
+		// moving the stamp from the wall clock over picks up any slewing or small
+		// step of the wall clock while the packet waited
+		if (queued_us < (WAIT_MS - 5) * 1000 || after_send_us < -2000 || after_send_us > 5000) {
+			fprintf(stderr, "Packet %d: timestamp does not match its arrival\n", i);
+			errors++;
+		}
+	}
+	udpsocket_close(tx);
+	udpsocket_close(rx);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* A producer publishing in bursts to a consumer parked with a long timeout:
+ * every item must be picked up without the consumer sleeping through a notify,
+ * and items published while it runs must not signal. */
+
+#include "wakeup.h"
+#include "clock.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_us(us) Sleep((us) / 1000 + 1)
+#else
+#include <unistd.h>
+#define sleep_us(us) usleep(us)
+#endif
+
+#define ITEMS 20000
+#define BURST 64
+#define WAIT_MS 2000
+
+static struct rist_wakeup wakeup;
+static pthread_cond_t condition;
+static pthread_mutex_t mutex;
+static atomic_uint published;
+static unsigned consumed;
+static unsigned stalls;
+
+static PTHREAD_START_FUNC(consumer, arg)
+{
+	(void)arg;
+	while (consumed < ITEMS) {
+		unsigned seen = rist_wakeup_events(&wakeup);
+		unsigned available = atomic_load_explicit(&published, memory_order_acquire);
+		if (available != consumed) {
+			consumed = available;
+			continue;
+		}
+		uint64_t start = timestampNTP_u64();
+		pthread_mutex_lock(&mutex);
+		rist_wakeup_wait(&wakeup, &condition, &mutex, seen, WAIT_MS);
+		pthread_mutex_unlock(&mutex);
+		// only a lost notify lets the wait run into its timeout
+		if (rist_clock_ntp_to_us(timestampNTP_u64() - start) >= WAIT_MS * 1000 / 2)
+			stalls++;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	rist_clock_init();
+	rist_wakeup_init(&wakeup);
+	atomic_init(&published, 0);
+	if (pthread_cond_init(&condition, NULL) || pthread_mutex_init(&mutex, NULL))
+		return 99;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, consumer, NULL))
+		return 99;
+
+	unsigned signalled = 0;
+	unsigned coalesced = 0;
+	uint32_t rng = 0x12345678;
+	for (unsigned i = 0; i < ITEMS; i++) {
+		atomic_fetch_add_explicit(&published, 1, memory_order_release);
+		int ret = rist_wakeup_notify(&wakeup, &condition, &mutex);
+		if (ret < 0) {
+			fprintf(stderr, "Signalling failed\n");
+			return 1;
+		}
+		if (ret)
+			signalled++;
+		else
+			coalesced++;
+		// let the consumer drain and park between bursts, then race its park
+		// with short spins in the second half
+		if (i < ITEMS / 2 && i % BURST == BURST - 1)
+			sleep_us(200);
+		if (i >= ITEMS / 2) {
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			for (volatile unsigned spin = rng % 4096; spin; spin--)
+				;
+		}
+	}
+	pthread_join(thread, NULL);
+	pthread_cond_destroy(&condition);
+	pthread_mutex_destroy(&mutex);
+
+	fprintf(stdout, "%u items, %u signalled, %u coalesced, %u stalls\n", ITEMS, signalled, coalesced, stalls);
+	int errors = 0;
+	if (consumed != ITEMS) {
+		fprintf(stderr, "Consumed %u of %u items\n", consumed, ITEMS);
+		errors++;
+	}
+	if (stalls) {
+		fprintf(stderr, "Consumer slept through %u notifies\n", stalls);
+		errors++;
+	}
+	if (!signalled || !coalesced) {
+		fprintf(stderr, "Expected both signalled and coalesced notifies\n");
+		errors++;
+	}
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "metrics_http.h"
+#include "socket-shim.h"
+#include "pthread-shim.h"
+#include "time-shim.h"
+#include <librist/logging.h>
+#include <librist/stats.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+#ifdef _WIN32
+#define metrics_http_close(sd) closesocket(sd)
+#else
+#define metrics_http_close(sd) close(sd)
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define METRICS_HTTP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define METRICS_HTTP_SEND_FLAGS 0
+#endif
+
+#define METRICS_HTTP_MAX_CTX 64
+#define METRICS_HTTP_POLL_MS 200
+#define METRICS_HTTP_REQUEST_MAX 2048
+// whole request and response, one slow client must not stall the next scrape
+#define METRICS_HTTP_CONN_TIMEOUT_MS 250
+#define METRICS_HTTP_DEFAULT_ADDRESS "127.0.0.1"
+
+struct metrics_http {
+	int sd;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	bool stop;
+	struct rist_ctx *ctxs[METRICS_HTTP_MAX_CTX];
+	size_t count;
+	char *body;
+	size_t body_size;
+	struct rist_logging_settings *logging_settings;
+};
+
+static bool metrics_http_wait(int sd, int timeout_ms)
+{
+	fd_set set;
+	FD_ZERO(&set);
+	FD_SET(sd, &set);
+	struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+	return select(sd + 1, &set, NULL, NULL, &tv) > 0;
+}
+
+static int64_t metrics_http_now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void metrics_http_set_send_timeout(int sd, int timeout_ms)
+{
+#ifdef _WIN32
+	DWORD tv = (DWORD)timeout_ms;
+#else
+	struct timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+#endif
+	setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, (const char *)&tv, sizeof(tv));
+}
+
+static void metrics_http_send(int sd, const char *data, size_t len)
+{
+	while (len) {
+		int ret = (int)send(sd, data, (int)len, METRICS_HTTP_SEND_FLAGS);
+		if (ret <= 0)
+			return;
+		data += ret;
+		len -= (size_t)ret;
+	}
+}
+
+static int metrics_http_render(struct metrics_http *server)
+{
+	int len = rist_metrics_render(server->ctxs, server->count, server->body, server->body_size);
+	if (len >= 0 && (size_t)len >= server->body_size) {
+		size_t size = (size_t)len + 4096;
+		char *body = realloc(server->body, size);
+		if (!body)
+			return -1;
+		server->body = body;
+		server->body_size = size;
+		len = rist_metrics_render(server->ctxs, server->count, server->body, server->body_size);
+	}
+	return len >= 0 && (size_t)len < server->body_size ? len : -1;
+}
+
+static void metrics_http_serve(struct metrics_http *server, int sd)
+{
+	char request[METRICS_HTTP_REQUEST_MAX];
+	size_t len = 0;
+	int64_t deadline = metrics_http_now_ms() + METRICS_HTTP_CONN_TIMEOUT_MS;
+	metrics_http_set_send_timeout(sd, METRICS_HTTP_CONN_TIMEOUT_MS);
+	// the request line is all we look at, wait for the end of the headers
+	for (;;) {
+		int64_t left = deadline - metrics_http_now_ms();
+		if (len >= sizeof(request) - 1 || left <= 0 || !metrics_http_wait(sd, (int)left))
+			break;
+		int ret = (int)recv(sd, &request[len], (int)(sizeof(request) - 1 - len), 0);
+		if (ret <= 0)
+			break;
+		len += (size_t)ret;
+		request[len] = '\0';
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+	request[len] = '\0';
+
+	char header[256];
+	bool metrics = strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0 ||
+				   strncmp(request, "GET / ", 6) == 0;
+	if (!metrics) {
+		static const char not_found[] = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\nConnection: close\r\n\r\nNot found\n";
+		metrics_http_send(sd, not_found, sizeof(not_found) - 1);
+		return;
+	}
+	int body_len = metrics_http_render(server);
+	if (body_len < 0) {
+		static const char error[] = "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		metrics_http_send(sd, error, sizeof(error) - 1);
+		return;
+	}
+	int header_len = snprintf(header, sizeof(header),
+							  "HTTP/1.0 200 OK\r\n"
+							  "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+							  "Content-Length: %d\r\n"
+							  "Connection: close\r\n\r\n",
+							  body_len);
+	metrics_http_send(sd, header, (size_t)header_len);
+	metrics_http_send(sd, server->body, (size_t)body_len);
+}
+
+static PTHREAD_START_FUNC(metrics_http_loop, arg)
+{
+	struct metrics_http *server = arg;
+	for (;;) {
+		pthread_mutex_lock(&server->lock);
+		bool stop = server->stop;
+		pthread_mutex_unlock(&server->lock);
+		if (stop)
+			break;
+		if (!metrics_http_wait(server->sd, METRICS_HTTP_POLL_MS))
+			continue;
+		int sd = (int)accept(server->sd, NULL, NULL);
+		if (sd < 0)
+			continue;
+		metrics_http_serve(server, sd);
+		metrics_http_close(sd);
+	}
+	return 0;
+}
+
+/* Splits [IP:]PORT, IPv6 addresses go in brackets */
+static bool metrics_http_parse_address(const char *address, char *host, size_t host_size, char *port, size_t port_size)
+{
+	const char *host_start = address;
+	const char *host_end = NULL;
+	const char *port_start = address;
+	if (address[0] == '[') {
+		host_start = address + 1;
+		host_end = strchr(host_start, ']');
+		if (!host_end || host_end[1] != ':')
+			return false;
+		port_start = host_end + 2;
+	} else if ((host_end = strchr(address, ':')) != NULL) {
+		if (strchr(host_end + 1, ':'))
+			return false;
+		port_start = host_end + 1;
+	}
+	if (host_end) {
+		size_t host_len = (size_t)(host_end - host_start);
+		if (host_len == 0 || host_len >= host_size)
+			return false;
+		memcpy(host, host_start, host_len);
+		host[host_len] = '\0';
+	} else {
+		snprintf(host, host_size, "%s", METRICS_HTTP_DEFAULT_ADDRESS);
+	}
+	int port_num = atoi(port_start);
+	if (port_num <= 0 || port_num > UINT16_MAX)
+		return false;
+	snprintf(port, port_size, "%d", port_num);
+	return true;
+}
+
+struct metrics_http *metrics_http_start(const char *address, struct rist_ctx **ctxs, size_t count, struct rist_logging_settings *logging_settings)
+{
+	if (!count || count > METRICS_HTTP_MAX_CTX)
+		return NULL;
+	char host[64];
+	char port[8];
+	if (!metrics_http_parse_address(address, host, sizeof(host), port, sizeof(port))) {
+		rist_log(logging_settings, RIST_LOG_ERROR, "Invalid metrics address %s, expected [IP:]PORT\n", address);
+		return NULL;
+	}
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+	struct addrinfo *ai = NULL;
+	if (getaddrinfo(host, port, &hints, &ai) != 0 || !ai) {
+		rist_log(logging_settings, RIST_LOG_ERROR, "Invalid metrics address %s\n", host);
+		return NULL;
+	}
+	struct metrics_http *server = calloc(1, sizeof(*server));
+	if (!server) {
+		freeaddrinfo(ai);
+		return NULL;
+	}
+	memcpy(server->ctxs, ctxs, count * sizeof(*ctxs));
+	server->count = count;
+	server->logging_settings = logging_settings;
+	server->sd = (int)socket(ai->ai_family, SOCK_STREAM, 0);
+	if (server->sd < 0) {
+		rist_log(logging_settings, RIST_LOG_ERROR, "Could not create metrics socket\n");
+		freeaddrinfo(ai);
+		free(server);
+		return NULL;
+	}
+	int one = 1;
+	setsockopt(server->sd, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+	int ret = bind(server->sd, ai->ai_addr, (socklen_t)ai->ai_addrlen);
+	freeaddrinfo(ai);
+	if (ret != 0 || listen(server->sd, 8) != 0) {
+		rist_log(logging_settings, RIST_LOG_ERROR, "Could not listen for metrics on %s port %s\n", host, port);
+		metrics_http_close(server->sd);
+		free(server);
+		return NULL;
+	}
+	pthread_mutex_init(&server->lock, NULL);
+	if (pthread_create(&server->thread, NULL, metrics_http_loop, server) != 0) {
+		rist_log(logging_settings, RIST_LOG_ERROR, "Could not start metrics thread\n");
+		pthread_mutex_destroy(&server->lock);
+		metrics_http_close(server->sd);
+		free(server);
+		return NULL;
+	}
+	rist_log(logging_settings, RIST_LOG_INFO, "Serving OpenMetrics on %s port %s at /metrics\n", host, port);
+	return server;
+}
+
+void metrics_http_stop(struct metrics_http *server)
+{
+	if (!server)
+		return;
+	pthread_mutex_lock(&server->lock);
+	server->stop = true;
+	pthread_mutex_unlock(&server->lock);
+	pthread_join(server->thread, NULL);
+	pthread_mutex_destroy(&server->lock);
+	metrics_http_close(server->sd);
+	free(server->body);
+	free(server);
+}
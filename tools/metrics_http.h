@@ -0,0 +1,25 @@
+/*
+ * Copyright © 2026, VideoLAN and librist authors
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef RIST_TOOLS_METRICS_HTTP_H
+#define RIST_TOOLS_METRICS_HTTP_H
+
+#include <librist/librist.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Minimal HTTP/1.0 endpoint answering GET /metrics with rist_metrics_render()
+ * of the given contexts, one request per connection on its own thread.
+ * The address is [IP:]PORT, a bare port listens on 127.0.0.1 only.
+ */
+struct metrics_http;
+
+struct metrics_http *metrics_http_start(const char *address, struct rist_ctx **ctxs, size_t count, struct rist_logging_settings *logging_settings);
+void metrics_http_stop(struct metrics_http *server);
+
+#endif
@@ -13,7 +13,6 @@
 #include "config.h"
 #if HAVE_MBEDTLS
 #include "librist/librist_srp.h"
-#include "srp_shared.h"
 #endif
 #include "vcs_version.h"
 #include <stdio.h>
@@ -85,7 +84,7 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       --verbose-level 6         \n";
 
 #if HAVE_MBEDTLS
-	FILE *srpfile = NULL;
+	struct rist_srp_verifier_store *srp_store = NULL;
 #endif
 
 static void usage(char *cmd)
@@ -160,7 +159,7 @@ static struct rist_ctx* setup_rist_sender(struct rist_sender_args *setup) {
 	}
 
 	if (setup->statsinterval) {
-		rist_stats_callback_set(ctx, setup->statsinterval, cb_stats, NULL);
+		rist_stats_callback_set2(ctx, setup->statsinterval, RIST_STATS_FORMAT_JSON_REUSED, cb_stats, NULL);
 	}
 
 	// Applications defaults and/or command line options
@@ -216,11 +215,11 @@ static struct rist_ctx* setup_rist_sender(struct rist_sender_args *setup) {
 		if (srp_error)
 			rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP for peer\n", srp_error);
 	}
-	if (srpfile)
+	if (srp_store)
 	{
-		srp_error = rist_enable_eap_srp(peer, NULL, NULL, user_verifier_lookup, srpfile);
+		srp_error = rist_enable_eap_srp(peer, NULL, NULL, rist_srp_verifier_store_lookup, srp_store);
 		if (srp_error)
-			rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator, file %s\n", srp_error, srpfile);
+			rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator\n", srp_error);
 	}
 #endif
 
@@ -333,8 +332,7 @@ int main (int argc, char **argv) {
 		break;
 #if HAVE_MBEDTLS
 		case 'F':
-			srpfile = fopen(optarg, "r");
-			if (!srpfile) {
+			if (rist_srp_verifier_store_create(&srp_store, optarg) != 0) {
 				rist_log(&logging_settings, RIST_LOG_ERROR, "Could not open srp file %s\n", optarg);
 				exitcode = 1;
 				goto out;
@@ -411,7 +409,7 @@ usage:
 	}
 
 	if (statsinterval) {
-		rist_stats_callback_set(receiver_ctx, statsinterval, cb_stats, NULL);
+		rist_stats_callback_set2(receiver_ctx, statsinterval, RIST_STATS_FORMAT_JSON_REUSED, cb_stats, NULL);
 	}
 
 	// URL overrides (also cleans up the URL)
@@ -469,6 +467,9 @@ usage:
 	rist_destroy(receiver_ctx);
 	rist_destroy(cb_arg.sender_ctx);
 out:
+#if HAVE_MBEDTLS
+	rist_srp_verifier_store_destroy(srp_store);
+#endif
 	rist_logging_unset_global();
 	if (client_args.shared_secret)
 		free(client_args.shared_secret);
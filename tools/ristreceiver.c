@@ -12,7 +12,6 @@
 #include "config.h"
 #if HAVE_MBEDTLS
 #include "librist/librist_srp.h"
-#include "srp_shared.h"
 #endif
 #include "vcs_version.h"
 #include <errno.h>
@@ -28,6 +27,7 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include "oob_shared.h"
+#include "metrics_http.h"
 #ifdef USE_TUN
 #include "rist-private.h"
 #include <sys/ioctl.h>
@@ -68,6 +68,11 @@ static struct option long_options[] = {
 { "stats",           required_argument, NULL, 'S' },
 { "verbose-level",   required_argument, NULL, 'v' },
 { "remote-logging",  required_argument, NULL, 'r' },
+{ "metrics-port",    required_argument, NULL, 'M' },
+{ "timestamps",      required_argument, NULL, 'T' },
+{ "pcr-pacing",      required_argument, NULL, 'P' },
+{ "adaptive-latency", no_argument,      NULL, 'A' },
+{ "fast-start",      required_argument, NULL, 'f' },
 #if HAVE_MBEDTLS
 { "srpfile",         required_argument, NULL, 'F' },
 #endif
@@ -90,6 +95,16 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       -S | --statsinterval value (ms)           | Interval at which stats get printed, 0 to disable        |\n"
 "       -v | --verbose-level value                | To disable logging: -1, log levels match syslog levels   |\n"
 "       -r | --remote-logging IP:PORT             | Send logs and stats to this IP:PORT using udp messages   |\n"
+"       -M | --metrics-port [IP:]PORT             | Serve stats as OpenMetrics on http://IP:PORT/metrics     |\n"
+"                                                 | IP defaults to 127.0.0.1                                 |\n"
+"       -T | --timestamps mode                    | Kernel receive timestamps (0 = off, 1 = software,        |\n"
+"                                                 | 2 = hardware where the NIC supports it)                  |\n"
+"       -P | --pcr-pacing ms                      | Release MPEG-TS output following its PCRs, within this   |\n"
+"                                                 | output jitter (0 = default of 2 ms)                      |\n"
+"       -A | --adaptive-latency                   | Adapt the buffer to late packets and recovery times,     |\n"
+"                                                 | between the buffer-min and buffer-max of the input URLs  |\n"
+"       -f | --fast-start ms                      | Start output after this buffer when the sender bursts    |\n"
+"                                                 | its history, growing to the full buffer afterwards       |\n"
 #if HAVE_MBEDTLS
 "       -F | --srpfile filepath                   | When in listening mode, use this file to hold the list   |\n"
 "                                                 | of usernames and passwords to validate against. Use the  |\n"
@@ -466,6 +481,12 @@ int main(int argc, char *argv[])
 	enum rist_log_level loglevel = RIST_LOG_INFO;
 	int statsinterval = 1000;
 	char *remote_log_address = NULL;
+	char *metrics_address = NULL;
+	int timestamps = UDPSOCKET_TIMESTAMP_NONE;
+	int pcr_pacing_ms = -1;
+	bool adaptive_latency = false;
+	int fast_start_ms = 0;
+	struct metrics_http *metrics_server = NULL;
 	if (pthread_mutex_init(&signal_lock, NULL) != 0)
 	{
 		fprintf(stderr, "Could not initialize signal lock\n");
@@ -477,7 +498,7 @@ int main(int argc, char *argv[])
 #endif
 
 #if HAVE_MBEDTLS
-	FILE *srpfile = NULL;
+	struct rist_srp_verifier_store *srp_store = NULL;
 #endif
 
 	for (size_t i = 0; i < MAX_OUTPUT_COUNT; i++)
@@ -505,7 +526,7 @@ int main(int argc, char *argv[])
 
 	rist_log(&logging_settings, RIST_LOG_INFO, "Starting ristreceiver version: %s libRIST library: %s API version: %s\n", LIBRIST_VERSION, librist_version(), librist_api_version());
 
-	while ((c = getopt_long(argc, argv, "r:i:o:b:s:e:t:m:p:S:v:F:h:u", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "r:i:o:b:s:e:t:m:p:S:v:F:M:T:P:Af:h:u", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'i':
 			inputurl = strdup(optarg);
@@ -542,10 +563,24 @@ int main(int argc, char *argv[])
 		case 'r':
 			remote_log_address = strdup(optarg);
 		break;
+		case 'M':
+			metrics_address = strdup(optarg);
+		break;
+		case 'T':
+			timestamps = atoi(optarg);
+		break;
+		case 'P':
+			pcr_pacing_ms = atoi(optarg);
+		break;
+		case 'A':
+			adaptive_latency = true;
+		break;
+		case 'f':
+			fast_start_ms = atoi(optarg);
+		break;
 #if HAVE_MBEDTLS
 		case 'F':
-			srpfile = fopen(optarg, "r");
-			if (!srpfile) {
+			if (rist_srp_verifier_store_create(&srp_store, optarg) != 0) {
 				rist_log(&logging_settings, RIST_LOG_ERROR, "Could not open srp file %s\n", optarg);
 				return 1;
 			}
@@ -587,6 +622,30 @@ int main(int argc, char *argv[])
 
 	callback_object.receiver_ctx = ctx;
 
+	if (timestamps != UDPSOCKET_TIMESTAMP_NONE &&
+		rist_set_opt(ctx, RIST_OPT_RECEIVE_TIMESTAMPS, &timestamps, NULL, NULL) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Invalid timestamps mode %d\n", timestamps);
+		exit(1);
+	}
+
+	if (pcr_pacing_ms >= 0 &&
+		rist_receiver_output_pacing_set(ctx, RIST_OUTPUT_PACING_MPEGTS_PCR, (uint32_t)pcr_pacing_ms) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable PCR output pacing\n");
+		exit(1);
+	}
+
+	if (adaptive_latency &&
+		rist_receiver_latency_mode_set(ctx, RIST_LATENCY_ADAPTIVE) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable adaptive latency\n");
+		exit(1);
+	}
+
+	if (fast_start_ms > 0 &&
+		rist_receiver_fast_start_set(ctx, (uint32_t)fast_start_ms) != 0) {
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable fast start\n");
+		exit(1);
+	}
+
 	if (rist_auth_handler_set(ctx, cb_auth_connect, cb_auth_disconnect, (void *)&callback_object) != 0) {
 
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not init rist auth handler\n");
@@ -605,7 +664,7 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	if (rist_stats_callback_set(ctx, statsinterval, cb_stats, NULL) == -1) {
+	if (rist_stats_callback_set2(ctx, statsinterval, RIST_STATS_FORMAT_JSON_REUSED, cb_stats, NULL) == -1) {
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable stats callback\n");
 		exit(1);
 	}
@@ -673,11 +732,11 @@ int main(int argc, char *argv[])
 				if (srp_error)
 					rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP for peer\n", srp_error);
 			}
-			if (srpfile)
+			if (srp_store)
 			{
-				srp_error = rist_enable_eap_srp(peer, NULL, NULL, user_verifier_lookup, srpfile);
+				srp_error = rist_enable_eap_srp(peer, NULL, NULL, rist_srp_verifier_store_lookup, srp_store);
 				if (srp_error)
-					rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator, file %s\n", srp_error, srpfile);
+					rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator\n", srp_error);
 			}
 		}
 		else
@@ -781,6 +840,8 @@ next:
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not start rist receiver\n");
 		exit(1);
 	}
+	if (metrics_address)
+		metrics_server = metrics_http_start(metrics_address, &ctx, 1, &logging_settings);
 	/* Start the rist protocol thread */
 	if (data_read_mode == DATA_READ_MODE_CALLBACK) {
 #ifdef _WIN32
@@ -875,6 +936,8 @@ next:
 	}
 #endif
 	fprintf(stderr, "DESTROY\n");
+	metrics_http_stop(metrics_server);
+	free(metrics_address);
 	rist_destroy(ctx);
 
 	for (size_t i = 0; i < MAX_OUTPUT_COUNT; i++) {
@@ -883,6 +946,9 @@ next:
 			rist_udp_config_free2(&callback_object.udp_config[i]);
 	}
 
+#if HAVE_MBEDTLS
+	rist_srp_verifier_store_destroy(srp_store);
+#endif
 	rist_logging_unset_global();
 	if (inputurl)
 		free(inputurl);
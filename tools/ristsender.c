@@ -11,7 +11,6 @@
 #include "config.h"
 #if HAVE_MBEDTLS
 #include "librist/librist_srp.h"
-#include "srp_shared.h"
 #endif
 #include "vcs_version.h"
 #include <errno.h>
@@ -27,6 +26,7 @@
 #include "rist-private.h"
 #include <stdatomic.h>
 #include "oob_shared.h"
+#include "metrics_http.h"
 #ifdef USE_TUN
 #include <sys/ioctl.h>
 #include <linux/if_tun.h>
@@ -54,6 +54,7 @@ struct rist_callback_object {
 	struct rist_ctx *receiver_ctx;
 	struct rist_ctx *sender_ctx;
 	struct rist_udp_config *udp_config;
+	bool timestamps;
 	uint8_t recv[RIST_MAX_PACKET_SIZE + 100];
 };
 
@@ -82,6 +83,8 @@ struct rist_sender_args {
 	int buffer_size;
 	int statsinterval;
 	uint16_t stream_id;
+	bool pcr_clock;
+	int burst_ms;
 #ifdef USE_TUN
 	struct rist_callback_tun_object *callback_tun_object;
 #endif
@@ -102,10 +105,14 @@ static struct option long_options[] = {
 { "stats",           required_argument, NULL, 'S' },
 { "verbose-level",   required_argument, NULL, 'v' },
 { "remote-logging",  required_argument, NULL, 'r' },
+{ "metrics-port",    required_argument, NULL, 'M' },
+{ "timestamps",      required_argument, NULL, 'T' },
+{ "pcr-clock",       no_argument,       NULL, 'c' },
 #if HAVE_MBEDTLS
 { "srpfile",         required_argument, NULL, 'F' },
 #endif
 { "fast-start",      required_argument, NULL, 'f' },
+{ "burst",           required_argument, NULL, 'B' },
 { "help",            no_argument,       NULL, 'h' },
 { "help-url",        no_argument,       NULL, 'u' },
 { 0, 0, 0, 0 },
@@ -126,6 +133,11 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 "       -S | --statsinterval value (ms)           | Interval at which stats get printed, 0 to disable        |\n"
 "       -v | --verbose-level value                | To disable logging: -1, log levels match syslog levels   |\n"
 "       -r | --remote-logging IP:PORT             | Send logs and stats to this IP:PORT using udp messages   |\n"
+"       -M | --metrics-port [IP:]PORT             | Serve stats as OpenMetrics on http://IP:PORT/metrics     |\n"
+"                                                 | IP defaults to 127.0.0.1                                 |\n"
+"       -T | --timestamps mode                    | Kernel receive timestamps (0 = off, 1 = software,        |\n"
+"                                                 | 2 = hardware where the NIC supports it)                  |\n"
+"       -c | --pcr-clock                          | Timestamp MPEG-TS inputs from their PCR                  |\n"
 #if HAVE_MBEDTLS
 "       -F | --srpfile filepath                   | When in listening mode, use this file to hold the list   |\n"
 "                                                 | of usernames and passwords to validate against. Use the  |\n"
@@ -142,6 +154,8 @@ const char help_str[] = "Usage: %s [OPTIONS] \nWhere OPTIONS are:\n"
 //"                                                 | -1 = hold data out and igmp source joins                 |\n"
 "                                                 |  0 = hold data out                                       |\n"
 "                                                 |  1 = start to send data immediately                      |\n"
+"       -B | --burst ms                           | Send this much history to receivers connecting to a      |\n"
+"                                                 | listening output, at twice real time, for a fast start   |\n"
 "       -h | --help                               | Show this help                                           |\n"
 "       -u | --help-url                           | Show all the possible url options                        |\n"
 "   * == mandatory value \n"
@@ -162,7 +176,7 @@ static uint64_t risttools_convertRTPtoNTP(uint32_t i_rtp)
 */
 
 #if HAVE_MBEDTLS
-	FILE *srpfile = NULL;
+	struct rist_srp_verifier_store *srp_store = NULL;
 #endif
 
 static void input_udp_recv(struct evsocket_ctx *evctx, int fd, short revents, void *arg)
@@ -182,31 +196,34 @@ static void input_udp_recv(struct evsocket_ctx *evctx, int fd, short revents, vo
 	size_t ipheader_bytes = sizeof(ipv4hdr) + sizeof(udphdr);
 	socklen_t addrlen = 0;
 
+	uint64_t ts_ntp = 0;
+
 	uint16_t address_family = (uint16_t)callback_object->udp_config->address_family;
 	if (address_family == AF_INET6) {
 		addrlen = sizeof(struct sockaddr_in6);
-		recv_bufsize = udpsocket_recvfrom(callback_object->sd, recv_buf + ipheader_bytes, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *) &addr6, &addrlen);
 		addr = (struct sockaddr *) &addr6;
 	} else {
 		addrlen = sizeof(struct sockaddr_in);
-		recv_bufsize = udpsocket_recvfrom(callback_object->sd, recv_buf + ipheader_bytes, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, (struct sockaddr *) &addr4, &addrlen);
 		addr = (struct sockaddr *) &addr4;
 	}
+	if (callback_object->timestamps)
+		recv_bufsize = udpsocket_recvfrom_ts(callback_object->sd, recv_buf + ipheader_bytes, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, addr, &addrlen, &ts_ntp);
+	else
+		recv_bufsize = udpsocket_recvfrom(callback_object->sd, recv_buf + ipheader_bytes, RIST_MAX_PACKET_SIZE, MSG_DONTWAIT, addr, &addrlen);
 
 	if (recv_bufsize > 0) {
 		ssize_t offset = 0;
 		struct rist_data_block data_block = { 0 };
-		// Delegate ts_ntp to the library by default.
-		// If we wanted to be more accurate, we could use the kernel nic capture timestamp (linux)
-		data_block.ts_ntp = 0;
+		// Kernel capture time when input timestamps are enabled, otherwise 0
+		// delegates ts_ntp to the library
+		data_block.ts_ntp = ts_ntp;
 		data_block.flags = 0;
 		if (callback_object->udp_config->rtp_timestamp && recv_bufsize > 12)
 		{
-			// Extract timestamp from rtp header
-			//uint32_t rtp_time = (recv_buf[4] << 24) | (recv_buf[5] << 16) | (recv_buf[6] << 8) | recv_buf[7];
-			// Convert to NTP (assumes 90Khz)
-			//data_block.ts_ntp = risttools_convertRTPtoNTP(rtp_time);
-			// TODO: Figure out why this does not work (commenting out for now)
+			// Extract timestamp from rtp header, the library maps it to our clock
+			const uint8_t *rtp = recv_buf + ipheader_bytes;
+			uint32_t rtp_time = ((uint32_t)rtp[4] << 24) | (rtp[5] << 16) | (rtp[6] << 8) | rtp[7];
+			data_block.ts_ntp = rist_sender_source_clock_ts(callback_object->sender_ctx, rtp_time);
 		}
 		if (callback_object->udp_config->rtp_sequence && recv_bufsize > 12)
 		{
@@ -377,7 +394,7 @@ static void intHandler(int signal)
 
 static struct rist_peer* setup_rist_peer(struct rist_ctx *ctx, struct rist_sender_args *setup)
 {
-	if (rist_stats_callback_set(ctx, setup->statsinterval, cb_stats, NULL) == -1) {
+	if (rist_stats_callback_set2(ctx, setup->statsinterval, RIST_STATS_FORMAT_JSON_REUSED, cb_stats, NULL) == -1) {
 
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable stats callback\n");
 		return NULL;
@@ -404,7 +421,7 @@ static struct rist_peer* setup_rist_peer(struct rist_ctx *ctx, struct rist_sende
 		}
 	}
 
-	if (rist_stats_callback_set(ctx, setup->statsinterval, cb_stats, NULL) == -1) {
+	if (rist_stats_callback_set2(ctx, setup->statsinterval, RIST_STATS_FORMAT_JSON_REUSED, cb_stats, NULL) == -1) {
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not enable stats callback\n");
 		return NULL;
 	}
@@ -463,11 +480,11 @@ static struct rist_peer* setup_rist_peer(struct rist_ctx *ctx, struct rist_sende
 			if (srp_error)
 				rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP for peer\n", srp_error);
 		}
-		if (srpfile)
+		if (srp_store)
 		{
-			srp_error = rist_enable_eap_srp(peer, NULL, NULL, user_verifier_lookup, srpfile);
+			srp_error = rist_enable_eap_srp(peer, NULL, NULL, rist_srp_verifier_store_lookup, srp_store);
 			if (srp_error)
-				rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator, file %s\n", srp_error, srpfile);
+				rist_log(&logging_settings, RIST_LOG_WARN, "Error %d trying to enable SRP global authenticator\n", srp_error);
 		}
 	}
 	else
@@ -587,6 +604,16 @@ static struct rist_ctx *configure_rist_output_context(char* outputurl,
 		rist_log(&logging_settings, RIST_LOG_ERROR, "Could not create rist sender context\n");
 		goto fail;
 	}
+	if (udp_config->rtp_timestamp) {
+		if (rist_sender_source_clock_set(sender_ctx, RIST_SOURCE_CLOCK_RTP, 0) != 0)
+			rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable rtp source clock recovery\n");
+	} else if (peer_args->pcr_clock) {
+		if (rist_sender_source_clock_set(sender_ctx, RIST_SOURCE_CLOCK_MPEGTS_PCR, 0) != 0)
+			rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable pcr source clock recovery\n");
+	}
+	if (peer_args->burst_ms > 0 &&
+		rist_sender_fast_start_set(sender_ctx, (uint32_t)peer_args->burst_ms) != 0)
+		rist_log(&logging_settings, RIST_LOG_ERROR, "Failed to enable fast start bursts\n");
 	if (npd) {
 		if (profile == RIST_PROFILE_SIMPLE)
 			rist_log(&logging_settings, RIST_LOG_INFO, "NULL packet deletion enabled on SIMPLE profile. This is non-compliant but might work if receiver supports it (librist does)\n");
@@ -633,8 +660,11 @@ int main(int argc, char *argv[])
 	enum rist_log_level loglevel = RIST_LOG_INFO;
 	bool npd = false;
 	int faststart = 0;
-	struct rist_sender_args peer_args;
+	struct rist_sender_args peer_args = { 0 };
 	char *remote_log_address = NULL;
+	char *metrics_address = NULL;
+	int timestamps = UDPSOCKET_TIMESTAMP_NONE;
+	struct metrics_http *metrics_server = NULL;
 	bool thread_started[MAX_INPUT_COUNT +1] = {false};
 #ifdef USE_TUN
 	pthread_t thread_main_loop[MAX_INPUT_COUNT+2] = { 0 };
@@ -666,7 +696,7 @@ int main(int argc, char *argv[])
 
 	rist_log(&logging_settings, RIST_LOG_INFO, "Starting ristsender version: %s libRIST library: %s API version: %s\n", LIBRIST_VERSION, librist_version(), librist_api_version());
 
-	while ((c = getopt_long(argc, argv, "r:i:o:b:s:e:t:m:p:S:F:f:v:hun", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "r:i:o:b:s:e:t:m:p:S:F:f:B:v:M:T:chun", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'i':
 			inputurl = strdup(optarg);
@@ -703,10 +733,18 @@ int main(int argc, char *argv[])
 		case 'r':
 			remote_log_address = strdup(optarg);
 		break;
+		case 'M':
+			metrics_address = strdup(optarg);
+		break;
+		case 'T':
+			timestamps = atoi(optarg);
+		break;
+		case 'c':
+			peer_args.pcr_clock = true;
+		break;
 #if HAVE_MBEDTLS
 		case 'F':
-			srpfile = fopen(optarg, "r");
-			if (!srpfile) {
+			if (rist_srp_verifier_store_create(&srp_store, optarg) != 0) {
 				rist_log(&logging_settings, RIST_LOG_ERROR, "Could not open srp file %s\n", optarg);
 				return 1;
 			}
@@ -719,6 +757,9 @@ int main(int argc, char *argv[])
 		case 'f':
 			faststart = atoi(optarg);
 			break;
+		case 'B':
+			peer_args.burst_ms = atoi(optarg);
+			break;
 		case 'n':
 			npd = true;
 			break;
@@ -738,6 +779,16 @@ int main(int argc, char *argv[])
 		usage(argv[0]);
 	}
 
+	if (timestamps < UDPSOCKET_TIMESTAMP_NONE || timestamps > UDPSOCKET_TIMESTAMP_HARDWARE) {
+		fprintf(stderr,"Invalid timestamps mode %d\n", timestamps);
+		exit(1);
+	}
+
+	if (peer_args.pcr_clock && timestamps != UDPSOCKET_TIMESTAMP_NONE) {
+		rist_log(&logging_settings, RIST_LOG_WARN, "PCR clock recovery replaces kernel input timestamps\n");
+		timestamps = UDPSOCKET_TIMESTAMP_NONE;
+	}
+
 	if (faststart < 0 || faststart > 1) {
 		fprintf(stderr,"Invalid or not implemented fast-start mode %d\n", faststart);
 		exit(1);
@@ -880,6 +931,12 @@ int main(int argc, char *argv[])
 			} else {
 				udpsocket_set_nonblocking(callback_object[i].sd);
 				rist_log(&logging_settings, RIST_LOG_INFO, "Input socket is open and bound %s:%d\n", (char *) hostname, inputport);
+				if (timestamps != UDPSOCKET_TIMESTAMP_NONE) {
+					int enabled = udpsocket_set_timestamping(callback_object[i].sd, timestamps);
+					if (enabled < 0)
+						rist_log(&logging_settings, RIST_LOG_WARN, "Kernel receive timestamps unavailable on input %s:%d\n", (char *) hostname, inputport);
+					callback_object[i].timestamps = enabled > UDPSOCKET_TIMESTAMP_NONE;
+				}
 				atleast_one_socket_opened = true;
 			}
 			callback_object[i].udp_config = udp_config;
@@ -928,6 +985,20 @@ next:
 		thread_started[i+1] = true;
 	}
 
+	if (metrics_address) {
+		// inputs may share one sender context when the output listens
+		struct rist_ctx *metrics_ctxs[MAX_INPUT_COUNT * 2];
+		size_t metrics_ctx_count = 0;
+		for (size_t i = 0; i < MAX_INPUT_COUNT; i++) {
+			if (callback_object[i].sender_ctx && (i == 0 || callback_object[i].sender_ctx != callback_object[0].sender_ctx))
+				metrics_ctxs[metrics_ctx_count++] = callback_object[i].sender_ctx;
+			if (callback_object[i].receiver_ctx)
+				metrics_ctxs[metrics_ctx_count++] = callback_object[i].receiver_ctx;
+		}
+		if (metrics_ctx_count)
+			metrics_server = metrics_http_start(metrics_address, metrics_ctxs, metrics_ctx_count, &logging_settings);
+	}
+
 #ifdef USE_TUN
 	if (callback_tun_object.tun && pthread_create(&thread_main_loop[MAX_INPUT_COUNT + 1], NULL, tun_loop, (void *)&callback_tun_object) != 0)
 	{
@@ -943,6 +1014,8 @@ next:
 #endif
 
 shutdown:
+	metrics_http_stop(metrics_server);
+	free(metrics_address);
 	if (udp_config) {
 		rist_udp_config_free2(&udp_config);
 	}
@@ -966,6 +1039,9 @@ shutdown:
 			pthread_join(thread_main_loop[i], NULL);
 	}
 
+#if HAVE_MBEDTLS
+	rist_srp_verifier_store_destroy(srp_store);
+#endif
 	rist_logging_unset_global();
 	if (inputurl)
 		free(inputurl);